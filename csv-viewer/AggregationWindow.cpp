@@ -0,0 +1,102 @@
+#include "AggregationWindow.h"
+#include "FastItemDelegate.h"
+#include "TableModel.h"
+#include <QHeaderView>
+#include <QLabel>
+#include <QProgressBar>
+#include <QScrollBar>
+#include <QTableView>
+#include <QVBoxLayout>
+
+AggregationWindow::AggregationWindow(const QString &title, const AggregateSource &source,
+                                     const AggregateOptions &options, QWidget *parent)
+    : QDialog(parent)
+    , m_aggregator(new Aggregator(this))
+    , m_tableModel(new TableModel(this))
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(title);
+    resize(800, 500);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    m_statusLabel = new QLabel(tr("正在汇总 ..."), this);
+    layout->addWidget(m_statusLabel);
+    m_progressBar = new QProgressBar(this);
+    m_progressBar->setRange(0, 1000);
+    layout->addWidget(m_progressBar);
+
+    // 结果表格与主窗口的表格使用相同的渲染设置
+    m_view = new QTableView(this);
+    m_view->setModel(m_tableModel);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_view->setItemDelegate(new FastItemDelegate(m_view));
+    m_view->setWordWrap(false);
+    m_view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_view->verticalHeader()->setDefaultSectionSize(m_view->fontMetrics().height() + 6);
+    m_view->setVisible(false);
+    layout->addWidget(m_view);
+
+    connect(m_view->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int) {
+        loadRowsForViewport();
+    });
+    // 窗口大小变化时视口覆盖的行随之变化
+    connect(m_view->verticalScrollBar(), &QScrollBar::rangeChanged, this, [this](int, int) {
+        loadRowsForViewport();
+    });
+    connect(m_tableModel, &TableModel::pageEvicted, this, [this](int) {
+        loadRowsForViewport();
+    });
+
+    connect(m_aggregator, &Aggregator::progress, this, [this](qint64 done, qint64 total) {
+        m_progressBar->setValue(total > 0 ? static_cast<int>(done * 1000 / total) : 0);
+    });
+    connect(m_aggregator, &Aggregator::finished, this, &AggregationWindow::onFinished);
+
+    m_aggregator->start(source, options);
+}
+
+AggregationWindow::~AggregationWindow()
+{
+    m_aggregator->cancel();
+}
+
+void AggregationWindow::onFinished(bool success, const AggregateResult &result, const QString &error)
+{
+    m_progressBar->setVisible(false);
+    if (!success) {
+        m_statusLabel->setText(tr("汇总失败: %1").arg(error));
+        return;
+    }
+
+    m_rows = result.rows;
+    m_statusLabel->setText(tr("%1 行数据汇总为 %2 组").arg(result.inputRows).arg(m_rows.size()));
+    m_tableModel->setHeaders(result.headers);
+    m_tableModel->setTotalRowCount(m_rows.size());
+    m_view->setVisible(true);
+    loadRowsForViewport();
+    m_view->resizeColumnsToContents();
+}
+
+void AggregationWindow::loadRowsForViewport()
+{
+    if (m_rows.isEmpty()) {
+        return;
+    }
+
+    const int firstRow = qMax(m_view->rowAt(0), 0);
+    int lastRow = m_view->rowAt(m_view->viewport()->height() - 1);
+    if (lastRow < 0) {
+        lastRow = qMin(firstRow + TableModel::PAGE_SIZE, int(m_rows.size())) - 1;
+    }
+
+    // 告诉模型当前视口，内存预算淘汰时优先淘汰离视口最远的页，而不是刚加载的可见页
+    m_tableModel->setViewport(firstRow, lastRow);
+
+    // 结果行已在内存中，页与结果共享行数据，不会复制文本
+    for (int page = firstRow / TableModel::PAGE_SIZE; page <= lastRow / TableModel::PAGE_SIZE; ++page) {
+        if (!m_tableModel->isPageLoaded(page)) {
+            m_tableModel->setPage(page, m_rows.mid(page * TableModel::PAGE_SIZE, TableModel::PAGE_SIZE));
+        }
+    }
+}
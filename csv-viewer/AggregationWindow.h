@@ -0,0 +1,40 @@
+#ifndef AGGREGATIONWINDOW_H
+#define AGGREGATIONWINDOW_H
+
+#include <QDialog>
+#include <QList>
+#include <QStringList>
+
+#include "Aggregator.h"
+
+class QLabel;
+class QProgressBar;
+class QTableView;
+class TableModel;
+
+// 分组汇总结果窗口
+// 非模态，在后台聚合完成后以分页模型显示结果，关闭窗口时取消尚未完成的聚合
+class AggregationWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    AggregationWindow(const QString &title, const AggregateSource &source, const AggregateOptions &options,
+                      QWidget *parent = nullptr);
+    ~AggregationWindow();
+
+private:
+    void onFinished(bool success, const AggregateResult &result, const QString &error);
+
+    // 把视口中尚未加载的结果页交给模型
+    void loadRowsForViewport();
+
+    Aggregator *m_aggregator;
+    TableModel *m_tableModel;
+    QTableView *m_view;
+    QLabel *m_statusLabel;
+    QProgressBar *m_progressBar;
+    QList<QStringList> m_rows; // 全部结果行
+};
+
+#endif // AGGREGATIONWINDOW_H
@@ -0,0 +1,420 @@
+#include "Aggregator.h"
+#include "BackgroundTask.h"
+#include "ColumnarFile.h"
+#include "CompositeKey.h"
+#include "RecordParser.h"
+#include "RecordScanner.h"
+#include <QAtomicInteger>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QLocale>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// 一个聚合值的累加状态
+struct MeasureState {
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    qint64 values = 0;   // 数值个数
+    qint64 nonEmpty = 0; // 非空值个数
+
+    void merge(const MeasureState &other)
+    {
+        sum += other.sum;
+        min = qMin(min, other.min);
+        max = qMax(max, other.max);
+        values += other.values;
+        nonEmpty += other.nonEmpty;
+    }
+};
+
+// 一个分组的累加状态
+struct GroupState {
+    qint64 rows = 0;
+    QVector<MeasureState> measures;
+};
+
+// 分组键为各分组值组成的CompositeKey
+using GroupTable = QHash<QByteArray, GroupState>;
+
+using FieldSlice = RecordParser::FieldSlice;
+
+// 聚合计划：需要读取的列以及它们在字段槽中的位置
+struct AggregatePlan {
+    QVector<int> slotOfColumn;  // 原始列 -> 字段槽，不需要的列为-1
+    QVector<int> groupSlots;    // 各分组列的字段槽
+    QVector<int> measureSlots;  // 各聚合值的字段槽
+    int slotCount = 0;
+};
+
+AggregatePlan makePlan(const AggregateOptions &options)
+{
+    AggregatePlan plan;
+    auto slotFor = [&plan](int column) {
+        if (column >= plan.slotOfColumn.size()) {
+            plan.slotOfColumn.resize(column + 1, -1);
+        }
+        if (plan.slotOfColumn[column] < 0) {
+            plan.slotOfColumn[column] = plan.slotCount++;
+        }
+        return plan.slotOfColumn[column];
+    };
+    for (int column : options.groupColumns) {
+        plan.groupSlots.append(slotFor(column));
+    }
+    for (const AggregateOptions::Measure &measure : options.measures) {
+        plan.measureSlots.append(slotFor(measure.column));
+    }
+    return plan;
+}
+
+// 累加一个值
+void accumulate(MeasureState &state, const QByteArray &text)
+{
+    const QByteArray value = text.trimmed();
+    if (value.isEmpty()) {
+        return;
+    }
+    ++state.nonEmpty;
+    bool ok = false;
+    const double number = value.toDouble(&ok);
+    if (ok) {
+        state.sum += number;
+        state.min = qMin(state.min, number);
+        state.max = qMax(state.max, number);
+        ++state.values;
+    }
+}
+
+void accumulate(MeasureState &state, double number)
+{
+    ++state.nonEmpty;
+    state.sum += number;
+    state.min = qMin(state.min, number);
+    state.max = qMax(state.max, number);
+    ++state.values;
+}
+
+// 查找或创建分组
+GroupState &groupFor(GroupTable &table, const QByteArray &key, int measureCount)
+{
+    auto it = table.find(key);
+    if (it == table.end()) {
+        GroupState state;
+        state.measures.resize(measureCount);
+        it = table.insert(key, state);
+    }
+    return it.value();
+}
+
+// 聚合一块CSV数据：只切分出需要的字段，其余字段只跳过不转换
+// 记录边界与RecordScanner一致，字段不足的记录缺少的字段按空值处理；返回处理的记录数
+qint64 aggregateCsvChunk(const char *data, qint64 length, const CsvFormat &format, bool utf8, const AggregatePlan &plan,
+                         int measureCount, GroupTable &table)
+{
+    const char quoteChar = format.quoteChar;
+    const char *end = data + length;
+    const char *p = data;
+
+    QVarLengthArray<FieldSlice, 16> slices(plan.slotCount);
+    QByteArray key;
+    QByteArray buffer;
+    qint64 records = 0;
+
+    while (p < end) {
+        p = RecordParser::sliceRecord(p, end, format, utf8, plan.slotOfColumn, slices.data(), plan.slotCount);
+
+        key.clear();
+        for (int slot : plan.groupSlots) {
+            CompositeKey::append(key, RecordParser::fieldValue(slices[slot], quoteChar, buffer));
+        }
+        GroupState &group = groupFor(table, key, measureCount);
+        ++group.rows;
+        for (int i = 0; i < measureCount; ++i) {
+            accumulate(group.measures[i], RecordParser::fieldValue(slices[plan.measureSlots[i]], quoteChar, buffer));
+        }
+        ++records;
+    }
+    return records;
+}
+
+// 聚合列式文件的一个行组：数值列直接读取，不做任何文本转换
+qint64 aggregateRowGroup(const ColumnarFile &file, const ColumnarFile::RowGroupInfo &group,
+                         const AggregateOptions &options, GroupTable &table)
+{
+    const int measureCount = options.measures.size();
+    QByteArray key;
+    for (qint64 row = 0; row < group.rows; ++row) {
+        key.clear();
+        for (int column : options.groupColumns) {
+            CompositeKey::append(key, file.rawValue(group, column, row));
+        }
+        GroupState &state = groupFor(table, key, measureCount);
+        ++state.rows;
+        for (int i = 0; i < measureCount; ++i) {
+            double number = 0.0;
+            if (file.numericValue(group, options.measures[i].column, row, &number)) {
+                accumulate(state.measures[i], number);
+            } else {
+                accumulate(state.measures[i], file.rawValue(group, options.measures[i].column, row));
+            }
+        }
+    }
+    return group.rows;
+}
+
+// 把other合并到table
+void mergeTable(GroupTable &table, const GroupTable &other)
+{
+    for (auto it = other.constBegin(); it != other.constEnd(); ++it) {
+        auto target = table.find(it.key());
+        if (target == table.end()) {
+            table.insert(it.key(), it.value());
+            continue;
+        }
+        target->rows += it->rows;
+        for (int i = 0; i < target->measures.size(); ++i) {
+            target->measures[i].merge(it->measures.at(i));
+        }
+    }
+}
+
+// 数值显示：整数不带小数和指数
+QString formatNumber(double value)
+{
+    // 先检查范围：超出qint64范围（以及无穷大和NaN）的值转换为整数是未定义行为
+    if (qAbs(value) < 1e15 && value == static_cast<double>(static_cast<qint64>(value))) {
+        return QString::number(static_cast<qint64>(value));
+    }
+    return QString::number(value, 'g', QLocale::FloatingPointShortest);
+}
+
+QString formatMeasure(const MeasureState &state, AggregateOptions::Function function)
+{
+    if (function == AggregateOptions::Count) {
+        return QString::number(state.nonEmpty);
+    }
+    if (state.values == 0) {
+        return QString();
+    }
+    switch (function) {
+    case AggregateOptions::Sum:
+        return formatNumber(state.sum);
+    case AggregateOptions::Min:
+        return formatNumber(state.min);
+    case AggregateOptions::Max:
+        return formatNumber(state.max);
+    case AggregateOptions::Avg:
+        return formatNumber(state.sum / state.values);
+    default:
+        return QString();
+    }
+}
+
+} // namespace
+
+QString AggregateOptions::functionName(Function function)
+{
+    switch (function) {
+    case Count:
+        return "count";
+    case Sum:
+        return "sum";
+    case Min:
+        return "min";
+    case Max:
+        return "max";
+    case Avg:
+        return "avg";
+    }
+    return QString();
+}
+
+AggregationThread::AggregationThread(const AggregateSource &source, const AggregateOptions &options, QObject *parent)
+    : QThread(parent)
+    , m_source(source)
+    , m_options(options)
+{
+}
+
+AggregateResult AggregationThread::result() const
+{
+    return m_result;
+}
+
+void AggregationThread::run()
+{
+    QElapsedTimer aggregateTimer;
+    aggregateTimer.start();
+
+    QFile sourceFile(m_source.filePath);
+    if (!sourceFile.open(QIODevice::ReadOnly)) {
+        emit aggregated(false, QString("Failed to open file: %1, error: %2").arg(m_source.filePath).arg(sourceFile.errorString()));
+        return;
+    }
+    const qint64 size = sourceFile.size();
+    const char *data = reinterpret_cast<const char *>(sourceFile.map(0, size));
+    if (!data) {
+        emit aggregated(false, QString("Failed to map file: %1, error: %2").arg(m_source.filePath).arg(sourceFile.errorString()));
+        return;
+    }
+
+    // 数据块：CSV为记录对齐的字节范围，列式文件为行组
+    ColumnarFile columnarFile;
+    QVector<ColumnarFile::RowGroupInfo> rowGroups;
+    QVector<qint64> bounds;
+    if (m_source.columnar) {
+        QString error;
+        if (!columnarFile.open(data, size, &error)) {
+            emit aggregated(false, QString("Failed to open columnar file: %1, error: %2").arg(m_source.filePath).arg(error));
+            return;
+        }
+        rowGroups = columnarFile.rowGroups();
+    } else {
+        bounds = RecordScanner::chunkBounds(data, size, m_source.dataStart, CHUNK_SIZE, m_source.parse.dialect.quoteChar);
+    }
+    const int chunkCount = m_source.columnar ? rowGroups.size() : bounds.size() - 1;
+    const qint64 total = m_source.columnar ? columnarFile.rowCount() : size - m_source.dataStart;
+
+    const AggregatePlan plan = makePlan(m_options);
+    const int measureCount = m_options.measures.size();
+
+    // 每个工作任务一张哈希表，循环领取下一块数据，直到全部处理完或被取消
+    const int workerCount = BackgroundTask::workerCount(chunkCount);
+    QVector<GroupTable> tables(workerCount);
+    QVector<qint64> records(workerCount, 0);
+    QAtomicInteger<qint64> done(0);
+    QAtomicInteger<int> tooManyGroups(0);
+
+    BackgroundTask::forEachChunk(chunkCount, [&](int chunk, int worker) {
+        if (isInterruptionRequested() || tooManyGroups.loadRelaxed()) {
+            return false;
+        }
+        GroupTable &table = tables[worker];
+        if (m_source.columnar) {
+            records[worker] += aggregateRowGroup(columnarFile, rowGroups.at(chunk), m_options, table);
+            done.fetchAndAddRelaxed(rowGroups.at(chunk).rows);
+        } else {
+            records[worker] += aggregateCsvChunk(data + bounds[chunk], bounds[chunk + 1] - bounds[chunk],
+                                                 m_source.parse.dialect, m_source.parse.encoding == CsvReader::UTF8,
+                                                 plan, measureCount, table);
+            done.fetchAndAddRelaxed(bounds[chunk + 1] - bounds[chunk]);
+        }
+        if (table.size() > MAX_GROUPS) {
+            tooManyGroups.storeRelaxed(1);
+        }
+        return true;
+    }, [&]() {
+        emit progress(done.loadRelaxed(), total);
+    });
+
+    if (isInterruptionRequested()) {
+        emit aggregated(false, "Aggregation cancelled");
+        return;
+    }
+    if (tooManyGroups.loadRelaxed()) {
+        emit aggregated(false, QString("Too many groups (more than %1), choose fewer or coarser group columns").arg(MAX_GROUPS));
+        return;
+    }
+
+    // 合并各工作任务的哈希表
+    QElapsedTimer mergeTimer;
+    mergeTimer.start();
+    GroupTable &merged = tables[0];
+    for (int worker = 1; worker < workerCount; ++worker) {
+        mergeTable(merged, tables.at(worker));
+        tables[worker].clear();
+    }
+    qint64 inputRows = 0;
+    for (qint64 count : records) {
+        inputRows += count;
+    }
+    const qint64 mergeTime = mergeTimer.elapsed();
+
+    // 生成结果，按分组值排序
+    const bool utf8 = m_source.columnar || m_source.parse.encoding == CsvReader::UTF8;
+    m_result = AggregateResult();
+    m_result.inputRows = inputRows;
+    for (int column : m_options.groupColumns) {
+        m_result.headers.append(m_source.headers.value(column));
+    }
+    m_result.headers.append("行数");
+    for (const AggregateOptions::Measure &measure : m_options.measures) {
+        m_result.headers.append(QString("%1(%2)").arg(AggregateOptions::functionName(measure.function),
+                                                      m_source.headers.value(measure.column)));
+    }
+
+    m_result.rows.reserve(merged.size());
+    for (auto it = merged.constBegin(); it != merged.constEnd(); ++it) {
+        QStringList row;
+        for (const QByteArray &part : CompositeKey::split(it.key())) {
+            row.append(utf8 ? QString::fromUtf8(part) : QString::fromLocal8Bit(part));
+        }
+        row.append(QString::number(it->rows));
+        for (int i = 0; i < measureCount; ++i) {
+            row.append(formatMeasure(it->measures.at(i), m_options.measures.at(i).function));
+        }
+        m_result.rows.append(row);
+    }
+    std::sort(m_result.rows.begin(), m_result.rows.end());
+
+    qDebug() << "Aggregated" << inputRows << "rows into" << m_result.rows.size() << "groups with" << workerCount
+             << "workers in" << aggregateTimer.elapsed() << "ms (merge" << mergeTime << "ms)";
+    emit progress(total, total);
+    emit aggregated(true, QString());
+}
+
+Aggregator::Aggregator(QObject *parent)
+    : QObject(parent)
+{
+}
+
+Aggregator::~Aggregator()
+{
+    cancel();
+}
+
+void Aggregator::start(const AggregateSource &source, const AggregateOptions &options)
+{
+    cancel();
+
+    m_thread = new AggregationThread(source, options, this);
+    connect(m_thread, &AggregationThread::progress, this, &Aggregator::onProgress);
+    connect(m_thread, &AggregationThread::aggregated, this, &Aggregator::onAggregated);
+    m_thread->start();
+}
+
+void Aggregator::cancel()
+{
+    BackgroundTask::stopThread(m_thread);
+}
+
+bool Aggregator::isRunning() const
+{
+    return m_thread && m_thread->isRunning();
+}
+
+void Aggregator::onProgress(qint64 done, qint64 total)
+{
+    // 忽略已取消的旧聚合遗留的信号
+    if (sender() != m_thread) {
+        return;
+    }
+
+    emit progress(done, total);
+}
+
+void Aggregator::onAggregated(bool success, const QString &error)
+{
+    if (sender() != m_thread) {
+        return;
+    }
+
+    emit finished(success, success ? m_thread->result() : AggregateResult(), error);
+}
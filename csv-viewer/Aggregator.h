@@ -0,0 +1,110 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+
+#include "CsvReader.h"
+
+// 聚合的数据来源：独立于CsvReader，聚合过程中关闭标签页也不受影响
+struct AggregateSource {
+    QString filePath;
+    qint64 dataStart = 0;            // 数据区起始偏移（CSV文件）
+    CsvReader::ParseSettings parse;  // 源文件的编码和方言（CSV文件）
+    QStringList headers;
+    bool columnar = false;           // 列式文件直接读取类型化的列，不做文本解析
+};
+
+// 聚合选项：按若干列分组，对若干列计算聚合值
+struct AggregateOptions {
+    enum Function {
+        Count, // 非空值个数
+        Sum,
+        Min,
+        Max,
+        Avg
+    };
+
+    struct Measure {
+        int column = 0;
+        Function function = Count;
+    };
+
+    QVector<int> groupColumns;
+    QVector<Measure> measures;
+
+    // 聚合函数的显示名称
+    static QString functionName(Function function);
+};
+
+// 聚合结果：分组列、行数和各聚合值，按分组值排序
+struct AggregateResult {
+    QStringList headers;
+    QList<QStringList> rows;
+    qint64 inputRows = 0; // 参与聚合的数据行数
+};
+
+// 聚合线程
+// 把数据切分为若干块（CSV按字节、列式文件按行组），共享线程池中每个工作任务
+// 循环领取数据块，累加到各自的哈希表中，全部完成后由本线程合并；
+// 工作任务之间没有任何共享的可变状态
+class AggregationThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    AggregationThread(const AggregateSource &source, const AggregateOptions &options, QObject *parent = nullptr);
+
+    // 聚合成功后的结果（aggregated信号发出后有效）
+    AggregateResult result() const;
+
+    static constexpr qint64 CHUNK_SIZE = 8 * 1024 * 1024; // 每块CSV数据的大小
+    static constexpr int MAX_GROUPS = 5 * 1000 * 1000;     // 分组数上限，超出时中止
+
+signals:
+    void progress(qint64 done, qint64 total);
+    void aggregated(bool success, const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    AggregateSource m_source;
+    AggregateOptions m_options;
+    AggregateResult m_result;
+};
+
+// 聚合器：在后台对整个文件做分组聚合
+class Aggregator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Aggregator(QObject *parent = nullptr);
+    ~Aggregator();
+
+    // 开始聚合，之前的聚合会被取消
+    void start(const AggregateSource &source, const AggregateOptions &options);
+
+    // 取消聚合
+    void cancel();
+
+    bool isRunning() const;
+
+signals:
+    void progress(qint64 done, qint64 total);
+    void finished(bool success, const AggregateResult &result, const QString &error);
+
+private slots:
+    void onProgress(qint64 done, qint64 total);
+    void onAggregated(bool success, const QString &error);
+
+private:
+    AggregationThread *m_thread = nullptr;
+};
+
+#endif // AGGREGATOR_H
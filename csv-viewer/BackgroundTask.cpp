@@ -0,0 +1,122 @@
+#include "BackgroundTask.h"
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+Q_GLOBAL_STATIC(QThreadPool, sharedWorkerPool)
+Q_GLOBAL_STATIC(QThreadPool, sharedScanPool)
+
+static const int SCAN_THREAD_COUNT = 2; // 同时进行的整文件扫描数
+
+BackgroundTask::BackgroundTask(QObject *parent)
+    : QObject(parent)
+{
+    setAutoDelete(false);
+}
+
+QThreadPool *BackgroundTask::pool()
+{
+    QThreadPool *workerPool = sharedWorkerPool();
+    static const bool initialized = [workerPool]() {
+        workerPool->setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+        return true;
+    }();
+    Q_UNUSED(initialized);
+    return workerPool;
+}
+
+QThreadPool *BackgroundTask::scanPool()
+{
+    QThreadPool *scan = sharedScanPool();
+    static const bool initialized = [scan]() {
+        scan->setMaxThreadCount(SCAN_THREAD_COUNT);
+        return true;
+    }();
+    Q_UNUSED(initialized);
+    return scan;
+}
+
+int BackgroundTask::workerCount(int chunkCount)
+{
+    return qMax(1, qMin(pool()->maxThreadCount(), chunkCount));
+}
+
+void BackgroundTask::forEachChunk(int chunkCount, const std::function<bool(int chunk, int worker)> &fn,
+                                  const std::function<void()> &progress)
+{
+    const int PROGRESS_INTERVAL_MS = 200;
+
+    const int workers = workerCount(chunkCount);
+    QAtomicInteger<int> nextChunk(0);
+    QMutex mutex;
+    QWaitCondition finished;
+    int running = workers;
+
+    // 优先于普通后台任务执行，调用方正在等待结果
+    for (int worker = 0; worker < workers; ++worker) {
+        pool()->start([&, worker]() {
+            for (int chunk = nextChunk.fetchAndAddRelaxed(1); chunk < chunkCount; chunk = nextChunk.fetchAndAddRelaxed(1)) {
+                if (!fn(chunk, worker)) {
+                    break;
+                }
+            }
+            QMutexLocker locker(&mutex);
+            --running;
+            finished.wakeAll();
+        }, 1);
+    }
+
+    QMutexLocker locker(&mutex);
+    while (running > 0) {
+        finished.wait(&mutex, PROGRESS_INTERVAL_MS);
+        if (progress) {
+            progress();
+        }
+    }
+}
+
+void BackgroundTask::setThreadPool(QThreadPool *pool)
+{
+    Q_ASSERT(!m_submitted);
+    m_pool = pool;
+}
+
+void BackgroundTask::start(int priority)
+{
+    cancel();
+    m_cancelled.storeRelaxed(0);
+    m_submitted = true;
+    (m_pool ? m_pool : pool())->start(this, priority);
+}
+
+void BackgroundTask::cancel()
+{
+    if (!m_submitted) {
+        return;
+    }
+
+    m_cancelled.storeRelaxed(1);
+
+    // 还在队列中没有开始执行，直接移除
+    if ((m_pool ? m_pool : pool())->tryTake(this)) {
+        m_finished.release();
+    }
+
+    m_finished.acquire();
+    m_submitted = false;
+}
+
+bool BackgroundTask::isCancelled() const
+{
+    return m_cancelled.loadRelaxed() != 0;
+}
+
+void BackgroundTask::run()
+{
+    if (!isCancelled()) {
+        execute();
+    }
+    m_finished.release();
+}
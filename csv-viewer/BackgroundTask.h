@@ -0,0 +1,80 @@
+#ifndef BACKGROUNDTASK_H
+#define BACKGROUNDTASK_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QThread>
+#include <functional>
+
+class QThreadPool;
+
+// 后台任务基类
+// 所有打开的文件共用一个线程池执行列宽测量、预读等后台任务，
+// 线程数与CPU核数一致，不会随打开文件的数量增长
+// 整文件的行计数扫描一次要占用线程很久，放在单独的扫描线程池中执行，
+// 同时打开多个大文件时不会占满共享线程池、饿死其他后台任务
+//
+// 任务对象由发起方持有（不自动删除），删除前必须先调用cancel()等待任务结束
+class BackgroundTask : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    explicit BackgroundTask(QObject *parent = nullptr);
+
+    // 指定执行任务的线程池，默认为共享线程池；必须在start()之前设置
+    void setThreadPool(QThreadPool *pool);
+
+    // 提交到线程池，priority越大越先执行
+    void start(int priority = 0);
+
+    // 请求取消并等待任务结束；任务尚未开始执行时直接从队列中移除
+    void cancel();
+
+    // 任务是否已被请求取消，execute()中应定期检查
+    bool isCancelled() const;
+
+    // 共享线程池
+    static QThreadPool *pool();
+
+    // 整文件扫描（行计数）使用的线程池，线程数固定，超出的扫描排队等待
+    static QThreadPool *scanPool();
+
+    // 处理chunkCount块数据使用的工作任务数，不超过线程池的线程数和块数
+    static int workerCount(int chunkCount);
+
+    // 在共享线程池中并行处理[0, chunkCount)的各块，阻塞到全部结束
+    // workerCount(chunkCount)个工作任务循环领取下一块，fn(chunk, worker)处理一块，
+    // worker为工作任务序号，用于访问各工作任务自己的累积结果；fn返回false时该工作任务不再领取
+    // progress在调用线程中每隔200毫秒调用一次（可为空）；调用线程不能是共享线程池中的线程
+    static void forEachChunk(int chunkCount, const std::function<bool(int chunk, int worker)> &fn,
+                             const std::function<void()> &progress = std::function<void()>());
+
+    // 请求中断QThread驱动的后台任务，等待其结束后删除，thread置为nullptr
+    template <typename Thread>
+    static void stopThread(Thread *&thread)
+    {
+        if (thread) {
+            thread->requestInterruption();
+            thread->wait();
+            delete thread;
+            thread = nullptr;
+        }
+    }
+
+protected:
+    // 在工作线程中执行的任务内容
+    virtual void execute() = 0;
+
+private:
+    void run() override;
+
+    QThreadPool *m_pool = nullptr; // 为空时使用共享线程池
+    QAtomicInt m_cancelled;
+    QSemaphore m_finished; // 任务结束（或被移出队列）时释放
+    bool m_submitted = false; // 已提交且尚未通过cancel()回收
+};
+
+#endif // BACKGROUNDTASK_H
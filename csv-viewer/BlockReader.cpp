@@ -0,0 +1,429 @@
+#include "BlockReader.h"
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtGlobal>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+#ifdef CSV_VIEWER_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+// 读取只等待磁盘，不占用CPU；扫描任务本身运行在共享线程池中并等待读取完成，
+// 读取任务如果也提交到共享线程池，线程都被等待中的扫描任务占满时会互相阻塞
+static const int IO_THREAD_COUNT = 16;
+
+Q_GLOBAL_STATIC(QThreadPool, ioThreadPool)
+
+static QThreadPool *ioPool()
+{
+    QThreadPool *pool = ioThreadPool();
+    static const bool initialized = [pool]() {
+        pool->setMaxThreadCount(IO_THREAD_COUNT);
+        return true;
+    }();
+    Q_UNUSED(initialized);
+    return pool;
+}
+
+// 线程池后端：每个读取请求在I/O线程中用pread读完整块
+class PreadBackend : public BlockReader::Backend
+{
+public:
+    explicit PreadBackend(QFile *file)
+        : m_fd(file->handle())
+        , m_filePath(file->fileName())
+    {
+    }
+
+    ~PreadBackend() override
+    {
+        drain();
+    }
+
+    void submit(BlockReader::Slot *slot) override
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            slot->pending = true;
+            ++m_inFlight;
+        }
+        char *target = slot->buffer.data();
+        const qint64 offset = slot->offset;
+        const qint64 size = slot->size;
+        ioPool()->start([this, slot, target, offset, size]() {
+            QString error;
+            const qint64 bytesRead = readFully(target, offset, size, &error);
+            QMutexLocker locker(&m_mutex);
+            slot->bytesRead = bytesRead;
+            slot->error = error;
+            slot->pending = false;
+            --m_inFlight;
+            m_finished.wakeAll();
+        });
+    }
+
+    void wait(BlockReader::Slot *slot) override
+    {
+        QMutexLocker locker(&m_mutex);
+        while (slot->pending) {
+            m_finished.wait(&m_mutex);
+        }
+    }
+
+    void drain() override
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_inFlight > 0) {
+            m_finished.wait(&m_mutex);
+        }
+    }
+
+private:
+    // 读取[offset, offset + size)，返回实际读入的字节数（文件变短时较少）
+    qint64 readFully(char *target, qint64 offset, qint64 size, QString *error) const
+    {
+        qint64 done = 0;
+#ifdef Q_OS_UNIX
+        while (done < size) {
+            const ssize_t n = pread(m_fd, target + done, static_cast<size_t>(size - done), offset + done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                *error = QString::fromLocal8Bit(strerror(errno));
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            done += n;
+        }
+#else
+        // 没有pread的平台上每个请求使用独立的文件句柄，读取之间互不影响
+        QFile file(m_filePath);
+        if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) {
+            *error = file.errorString();
+            return 0;
+        }
+        while (done < size) {
+            const qint64 n = file.read(target + done, size - done);
+            if (n < 0) {
+                *error = file.errorString();
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            done += n;
+        }
+#endif
+        return done;
+    }
+
+    int m_fd;
+    QString m_filePath;
+    QMutex m_mutex;
+    QWaitCondition m_finished;
+    int m_inFlight = 0;
+};
+
+#ifdef CSV_VIEWER_HAVE_LIBURING
+// io_uring后端：所有读取请求一次提交给内核，由调用线程收取完成事件，不需要额外的线程
+class IoUringBackend : public BlockReader::Backend
+{
+public:
+    explicit IoUringBackend(int fd)
+        : m_fd(fd)
+    {
+    }
+
+    ~IoUringBackend() override
+    {
+        if (m_initialized) {
+            drain();
+            io_uring_queue_exit(&m_ring);
+        }
+    }
+
+    // 内核不支持io_uring或IORING_OP_READ（5.6之前）时返回false
+    bool init()
+    {
+        if (io_uring_queue_init(BlockReader::QUEUE_DEPTH, &m_ring, 0) < 0) {
+            return false;
+        }
+        m_initialized = true;
+        io_uring_probe *probe = io_uring_get_probe_ring(&m_ring);
+        const bool supported = probe && io_uring_opcode_supported(probe, IORING_OP_READ);
+        if (probe) {
+            io_uring_free_probe(probe);
+        }
+        return supported;
+    }
+
+    void submit(BlockReader::Slot *slot) override
+    {
+        slot->pending = true;
+        ++m_inFlight;
+        queueRead(slot);
+    }
+
+    void wait(BlockReader::Slot *slot) override
+    {
+        while (slot->pending) {
+            reap();
+        }
+    }
+
+    void drain() override
+    {
+        while (m_inFlight > 0) {
+            reap();
+        }
+    }
+
+    bool isBroken() const override
+    {
+        return m_broken;
+    }
+
+private:
+    // 提交slot剩余部分的读取；同时在途的请求不超过队列深度，总能取得提交项
+    void queueRead(BlockReader::Slot *slot)
+    {
+        m_pendingSlots.insert(slot);
+        io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+        if (!sqe) {
+            fail(QStringLiteral("io_uring submission queue is full"));
+            return;
+        }
+        io_uring_prep_read(sqe, m_fd, slot->buffer.data() + slot->bytesRead,
+                           static_cast<unsigned>(slot->size - slot->bytesRead), slot->offset + slot->bytesRead);
+        io_uring_sqe_set_data(sqe, slot);
+        const int ret = io_uring_submit(&m_ring);
+        if (ret < 0) {
+            fail(QString("io_uring submit failed: %1").arg(QString::fromLocal8Bit(strerror(-ret))));
+        }
+    }
+
+    void finish(BlockReader::Slot *slot)
+    {
+        slot->pending = false;
+        m_pendingSlots.remove(slot);
+        --m_inFlight;
+    }
+
+    // 环无法继续使用：所有在途的读取标记为失败，wait()和drain()不再等待完成事件
+    // 内核可能仍在写入这些缓冲区，把它们转交给后端持有，缓冲区槽位之后重新分配
+    void fail(const QString &error)
+    {
+        qDebug() << "io_uring backend failed:" << error;
+        m_broken = true;
+        for (BlockReader::Slot *slot : std::as_const(m_pendingSlots)) {
+            m_abandonedBuffers.append(slot->buffer);
+            slot->buffer = QByteArray();
+            slot->error = error;
+            slot->pending = false;
+        }
+        m_pendingSlots.clear();
+        m_inFlight = 0;
+    }
+
+    // 收取一个完成事件，读取不完整时继续提交剩余部分
+    void reap()
+    {
+        if (m_broken) {
+            return;
+        }
+        io_uring_cqe *cqe = nullptr;
+        const int ret = io_uring_wait_cqe(&m_ring, &cqe);
+        if (ret < 0) {
+            if (ret != -EINTR && ret != -EAGAIN) {
+                fail(QString("io_uring wait failed: %1").arg(QString::fromLocal8Bit(strerror(-ret))));
+            }
+            return;
+        }
+        BlockReader::Slot *slot = static_cast<BlockReader::Slot *>(io_uring_cqe_get_data(cqe));
+        const int result = cqe->res;
+        io_uring_cqe_seen(&m_ring, cqe);
+
+        if (result == -EINTR || result == -EAGAIN) {
+            queueRead(slot);
+            return;
+        }
+        if (result < 0) {
+            slot->error = QString::fromLocal8Bit(strerror(-result));
+            finish(slot);
+            return;
+        }
+        slot->bytesRead += result;
+        if (result > 0 && slot->bytesRead < slot->size) {
+            queueRead(slot);
+            return;
+        }
+        finish(slot);
+    }
+
+    int m_fd;
+    io_uring m_ring;
+    bool m_initialized = false;
+    bool m_broken = false;
+    int m_inFlight = 0;
+    QSet<BlockReader::Slot *> m_pendingSlots;
+    QList<QByteArray> m_abandonedBuffers;
+};
+#endif
+
+BlockReader::BlockReader(const QString &filePath, qint64 begin, qint64 end)
+    : m_filePath(filePath)
+    , m_begin(begin)
+    , m_end(end)
+{
+}
+
+BlockReader::~BlockReader()
+{
+    // 在途的读取还在写入缓冲区，必须先等它们结束
+    if (m_backend) {
+        m_backend->drain();
+    }
+    m_backend.reset();
+    m_brokenBackend.reset();
+}
+
+bool BlockReader::open()
+{
+    m_file.setFileName(m_filePath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    const qint64 fileSize = m_file.size();
+    if (m_end < 0 || m_end > fileSize) {
+        m_end = fileSize;
+    }
+    m_begin = qBound<qint64>(0, m_begin, m_end);
+    m_blockCount = (m_end - m_begin + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    m_nextBlock = 0;
+    m_currentSlot = -1;
+    m_slots.resize(QUEUE_DEPTH);
+
+#ifdef Q_OS_LINUX
+    // 提示内核按顺序读取，加大文件系统自身的预读窗口
+    posix_fadvise(m_file.handle(), m_begin, m_end - m_begin, POSIX_FADV_SEQUENTIAL);
+#endif
+
+#ifdef CSV_VIEWER_HAVE_LIBURING
+    std::unique_ptr<IoUringBackend> uring(new IoUringBackend(m_file.handle()));
+    if (uring->init()) {
+        m_backend = std::move(uring);
+        m_backendType = IoUring;
+    } else {
+        qDebug() << "io_uring is not available, falling back to pread thread pool";
+    }
+#endif
+    if (!m_backend) {
+        m_backend.reset(new PreadBackend(&m_file));
+        m_backendType = ThreadPool;
+    }
+
+    for (int i = 0; i < QUEUE_DEPTH; ++i) {
+        submitBlock(i, i);
+    }
+    return true;
+}
+
+void BlockReader::submitBlock(int slotIndex, qint64 block)
+{
+    if (block >= m_blockCount) {
+        return;
+    }
+    Slot &slot = m_slots[slotIndex];
+    slot.offset = m_begin + block * BLOCK_SIZE;
+    slot.size = qMin(BLOCK_SIZE, m_end - slot.offset);
+    slot.bytesRead = 0;
+    slot.error.clear();
+    if (slot.buffer.size() < slot.size) {
+        slot.buffer.resize(slot.size);
+    }
+    m_backend->submit(&slot);
+}
+
+bool BlockReader::next(Block *block)
+{
+    if (!m_backend) {
+        return false;
+    }
+
+    // 调用方已处理完上一块，它的缓冲区接着读取队列末尾之后的块
+    if (m_currentSlot >= 0) {
+        submitBlock(m_currentSlot, m_nextBlock - 1 + QUEUE_DEPTH);
+        m_currentSlot = -1;
+    }
+    if (!m_error.isEmpty() || m_nextBlock >= m_blockCount) {
+        return false;
+    }
+
+    const int slotIndex = static_cast<int>(m_nextBlock % QUEUE_DEPTH);
+    Slot &slot = m_slots[slotIndex];
+    m_backend->wait(&slot);
+    if (!slot.error.isEmpty() && m_backend->isBroken()) {
+        fallBackToPread();
+        m_backend->wait(&slot);
+    }
+    if (!slot.error.isEmpty()) {
+        m_error = slot.error;
+        return false;
+    }
+    if (slot.bytesRead < slot.size) {
+        m_error = QString("Unexpected end of file at offset %1").arg(slot.offset + slot.bytesRead);
+        return false;
+    }
+
+    block->data = slot.buffer.constData();
+    block->offset = slot.offset;
+    block->size = slot.bytesRead;
+    m_currentSlot = slotIndex;
+    ++m_nextBlock;
+    return true;
+}
+
+void BlockReader::fallBackToPread()
+{
+    qDebug() << "Block reader falling back to pread thread pool at offset" << m_begin + m_nextBlock * BLOCK_SIZE;
+    m_brokenBackend = std::move(m_backend);
+    m_backend.reset(new PreadBackend(&m_file));
+    m_backendType = ThreadPool;
+
+    // 失效的后端已结束所有在途读取，队列中的块全部重新读取
+    for (int i = 0; i < QUEUE_DEPTH; ++i) {
+        const qint64 block = m_nextBlock + i;
+        submitBlock(static_cast<int>(block % QUEUE_DEPTH), block);
+    }
+}
+
+BlockReader::BackendType BlockReader::backendType() const
+{
+    return m_backendType;
+}
+
+bool BlockReader::hasError() const
+{
+    return !m_error.isEmpty();
+}
+
+QString BlockReader::errorString() const
+{
+    return m_error;
+}
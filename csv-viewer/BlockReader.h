@@ -0,0 +1,99 @@
+#ifndef BLOCKREADER_H
+#define BLOCKREADER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+// 顺序扫描整个文件的块读取器
+// 内存映射在冷缓存上按缺页逐个读取，同一时间只有一个I/O在途，网络存储和机械硬盘上很慢；
+// 这里同时保持QUEUE_DEPTH个大块读取在途，按文件顺序把读好的块交给调用方，
+// 调用方处理完一块后这个缓冲区立即用于读取后面的块，缓冲区总量固定（有界队列）
+//
+// I/O后端可替换：Linux上有liburing时使用io_uring，否则使用专用I/O线程池上的pread
+// 只在一个线程中使用
+class BlockReader
+{
+public:
+    enum BackendType {
+        ThreadPool, // I/O线程池上的pread
+        IoUring     // Linux io_uring
+    };
+
+    // 读好的一块数据，在下一次调用next()之前有效
+    struct Block {
+        const char *data = nullptr;
+        qint64 offset = 0; // 在文件中的偏移
+        qint64 size = 0;
+    };
+
+    // 读取[begin, end)，end为-1时读到文件末尾
+    explicit BlockReader(const QString &filePath, qint64 begin = 0, qint64 end = -1);
+    ~BlockReader();
+
+    // 打开文件并提交第一批读取
+    bool open();
+
+    // 按文件顺序取得下一块，读完或出错时返回false
+    bool next(Block *block);
+
+    BackendType backendType() const;
+    bool hasError() const;
+    QString errorString() const;
+
+    static constexpr qint64 BLOCK_SIZE = 4 * 1024 * 1024; // 每个读取请求的大小
+    static constexpr int QUEUE_DEPTH = 8;                 // 同时在途的读取数（缓冲区个数）
+
+    // 一个缓冲区及其正在读取的块
+    struct Slot {
+        QByteArray buffer;
+        qint64 offset = 0;
+        qint64 size = 0;      // 请求的字节数
+        qint64 bytesRead = 0; // 已读入的字节数
+        bool pending = false; // 读取尚未完成
+        QString error;
+    };
+
+    // I/O后端：提交一个缓冲区的读取，等待它完成
+    class Backend
+    {
+    public:
+        virtual ~Backend() = default;
+
+        // 提交slot的读取，读取完成（或出错）时slot->pending变为false
+        virtual void submit(Slot *slot) = 0;
+
+        // 等待slot读取完成
+        virtual void wait(Slot *slot) = 0;
+
+        // 等待所有在途的读取结束，之后缓冲区可以释放
+        virtual void drain() = 0;
+
+        // 后端已无法继续工作（在途的读取都已标记为失败），需要换用其他后端
+        virtual bool isBroken() const { return false; }
+    };
+
+private:
+    // 让slot读取第block块，超出范围时不提交
+    void submitBlock(int slotIndex, qint64 block);
+
+    // 当前后端失效后换用pread线程池，重新提交尚未交给调用方的块
+    void fallBackToPread();
+
+    QString m_filePath;
+    QFile m_file;
+    qint64 m_begin;
+    qint64 m_end;
+    qint64 m_blockCount = 0;
+    qint64 m_nextBlock = 0;  // 下一次next()返回的块号
+    int m_currentSlot = -1;  // 上一次返回给调用方的缓冲区
+    QVector<Slot> m_slots;
+    std::unique_ptr<Backend> m_backend;
+    std::unique_ptr<Backend> m_brokenBackend; // 失效的后端持有的缓冲区可能仍被内核写入，保留到读取器销毁
+    BackendType m_backendType = ThreadPool;
+    QString m_error;
+};
+
+#endif // BLOCKREADER_H
@@ -0,0 +1,195 @@
+#include "CellTextCache.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFontMetrics>
+
+ElideTask::ElideTask(int firstRow, const QVector<int> &columns, const QVector<int> &widths,
+                     const QList<QStringList> &rows, const QFont &font, QObject *parent)
+    : BackgroundTask(parent)
+    , m_firstRow(firstRow)
+    , m_columns(columns)
+    , m_widths(widths)
+    , m_rows(rows)
+    , m_font(font)
+{
+}
+
+void ElideTask::execute()
+{
+    QElapsedTimer elideTimer;
+    elideTimer.start();
+
+    const QFontMetrics metrics(m_font);
+    m_result.reserve(m_rows.size());
+    for (const QStringList &row : m_rows) {
+        if (isCancelled()) {
+            return;
+        }
+        QStringList elidedRow;
+        elidedRow.reserve(row.size());
+        for (int i = 0; i < row.size(); ++i) {
+            elidedRow.append(row.at(i).isEmpty() ? QString() : metrics.elidedText(row.at(i), Qt::ElideRight, m_widths.at(i)));
+        }
+        m_result.append(elidedRow);
+    }
+
+    qDebug() << "Prefetched text of" << m_rows.size() << "rows x" << m_columns.size() << "columns in"
+             << elideTimer.elapsed() << "ms";
+    emit elided();
+}
+
+CellTextCache::CellTextCache(QObject *parent)
+    : QObject(parent)
+{
+}
+
+CellTextCache::~CellTextCache()
+{
+    if (m_task) {
+        m_task->cancel();
+        delete m_task;
+    }
+}
+
+const QStaticText *CellTextCache::lookup(int row, int column, int width) const
+{
+    auto it = m_entries.constFind(key(row, column));
+    if (it == m_entries.constEnd() || it->width != width) {
+        return nullptr;
+    }
+    return &it->text;
+}
+
+const QStaticText *CellTextCache::insert(int row, int column, int width, const QString &elidedText)
+{
+    Entry &entry = m_entries[key(row, column)];
+    entry.width = width;
+    entry.text.setText(elidedText);
+    entry.text.setTextFormat(Qt::PlainText);
+    entry.text.setPerformanceHint(QStaticText::AggressiveCaching);
+    return &entry.text;
+}
+
+void CellTextCache::prefetch(int firstRow, const QVector<int> &columns, const QVector<int> &widths,
+                             const QList<QStringList> &rows, const QFont &font)
+{
+    if (rows.isEmpty() || columns.isEmpty()) {
+        return;
+    }
+
+    Request request{firstRow, columns, widths, rows, font};
+    if (m_task) {
+        m_pending = request;
+        m_hasPending = true;
+        return;
+    }
+    startTask(request);
+}
+
+void CellTextCache::startTask(const Request &request)
+{
+    m_task = new ElideTask(request.firstRow, request.columns, request.widths, request.rows, request.font, this);
+    m_taskStale = false;
+    connect(m_task, &ElideTask::elided, this, &CellTextCache::onElided);
+    // 预取影响滚动的流畅度，与列宽估算一样优先执行
+    m_task->start(1);
+}
+
+void CellTextCache::onElided()
+{
+    if (sender() != m_task) {
+        return;
+    }
+
+    ElideTask *task = m_task;
+    m_task = nullptr;
+    task->cancel(); // 等待run()返回，信号在任务结束前发出
+    if (!m_taskStale) {
+        const QVector<int> columns = task->columns();
+        const QVector<int> widths = task->widths();
+        const QList<QStringList> result = task->result();
+        for (int i = 0; i < result.size(); ++i) {
+            const QStringList &row = result.at(i);
+            for (int j = 0; j < row.size(); ++j) {
+                if (!lookup(task->firstRow() + i, columns.at(j), widths.at(j))) {
+                    insert(task->firstRow() + i, columns.at(j), widths.at(j), row.at(j));
+                }
+            }
+        }
+    }
+    delete task;
+
+    if (m_hasPending) {
+        m_hasPending = false;
+        startTask(m_pending);
+        m_pending = Request();
+    }
+}
+
+void CellTextCache::trim(int firstRow, int lastRow)
+{
+    if (m_entries.size() <= MAX_ENTRIES) {
+        return;
+    }
+
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        const int row = static_cast<int>(it.key() >> 32);
+        if (row < firstRow || row > lastRow) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CellTextCache::invalidateColumn(int column)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (static_cast<int>(it.key() & 0xFFFFFFFF) == column) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (m_task && m_task->columns().contains(column)) {
+        m_taskStale = true;
+    }
+    if (m_hasPending && m_pending.columns.contains(column)) {
+        m_hasPending = false;
+    }
+}
+
+void CellTextCache::invalidateRows(int firstRow, int lastRow)
+{
+    if (m_entries.isEmpty() && !m_task) {
+        return;
+    }
+
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        const int row = static_cast<int>(it.key() >> 32);
+        if (row >= firstRow && row <= lastRow) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    auto overlaps = [firstRow, lastRow](int requestFirst, int requestRows) {
+        return requestFirst <= lastRow && requestFirst + requestRows - 1 >= firstRow;
+    };
+    if (m_task && overlaps(m_task->firstRow(), m_task->rowCount())) {
+        m_taskStale = true;
+    }
+    if (m_hasPending && overlaps(m_pending.firstRow, m_pending.rows.size())) {
+        m_hasPending = false;
+    }
+}
+
+void CellTextCache::invalidate()
+{
+    m_entries.clear();
+    if (m_task) {
+        m_taskStale = true;
+    }
+    m_hasPending = false;
+    m_pending = Request();
+}
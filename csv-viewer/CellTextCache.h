@@ -0,0 +1,113 @@
+#ifndef CELLTEXTCACHE_H
+#define CELLTEXTCACHE_H
+
+#include <QObject>
+#include <QFont>
+#include <QHash>
+#include <QList>
+#include <QStaticText>
+#include <QStringList>
+#include <QVector>
+
+#include "BackgroundTask.h"
+
+// 预先省略单元格文本的任务：按列宽计算省略后的文本
+class ElideTask : public BackgroundTask
+{
+    Q_OBJECT
+
+public:
+    // rows[i][j]为第firstRow + i行、第columns[j]列的文本，widths[j]为该列文本区域的宽度
+    ElideTask(int firstRow, const QVector<int> &columns, const QVector<int> &widths,
+              const QList<QStringList> &rows, const QFont &font, QObject *parent = nullptr);
+
+    int firstRow() const { return m_firstRow; }
+    int rowCount() const { return m_rows.size(); }
+    QVector<int> columns() const { return m_columns; }
+    QVector<int> widths() const { return m_widths; }
+
+    // 省略后的文本，与rows一一对应（elided信号发出后有效）
+    QList<QStringList> result() const { return m_result; }
+
+signals:
+    void elided();
+
+protected:
+    void execute() override;
+
+private:
+    int m_firstRow;
+    QVector<int> m_columns;
+    QVector<int> m_widths;
+    QList<QStringList> m_rows;
+    QFont m_font;
+    QList<QStringList> m_result;
+};
+
+// 单元格文本缓存
+// 以（行, 视图列, 文本宽度）为键保存省略并排版好的文本，重绘时不再经过data()/QVariant
+// 和逐格的省略计算；滚动时在后台线程预先计算滚动方向上视口之外的行。
+// 只在GUI线程中访问，后台任务只计算省略文本，QStaticText在首次绘制时准备
+class CellTextCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CellTextCache(QObject *parent = nullptr);
+    ~CellTextCache();
+
+    // 查找单元格的文本，没有缓存或宽度不同时返回nullptr
+    const QStaticText *lookup(int row, int column, int width) const;
+
+    // 缓存单元格省略后的文本，返回缓存中的条目
+    const QStaticText *insert(int row, int column, int width, const QString &elidedText);
+
+    // 在后台省略[firstRow, firstRow + rows.size())行中columns列的文本，完成后加入缓存
+    // 已有任务在执行时只保留最新的请求，不等待也不打断正在执行的任务
+    void prefetch(int firstRow, const QVector<int> &columns, const QVector<int> &widths,
+                  const QList<QStringList> &rows, const QFont &font);
+
+    // 条目过多时只保留[firstRow, lastRow]范围内的行
+    void trim(int firstRow, int lastRow);
+
+    // 失效：列宽变化时失效一列，数据变化时失效一段行，模型重置时全部失效
+    void invalidateColumn(int column);
+    void invalidateRows(int firstRow, int lastRow);
+    void invalidate();
+
+    int size() const { return m_entries.size(); }
+
+    static constexpr int MAX_ENTRIES = 50000; // 超过时trim()才会丢弃视口附近之外的条目
+
+private slots:
+    void onElided();
+
+private:
+    struct Entry {
+        int width = 0;
+        QStaticText text;
+    };
+
+    struct Request {
+        int firstRow = 0;
+        QVector<int> columns;
+        QVector<int> widths;
+        QList<QStringList> rows;
+        QFont font;
+    };
+
+    static quint64 key(int row, int column)
+    {
+        return (quint64(quint32(row)) << 32) | quint32(column);
+    }
+
+    void startTask(const Request &request);
+
+    QHash<quint64, Entry> m_entries;
+    ElideTask *m_task = nullptr;
+    bool m_taskStale = false;     // 任务执行期间其范围内的数据已失效，结果丢弃
+    bool m_hasPending = false;
+    Request m_pending;            // 任务执行期间收到的最新请求
+};
+
+#endif // CELLTEXTCACHE_H
@@ -0,0 +1,117 @@
+#include "ColumnListModel.h"
+
+ColumnListModel::ColumnListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int ColumnListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_columns.size();
+}
+
+QVariant ColumnListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_columns.size())
+        return QVariant();
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        return m_columns.at(index.row());
+    case Qt::CheckStateRole:
+        return m_checked.at(index.row()) ? Qt::Checked : Qt::Unchecked;
+    default:
+        return QVariant();
+    }
+}
+
+bool ColumnListModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || index.row() >= m_columns.size() || role != Qt::CheckStateRole)
+        return false;
+
+    m_checked[index.row()] = (value.toInt() == Qt::Checked);
+    emit dataChanged(index, index, {Qt::CheckStateRole});
+    return true;
+}
+
+Qt::ItemFlags ColumnListModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable | Qt::ItemNeverHasChildren;
+}
+
+void ColumnListModel::setColumns(const QStringList &columns)
+{
+    beginResetModel();
+    m_columns = columns;
+    m_checked.fill(true, columns.size()); // 默认选中所有列
+    endResetModel();
+}
+
+void ColumnListModel::appendColumn(const QString &name)
+{
+    const int row = m_columns.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_columns.append(name);
+    m_checked.append(true);
+    endInsertRows();
+}
+
+void ColumnListModel::setAllChecked(bool checked)
+{
+    if (m_columns.isEmpty())
+        return;
+
+    m_checked.fill(checked);
+    emit dataChanged(index(0), index(m_columns.size() - 1), {Qt::CheckStateRole});
+}
+
+QStringList ColumnListModel::setCheckedColumns(const QStringList &names)
+{
+    QStringList missing;
+    if (m_columns.isEmpty())
+        return names;
+
+    m_checked.fill(false);
+    for (const QString &name : names) {
+        bool found = false;
+        for (int i = 0; i < m_columns.size(); ++i) {
+            if (m_columns.at(i) == name) {
+                m_checked[i] = true;
+                found = true;
+            }
+        }
+        if (!found) {
+            missing.append(name);
+        }
+    }
+    emit dataChanged(index(0), index(m_columns.size() - 1), {Qt::CheckStateRole});
+    return missing;
+}
+
+QVector<int> ColumnListModel::checkedColumns() const
+{
+    QVector<int> columns;
+    columns.reserve(m_checked.size());
+    for (int i = 0; i < m_checked.size(); ++i) {
+        if (m_checked.at(i)) {
+            columns.append(i);
+        }
+    }
+    return columns;
+}
+
+void ColumnListModel::clear()
+{
+    beginResetModel();
+    m_columns.clear();
+    m_checked.clear();
+    endResetModel();
+}
@@ -0,0 +1,45 @@
+#ifndef COLUMNLISTMODEL_H
+#define COLUMNLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QVector>
+
+// 可勾选的列名列表模型
+// 配合QListView使用，视图只为可见的几行创建绘制数据，
+// 上万列的文件也不需要为每一列创建复选框控件
+class ColumnListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit ColumnListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    // 设置列名，默认全部勾选
+    void setColumns(const QStringList &columns);
+
+    // 在末尾追加一列（计算列）并勾选
+    void appendColumn(const QString &name);
+
+    // 勾选或取消勾选所有列，只发出一次数据变化通知
+    void setAllChecked(bool checked);
+
+    // 只勾选指定名称的列（同名的列都勾选），返回找不到的列名
+    QStringList setCheckedColumns(const QStringList &names);
+
+    // 按原始顺序返回所有勾选列的序号
+    QVector<int> checkedColumns() const;
+
+    void clear();
+
+private:
+    QStringList m_columns;
+    QVector<bool> m_checked;
+};
+
+#endif // COLUMNLISTMODEL_H
@@ -0,0 +1,197 @@
+#include "ColumnWidthEstimator.h"
+#include "RecordScanner.h"
+#include "RowIndex.h"
+#include <QFontMetrics>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+
+ColumnWidthTask::ColumnWidthTask(const QStringList &headers, const QList<QStringList> &sampleRows,
+                                 const QFont &font, QObject *parent)
+    : BackgroundTask(parent)
+    , m_headers(headers)
+    , m_sampleRows(sampleRows)
+    , m_font(font)
+{
+}
+
+ColumnWidthTask::ColumnWidthTask(const QStringList &headers, const CsvReader::ReadAheadSource &source, int totalRows,
+                                 const QFont &font, QObject *parent)
+    : BackgroundTask(parent)
+    , m_headers(headers)
+    , m_font(font)
+    , m_hasSource(true)
+    , m_source(source)
+    , m_totalRows(totalRows)
+{
+}
+
+void ColumnWidthTask::sampleSource()
+{
+    QElapsedTimer sampleTimer;
+    sampleTimer.start();
+
+    const int headRows = ColumnWidthEstimator::SAMPLE_HEAD_ROWS;
+    const int rowsPerBlock = ColumnWidthEstimator::SAMPLE_ROWS_PER_BLOCK;
+    appendSampleRows(0, headRows);
+    if (m_totalRows > headRows && !isCancelled()) {
+        // 文件末尾
+        const int tailStart = qMax(headRows, m_totalRows - ColumnWidthEstimator::SAMPLE_TAIL_ROWS);
+        appendSampleRows(tailStart, m_totalRows - tailStart);
+
+        // 中间的随机位置，种子固定为总行数，同一文件每次采样结果一致
+        const int span = tailStart - headRows - rowsPerBlock;
+        if (span > 0) {
+            QRandomGenerator generator(static_cast<quint32>(m_totalRows));
+            for (int i = 0; i < ColumnWidthEstimator::SAMPLE_RANDOM_BLOCKS && !isCancelled(); ++i) {
+                appendSampleRows(headRows + generator.bounded(span), rowsPerBlock);
+            }
+        }
+    }
+
+    qDebug() << "Sampled" << m_sampleRows.size() << "rows for column widths in" << sampleTimer.elapsed() << "ms";
+}
+
+void ColumnWidthTask::appendSampleRows(qint64 firstRow, int count)
+{
+    // 列式文件按行号直接读取
+    if (m_source.columnarFile) {
+        m_sampleRows.append(m_source.columnarFile->readRows(firstRow, count, m_source.columnProjection));
+        return;
+    }
+
+    const qint64 begin = sampleOffset(firstRow);
+    if (begin < 0 || begin >= m_source.fileSize) {
+        return;
+    }
+    const qint64 end = RecordScanner::skipRecords(m_source.data, m_source.fileSize, begin, count,
+                                                  m_source.parse.dialect.quoteChar);
+    // 总是按记录容错解析，严格模式下格式错误的行也参与测量，不会中断采样
+    const QList<QStringList> rows = CsvReader::parseRecords(m_source.data + begin, end - begin, m_source.parse, begin);
+    m_sampleRows.append(rows.mid(0, count));
+}
+
+qint64 ColumnWidthTask::sampleOffset(qint64 row) const
+{
+    // 行索引已覆盖，或全部数据都已在初始加载时读入（没有行索引）
+    qint64 checkpointRow = 0;
+    qint64 checkpointOffset = 0;
+    if (!m_source.rowIndex || m_source.bytesPerRecord <= 0
+        || m_source.rowIndex->lookup(row, &checkpointRow, &checkpointOffset)) {
+        return CsvReader::locateRow(m_source, row);
+    }
+
+    // 行索引尚未覆盖：按平均记录长度估算，不从最后一个检查点扫描到文件末尾；采样不要求行号精确
+    const qint64 approxOffset = m_source.dataStart + static_cast<qint64>(row * m_source.bytesPerRecord);
+    return RecordScanner::syncToRecordStart(m_source.data, m_source.fileSize, m_source.dataStart, approxOffset,
+                                            m_source.parse.dialect.quoteChar);
+}
+
+void ColumnWidthTask::execute()
+{
+    if (m_hasSource) {
+        sampleSource();
+        if (isCancelled()) {
+            return;
+        }
+    }
+
+    QElapsedTimer measureTimer;
+    measureTimer.start();
+
+    // 整个测量过程共用一个QFontMetrics
+    const QFontMetrics metrics(m_font);
+    const int padding = 2 * metrics.averageCharWidth() + 8;
+    const int columnCount = m_headers.size();
+
+    QVector<int> widths(columnCount);
+    QVector<const QString *> candidates;
+    candidates.reserve(ColumnWidthEstimator::CANDIDATES_PER_COLUMN);
+
+    for (int column = 0; column < columnCount; ++column) {
+        if (isCancelled()) {
+            return;
+        }
+
+        // 先按字符数挑出最长的几个值，只测量这几个，而不是每个采样值都做文本排版
+        candidates.clear();
+        for (const QStringList &row : m_sampleRows) {
+            if (column >= row.size() || row.at(column).isEmpty()) {
+                continue;
+            }
+            const QString *value = &row.at(column);
+            if (candidates.size() < ColumnWidthEstimator::CANDIDATES_PER_COLUMN) {
+                candidates.append(value);
+                continue;
+            }
+            int shortest = 0;
+            for (int i = 1; i < candidates.size(); ++i) {
+                if (candidates.at(i)->size() < candidates.at(shortest)->size()) {
+                    shortest = i;
+                }
+            }
+            if (value->size() > candidates.at(shortest)->size()) {
+                candidates[shortest] = value;
+            }
+        }
+
+        int width = metrics.horizontalAdvance(m_headers.at(column));
+        for (const QString *value : candidates) {
+            width = qMax(width, metrics.horizontalAdvance(*value));
+        }
+        widths[column] = qBound(ColumnWidthEstimator::MIN_WIDTH, width + padding, ColumnWidthEstimator::MAX_WIDTH);
+    }
+
+    qDebug() << "Measured" << columnCount << "column widths from" << m_sampleRows.size()
+             << "sample rows in" << measureTimer.elapsed() << "ms";
+    emit measured(widths);
+}
+
+ColumnWidthEstimator::ColumnWidthEstimator(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ColumnWidthEstimator::~ColumnWidthEstimator()
+{
+    cancel();
+}
+
+void ColumnWidthEstimator::estimate(const QStringList &headers, const QList<QStringList> &sampleRows, const QFont &font)
+{
+    cancel();
+
+    m_task = new ColumnWidthTask(headers, sampleRows, font, this);
+    connect(m_task, &ColumnWidthTask::measured, this, &ColumnWidthEstimator::onMeasured);
+    // 列宽影响首屏显示，优先于行计数等长时间任务执行
+    m_task->start(1);
+}
+
+void ColumnWidthEstimator::estimate(const QStringList &headers, const CsvReader::ReadAheadSource &source, int totalRows,
+                                    const QFont &font)
+{
+    cancel();
+
+    m_task = new ColumnWidthTask(headers, source, totalRows, font, this);
+    connect(m_task, &ColumnWidthTask::measured, this, &ColumnWidthEstimator::onMeasured);
+    m_task->start(1);
+}
+
+void ColumnWidthEstimator::cancel()
+{
+    if (m_task) {
+        m_task->cancel();
+        delete m_task;
+        m_task = nullptr;
+    }
+}
+
+void ColumnWidthEstimator::onMeasured(const QVector<int> &widths)
+{
+    // 忽略已取消的旧测量遗留的信号
+    if (sender() != m_task) {
+        return;
+    }
+
+    emit widthsReady(widths);
+}
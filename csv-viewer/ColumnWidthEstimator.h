@@ -0,0 +1,93 @@
+#ifndef COLUMNWIDTHESTIMATOR_H
+#define COLUMNWIDTHESTIMATOR_H
+
+#include <QObject>
+#include <QFont>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+
+#include "BackgroundTask.h"
+#include "CsvReader.h"
+
+// 列宽测量任务：从文件中读取采样行，逐列测量文本宽度
+class ColumnWidthTask : public BackgroundTask
+{
+    Q_OBJECT
+
+public:
+    // 测量已经读出的采样行
+    ColumnWidthTask(const QStringList &headers, const QList<QStringList> &sampleRows,
+                    const QFont &font, QObject *parent = nullptr);
+
+    // 在工作线程中直接从文件采样，不改变读取器的状态；totalRows为估算的总行数
+    ColumnWidthTask(const QStringList &headers, const CsvReader::ReadAheadSource &source, int totalRows,
+                    const QFont &font, QObject *parent = nullptr);
+
+signals:
+    // 测量完成，widths[i]为第i列的建议宽度（像素）
+    void measured(const QVector<int> &widths);
+
+protected:
+    void execute() override;
+
+private:
+    // 采样文件开头、末尾和中间随机位置的行
+    void sampleSource();
+
+    // 读取从firstRow开始的count行追加到采样行
+    void appendSampleRows(qint64 firstRow, int count);
+
+    // 采样行的起始偏移：行索引已覆盖时精确定位，否则按平均记录长度估算
+    qint64 sampleOffset(qint64 row) const;
+
+    QStringList m_headers;
+    QList<QStringList> m_sampleRows;
+    QFont m_font;
+    bool m_hasSource = false;
+    CsvReader::ReadAheadSource m_source;
+    int m_totalRows = 0;
+};
+
+// 列宽估算器
+// 用少量采样行（文件开头、末尾和随机位置）估算所有列的宽度，
+// 代替resizeColumnToContents对每一个已加载行逐格测量
+class ColumnWidthEstimator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ColumnWidthEstimator(QObject *parent = nullptr);
+    ~ColumnWidthEstimator();
+
+    // 在共享线程池中测量采样行，完成后发出widthsReady
+    void estimate(const QStringList &headers, const QList<QStringList> &sampleRows, const QFont &font);
+
+    // 在共享线程池中从文件采样并测量，source引用的内存映射在测量结束或取消前必须保持有效
+    void estimate(const QStringList &headers, const CsvReader::ReadAheadSource &source, int totalRows,
+                  const QFont &font);
+
+    // 取消正在进行的测量
+    void cancel();
+
+    static constexpr int MIN_WIDTH = 40;   // 最小列宽
+    static constexpr int MAX_WIDTH = 400;  // 最大列宽，避免个别超长文本撑开整列
+    static constexpr int CANDIDATES_PER_COLUMN = 3; // 每列只测量字符数最多的几个值
+
+    // 采样行数有上限，与文件大小和已加载行数无关
+    static constexpr int SAMPLE_HEAD_ROWS = 100;     // 文件开头
+    static constexpr int SAMPLE_TAIL_ROWS = 100;     // 文件末尾
+    static constexpr int SAMPLE_RANDOM_BLOCKS = 16;  // 中间的随机位置
+    static constexpr int SAMPLE_ROWS_PER_BLOCK = 8;  // 每个随机位置的行数
+
+signals:
+    void widthsReady(const QVector<int> &widths);
+
+private slots:
+    void onMeasured(const QVector<int> &widths);
+
+private:
+    ColumnWidthTask *m_task = nullptr;
+};
+
+#endif // COLUMNWIDTHESTIMATOR_H
@@ -0,0 +1,399 @@
+#include "ColumnarFile.h"
+#include <QLocale>
+#include <cstring>
+#include <algorithm>
+
+const QByteArray ColumnarFile::MAGIC = QByteArrayLiteral("CSVCOL01");
+
+namespace {
+
+// 尾部：目录偏移 + MAGIC
+const qint64 TRAILER_SIZE = 8 + 8;
+
+template <typename T>
+void appendValue(QByteArray &out, T value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+T readValue(const char *data)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// 目录的顺序读取器，越界时标记失败而不是读出文件范围
+class FooterReader
+{
+public:
+    FooterReader(const char *data, qint64 begin, qint64 end)
+        : m_data(data), m_pos(begin), m_end(end) {}
+
+    template <typename T>
+    T read()
+    {
+        if (m_pos + qint64(sizeof(T)) > m_end) {
+            m_ok = false;
+            return T();
+        }
+        const T value = readValue<T>(m_data + m_pos);
+        m_pos += sizeof(T);
+        return value;
+    }
+
+    QString readString()
+    {
+        const quint32 length = read<quint32>();
+        if (!m_ok || m_pos + length > m_end) {
+            m_ok = false;
+            return QString();
+        }
+        const QString value = QString::fromUtf8(m_data + m_pos, length);
+        m_pos += length;
+        return value;
+    }
+
+    bool ok() const { return m_ok; }
+
+private:
+    const char *m_data;
+    qint64 m_pos;
+    qint64 m_end;
+    bool m_ok = true;
+};
+
+// 检查目录中的一列数据是否完整地位于数据区内，读取单元格时不再做边界检查：
+// 定长列的长度至少容纳rows个值；文本列的偏移数组有rows + 1项，单调不减且不超出其后的文本
+bool validChunk(const char *data, qint64 dataEnd, qint64 rows, const ColumnarFile::ColumnChunk &chunk)
+{
+    if (chunk.offset < 0 || chunk.length < 0 || chunk.offset > dataEnd || chunk.length > dataEnd - chunk.offset) {
+        return false;
+    }
+
+    switch (chunk.type) {
+    case ColumnarFile::Int64:
+        return rows <= chunk.length / qint64(sizeof(qint64));
+    case ColumnarFile::Double:
+        return rows <= chunk.length / qint64(sizeof(double));
+    case ColumnarFile::String: {
+        if (rows + 1 > chunk.length / qint64(sizeof(quint32))) {
+            return false;
+        }
+        const char *offsets = data + chunk.offset;
+        const qint64 textLength = chunk.length - (rows + 1) * qint64(sizeof(quint32));
+        quint32 previous = 0;
+        for (qint64 i = 0; i <= rows; ++i) {
+            const quint32 offset = readValue<quint32>(offsets + i * sizeof(quint32));
+            if (offset < previous || offset > textLength) {
+                return false;
+            }
+            previous = offset;
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+} // namespace
+
+bool ColumnarFile::isColumnarFile(const char *data, qint64 size)
+{
+    return data && size >= MAGIC.size() * 2 + 8 && memcmp(data, MAGIC.constData(), MAGIC.size()) == 0;
+}
+
+ColumnarFile::RowGroup ColumnarFile::encodeRowGroup(const QList<QStringList> &rows, int columnCount)
+{
+    RowGroup group;
+    group.rows = rows.size();
+    group.columns.resize(columnCount);
+
+    static const QString EMPTY;
+    auto valueAt = [&](const QStringList &row, int column) -> const QString & {
+        return column < row.size() ? row.at(column) : EMPTY;
+    };
+
+    for (int column = 0; column < columnCount; ++column) {
+        // 推断类型：只有所有值都能原样还原时才按数值存储，保证转换前后显示完全一致
+        bool canInt = !rows.isEmpty();
+        bool canDouble = !rows.isEmpty();
+        for (const QStringList &row : rows) {
+            const QString &value = valueAt(row, column);
+            bool ok = false;
+            if (canInt) {
+                const qint64 number = value.toLongLong(&ok);
+                canInt = ok && QString::number(number) == value;
+            }
+            if (!canInt && canDouble) {
+                const double number = value.toDouble(&ok);
+                canDouble = ok && QString::number(number, 'g', QLocale::FloatingPointShortest) == value;
+            }
+            if (!canInt && !canDouble) {
+                break;
+            }
+        }
+
+        // 每列从8字节边界开始，定长数组可以直接按元素访问
+        while (group.bytes.size() % 8 != 0) {
+            group.bytes.append('\0');
+        }
+
+        ColumnChunk &chunk = group.columns[column];
+        chunk.type = canInt ? Int64 : (canDouble ? Double : String);
+        chunk.offset = group.bytes.size();
+
+        switch (chunk.type) {
+        case Int64:
+            for (const QStringList &row : rows) {
+                appendValue<qint64>(group.bytes, valueAt(row, column).toLongLong());
+            }
+            break;
+        case Double:
+            for (const QStringList &row : rows) {
+                appendValue<double>(group.bytes, valueAt(row, column).toDouble());
+            }
+            break;
+        case String: {
+            // 偏移数组（rows + 1个）之后紧跟所有值的UTF-8字节
+            QByteArray text;
+            QVector<quint32> offsets;
+            offsets.reserve(rows.size() + 1);
+            offsets.append(0);
+            for (const QStringList &row : rows) {
+                text.append(valueAt(row, column).toUtf8());
+                offsets.append(static_cast<quint32>(text.size()));
+            }
+            group.bytes.append(reinterpret_cast<const char *>(offsets.constData()), offsets.size() * sizeof(quint32));
+            group.bytes.append(text);
+            break;
+        }
+        }
+
+        chunk.length = group.bytes.size() - chunk.offset;
+    }
+
+    while (group.bytes.size() % 8 != 0) {
+        group.bytes.append('\0');
+    }
+    return group;
+}
+
+QByteArray ColumnarFile::encodeFooter(const QStringList &headers, const QVector<RowGroupInfo> &groups, qint64 footerOffset)
+{
+    QByteArray footer;
+    appendValue<quint32>(footer, static_cast<quint32>(headers.size()));
+    for (const QString &header : headers) {
+        const QByteArray name = header.toUtf8();
+        appendValue<quint32>(footer, static_cast<quint32>(name.size()));
+        footer.append(name);
+    }
+
+    appendValue<quint32>(footer, static_cast<quint32>(groups.size()));
+    for (const RowGroupInfo &group : groups) {
+        appendValue<qint64>(footer, group.firstRow);
+        appendValue<qint64>(footer, group.rows);
+        for (const ColumnChunk &chunk : group.columns) {
+            appendValue<quint8>(footer, chunk.type);
+            appendValue<qint64>(footer, chunk.offset);
+            appendValue<qint64>(footer, chunk.length);
+        }
+    }
+
+    appendValue<qint64>(footer, footerOffset);
+    footer.append(MAGIC);
+    return footer;
+}
+
+bool ColumnarFile::open(const char *data, qint64 size, QString *error)
+{
+    close();
+
+    if (!isColumnarFile(data, size) || memcmp(data + size - MAGIC.size(), MAGIC.constData(), MAGIC.size()) != 0) {
+        *error = "Not a columnar file or file is truncated";
+        return false;
+    }
+
+    const qint64 footerOffset = readValue<qint64>(data + size - TRAILER_SIZE);
+    if (footerOffset < MAGIC.size() || footerOffset > size - TRAILER_SIZE) {
+        *error = "Invalid columnar file directory offset";
+        return false;
+    }
+
+    FooterReader footer(data, footerOffset, size - TRAILER_SIZE);
+    const quint32 columnCount = footer.read<quint32>();
+    QStringList headers;
+    for (quint32 i = 0; i < columnCount && footer.ok(); ++i) {
+        headers.append(footer.readString());
+    }
+
+    const quint32 groupCount = footer.read<quint32>();
+    QVector<RowGroupInfo> groups;
+    qint64 rowCount = 0;
+    for (quint32 i = 0; i < groupCount && footer.ok(); ++i) {
+        RowGroupInfo group;
+        group.firstRow = footer.read<qint64>();
+        group.rows = footer.read<qint64>();
+        if (footer.ok() && (group.firstRow != rowCount || group.rows < 0 || group.rows > footerOffset)) {
+            *error = "Invalid columnar file row group";
+            return false;
+        }
+        group.columns.resize(columnCount);
+        for (ColumnChunk &chunk : group.columns) {
+            const quint8 type = footer.read<quint8>();
+            chunk.type = static_cast<ColumnType>(type);
+            chunk.offset = footer.read<qint64>();
+            chunk.length = footer.read<qint64>();
+            if (!footer.ok()) {
+                break;
+            }
+            if (type > Double || !validChunk(data, footerOffset, group.rows, chunk)) {
+                *error = "Invalid columnar file column chunk";
+                return false;
+            }
+        }
+        rowCount += group.rows;
+        groups.append(group);
+    }
+
+    if (!footer.ok()) {
+        *error = "Columnar file directory is truncated";
+        return false;
+    }
+
+    m_data = data;
+    m_size = size;
+    m_headers = headers;
+    m_groups = groups;
+    m_rowCount = rowCount;
+    return true;
+}
+
+void ColumnarFile::close()
+{
+    m_data = nullptr;
+    m_size = 0;
+    m_headers.clear();
+    m_groups.clear();
+    m_rowCount = 0;
+}
+
+QStringList ColumnarFile::headers() const
+{
+    return m_headers;
+}
+
+qint64 ColumnarFile::rowCount() const
+{
+    return m_rowCount;
+}
+
+QList<QStringList> ColumnarFile::readRows(qint64 firstRow, int count, const QVector<int> &columns) const
+{
+    QList<QStringList> rows;
+    if (!m_data || firstRow < 0 || firstRow >= m_rowCount || count <= 0) {
+        return rows;
+    }
+
+    const qint64 lastRow = qMin(firstRow + count, m_rowCount);
+    rows.reserve(lastRow - firstRow);
+    const int columnCount = m_headers.size();
+
+    // 二分查找第一行所在的行组
+    auto group = std::upper_bound(m_groups.constBegin(), m_groups.constEnd(), firstRow,
+                                  [](qint64 row, const RowGroupInfo &info) { return row < info.firstRow; }) - 1;
+
+    for (qint64 row = firstRow; row < lastRow; ++row) {
+        while (row >= group->firstRow + group->rows) {
+            ++group;
+        }
+
+        QStringList cells;
+        cells.reserve(columnCount);
+        if (columns.isEmpty()) {
+            for (int column = 0; column < columnCount; ++column) {
+                cells.append(cell(*group, column, row - group->firstRow));
+            }
+        } else {
+            // 未显示的列保持为空字符串，不访问其数据
+            for (int column = 0; column < columnCount; ++column) {
+                cells.append(QString());
+            }
+            for (int column : columns) {
+                if (column >= 0 && column < columnCount) {
+                    cells[column] = cell(*group, column, row - group->firstRow);
+                }
+            }
+        }
+        rows.append(cells);
+    }
+    return rows;
+}
+
+QVector<ColumnarFile::RowGroupInfo> ColumnarFile::rowGroups() const
+{
+    return m_groups;
+}
+
+QByteArray ColumnarFile::rawValue(const RowGroupInfo &group, int column, qint64 rowInGroup) const
+{
+    const ColumnChunk &chunk = group.columns.at(column);
+    const char *base = m_data + chunk.offset;
+
+    switch (chunk.type) {
+    case Int64:
+        return QByteArray::number(readValue<qint64>(base + rowInGroup * sizeof(qint64)));
+    case Double:
+        return QByteArray::number(readValue<double>(base + rowInGroup * sizeof(double)), 'g', QLocale::FloatingPointShortest);
+    case String: {
+        const quint32 begin = readValue<quint32>(base + rowInGroup * sizeof(quint32));
+        const quint32 end = readValue<quint32>(base + (rowInGroup + 1) * sizeof(quint32));
+        const char *text = base + (group.rows + 1) * sizeof(quint32);
+        return QByteArray::fromRawData(text + begin, end - begin);
+    }
+    }
+    return QByteArray();
+}
+
+bool ColumnarFile::numericValue(const RowGroupInfo &group, int column, qint64 rowInGroup, double *value) const
+{
+    const ColumnChunk &chunk = group.columns.at(column);
+    const char *base = m_data + chunk.offset;
+
+    switch (chunk.type) {
+    case Int64:
+        *value = static_cast<double>(readValue<qint64>(base + rowInGroup * sizeof(qint64)));
+        return true;
+    case Double:
+        *value = readValue<double>(base + rowInGroup * sizeof(double));
+        return true;
+    case String: {
+        bool ok = false;
+        const QByteArray text = rawValue(group, column, rowInGroup).trimmed();
+        *value = text.toDouble(&ok);
+        return ok;
+    }
+    }
+    return false;
+}
+
+QString ColumnarFile::cell(const RowGroupInfo &group, int column, qint64 rowInGroup) const
+{
+    const ColumnChunk &chunk = group.columns.at(column);
+    const char *base = m_data + chunk.offset;
+
+    switch (chunk.type) {
+    case Int64:
+        return QString::number(readValue<qint64>(base + rowInGroup * sizeof(qint64)));
+    case Double:
+        return QString::number(readValue<double>(base + rowInGroup * sizeof(double)), 'g', QLocale::FloatingPointShortest);
+    case String: {
+        const quint32 begin = readValue<quint32>(base + rowInGroup * sizeof(quint32));
+        const quint32 end = readValue<quint32>(base + (rowInGroup + 1) * sizeof(quint32));
+        const char *text = base + (group.rows + 1) * sizeof(quint32);
+        return QString::fromUtf8(text + begin, end - begin);
+    }
+    }
+    return QString();
+}
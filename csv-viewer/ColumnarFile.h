@@ -0,0 +1,89 @@
+#ifndef COLUMNARFILE_H
+#define COLUMNARFILE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+
+// 列式二进制文件
+// 由CSV转换得到，按行组存储，每个行组内逐列连续存放：整数列和浮点列为定长数组，
+// 文本列为偏移数组加UTF-8字节。打开时只读取文件末尾的目录，读取行时直接从
+// 内存映射中取出需要的列，没有任何文本解析，未显示的列不会被访问
+//
+// 文件布局（小端）：
+//   MAGIC | 行组... | 目录 | 目录偏移(int64) | MAGIC
+//   目录：列数(uint32)，每列名称长度(uint32)+UTF-8名称；行组数(uint32)，
+//         每个行组首行号(int64)、行数(int64)，以及每列的类型(uint8)、偏移(int64)、长度(int64)
+class ColumnarFile
+{
+public:
+    enum ColumnType : quint8 {
+        String = 0,
+        Int64 = 1,
+        Double = 2
+    };
+
+    // 行组中一列数据的位置
+    struct ColumnChunk {
+        ColumnType type = String;
+        qint64 offset = 0; // 相对于行组起始位置（编码时）或文件起始位置（目录中）
+        qint64 length = 0;
+    };
+
+    // 编码好的一个行组
+    struct RowGroup {
+        QByteArray bytes;
+        qint64 rows = 0;
+        QVector<ColumnChunk> columns;
+    };
+
+    // 行组在文件中的位置
+    struct RowGroupInfo {
+        qint64 firstRow = 0;
+        qint64 rows = 0;
+        QVector<ColumnChunk> columns; // 偏移相对于文件起始位置
+    };
+
+    static const QByteArray MAGIC;
+
+    // 数据是否为列式文件
+    static bool isColumnarFile(const char *data, qint64 size);
+
+    // 把一组行编码为行组，逐列推断类型：所有值都能无损往返时才使用整数或浮点类型
+    static RowGroup encodeRowGroup(const QList<QStringList> &rows, int columnCount);
+
+    // 编码文件末尾的目录和尾部
+    static QByteArray encodeFooter(const QStringList &headers, const QVector<RowGroupInfo> &groups, qint64 footerOffset);
+
+    // 打开内存映射的列式文件，data在对象使用期间必须保持有效
+    bool open(const char *data, qint64 size, QString *error);
+    void close();
+
+    QStringList headers() const;
+    qint64 rowCount() const;
+
+    // 读取从firstRow开始的count行；columns非空时只读取这些列，其余列为空字符串
+    QList<QStringList> readRows(qint64 firstRow, int count, const QVector<int> &columns = QVector<int>()) const;
+
+    // 按行组逐列扫描（聚合等不需要整行文本的场景），直接访问类型化的列数据
+    QVector<RowGroupInfo> rowGroups() const;
+
+    // 单元格的UTF-8文本，文本列不复制数据（引用内存映射）
+    QByteArray rawValue(const RowGroupInfo &group, int column, qint64 rowInGroup) const;
+
+    // 单元格的数值，整数列和浮点列直接读取，文本列按文本转换；不是数值时返回false
+    bool numericValue(const RowGroupInfo &group, int column, qint64 rowInGroup, double *value) const;
+
+private:
+    // 读取一个单元格
+    QString cell(const RowGroupInfo &group, int column, qint64 rowInGroup) const;
+
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+    QStringList m_headers;
+    QVector<RowGroupInfo> m_groups;
+    qint64 m_rowCount = 0;
+};
+
+#endif // COLUMNARFILE_H
@@ -0,0 +1,23 @@
+#include "CompositeKey.h"
+#include <cstring>
+
+void CompositeKey::append(QByteArray &key, const QByteArray &value)
+{
+    const quint32 length = static_cast<quint32>(value.size());
+    key.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    key.append(value);
+}
+
+QList<QByteArray> CompositeKey::split(const QByteArray &key)
+{
+    QList<QByteArray> parts;
+    qint64 pos = 0;
+    while (pos + qint64(sizeof(quint32)) <= key.size()) {
+        quint32 length = 0;
+        memcpy(&length, key.constData() + pos, sizeof(length));
+        pos += sizeof(length);
+        parts.append(key.mid(pos, length));
+        pos += length;
+    }
+    return parts;
+}
@@ -0,0 +1,19 @@
+#ifndef COMPOSITEKEY_H
+#define COMPOSITEKEY_H
+
+#include <QByteArray>
+#include <QList>
+
+// 多列组成的键：各列的值依次写入“长度(uint32) + 原始字节”，
+// 不需要转义，任意字节内容的值都不会互相混淆；分组汇总和文件比较共用
+class CompositeKey
+{
+public:
+    // 在键末尾追加一列的值
+    static void append(QByteArray &key, const QByteArray &value);
+
+    // 把键拆分回各列的值
+    static QList<QByteArray> split(const QByteArray &key);
+};
+
+#endif // COMPOSITEKEY_H
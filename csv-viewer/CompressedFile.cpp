@@ -0,0 +1,486 @@
+#include "CompressedFile.h"
+#include <QDebug>
+#include <QtEndian>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#ifdef CSV_VIEWER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CSV_VIEWER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// 每次提供给解压器的压缩数据量
+static const qint64 INPUT_CHUNK_SIZE = 1024 * 1024;
+
+// zstd帧格式中的魔数（小端）
+static const quint32 ZSTD_SKIPPABLE_MAGIC_MASK = 0xFFFFFFF0; // 可跳过帧的魔数为0x184D2A50 - 0x184D2A5F
+static const quint32 ZSTD_SKIPPABLE_MAGIC = 0x184D2A50;
+static const quint32 ZSTD_SEEK_TABLE_MAGIC = 0x184D2A5E;     // 保存跳转表的可跳过帧
+static const quint32 ZSTD_SEEKABLE_MAGIC = 0x8F92EAB1;       // 跳转表末尾的标记
+static const qint64 ZSTD_SEEK_TABLE_FOOTER_SIZE = 9;          // 帧数(4) + 描述符(1) + 标记(4)
+
+static quint32 readLittleEndian32(const char *data)
+{
+    return qFromLittleEndian<quint32>(data);
+}
+
+// data处是否为可跳过帧（跳转表等元数据，不产生输出）
+static bool isSkippableFrame(const char *data, qint64 available)
+{
+    return available >= 4 && (readLittleEndian32(data) & ZSTD_SKIPPABLE_MAGIC_MASK) == ZSTD_SKIPPABLE_MAGIC;
+}
+
+struct CompressedFile::Decoder::State {
+#ifdef CSV_VIEWER_HAVE_ZLIB
+    z_stream zstream;
+    bool zstreamInitialized = false;
+    bool raw = false; // 从访问点恢复时处于原始deflate模式，成员结束后需自行跳过gzip尾部
+#endif
+#ifdef CSV_VIEWER_HAVE_ZSTD
+    ZSTD_DCtx *dctx = nullptr;
+    bool frameFinished = true; // 上一次解压调用后当前帧是否已完整输出
+#endif
+};
+
+CompressedFile::Compression CompressedFile::detect(const char *data, qint64 size)
+{
+    if (size >= 2 && static_cast<unsigned char>(data[0]) == 0x1F && static_cast<unsigned char>(data[1]) == 0x8B) {
+        return Gzip;
+    }
+    if (size >= 4 && memcmp(data, "\x28\xB5\x2F\xFD", 4) == 0) {
+        return Zstd;
+    }
+    return None;
+}
+
+bool CompressedFile::isSupported(Compression compression)
+{
+    switch (compression) {
+    case Gzip:
+#ifdef CSV_VIEWER_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Zstd:
+#ifdef CSV_VIEWER_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    case None:
+        return true;
+    }
+    return false;
+}
+
+CompressedFile::CompressedFile(const char *data, qint64 size, Compression compression)
+    : m_data(data)
+    , m_size(size)
+    , m_compression(compression)
+{
+    // 文件开头总是一个访问点
+    m_accessPoints.append(AccessPoint());
+
+    if (m_compression == Zstd && loadSeekTable()) {
+        qDebug() << "zstd seek table:" << m_seekTableFrames << "frames," << m_accessPoints.size() << "access points";
+    }
+}
+
+bool CompressedFile::loadSeekTable()
+{
+    // 跳转表位于最后一个可跳过帧中：帧头(8) + 每帧一项(压缩大小, 解压后大小[, 校验和]) + 末尾标记
+    if (m_size < 8 + ZSTD_SEEK_TABLE_FOOTER_SIZE) {
+        return false;
+    }
+    const char *footer = m_data + m_size - ZSTD_SEEK_TABLE_FOOTER_SIZE;
+    if (readLittleEndian32(footer + 5) != ZSTD_SEEKABLE_MAGIC) {
+        return false;
+    }
+    const qint64 frames = readLittleEndian32(footer);
+    const quint8 descriptor = static_cast<quint8>(footer[4]);
+    if (descriptor & 0x7C) { // 保留位必须为0
+        return false;
+    }
+    const qint64 entrySize = (descriptor & 0x80) ? 12 : 8;
+    const qint64 tableSize = frames * entrySize + ZSTD_SEEK_TABLE_FOOTER_SIZE;
+    const qint64 tableStart = m_size - tableSize - 8;
+    if (tableStart < 0 || readLittleEndian32(m_data + tableStart) != ZSTD_SEEK_TABLE_MAGIC
+        || readLittleEndian32(m_data + tableStart + 4) != tableSize) {
+        return false;
+    }
+
+    // 各帧的起始位置，相邻访问点之间至少间隔ACCESS_POINT_SPAN的输出
+    QVector<AccessPoint> points;
+    points.append(AccessPoint());
+    AccessPoint point;
+    const char *entry = m_data + tableStart + 8;
+    for (qint64 frame = 0; frame < frames; ++frame, entry += entrySize) {
+        if (point.out - points.last().out >= ACCESS_POINT_SPAN) {
+            points.append(point);
+        }
+        point.in += readLittleEndian32(entry);
+        point.out += readLittleEndian32(entry + 4);
+    }
+
+    // 各帧的压缩大小之和必须正好到跳转表为止，否则跳转表与文件内容不符
+    if (point.in != tableStart) {
+        qDebug() << "Ignoring inconsistent zstd seek table";
+        return false;
+    }
+
+    m_accessPoints = points;
+    m_seekTableFrames = static_cast<int>(qMin<qint64>(frames, INT_MAX));
+    return true;
+}
+
+CompressedFile::~CompressedFile() = default;
+
+CompressedFile::Compression CompressedFile::compression() const
+{
+    return m_compression;
+}
+
+qint64 CompressedFile::compressedSize() const
+{
+    return m_size;
+}
+
+bool CompressedFile::hasRandomAccess() const
+{
+    if (m_compression != Zstd) {
+        return true;
+    }
+    return m_seekTableFrames > 1 || m_multiFrame.loadRelaxed() != 0;
+}
+
+QByteArray CompressedFile::read(qint64 offset, qint64 length)
+{
+    QByteArray result;
+    if (offset < 0 || length <= 0) {
+        return result;
+    }
+
+    // 目标在当前解压位置之前，或后台扫描已经登记了更近的访问点时，重新定位
+    const AccessPoint point = nearestAccessPoint(offset);
+    if (!m_cursor || offset < m_cursor->position() || point.out > m_cursor->position()) {
+        m_cursor.reset(new Decoder(this, false));
+        if (!m_cursor->seek(point)) {
+            qDebug() << "Failed to seek compressed file:" << m_cursor->errorString();
+            m_cursor.reset();
+            return result;
+        }
+    }
+
+    // 解压并丢弃目标之前的数据
+    QByteArray scratch;
+    while (m_cursor->position() < offset) {
+        scratch.resize(qMin<qint64>(offset - m_cursor->position(), INPUT_CHUNK_SIZE * 4));
+        if (m_cursor->read(scratch.data(), scratch.size()) <= 0) {
+            return result;
+        }
+    }
+
+    result.resize(length);
+    const qint64 bytesRead = m_cursor->read(result.data(), length);
+    result.resize(qMax<qint64>(bytesRead, 0));
+    if (m_cursor->hasError()) {
+        qDebug() << "Failed to decompress file:" << m_cursor->errorString();
+    }
+    return result;
+}
+
+void CompressedFile::addAccessPoint(const AccessPoint &point)
+{
+    QMutexLocker locker(&m_mutex);
+    if (point.out > m_accessPoints.last().out) {
+        m_accessPoints.append(point);
+    }
+}
+
+CompressedFile::AccessPoint CompressedFile::nearestAccessPoint(qint64 offset) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = std::upper_bound(m_accessPoints.constBegin(), m_accessPoints.constEnd(), offset,
+                               [](qint64 value, const AccessPoint &point) { return value < point.out; });
+    return *(it - 1);
+}
+
+CompressedFile::Decoder::Decoder(CompressedFile *file, bool recordAccessPoints)
+    : m_file(file)
+    , m_recordAccessPoints(recordAccessPoints)
+    , m_state(new State)
+{
+    seek(AccessPoint());
+}
+
+CompressedFile::Decoder::~Decoder()
+{
+#ifdef CSV_VIEWER_HAVE_ZLIB
+    if (m_state->zstreamInitialized) {
+        inflateEnd(&m_state->zstream);
+    }
+#endif
+#ifdef CSV_VIEWER_HAVE_ZSTD
+    if (m_state->dctx) {
+        ZSTD_freeDCtx(m_state->dctx);
+    }
+#endif
+}
+
+bool CompressedFile::Decoder::seek(const AccessPoint &point)
+{
+    m_in = point.in;
+    m_out = point.out;
+    m_lastAccessPoint = point.out;
+    m_finished = false;
+    m_error.clear();
+    m_window = point.window;
+
+    switch (m_file->m_compression) {
+    case Gzip: {
+#ifdef CSV_VIEWER_HAVE_ZLIB
+        State &state = *m_state;
+        if (state.zstreamInitialized) {
+            inflateEnd(&state.zstream);
+            state.zstreamInitialized = false;
+        }
+        memset(&state.zstream, 0, sizeof(state.zstream));
+
+        // 文件开头按gzip格式解析头部；其余访问点处于deflate数据中间，使用原始模式并恢复状态
+        state.raw = point.out > 0;
+        if (inflateInit2(&state.zstream, state.raw ? -15 : 15 + 16) != Z_OK) {
+            m_error = "Failed to initialize gzip decoder";
+            return false;
+        }
+        state.zstreamInitialized = true;
+
+        if (state.raw) {
+            if (point.bits > 0) {
+                const int byte = static_cast<unsigned char>(m_file->m_data[point.in - 1]);
+                inflatePrime(&state.zstream, point.bits, byte >> (8 - point.bits));
+            }
+            inflateSetDictionary(&state.zstream, reinterpret_cast<const Bytef *>(point.window.constData()),
+                                 static_cast<uInt>(point.window.size()));
+        }
+        return true;
+#else
+        m_error = "gzip support is not available in this build";
+        return false;
+#endif
+    }
+    case Zstd: {
+#ifdef CSV_VIEWER_HAVE_ZSTD
+        // zstd的访问点都在帧起始位置，重置会话即可从这里开始解压
+        if (!m_state->dctx) {
+            m_state->dctx = ZSTD_createDCtx();
+        }
+        if (!m_state->dctx) {
+            m_error = "Failed to initialize zstd decoder";
+            return false;
+        }
+        ZSTD_DCtx_reset(m_state->dctx, ZSTD_reset_session_only);
+        m_state->frameFinished = true;
+        return true;
+#else
+        m_error = "zstd support is not available in this build";
+        return false;
+#endif
+    }
+    case None:
+        return true;
+    }
+    return false;
+}
+
+qint64 CompressedFile::Decoder::read(char *buffer, qint64 capacity)
+{
+    if (m_finished || !m_error.isEmpty() || capacity <= 0) {
+        return 0;
+    }
+
+    switch (m_file->m_compression) {
+    case Gzip:
+        return readGzip(buffer, capacity);
+    case Zstd:
+        return readZstd(buffer, capacity);
+    case None: {
+        // 未压缩的数据直接复制
+        const qint64 length = qMin(capacity, m_file->m_size - m_in);
+        memcpy(buffer, m_file->m_data + m_in, static_cast<size_t>(length));
+        m_in += length;
+        m_out += length;
+        m_finished = (m_in >= m_file->m_size);
+        return length;
+    }
+    }
+    return 0;
+}
+
+qint64 CompressedFile::Decoder::readGzip(char *buffer, qint64 capacity)
+{
+#ifdef CSV_VIEWER_HAVE_ZLIB
+    State &state = *m_state;
+    z_stream &stream = state.zstream;
+    qint64 produced = 0;
+
+    while (produced < capacity && !m_finished) {
+        if (m_in >= m_file->m_size) {
+            m_error = "Unexpected end of gzip data";
+            break;
+        }
+
+        const uInt inputSize = static_cast<uInt>(qMin(INPUT_CHUNK_SIZE, m_file->m_size - m_in));
+        const uInt outputSize = static_cast<uInt>(qMin<qint64>(capacity - produced, UINT_MAX));
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(m_file->m_data + m_in));
+        stream.avail_in = inputSize;
+        stream.next_out = reinterpret_cast<Bytef *>(buffer + produced);
+        stream.avail_out = outputSize;
+
+        // 记录访问点时按块解压，每个块结束时都有机会保存状态
+        const int ret = inflate(&stream, m_recordAccessPoints ? Z_BLOCK : Z_NO_FLUSH);
+        const qint64 consumed = inputSize - stream.avail_in;
+        const qint64 output = outputSize - stream.avail_out;
+        m_in += consumed;
+        if (m_recordAccessPoints) {
+            updateWindow(buffer + produced, output);
+        }
+        produced += output;
+        m_out += output;
+
+        if (ret == Z_STREAM_END) {
+            // 原始模式下需要自行跳过8字节的gzip尾部
+            if (state.raw) {
+                m_in += 8;
+            }
+            // 多个gzip成员首尾相接时继续解压下一个成员
+            if (m_in + 2 <= m_file->m_size && detect(m_file->m_data + m_in, m_file->m_size - m_in) == Gzip) {
+                inflateReset2(&stream, 15 + 16);
+                state.raw = false;
+                continue;
+            }
+            m_finished = true;
+            break;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            m_error = QString("gzip data error: %1").arg(stream.msg ? stream.msg : "unknown");
+            break;
+        }
+        if (ret == Z_BUF_ERROR && consumed == 0 && output == 0) {
+            m_error = "gzip data is truncated";
+            break;
+        }
+
+        // 块边界（不是最后一个块）处保存访问点
+        const bool atBlockBoundary = (stream.data_type & 128) && !(stream.data_type & 64);
+        if (m_recordAccessPoints && atBlockBoundary && m_out - m_lastAccessPoint >= ACCESS_POINT_SPAN) {
+            AccessPoint point;
+            point.out = m_out;
+            point.in = m_in;
+            point.bits = stream.data_type & 7;
+            point.window = m_window;
+            m_file->addAccessPoint(point);
+            m_lastAccessPoint = m_out;
+        }
+    }
+
+    return produced;
+#else
+    Q_UNUSED(buffer);
+    Q_UNUSED(capacity);
+    m_error = "gzip support is not available in this build";
+    return 0;
+#endif
+}
+
+qint64 CompressedFile::Decoder::readZstd(char *buffer, qint64 capacity)
+{
+#ifdef CSV_VIEWER_HAVE_ZSTD
+    qint64 produced = 0;
+
+    while (produced < capacity && !m_finished) {
+        if (m_in >= m_file->m_size) {
+            if (!m_state->frameFinished) {
+                m_error = "zstd data is truncated";
+            }
+            m_finished = true;
+            break;
+        }
+
+        // 帧起始位置保存访问点，从这里可以独立解压
+        if (m_recordAccessPoints && m_state->frameFinished && m_out - m_lastAccessPoint >= ACCESS_POINT_SPAN) {
+            AccessPoint point;
+            point.out = m_out;
+            point.in = m_in;
+            m_file->addAccessPoint(point);
+            m_lastAccessPoint = m_out;
+        }
+
+        ZSTD_inBuffer input = { m_file->m_data + m_in, static_cast<size_t>(qMin(INPUT_CHUNK_SIZE, m_file->m_size - m_in)), 0 };
+        ZSTD_outBuffer output = { buffer + produced, static_cast<size_t>(capacity - produced), 0 };
+        const size_t ret = ZSTD_decompressStream(m_state->dctx, &output, &input);
+        if (ZSTD_isError(ret)) {
+            m_error = QString("zstd data error: %1").arg(ZSTD_getErrorName(ret));
+            break;
+        }
+
+        m_in += input.pos;
+        produced += output.pos;
+        m_out += output.pos;
+        m_state->frameFinished = (ret == 0);
+
+        // 一帧结束后还有数据帧（不是末尾的跳转表等可跳过帧），之后的帧起始位置都可以作为访问点
+        if (m_recordAccessPoints && m_state->frameFinished && m_in < m_file->m_size
+            && !isSkippableFrame(m_file->m_data + m_in, m_file->m_size - m_in)) {
+            m_file->m_multiFrame.storeRelaxed(1);
+        }
+
+        if (input.pos == 0 && output.pos == 0) {
+            m_error = "zstd decoder made no progress";
+            break;
+        }
+    }
+
+    return produced;
+#else
+    Q_UNUSED(buffer);
+    Q_UNUSED(capacity);
+    m_error = "zstd support is not available in this build";
+    return 0;
+#endif
+}
+
+void CompressedFile::Decoder::updateWindow(const char *data, qint64 length)
+{
+    if (length >= WINDOW_SIZE) {
+        m_window = QByteArray(data + length - WINDOW_SIZE, WINDOW_SIZE);
+        return;
+    }
+    m_window.append(data, length);
+    if (m_window.size() > WINDOW_SIZE) {
+        m_window.remove(0, m_window.size() - WINDOW_SIZE);
+    }
+}
+
+qint64 CompressedFile::Decoder::position() const
+{
+    return m_out;
+}
+
+qint64 CompressedFile::Decoder::compressedPosition() const
+{
+    return m_in;
+}
+
+bool CompressedFile::Decoder::hasError() const
+{
+    return !m_error.isEmpty();
+}
+
+QString CompressedFile::Decoder::errorString() const
+{
+    return m_error;
+}
@@ -0,0 +1,115 @@
+#ifndef COMPRESSEDFILE_H
+#define COMPRESSEDFILE_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+// 压缩文件（gzip/zstd）的解压视图
+// 不生成解压后的副本：首次后台扫描时顺序解压，每隔一段输出保存一个访问点
+// （gzip为块边界处的解压器状态与32KB窗口，zstd为帧起始位置），
+// 之后随机读取时从最近的访问点开始解压，只需解压很少的数据
+// zstd只能从帧起始位置开始解压：带跳转表（seekable格式）的文件打开时即可得到全部访问点，
+// 只有一帧的文件（zstd命令行的默认输出）没有文件开头以外的访问点，随机读取都要从头解压
+class CompressedFile
+{
+public:
+    enum Compression {
+        None,
+        Gzip,
+        Zstd
+    };
+
+    // 根据文件开头的魔数判断压缩格式
+    static Compression detect(const char *data, qint64 size);
+
+    // 当前构建是否支持该压缩格式（依赖zlib/libzstd）
+    static bool isSupported(Compression compression);
+
+    // data为压缩数据的内存映射，在对象使用期间必须保持有效
+    CompressedFile(const char *data, qint64 size, Compression compression);
+    ~CompressedFile();
+
+    Compression compression() const;
+    qint64 compressedSize() const;
+
+    // 是否有文件开头以外的访问点可用：gzip总是可以；zstd需要跳转表中有多帧，
+    // 或后台扫描已经发现了后续的帧（线程安全）
+    bool hasRandomAccess() const;
+
+    // 读取解压后[offset, offset + length)的数据，到达末尾时返回的数据较短
+    // 只在主线程中调用；连续读取时沿用上一次的解压位置
+    QByteArray read(qint64 offset, qint64 length);
+
+    static constexpr qint64 ACCESS_POINT_SPAN = 8 * 1024 * 1024; // 访问点之间的解压输出间隔
+    static constexpr int WINDOW_SIZE = 32 * 1024;                 // deflate的回溯窗口大小
+
+    // 访问点：从这里开始解压可以得到offset处的输出
+    struct AccessPoint {
+        qint64 out = 0;   // 解压后的偏移
+        qint64 in = 0;    // 压缩数据中的偏移
+        int bits = 0;     // gzip：in之前一个字节中尚未使用的位数
+        QByteArray window; // gzip：out之前的最多32KB输出
+    };
+
+    // 顺序解压器；recordAccessPoints时在解压过程中向文件登记访问点（后台扫描使用）
+    class Decoder
+    {
+    public:
+        Decoder(CompressedFile *file, bool recordAccessPoints);
+        ~Decoder();
+
+        // 定位到访问点
+        bool seek(const AccessPoint &point);
+
+        // 解压最多capacity字节，返回实际字节数，0表示到达末尾或出错
+        qint64 read(char *buffer, qint64 capacity);
+
+        qint64 position() const;           // 已输出的解压后偏移
+        qint64 compressedPosition() const; // 已消耗的压缩数据偏移
+        bool hasError() const;
+        QString errorString() const;
+
+    private:
+        struct State;
+
+        qint64 readGzip(char *buffer, qint64 capacity);
+        qint64 readZstd(char *buffer, qint64 capacity);
+
+        // 保留最近的输出作为下一个访问点的窗口
+        void updateWindow(const char *data, qint64 length);
+
+        CompressedFile *m_file;
+        bool m_recordAccessPoints;
+        std::unique_ptr<State> m_state;
+        qint64 m_in = 0;
+        qint64 m_out = 0;
+        qint64 m_lastAccessPoint = 0;
+        bool m_finished = false;
+        QString m_error;
+        QByteArray m_window;
+    };
+
+private:
+    void addAccessPoint(const AccessPoint &point);
+
+    // 读取zstd seekable格式文件末尾的跳转表，按帧起始位置登记访问点；没有跳转表时返回false
+    bool loadSeekTable();
+    AccessPoint nearestAccessPoint(qint64 offset) const;
+
+    const char *m_data;
+    qint64 m_size;
+    Compression m_compression;
+
+    mutable QMutex m_mutex; // 保护m_accessPoints，后台扫描线程追加，主线程查找
+    QVector<AccessPoint> m_accessPoints;
+    int m_seekTableFrames = 0; // zstd跳转表中的帧数，没有跳转表时为0
+    QAtomicInt m_multiFrame;   // 后台扫描发现了第一帧之后的数据帧
+
+    std::unique_ptr<Decoder> m_cursor; // 主线程随机读取使用的解压器
+};
+
+#endif // COMPRESSEDFILE_H
@@ -0,0 +1,829 @@
+#include "CsvDocument.h"
+#include "FastItemDelegate.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QItemSelectionModel>
+#include <QScrollBar>
+#include <QSettings>
+#include <QTimer>
+#include <QVBoxLayout>
+
+CsvDocument::CsvDocument(QObject *parent)
+    : QObject(parent)
+    , m_csvReader(new CsvReader(this))
+    , m_tableModel(new TableModel(this))
+    , m_columnWidthEstimator(new ColumnWidthEstimator(this))
+    , m_columnListModel(new ColumnListModel(this))
+    , m_exporter(new CsvExporter(this))
+    , m_textCache(new CellTextCache(this))
+    , m_readAhead(new ReadAheadScheduler(m_csvReader, m_tableModel, this))
+    , m_copier(new SelectionCopier(this))
+    , m_facetIndex(new FacetIndex(this))
+{
+    // 表格视图放在一个容器中，筛选前隐藏视图时标签页仍然保留
+    m_widget = new QWidget();
+    QVBoxLayout *layout = new QVBoxLayout(m_widget);
+    layout->setContentsMargins(0, 0, 0, 0);
+    m_view = new QTableView(m_widget);
+    layout->addWidget(m_view);
+
+    // 设置表格模型
+    m_view->setModel(m_tableModel);
+
+    // 连接表格视图的垂直滚动条信号，滚动到未加载的区域时加载数据
+    connect(m_view->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        const int direction = value - m_lastScrollValue;
+        m_lastScrollValue = value;
+        loadRowsForViewport();
+        prefetchCellText(direction);
+    });
+
+    // 预读的屏数可以在配置文件中调整
+    QSettings settings("csv-viewer", "csv-viewer");
+    m_readAhead->setScreens(settings.value("readAhead/screensAhead", ReadAheadScheduler::DEFAULT_SCREENS_AHEAD).toInt(),
+                            settings.value("readAhead/screensBehind", ReadAheadScheduler::DEFAULT_SCREENS_BEHIND).toInt());
+
+    // 列宽估算完成后应用到可见列
+    connect(m_columnWidthEstimator, &ColumnWidthEstimator::widthsReady, this, [this](const QVector<int> &widths) {
+        m_columnWidths = widths;
+        applyColumnWidths();
+    });
+
+    // 估算的总行数变化时同步更新模型行数，滚动条始终反映整个文件；按值筛选时行数为匹配的行数
+    connect(m_csvReader, &CsvReader::estimatedTotalRowsChanged, this, [this](int rows) {
+        if (!hasRowFilter()) {
+            m_tableModel->setTotalRowCount(rows);
+        }
+    });
+
+    // 行索引完成后，按估算位置加载的页可能有偏差，重新加载当前视口（按值筛选的页按偏移读取，不受影响）
+    connect(m_csvReader, &CsvReader::rowIndexCompleted, this, [this]() {
+        // 扫描完整个文件仍没有第一帧以外的访问点，确定是单帧的zstd文件
+        if (!m_csvReader->supportsRandomAccess()) {
+            emit statusMessage(tr("该zstd文件只有一帧，只能从头顺序解压：不支持跳转，滚动到远处的行需要较长时间"));
+        }
+        if (hasRowFilter()) {
+            return;
+        }
+        m_tableModel->clearPages();
+        loadRowsForViewport();
+    });
+
+    // 后台计数出错时总行数只是估算值
+    connect(m_csvReader, &CsvReader::rowCountFailed, this, [this](const QString &error) {
+        emit statusMessage(tr("统计总行数时读取文件出错，总行数为估算值：%1").arg(error));
+    });
+
+    // 容错解析发现格式错误的行时提示，可以通过导航菜单逐个定位
+    connect(m_csvReader, &CsvReader::malformedRowsFound, this, [this](int total) {
+        emit statusMessage(tr("已发现 %1 行格式错误（字段数不符、引号不配对或编码无效），可通过导航菜单定位").arg(total));
+    });
+
+    // 页被全局内存预算淘汰时，视口内的页需要重新加载
+    connect(m_tableModel, &TableModel::pageEvicted, this, &CsvDocument::onPageEvicted);
+
+    // 后台扫描出的倒排表只在仍是最近一次请求的值时生效
+    connect(m_facetIndex, &FacetIndex::postingsReady, this, [this](int column, const QByteArray &value, const QVector<qint64> &offsets) {
+        if (column == m_pendingRowFilterColumn && value == m_pendingRowFilterValue) {
+            applyRowFilter(column, value, offsets);
+        }
+    });
+    connect(m_facetIndex, &FacetIndex::facetsReady, this, &CsvDocument::facetsChanged);
+    connect(m_facetIndex, &FacetIndex::facetsProgress, this, &CsvDocument::facetsProgress);
+    connect(m_facetIndex, &FacetIndex::failed, this, [this](const QString &error) {
+        m_pendingRowFilterColumn = -1;
+        emit statusMessage(tr("统计值分布失败: %1").arg(error));
+    });
+
+    // 表格视图性能优化设置
+    m_view->setSortingEnabled(false); // 禁用排序，需要时再启用
+    m_view->setSelectionMode(QAbstractItemView::ExtendedSelection); // 设置选择模式
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers); // 禁用编辑
+    m_view->setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel); // 像素滚动
+    m_view->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel); // 像素滚动
+    m_view->setAttribute(Qt::WA_AlwaysShowToolTips);
+
+    // 设置表格字体为支持中文的字体
+    QFont font = m_view->font();
+    font.setFamily(QStringLiteral("SimHei")); // 黑体
+    m_view->setFont(font);
+
+    // 渲染快速路径：轻量级委托直接绘制文本；所有行等高，视图无需逐行计算行高
+    FastItemDelegate *delegate = new FastItemDelegate(m_view);
+    delegate->setTextCache(m_textCache);
+    m_view->setItemDelegate(delegate);
+
+    // 单元格文本缓存的失效：列宽变化失效该列，数据变化失效对应的行，模型重置全部失效
+    connect(m_view->horizontalHeader(), &QHeaderView::sectionResized, m_textCache, [this](int column) {
+        m_textCache->invalidateColumn(column);
+    });
+    connect(m_tableModel, &QAbstractItemModel::dataChanged, m_textCache, [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+        m_textCache->invalidateRows(topLeft.row(), bottomRight.row());
+    });
+    connect(m_tableModel, &QAbstractItemModel::rowsRemoved, m_textCache, [this](const QModelIndex &, int first, int last) {
+        m_textCache->invalidateRows(first, last);
+    });
+    connect(m_tableModel, &QAbstractItemModel::modelReset, m_textCache, &CellTextCache::invalidate);
+    m_view->setWordWrap(false);
+    m_view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_view->verticalHeader()->setDefaultSectionSize(m_view->fontMetrics().height() + 6);
+
+    // 初始隐藏表格数据，直到用户点击筛选按钮
+    m_view->setVisible(false);
+}
+
+CsvDocument::~CsvDocument()
+{
+    // 先停止后台任务，再释放视图
+    m_facetIndex->clear();
+    m_readAhead->cancel();
+    m_copier->cancel();
+    m_exporter->cancel();
+    m_columnWidthEstimator->cancel();
+    delete m_widget;
+}
+
+bool CsvDocument::load(const QString &filePath, CsvReader::Encoding encoding)
+{
+    m_filePath = filePath;
+    m_csvReader->setEncoding(encoding);
+
+    // 预读、复制和列宽采样任务引用读取器的内存映射，重新加载前必须停止
+    m_readAhead->cancel();
+    m_copier->cancel();
+    m_columnWidthEstimator->cancel();
+
+    // 分面和倒排表属于之前的文件内容和格式
+    m_facetIndex->clear();
+    m_facetSourceReady = false;
+    m_rowFilterColumn = -1;
+    m_rowFilterValue.clear();
+    m_rowFilterOffsets = QVector<qint64>();
+    m_pendingRowFilterColumn = -1;
+    m_pendingRowFilterValue.clear();
+    emit facetsChanged();
+
+    // 计算列按之前的列名编译，重新加载后列可能已经不同
+    m_computedColumns.clear();
+    m_facetIndex->setComputedColumns(m_computedColumns);
+
+    if (!m_csvReader->loadFile(filePath)) {
+        return false;
+    }
+
+    displayData(false); // 默认不加载全部数据
+    return true;
+}
+
+bool CsvDocument::reload(CsvReader::Encoding encoding)
+{
+    return load(m_filePath, encoding);
+}
+
+QWidget *CsvDocument::widget() const
+{
+    return m_widget;
+}
+
+QTableView *CsvDocument::view() const
+{
+    return m_view;
+}
+
+CsvReader *CsvDocument::reader() const
+{
+    return m_csvReader;
+}
+
+TableModel *CsvDocument::model() const
+{
+    return m_tableModel;
+}
+
+ColumnListModel *CsvDocument::columnListModel() const
+{
+    return m_columnListModel;
+}
+
+QString CsvDocument::filePath() const
+{
+    return m_filePath;
+}
+
+QString CsvDocument::fileName() const
+{
+    return QFileInfo(m_filePath).fileName();
+}
+
+QString CsvDocument::lastError() const
+{
+    return m_csvReader->getLastError();
+}
+
+bool CsvDocument::isFiltered() const
+{
+    return m_isFiltered;
+}
+
+QStringList CsvDocument::filteredHeaders() const
+{
+    return m_filteredHeaders;
+}
+
+int CsvDocument::currentRow() const
+{
+    return qMax(m_view->rowAt(0), 0);
+}
+
+void CsvDocument::setActive(bool active)
+{
+    if (!active) {
+        m_tableModel->setViewport(-1, -1);
+        return;
+    }
+    if (m_isFiltered) {
+        loadRowsForViewport();
+    }
+}
+
+bool CsvDocument::hasRowSelection() const
+{
+    return m_view->selectionModel() && m_view->selectionModel()->hasSelection();
+}
+
+bool CsvDocument::startExport(const QString &outputPath, ExportOptions::Format format, bool selectedRowsOnly)
+{
+    // 导出直接从CSV源文件的内存映射按字节片段解析，列式文件和压缩文件不支持；
+    // 导出的行范围是文件中的行号，按值筛选时不对应
+    if (!m_isFiltered || hasRowFilter() || m_tableModel->columnCount() == 0 || m_csvReader->isColumnar() || m_csvReader->isCompressed()) {
+        return false;
+    }
+
+    ExportSource source;
+    source.filePath = m_filePath;
+    source.dataStart = m_csvReader->dataStartOffset();
+    source.parse = m_csvReader->parseSettings();
+    source.headers = m_csvReader->getHeaders();
+    source.computed = m_computedColumns;
+
+    ExportOptions options;
+    options.outputPath = outputPath;
+    options.format = format;
+    for (int column = 0; column < m_tableModel->columnCount(); ++column) {
+        options.columns.append(m_tableModel->sourceColumn(column));
+    }
+
+    // 选择以范围的形式保存，全选几千万行也只有一个范围
+    if (selectedRowsOnly && hasRowSelection()) {
+        const QItemSelection selection = m_view->selectionModel()->selection();
+        for (const QItemSelectionRange &range : selection) {
+            options.rowRanges.append(qMakePair(range.top(), range.bottom()));
+        }
+    }
+
+    m_exporter->start(source, options);
+    emit statusMessage(tr("正在导出到 %1 ...").arg(outputPath));
+    return true;
+}
+
+CsvExporter *CsvDocument::exporter() const
+{
+    return m_exporter;
+}
+
+bool CsvDocument::startCopySelection()
+{
+    CsvReader::ReadAheadSource source;
+    if (!m_isFiltered || hasRowFilter() || !hasRowSelection() || !m_csvReader->readAheadSource(&source)) {
+        return false;
+    }
+
+    // 选择按范围保存，不逐个访问QModelIndex；输出所有选中行与所有选中列的交叉
+    const QItemSelection selection = m_view->selectionModel()->selection();
+    QVector<QPair<int, int>> rowRanges;
+    QVector<bool> selectedColumns(m_tableModel->columnCount(), false);
+    for (const QItemSelectionRange &range : selection) {
+        rowRanges.append(qMakePair(range.top(), range.bottom()));
+        for (int column = range.left(); column <= range.right(); ++column) {
+            selectedColumns[column] = true;
+        }
+    }
+    QVector<int> columns;
+    for (int column = 0; column < selectedColumns.size(); ++column) {
+        if (selectedColumns.at(column)) {
+            columns.append(m_tableModel->sourceColumn(column));
+        }
+    }
+
+    m_copier->start(source, rowRanges, columns, m_computedColumns);
+    return true;
+}
+
+SelectionCopier *CsvDocument::copier() const
+{
+    return m_copier;
+}
+
+bool CsvDocument::aggregateSource(AggregateSource *source) const
+{
+    // 聚合需要并行访问文件的任意位置，压缩文件只能顺序解压
+    if (m_csvReader->isCompressed() || m_csvReader->getHeaders().isEmpty()) {
+        return false;
+    }
+
+    source->filePath = m_filePath;
+    source->headers = m_csvReader->getHeaders();
+    source->columnar = m_csvReader->isColumnar();
+    if (!source->columnar) {
+        source->dataStart = m_csvReader->dataStartOffset();
+        source->parse = m_csvReader->parseSettings();
+    }
+    return true;
+}
+
+bool CsvDocument::requestFacets()
+{
+    if (!prepareFacetIndex()) {
+        return false;
+    }
+    m_facetIndex->computeFacets();
+    return true;
+}
+
+FacetIndex *CsvDocument::facetIndex() const
+{
+    return m_facetIndex;
+}
+
+bool CsvDocument::prepareFacetIndex()
+{
+    if (m_facetSourceReady) {
+        return true;
+    }
+
+    // 分面和倒排表都需要并行扫描整个文件，记录偏移只对未压缩的CSV文件有意义
+    AggregateSource source;
+    if (!aggregateSource(&source) || source.columnar) {
+        return false;
+    }
+    m_facetIndex->setSource(source);
+    m_facetIndex->setComputedColumns(m_computedColumns);
+    m_facetSourceReady = true;
+    return true;
+}
+
+bool CsvDocument::addComputedColumn(const QString &name, const QString &expression, QString *error)
+{
+    // 列式文件只读取投影的列，表达式引用的列不一定已经读入
+    if (m_csvReader->isColumnar()) {
+        *error = tr("列式文件不支持计算列");
+        return false;
+    }
+    const QStringList headers = m_csvReader->getHeaders();
+    if (headers.isEmpty()) {
+        *error = tr("没有打开的文件");
+        return false;
+    }
+    const QString trimmedName = name.trimmed();
+    if (trimmedName.isEmpty()) {
+        *error = tr("列名不能为空");
+        return false;
+    }
+    bool duplicate = headers.contains(trimmedName);
+    for (const ComputedColumn &computed : std::as_const(m_computedColumns)) {
+        duplicate = duplicate || computed.name == trimmedName;
+    }
+    if (duplicate) {
+        *error = tr("已经存在名为 %1 的列").arg(trimmedName);
+        return false;
+    }
+
+    QElapsedTimer compileTimer;
+    compileTimer.start();
+
+    const std::shared_ptr<const Expression> compiled = Expression::compile(expression, headers, error);
+    if (!compiled) {
+        return false;
+    }
+    m_computedColumns.append(ComputedColumn{trimmedName, compiled});
+    qDebug() << "Compiled computed column" << trimmedName << "in" << compileTimer.elapsed() << "ms";
+
+    // 模型、分面索引和列选择面板使用相同的列号：表头列数 + 第几个计算列
+    m_tableModel->setComputedColumns(m_computedColumns);
+    m_facetIndex->setComputedColumns(m_computedColumns);
+    m_columnListModel->appendColumn(trimmedName);
+
+    // 已经在显示数据时直接加入可见列，只计算视口内的行
+    if (m_isFiltered) {
+        applyFilter();
+    }
+    emit statusMessage(tr("已添加计算列 %1").arg(trimmedName));
+    return true;
+}
+
+QVector<ComputedColumn> CsvDocument::computedColumns() const
+{
+    return m_computedColumns;
+}
+
+QString CsvDocument::columnName(int column) const
+{
+    const QStringList headers = m_csvReader->getHeaders();
+    if (column < headers.size()) {
+        return headers.value(column);
+    }
+    return m_computedColumns.value(column - headers.size()).name;
+}
+
+bool CsvDocument::filterByComputedColumn(int k)
+{
+    if (k < 0 || k >= m_computedColumns.size() || !prepareFacetIndex()) {
+        return false;
+    }
+    // 计算列的倒排表收集条件为真的记录，值固定为true
+    setRowFilter(m_csvReader->getHeaders().size() + k, QByteArrayLiteral("true"));
+    return true;
+}
+
+void CsvDocument::setRowFilter(int column, const QByteArray &value)
+{
+    if (column == m_rowFilterColumn && value == m_rowFilterValue) {
+        clearRowFilter();
+        return;
+    }
+    if (!prepareFacetIndex()) {
+        return;
+    }
+
+    QVector<qint64> offsets;
+    if (m_facetIndex->postings(column, value, &offsets)) {
+        applyRowFilter(column, value, offsets);
+        return;
+    }
+
+    m_pendingRowFilterColumn = column;
+    m_pendingRowFilterValue = value;
+    emit statusMessage(tr("正在查找 %1 列中值相同的行 ...").arg(columnName(column)));
+}
+
+void CsvDocument::applyRowFilter(int column, const QByteArray &value, const QVector<qint64> &offsets)
+{
+    QElapsedTimer filterTimer;
+    filterTimer.start();
+
+    // 预读按文件中的行号提交页，按值筛选时停止
+    m_readAhead->cancel();
+    m_pendingRowFilterColumn = -1;
+    m_pendingRowFilterValue.clear();
+    m_rowFilterColumn = column;
+    m_rowFilterValue = value;
+    m_rowFilterOffsets = offsets;
+
+    m_tableModel->clearPages();
+    m_tableModel->setTotalRowCount(offsets.size());
+    m_view->scrollToTop();
+    loadRowsForViewport();
+
+    qDebug() << "Applied row filter on column" << column << "(" << offsets.size() << "rows) in" << filterTimer.elapsed() << "ms";
+    emit statusMessage(tr("按 %1 列的值筛选：%2 行（%3 ms）")
+        .arg(columnName(column))
+        .arg(offsets.size())
+        .arg(filterTimer.elapsed()));
+    emit facetsChanged();
+}
+
+void CsvDocument::clearRowFilter()
+{
+    m_pendingRowFilterColumn = -1;
+    m_pendingRowFilterValue.clear();
+    if (!hasRowFilter()) {
+        return;
+    }
+
+    m_rowFilterColumn = -1;
+    m_rowFilterValue.clear();
+    m_rowFilterOffsets = QVector<qint64>();
+
+    m_tableModel->clearPages();
+    m_tableModel->setTotalRowCount(m_csvReader->getEstimatedTotalRows());
+    m_view->scrollToTop();
+    loadRowsForViewport();
+
+    emit statusMessage(tr("已取消按值筛选"));
+    emit facetsChanged();
+}
+
+bool CsvDocument::hasRowFilter() const
+{
+    return m_rowFilterColumn >= 0;
+}
+
+int CsvDocument::rowFilterColumn() const
+{
+    return m_rowFilterColumn;
+}
+
+QByteArray CsvDocument::rowFilterValue() const
+{
+    return m_rowFilterValue;
+}
+
+void CsvDocument::displayData(bool loadAll)
+{
+    // 计时：整个UI显示过程
+    QElapsedTimer uiDisplayTimer;
+    uiDisplayTimer.start();
+
+    // 清空现有数据
+    m_tableModel->clear();
+
+    // 重置筛选状态
+    m_isFiltered = false;
+    m_filteredHeaders.clear();
+
+    // 保存表头和原始数据
+    QStringList headers = m_csvReader->getHeaders();
+
+    // 设置表头
+    m_tableModel->setHeaders(headers);
+
+    // 获取要加载的行数
+    int totalRows = m_csvReader->getRowCount();
+    int rowsToLoad = loadAll ? totalRows : qMin(DEFAULT_ROWS_LIMIT, totalRows);
+
+    // 使用估算的总行数设置模型行数，首帧即可得到正确的滚动条
+    m_tableModel->setTotalRowCount(m_csvReader->getEstimatedTotalRows());
+
+    // 按页加载到表格模型中，读取器中的行与页共享数据
+    if (rowsToLoad > 0) {
+        loadRows(0, rowsToLoad - 1);
+    }
+
+    // 在后台线程中用采样行估算列宽，用户点击筛选时通常已经完成
+    startColumnWidthEstimation();
+
+    // 一次性设置所有列名，默认选中所有列
+    m_columnListModel->setColumns(headers);
+
+    // 初始时不显示任何列，直到用户点击筛选按钮
+    m_tableModel->setVisibleColumns(QVector<int>());
+
+    // 隐藏表格，直到用户点击筛选按钮
+    m_view->setVisible(false);
+    emit statusMessage(tr("请在左侧选择要显示的列，然后点击'筛选'按钮"));
+
+    qint64 uiDisplayTime = uiDisplayTimer.elapsed();
+    qDebug() << "UI display time (loading all data):" << uiDisplayTime << "ms";
+}
+
+void CsvDocument::loadRowsForViewport()
+{
+    if (m_tableModel->rowCount() == 0) {
+        return;
+    }
+
+    // 视口顶部和底部对应的行，视口下方没有行时rowAt返回-1
+    const int firstVisibleRow = qMax(m_view->rowAt(0), 0);
+    int lastVisibleRow = m_view->rowAt(m_view->viewport()->height() - 1);
+    if (lastVisibleRow < 0) {
+        lastVisibleRow = m_tableModel->rowCount() - 1;
+    }
+
+    m_tableModel->setViewport(firstVisibleRow, lastVisibleRow);
+    loadRows(firstVisibleRow, lastVisibleRow);
+    if (!hasRowFilter()) {
+        m_readAhead->viewportChanged(firstVisibleRow, lastVisibleRow);
+    }
+}
+
+void CsvDocument::loadRows(int firstRow, int lastRow)
+{
+    // 计时：加载页数据的过程
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+
+    const int firstPage = firstRow / TableModel::PAGE_SIZE;
+    const int lastPage = lastRow / TableModel::PAGE_SIZE;
+    int pagesLoaded = 0;
+
+    for (int page = firstPage; page <= lastPage; ++page) {
+        if (m_tableModel->isPageLoaded(page)) {
+            continue;
+        }
+
+        // 只读取这一页的数据，无需加载之前的所有行；按值筛选时按倒排表中的偏移读取；
+        // 读不到数据（压缩文件尚未扫描到这里）时不缓存空页，之后滚动到这里会再次尝试
+        const QList<QStringList> rows = hasRowFilter()
+            ? m_csvReader->readRecords(m_rowFilterOffsets.mid(page * TableModel::PAGE_SIZE, TableModel::PAGE_SIZE))
+            : m_csvReader->readRows(page * TableModel::PAGE_SIZE, TableModel::PAGE_SIZE);
+        if (rows.isEmpty()) {
+            continue;
+        }
+        m_tableModel->setPage(page, rows);
+        ++pagesLoaded;
+    }
+
+    if (pagesLoaded > 0) {
+        qDebug() << "Loaded" << pagesLoaded << "pages for rows" << firstRow << "-" << lastRow << "in" << loadTimer.elapsed() << "ms";
+    }
+}
+
+void CsvDocument::prefetchCellText(int direction)
+{
+    if (direction == 0 || m_tableModel->rowCount() == 0) {
+        return;
+    }
+
+    const int firstVisibleRow = qMax(m_view->rowAt(0), 0);
+    int lastVisibleRow = m_view->rowAt(m_view->viewport()->height() - 1);
+    if (lastVisibleRow < 0) {
+        lastVisibleRow = m_tableModel->rowCount() - 1;
+    }
+    const int visibleRows = lastVisibleRow - firstVisibleRow + 1;
+    m_textCache->trim(firstVisibleRow - TEXT_CACHE_KEEP_ROWS, lastVisibleRow + TEXT_CACHE_KEEP_ROWS);
+
+    // 只预取水平方向上可见的列，宽表中视口之外的列不做排版
+    int firstColumn = qMax(m_view->columnAt(0), 0);
+    int lastColumn = m_view->columnAt(m_view->viewport()->width() - 1);
+    if (lastColumn < 0) {
+        lastColumn = m_tableModel->columnCount() - 1;
+    }
+    QVector<int> columns;
+    QVector<int> widths;
+    const int gridWidth = m_view->showGrid() ? 1 : 0;
+    for (int column = firstColumn; column <= lastColumn; ++column) {
+        if (m_view->isColumnHidden(column)) {
+            continue;
+        }
+        columns.append(column);
+        widths.append(FastItemDelegate::textWidth(m_view->columnWidth(column) - gridWidth));
+    }
+
+    const int count = PREFETCH_SCREENS * visibleRows;
+    const int firstRow = direction > 0 ? lastVisibleRow + 1 : qMax(firstVisibleRow - count, 0);
+    const int rowCount = direction > 0 ? count : firstVisibleRow - firstRow;
+    const QList<QStringList> rows = m_tableModel->loadedRows(firstRow, rowCount, columns);
+    m_textCache->prefetch(firstRow, columns, widths, rows, m_view->font());
+}
+
+void CsvDocument::onPageEvicted(int page)
+{
+    if (!m_isFiltered || m_reloadPending || !m_view->isVisible()) {
+        return;
+    }
+
+    const int firstVisibleRow = qMax(m_view->rowAt(0), 0);
+    const int lastVisibleRow = m_view->rowAt(m_view->viewport()->height() - 1);
+    const int firstRow = page * TableModel::PAGE_SIZE;
+    const int lastRow = firstRow + TableModel::PAGE_SIZE - 1;
+    if (lastRow < firstVisibleRow || (lastVisibleRow >= 0 && firstRow > lastVisibleRow)) {
+        return;
+    }
+
+    // 淘汰发生在加载其他页的过程中，推迟到事件循环中重新加载，避免重入
+    m_reloadPending = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_reloadPending = false;
+        loadRowsForViewport();
+    });
+}
+
+void CsvDocument::startColumnWidthEstimation()
+{
+    m_columnWidths.clear();
+
+    // 采样和测量都在后台线程中进行
+    CsvReader::ReadAheadSource source;
+    if (m_csvReader->readAheadSource(&source)) {
+        m_columnWidthEstimator->estimate(m_csvReader->getHeaders(), source, m_csvReader->getEstimatedTotalRows(),
+                                         m_view->font());
+        return;
+    }
+
+    // 压缩文件只能顺序解压，只采样已加载的开头部分
+    m_columnWidthEstimator->estimate(m_csvReader->getHeaders(),
+                                     m_csvReader->getRowsRange(0, ColumnWidthEstimator::SAMPLE_HEAD_ROWS),
+                                     m_view->font());
+}
+
+void CsvDocument::applyColumnWidths()
+{
+    if (!m_isFiltered || m_columnWidths.isEmpty()) {
+        return;
+    }
+
+    QElapsedTimer applyTimer;
+    applyTimer.start();
+
+    // 暂停重绘，所有可见列的宽度设置完后统一刷新一次
+    QHeaderView *header = m_view->horizontalHeader();
+    m_view->setUpdatesEnabled(false);
+    const int columnCount = m_tableModel->columnCount();
+    for (int column = 0; column < columnCount; ++column) {
+        const int sourceColumn = m_tableModel->sourceColumn(column);
+        if (sourceColumn >= 0 && sourceColumn < m_columnWidths.size()
+            && header->sectionSize(column) != m_columnWidths.at(sourceColumn)) {
+            header->resizeSection(column, m_columnWidths.at(sourceColumn));
+        }
+    }
+    m_view->setUpdatesEnabled(true);
+
+    qDebug() << "Applied column widths in" << applyTimer.elapsed() << "ms";
+}
+
+bool CsvDocument::applyFilter()
+{
+    QElapsedTimer filterTimer;
+    filterTimer.start();
+
+    // 收集选中的列
+    const QStringList headers = m_csvReader->getHeaders();
+    const QVector<int> visibleColumns = m_columnListModel->checkedColumns();
+
+    if (visibleColumns.isEmpty()) {
+        return false;
+    }
+
+    m_filteredHeaders.clear();
+    m_filteredHeaders.reserve(visibleColumns.size());
+    for (int column : visibleColumns) {
+        m_filteredHeaders.append(columnName(column));
+    }
+
+    // 通过列投影一次性更新所有列的可见性，不再逐列调用setColumnHidden
+    m_tableModel->setVisibleColumns(visibleColumns);
+    
+    // 列式文件只读取可见的列，可见列变化后已加载的页需要重新读取
+    if (m_csvReader->isColumnar()) {
+        m_csvReader->setColumnProjection(visibleColumns);
+        m_tableModel->clearPages();
+    }
+
+    // 更新筛选状态
+    m_isFiltered = true;
+
+    // 显示表格
+    m_view->setVisible(true);
+
+    // 列宽使用打开文件时在后台采样估算的结果，一次性应用到所有可见列；
+    // 估算尚未完成时，完成后会自动应用
+    applyColumnWidths();
+    loadRowsForViewport();
+
+    qDebug() << "Applied column filter (" << visibleColumns.size() << "of" << headers.size() << "columns) in" << filterTimer.elapsed() << "ms";
+    emit statusMessage(tr("已筛选显示 %1 列数据").arg(m_filteredHeaders.size()));
+    return true;
+}
+
+bool CsvDocument::jumpToNextMalformedRow()
+{
+    // 行号都是文件中的行号，先回到未按值筛选的视图
+    clearRowFilter();
+    bool exact = false;
+    const int row = m_csvReader->nextMalformedRow(currentRow(), &exact);
+    if (row < 0) {
+        return false;
+    }
+    jumpToRow(row);
+    if (!exact) {
+        emit statusMessage(tr("已跳转到格式错误行的估算位置（第 %1 行附近）").arg(row + 1));
+    }
+    return true;
+}
+
+void CsvDocument::jumpToRow(int row)
+{
+    clearRowFilter();
+    if (m_tableModel->rowCount() == 0) {
+        return;
+    }
+
+    // 计时：定位过程
+    QElapsedTimer jumpTimer;
+    jumpTimer.start();
+
+    row = qBound(0, row, m_tableModel->rowCount() - 1);
+
+    // 跳转前后两个视口的距离不能算作滚动速度，否则会向跳转方向过量预读
+    m_readAhead->resetVelocity();
+
+    // 先加载目标行所在的一屏数据，再滚动过去，避免滚动时显示空行
+    const int rowsPerScreen = qMax(m_view->viewport()->height() / qMax(m_view->verticalHeader()->defaultSectionSize(), 1), 1);
+    loadRows(row, qMin(row + rowsPerScreen, m_tableModel->rowCount() - 1));
+
+    // 滚动到第一个可见列上的目标行
+    const int column = qMax(m_view->columnAt(0), 0);
+    const QModelIndex target = m_tableModel->index(row, column);
+    m_view->scrollTo(target, QAbstractItemView::PositionAtTop);
+    m_view->setCurrentIndex(target);
+    loadRowsForViewport();
+
+    qint64 jumpTime = jumpTimer.elapsed();
+    qDebug() << "Jumped to row" << row << "in" << jumpTime << "ms";
+    emit statusMessage(tr("已跳转到第 %1 行%2（%3 ms）")
+        .arg(row + 1)
+        .arg(m_csvReader->isRowCountExact() ? QString() : tr("（估算位置）"))
+        .arg(jumpTime));
+}
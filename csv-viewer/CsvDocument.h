@@ -0,0 +1,182 @@
+#ifndef CSVDOCUMENT_H
+#define CSVDOCUMENT_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTableView>
+#include <QVector>
+
+#include "CsvReader.h"
+#include "TableModel.h"
+#include "ColumnWidthEstimator.h"
+#include "ColumnListModel.h"
+#include "CsvExporter.h"
+#include "Aggregator.h"
+#include "CellTextCache.h"
+#include "ReadAheadScheduler.h"
+#include "SelectionCopier.h"
+#include "FacetIndex.h"
+#include "Expression.h"
+
+// 一个打开的CSV文件
+// 每个标签页对应一个文档，持有该文件的读取器、分页模型、表格视图和列选择状态；
+// 后台任务使用共享线程池，页缓存受全局内存预算约束
+class CsvDocument : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CsvDocument(QObject *parent = nullptr);
+    ~CsvDocument();
+
+    // 加载文件并显示开头的数据
+    bool load(const QString &filePath, CsvReader::Encoding encoding);
+
+    // 以新的编码重新加载当前文件
+    bool reload(CsvReader::Encoding encoding);
+
+    // 标签页中显示的控件，表格视图在筛选前隐藏
+    QWidget *widget() const;
+    QTableView *view() const;
+
+    CsvReader *reader() const;
+    TableModel *model() const;
+    ColumnListModel *columnListModel() const;
+
+    QString filePath() const;
+    QString fileName() const;
+    QString lastError() const;
+
+    bool isFiltered() const;
+    QStringList filteredHeaders() const;
+
+    // 按列选择面板中勾选的列显示，没有勾选任何列时返回false
+    bool applyFilter();
+
+    // 定位到指定行：按字节偏移只加载目标附近的数据，然后滚动到该行
+    void jumpToRow(int row);
+
+    // 定位到当前行之后的下一个已发现的格式错误行，没有时返回false
+    bool jumpToNextMalformedRow();
+
+    // 视口顶部的行
+    int currentRow() const;
+
+    // 标签页切换时调用：不在前台的文档没有视口，内存不足时它的页最先被淘汰
+    void setActive(bool active);
+
+    // 表格中是否选中了行
+    bool hasRowSelection() const;
+
+    // 将当前筛选的列从源文件流式导出到新文件，selectedRowsOnly时只导出选中的行
+    bool startExport(const QString &outputPath, ExportOptions::Format format, bool selectedRowsOnly);
+    CsvExporter *exporter() const;
+
+    // 在后台从文件中读取选中的单元格，生成TSV文本；没有选择或是压缩文件时返回false
+    bool startCopySelection();
+    SelectionCopier *copier() const;
+
+    // 对整个文件分组聚合的数据来源，压缩文件不支持时返回false
+    bool aggregateSource(AggregateSource *source) const;
+
+    // 在后台统计整个文件各列出现最多的值（只统计一次），压缩文件和列式文件不支持时返回false
+    bool requestFacets();
+    FacetIndex *facetIndex() const;
+
+    // 添加计算列：表达式按文件的列名编译，计算列追加到列选择面板末尾并勾选；
+    // 列式文件、名称为空或与已有列重名、表达式有错误时返回false并写入error
+    bool addComputedColumn(const QString &name, const QString &expression, QString *error);
+    QVector<ComputedColumn> computedColumns() const;
+
+    // 原始列（包括计算列）的名称
+    QString columnName(int column) const;
+
+    // 只显示计算列k的条件为真的行，在后台并行扫描整个文件；压缩文件和列式文件不支持时返回false
+    bool filterByComputedColumn(int k);
+
+    // 只显示某列等于value的行，再次选择当前筛选的值时取消；
+    // 倒排表已缓存时立即生效，否则在后台扫描完成后生效
+    void setRowFilter(int column, const QByteArray &value);
+    void clearRowFilter();
+    bool hasRowFilter() const;
+    int rowFilterColumn() const;
+    QByteArray rowFilterValue() const;
+
+signals:
+    // 需要在状态栏中显示的消息
+    void statusMessage(const QString &message);
+
+    // 值分布统计完成、按值筛选生效或取消，以及重新加载后结果作废时发出
+    void facetsChanged();
+    void facetsProgress(qint64 done, qint64 total);
+
+private:
+    // 显示CSV数据
+    void displayData(bool loadAll = false);
+
+    // 确保视口中可见的行已经加载
+    void loadRowsForViewport();
+
+    // 加载[firstRow, lastRow]范围内尚未加载的页
+    void loadRows(int firstRow, int lastRow);
+
+    // 在后台预先排版滚动方向上视口之外的行（direction > 0向下，< 0向上）
+    void prefetchCellText(int direction);
+
+    // 用采样行在后台估算所有列的宽度
+    void startColumnWidthEstimation();
+
+    // 将估算的列宽一次性应用到所有可见列
+    void applyColumnWidths();
+
+    // 页被内存预算淘汰后，如果仍在视口内则重新加载
+    void onPageEvicted(int page);
+
+    // 为分面索引设置数据来源（每次加载后一次），不支持时返回false
+    bool prepareFacetIndex();
+
+    // 以倒排表中的记录作为表格的全部行
+    void applyRowFilter(int column, const QByteArray &value, const QVector<qint64> &offsets);
+
+    QPointer<QWidget> m_widget; // 由标签页控件持有，可能先于文档销毁
+    QTableView *m_view = nullptr;
+    CsvReader *m_csvReader;
+    TableModel *m_tableModel;
+    ColumnWidthEstimator *m_columnWidthEstimator;
+    ColumnListModel *m_columnListModel; // 可勾选的列名列表
+    CsvExporter *m_exporter;
+    CellTextCache *m_textCache; // 视口附近单元格省略排版后的文本
+    ReadAheadScheduler *m_readAhead; // 按滚动速度在后台预读视口前后的页
+    SelectionCopier *m_copier;
+    FacetIndex *m_facetIndex; // 各列的分面统计和按值筛选用过的倒排表
+
+    // 性能优化相关成员
+    const int DEFAULT_ROWS_LIMIT = 5000; // 默认初始加载行数限制
+
+    QVector<int> m_columnWidths; // 估算的列宽，空表示尚未完成
+
+    // 单元格文本预取：滚动方向上视口之外预先排版的屏数，以及视口前后保留的行数
+    const int PREFETCH_SCREENS = 2;
+    const int TEXT_CACHE_KEEP_ROWS = 2000;
+    int m_lastScrollValue = 0;
+
+    QString m_filePath;
+    bool m_reloadPending = false; // 视口重新加载已排队
+
+    // 筛选相关成员
+    QStringList m_filteredHeaders; // 存储筛选后的表头
+    bool m_isFiltered = false; // 标记是否处于筛选状态
+
+    // 按值筛选：当前生效的列和值及匹配记录的偏移，以及正在后台扫描的请求
+    bool m_facetSourceReady = false;
+    int m_rowFilterColumn = -1;
+    QByteArray m_rowFilterValue;
+    QVector<qint64> m_rowFilterOffsets;
+
+    // 计算列，原始列号从表头列数开始
+    QVector<ComputedColumn> m_computedColumns;
+    int m_pendingRowFilterColumn = -1;
+    QByteArray m_pendingRowFilterValue;
+};
+
+#endif // CSVDOCUMENT_H
@@ -0,0 +1,346 @@
+#include "CsvExporter.h"
+#include "BackgroundTask.h"
+#include "ColumnarFile.h"
+#include "RecordScanner.h"
+#include "RowRanges.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+namespace {
+
+// 一块源数据格式化后的结果
+struct ChunkResult {
+    QByteArray bytes;
+    qint64 rows = 0;
+    QVector<ColumnarFile::ColumnChunk> columns; // 列式导出时各列在bytes中的位置
+    QString error;
+};
+
+} // namespace
+
+ExportWriterThread::ExportWriterThread(const ExportSource &source, const ExportOptions &options, QObject *parent)
+    : QThread(parent)
+    , m_source(source)
+    , m_options(options)
+{
+    m_options.rowRanges = RowRanges::normalize(m_options.rowRanges);
+}
+
+void ExportWriterThread::run()
+{
+    QElapsedTimer exportTimer;
+    exportTimer.start();
+
+    QFile sourceFile(m_source.filePath);
+    if (!sourceFile.open(QIODevice::ReadOnly)) {
+        emit exported(false, 0, QString("Failed to open file: %1, error: %2").arg(m_source.filePath).arg(sourceFile.errorString()));
+        return;
+    }
+    const qint64 size = sourceFile.size();
+    const char *data = reinterpret_cast<const char *>(sourceFile.map(0, size));
+    if (!data) {
+        emit exported(false, 0, QString("Failed to map file: %1, error: %2").arg(m_source.filePath).arg(sourceFile.errorString()));
+        return;
+    }
+
+    QFile outputFile(m_options.outputPath);
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        emit exported(false, 0, QString("Failed to create file: %1, error: %2").arg(m_options.outputPath).arg(outputFile.errorString()));
+        return;
+    }
+
+    // 按固定大小切分数据区，每个切分点同步到真实的记录边界
+    const QVector<qint64> bounds = RecordScanner::chunkBounds(data, size, m_source.dataStart, CsvExporter::CHUNK_SIZE,
+                                                              m_source.parse.dialect.quoteChar);
+    const int chunkCount = bounds.size() - 1;
+
+    QThreadPool *pool = BackgroundTask::pool();
+    QMutex mutex;
+    QWaitCondition ready;
+
+    // 只导出部分行时，先并行统计每块的记录数，得到每块第一行的行号
+    const QVector<QPair<int, int>> &ranges = m_options.rowRanges;
+    QVector<qint64> firstRows(chunkCount + 1, 0);
+    if (!ranges.isEmpty()) {
+        QVector<qint64> counts(chunkCount, 0);
+        BackgroundTask::forEachChunk(chunkCount, [&](int chunk, int) {
+            bool inQuotes = false;
+            counts[chunk] = RecordScanner::countRecords(data + bounds[chunk], bounds[chunk + 1] - bounds[chunk],
+                                                        m_source.parse.dialect.quoteChar, inQuotes);
+            return !isInterruptionRequested();
+        });
+        for (int chunk = 0; chunk < chunkCount; ++chunk) {
+            firstRows[chunk + 1] = firstRows[chunk] + counts[chunk];
+        }
+    }
+
+    // 表头；列式文件的列名保存在文件末尾的目录中，开头只写MAGIC
+    const bool columnar = (m_options.format == ExportOptions::Columnar);
+    QStringList outputHeaders;
+    const int headerCount = m_source.headers.size();
+    QVector<bool> neededComputed(m_source.computed.size(), false);
+    for (int column : m_options.columns) {
+        if (column < headerCount) {
+            outputHeaders.append(m_source.headers.at(column));
+        } else {
+            const int k = column - headerCount;
+            outputHeaders.append(m_source.computed.value(k).name);
+            if (k < neededComputed.size()) {
+                neededComputed[k] = true;
+            }
+        }
+    }
+    const bool hasComputed = neededComputed.contains(true);
+    QByteArray headerLine;
+    if (columnar) {
+        headerLine = ColumnarFile::MAGIC;
+    } else if (m_options.includeHeader) {
+        CsvExporter::appendRow(headerLine, outputHeaders, m_options.format);
+    }
+    bool writeFailed = outputFile.write(headerLine) != headerLine.size();
+    qint64 outputPos = headerLine.size();
+    QVector<ColumnarFile::RowGroupInfo> rowGroups;
+
+    // 解析、投影和格式化一块数据（在共享线程池中执行）
+    auto formatChunk = [&](int chunk) -> ChunkResult {
+        ChunkResult result;
+        if (isInterruptionRequested()) {
+            return result;
+        }
+        try {
+            // 只导出部分行时行号按记录计算，解析也必须每条记录恰好得到一行
+            QList<QStringList> rows = ranges.isEmpty()
+                ? CsvReader::parseBytes(data + bounds[chunk], bounds[chunk + 1] - bounds[chunk], m_source.parse)
+                : CsvReader::parseRecords(data + bounds[chunk], bounds[chunk + 1] - bounds[chunk], m_source.parse);
+            // 计算列随各块在线程池中并行计算，只计算导出的列
+            if (hasComputed) {
+                appendComputedValues(m_source.computed, neededComputed, rows);
+            }
+            if (!columnar) {
+                result.bytes.reserve(bounds[chunk + 1] - bounds[chunk]);
+            }
+            QList<QStringList> projectedRows;
+            QStringList fields;
+            qint64 rowNumber = firstRows[chunk];
+            for (const QStringList &row : rows) {
+                if (ranges.isEmpty() || RowRanges::intersects(ranges, rowNumber, rowNumber)) {
+                    fields.clear();
+                    for (int column : m_options.columns) {
+                        fields.append(row.at(column));
+                    }
+                    if (columnar) {
+                        projectedRows.append(fields);
+                    } else {
+                        CsvExporter::appendRow(result.bytes, fields, m_options.format);
+                    }
+                    ++result.rows;
+                }
+                ++rowNumber;
+            }
+
+            // 每块数据编码为一个行组
+            if (columnar && !projectedRows.isEmpty()) {
+                ColumnarFile::RowGroup group = ColumnarFile::encodeRowGroup(projectedRows, m_options.columns.size());
+                result.bytes = std::move(group.bytes);
+                result.columns = std::move(group.columns);
+            }
+        } catch (const std::exception &e) {
+            result.error = QString("Error parsing CSV file: %1").arg(e.what());
+        } catch (...) {
+            result.error = "Unknown error occurred while parsing CSV file";
+        }
+        return result;
+    };
+
+    // 同时处理中的块数有上限，写入跟不上时解析暂停，内存占用保持稳定
+    const int maxInFlight = qMax(2, pool->maxThreadCount() * 2);
+    QHash<int, ChunkResult> results;
+    int submitted = 0;
+    int inFlight = 0;
+    qint64 rowsWritten = 0;
+    QString error;
+
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+    const qint64 PROGRESS_INTERVAL_MS = 200;
+
+    for (int next = 0; next < chunkCount && !writeFailed && error.isEmpty() && !isInterruptionRequested(); ++next) {
+        // 补充提交，跳过与导出行范围没有交集的块
+        while (submitted < chunkCount && submitted - next < maxInFlight) {
+            const int chunk = submitted++;
+            if (!ranges.isEmpty() && !RowRanges::intersects(ranges, firstRows[chunk], firstRows[chunk + 1] - 1)) {
+                QMutexLocker locker(&mutex);
+                results.insert(chunk, ChunkResult());
+                continue;
+            }
+            {
+                QMutexLocker locker(&mutex);
+                ++inFlight;
+            }
+            pool->start([&, chunk]() {
+                ChunkResult result = formatChunk(chunk);
+                QMutexLocker locker(&mutex);
+                results.insert(chunk, std::move(result));
+                --inFlight;
+                ready.wakeAll();
+            }, 1);
+        }
+
+        // 按顺序等待下一块，定期检查取消请求
+        ChunkResult result;
+        {
+            QMutexLocker locker(&mutex);
+            while (!results.contains(next) && !isInterruptionRequested()) {
+                ready.wait(&mutex, 100);
+            }
+            if (!results.contains(next)) {
+                break;
+            }
+            result = results.take(next);
+        }
+
+        if (!result.error.isEmpty()) {
+            error = result.error;
+            break;
+        }
+        if (outputFile.write(result.bytes) != result.bytes.size()) {
+            writeFailed = true;
+            break;
+        }
+        if (columnar && result.rows > 0) {
+            // 目录中记录各列在文件中的绝对位置
+            ColumnarFile::RowGroupInfo info;
+            info.firstRow = rowsWritten;
+            info.rows = result.rows;
+            info.columns = result.columns;
+            for (ColumnarFile::ColumnChunk &column : info.columns) {
+                column.offset += outputPos;
+            }
+            rowGroups.append(info);
+        }
+        outputPos += result.bytes.size();
+        rowsWritten += result.rows;
+
+        if (progressTimer.elapsed() >= PROGRESS_INTERVAL_MS) {
+            emit progress(bounds[next + 1] - m_source.dataStart, size - m_source.dataStart);
+            progressTimer.restart();
+        }
+    }
+
+    // 等待所有已提交的块结束，它们引用了本函数中的局部变量
+    {
+        QMutexLocker locker(&mutex);
+        while (inFlight > 0) {
+            ready.wait(&mutex);
+        }
+    }
+
+    if (columnar && !writeFailed && error.isEmpty() && !isInterruptionRequested()) {
+        const QByteArray footer = ColumnarFile::encodeFooter(outputHeaders, rowGroups, outputPos);
+        writeFailed = outputFile.write(footer) != footer.size();
+    }
+
+    if (writeFailed) {
+        error = QString("Failed to write file: %1, error: %2").arg(m_options.outputPath).arg(outputFile.errorString());
+    } else if (error.isEmpty() && isInterruptionRequested()) {
+        error = "Export cancelled";
+    }
+
+    outputFile.close();
+    if (!error.isEmpty()) {
+        outputFile.remove();
+        qDebug() << "Export failed:" << error;
+        emit exported(false, rowsWritten, error);
+        return;
+    }
+
+    qDebug() << "Exported" << rowsWritten << "rows (" << chunkCount << "chunks) to" << m_options.outputPath
+             << "in" << exportTimer.elapsed() << "ms";
+    emit progress(size - m_source.dataStart, size - m_source.dataStart);
+    emit exported(true, rowsWritten, QString());
+}
+
+CsvExporter::CsvExporter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+CsvExporter::~CsvExporter()
+{
+    cancel();
+}
+
+void CsvExporter::start(const ExportSource &source, const ExportOptions &options)
+{
+    cancel();
+
+    m_thread = new ExportWriterThread(source, options, this);
+    connect(m_thread, &ExportWriterThread::progress, this, &CsvExporter::onProgress);
+    connect(m_thread, &ExportWriterThread::exported, this, &CsvExporter::onExported);
+    m_thread->start();
+}
+
+void CsvExporter::cancel()
+{
+    BackgroundTask::stopThread(m_thread);
+}
+
+bool CsvExporter::isRunning() const
+{
+    return m_thread && m_thread->isRunning();
+}
+
+void CsvExporter::appendRow(QByteArray &out, const QStringList &fields, ExportOptions::Format format)
+{
+    const char delimiter = (format == ExportOptions::Tsv) ? '\t' : ',';
+
+    for (int i = 0; i < fields.size(); ++i) {
+        if (i > 0) {
+            out.append(delimiter);
+        }
+        QByteArray field = fields.at(i).toUtf8();
+
+        if (format == ExportOptions::Tsv) {
+            // TSV没有转义规则，字段中的分隔符和换行替换为空格
+            field.replace('\t', ' ').replace('\n', ' ').replace('\r', ' ');
+            out.append(field);
+            continue;
+        }
+
+        // 包含分隔符、引号或换行的字段加引号，引号写成两个
+        const bool needsQuotes = field.contains(delimiter) || field.contains(QUOTE_CHAR)
+                                 || field.contains('\n') || field.contains('\r');
+        if (needsQuotes) {
+            out.append(QUOTE_CHAR);
+            out.append(field.replace("\"", "\"\""));
+            out.append(QUOTE_CHAR);
+        } else {
+            out.append(field);
+        }
+    }
+    out.append('\n');
+}
+
+void CsvExporter::onProgress(qint64 bytesProcessed, qint64 bytesTotal)
+{
+    // 忽略已取消的旧导出遗留的信号
+    if (sender() != m_thread) {
+        return;
+    }
+
+    emit progress(bytesProcessed, bytesTotal);
+}
+
+void CsvExporter::onExported(bool success, qint64 rowsWritten, const QString &error)
+{
+    if (sender() != m_thread) {
+        return;
+    }
+
+    emit finished(success, rowsWritten, error);
+}
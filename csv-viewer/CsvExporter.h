@@ -0,0 +1,96 @@
+#ifndef CSVEXPORTER_H
+#define CSVEXPORTER_H
+
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+
+#include "CsvReader.h"
+#include "Expression.h"
+
+// 导出的数据来源：独立于CsvReader，导出过程中关闭标签页也不受影响
+struct ExportSource {
+    QString filePath;
+    qint64 dataStart = 0;                           // 数据区起始偏移
+    CsvReader::ParseSettings parse;                 // 解析数据片段使用的编码、方言和列数
+    QStringList headers;
+    QVector<ComputedColumn> computed;               // 计算列，原始列号从表头列数开始
+};
+
+// 导出选项
+struct ExportOptions {
+    enum Format {
+        Csv, // 逗号分隔，按需加引号
+        Tsv, // 制表符分隔，字段中的制表符和换行替换为空格
+        Columnar // 列式二进制文件（见ColumnarFile），重新打开时无需解析
+    };
+
+    QString outputPath;
+    Format format = Csv;
+    QVector<int> columns;                // 导出的原始列，按此顺序输出
+    QVector<QPair<int, int>> rowRanges;  // 导出的行范围[first, last]，为空表示全部行
+    bool includeHeader = true;
+};
+
+// 导出写入线程
+// 把数据区切分为若干块，由共享线程池并行解析、投影和格式化，
+// 本线程按顺序把格式化好的块写入输出文件；同时在处理中的块数有上限，
+// 内存占用与导出的数据量无关
+class ExportWriterThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    ExportWriterThread(const ExportSource &source, const ExportOptions &options, QObject *parent = nullptr);
+
+signals:
+    void progress(qint64 bytesProcessed, qint64 bytesTotal);
+    void exported(bool success, qint64 rowsWritten, const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    ExportSource m_source;
+    ExportOptions m_options;
+};
+
+// 导出器：把当前筛选的列（以及选中的行）从源文件流式导出为新文件
+class CsvExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CsvExporter(QObject *parent = nullptr);
+    ~CsvExporter();
+
+    // 开始导出，之前的导出会被取消
+    void start(const ExportSource &source, const ExportOptions &options);
+
+    // 取消导出并删除不完整的输出文件
+    void cancel();
+
+    bool isRunning() const;
+
+    static constexpr qint64 CHUNK_SIZE = 8 * 1024 * 1024; // 每块源数据的大小
+    static constexpr char QUOTE_CHAR = '"';
+
+    // 格式化一行输出，追加到out末尾
+    static void appendRow(QByteArray &out, const QStringList &fields, ExportOptions::Format format);
+
+signals:
+    void progress(qint64 bytesProcessed, qint64 bytesTotal);
+    void finished(bool success, qint64 rowsWritten, const QString &error);
+
+private slots:
+    void onProgress(qint64 bytesProcessed, qint64 bytesTotal);
+    void onExported(bool success, qint64 rowsWritten, const QString &error);
+
+private:
+    ExportWriterThread *m_thread = nullptr;
+};
+
+#endif // CSVEXPORTER_H
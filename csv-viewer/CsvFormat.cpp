@@ -0,0 +1,359 @@
+#include "CsvFormat.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QSettings>
+#include <QVector>
+#include <cstring>
+
+namespace {
+
+// 样本中的一条记录，不含行尾的换行符
+struct SampleRecord {
+    const char *begin;
+    const char *end;
+};
+
+// 按引号状态把样本切分为记录，最多maxRecords条
+// 样本没有覆盖整个文件时，末尾不完整的记录不参与检测
+QVector<SampleRecord> splitRecords(const char *data, qint64 length, bool complete, char quoteChar, int maxRecords)
+{
+    QVector<SampleRecord> records;
+    const char *end = data + length;
+    const char *begin = data;
+    bool inQuotes = false;
+    for (const char *p = data; p < end && records.size() < maxRecords; ++p) {
+        if (*p == quoteChar) {
+            inQuotes = !inQuotes;
+        } else if (*p == '\n' && !inQuotes) {
+            const char *recordEnd = (p > begin && p[-1] == '\r') ? p - 1 : p;
+            records.append(SampleRecord{begin, recordEnd});
+            begin = p + 1;
+        }
+    }
+    if (complete && begin < end && records.size() < maxRecords) {
+        records.append(SampleRecord{begin, end});
+    }
+    return records;
+}
+
+// 记录中引号外的分隔符个数
+int countDelimiters(const SampleRecord &record, char delimiter, char quoteChar)
+{
+    int count = 0;
+    bool inQuotes = false;
+    for (const char *p = record.begin; p < record.end; ++p) {
+        if (*p == quoteChar) {
+            inQuotes = !inQuotes;
+        } else if (*p == delimiter && !inQuotes) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// 拆分字段，去掉外层引号和两端空白；不处理转义，只用于类型判断
+QList<QByteArray> splitFields(const SampleRecord &record, char delimiter, char quoteChar)
+{
+    QList<QByteArray> fields;
+    const char *fieldBegin = record.begin;
+    bool inQuotes = false;
+    for (const char *p = record.begin; p <= record.end; ++p) {
+        if (p < record.end && *p == quoteChar) {
+            inQuotes = !inQuotes;
+        } else if (p == record.end || (*p == delimiter && !inQuotes)) {
+            QByteArray field = QByteArray(fieldBegin, p - fieldBegin).trimmed();
+            if (field.size() >= 2 && field.startsWith(quoteChar) && field.endsWith(quoteChar)) {
+                field = field.mid(1, field.size() - 2);
+            }
+            fields.append(field);
+            fieldBegin = p + 1;
+        }
+    }
+    return fields;
+}
+
+// 是否为数值（可带符号、小数点和指数）
+bool looksNumeric(const QByteArray &field)
+{
+    const char *p = field.constData();
+    const char *end = p + field.size();
+    if (p < end && (*p == '+' || *p == '-')) {
+        ++p;
+    }
+    bool digits = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        ++p;
+        digits = true;
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            ++p;
+            digits = true;
+        }
+    }
+    if (digits && p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p < end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        const char *exponent = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            ++p;
+        }
+        digits = (p > exponent);
+    }
+    return digits && p == end;
+}
+
+// 首行是否像表头：逐列比较首行与后续数据行的类型和长度，多数列认为是表头时返回true
+// 证据不足时按有表头处理，与之前的默认行为一致
+bool looksLikeHeader(const QVector<SampleRecord> &records, int first, char delimiter, char quoteChar)
+{
+    if (records.size() - first < 2) {
+        return true;
+    }
+
+    const QList<QByteArray> header = splitFields(records.at(first), delimiter, quoteChar);
+    QVector<QList<QByteArray>> rows;
+    for (int i = first + 1; i < records.size(); ++i) {
+        QList<QByteArray> fields = splitFields(records.at(i), delimiter, quoteChar);
+        if (fields.size() == header.size()) {
+            rows.append(fields);
+        }
+    }
+    if (rows.isEmpty()) {
+        return true;
+    }
+
+    int votes = 0;
+    for (int column = 0; column < header.size(); ++column) {
+        const QByteArray &name = header.at(column);
+        if (name.isEmpty()) {
+            // 表头很少有空的列名
+            --votes;
+            continue;
+        }
+
+        bool numeric = true;
+        bool hasValue = false;
+        int length = -1;
+        bool sameLength = true;
+        for (const QList<QByteArray> &row : rows) {
+            const QByteArray &value = row.at(column);
+            if (value.isEmpty()) {
+                continue;
+            }
+            hasValue = true;
+            numeric = numeric && looksNumeric(value);
+            if (length < 0) {
+                length = value.size();
+            } else if (length != value.size()) {
+                sameLength = false;
+            }
+        }
+        if (!hasValue) {
+            continue;
+        }
+
+        if (numeric) {
+            // 数值列：首行不是数值说明是列名
+            votes += looksNumeric(name) ? -1 : 1;
+        } else if (sameLength && rows.size() >= 2) {
+            // 定长文本列（如代码）：首行长度不同说明是列名
+            votes += (name.size() != length) ? 1 : -1;
+        }
+    }
+    return votes >= 0;
+}
+
+QString settingsGroup(const QString &filePath)
+{
+    // 路径中的斜杠在配置中表示分组，使用路径的哈希作为键
+    const QByteArray hash = QCryptographicHash::hash(filePath.toUtf8(), QCryptographicHash::Md5).toHex();
+    return QString("dialects/%1").arg(QString::fromLatin1(hash));
+}
+
+} // namespace
+
+bool CsvFormat::operator==(const CsvFormat &other) const
+{
+    return delimiter == other.delimiter && quoteChar == other.quoteChar
+        && hasHeader == other.hasHeader && commentChar == other.commentChar;
+}
+
+bool CsvFormat::operator!=(const CsvFormat &other) const
+{
+    return !(*this == other);
+}
+
+csv::CSVFormat CsvFormat::toParserFormat() const
+{
+    csv::CSVFormat format;
+    format.delimiter(delimiter).quote(quoteChar).no_header();
+    return format;
+}
+
+qint64 CsvFormat::skipComments(const char *data, qint64 size, qint64 offset) const
+{
+    if (commentChar == '\0') {
+        return offset;
+    }
+    while (offset < size && data[offset] == commentChar) {
+        const void *newline = memchr(data + offset, '\n', static_cast<size_t>(size - offset));
+        if (!newline) {
+            return size;
+        }
+        offset = static_cast<const char *>(newline) - data + 1;
+    }
+    return offset;
+}
+
+QString CsvFormat::description() const
+{
+    auto quoted = [](char c) {
+        return c == '\t' ? QString("'\\t'") : QString("'%1'").arg(QChar::fromLatin1(c));
+    };
+    QString text = QString("delimiter=%1 quote=%2 header=%3")
+        .arg(quoted(delimiter), quoted(quoteChar), QString(hasHeader ? "yes" : "no"));
+    if (commentChar != '\0') {
+        text += QString(" comment=%1").arg(quoted(commentChar));
+    }
+    return text;
+}
+
+CsvFormat CsvSniffer::sniff(const char *data, qint64 length)
+{
+    CsvFormat format;
+    const bool complete = (length <= SAMPLE_SIZE);
+    length = qMin(length, SAMPLE_SIZE);
+    if (length <= 0) {
+        return format;
+    }
+
+    // 引号字符：统计出现在字段开头的双引号和单引号，单引号更多时才使用单引号
+    int doubleQuotes = 0;
+    int singleQuotes = 0;
+    char previous = '\n';
+    for (qint64 i = 0; i < length; ++i) {
+        const char c = data[i];
+        if (previous == '\n' || memchr(DELIMITERS, previous, sizeof(DELIMITERS))) {
+            doubleQuotes += (c == '"');
+            singleQuotes += (c == '\'');
+        }
+        previous = c;
+    }
+    format.quoteChar = (singleQuotes > doubleQuotes) ? '\'' : '"';
+
+    QVector<SampleRecord> records = splitRecords(data, length, complete, format.quoteChar, SAMPLE_RECORDS);
+    if (records.isEmpty()) {
+        // 单条记录超过样本大小，只能用这一段不完整的记录检测分隔符
+        records.append(SampleRecord{data, data + length});
+    }
+
+    // 文件开头以#开始的行可能是注释，先不参与分隔符检测
+    int leadingHashes = 0;
+    while (leadingHashes < records.size() && records.at(leadingHashes).begin < records.at(leadingHashes).end
+           && *records.at(leadingHashes).begin == '#') {
+        ++leadingHashes;
+    }
+    const int first = (leadingHashes < records.size()) ? leadingHashes : 0;
+
+    // 分隔符：每条记录中引号外的分隔符个数应当一致，选出现次数最一致（其次最多）的候选
+    double bestConsistency = 0.0;
+    int bestFields = 0;
+    for (char delimiter : DELIMITERS) {
+        QHash<int, int> frequencies;
+        int nonEmptyRecords = 0;
+        for (int i = first; i < records.size(); ++i) {
+            const SampleRecord &record = records.at(i);
+            if (record.begin == record.end) {
+                continue; // 空行
+            }
+            ++frequencies[countDelimiters(record, delimiter, format.quoteChar)];
+            ++nonEmptyRecords;
+        }
+
+        int mode = 0;
+        int modeFrequency = 0;
+        for (auto it = frequencies.constBegin(); it != frequencies.constEnd(); ++it) {
+            if (it.key() > 0 && (it.value() > modeFrequency || (it.value() == modeFrequency && it.key() > mode))) {
+                mode = it.key();
+                modeFrequency = it.value();
+            }
+        }
+        if (mode == 0) {
+            continue;
+        }
+
+        const double consistency = double(modeFrequency) / nonEmptyRecords;
+        if (consistency > bestConsistency || (consistency == bestConsistency && mode > bestFields)) {
+            bestConsistency = consistency;
+            bestFields = mode;
+            format.delimiter = delimiter;
+        }
+    }
+
+    // 开头的#行中有分隔符个数与数据不同的行时，把这些行当作注释；
+    // 否则#只是第一个列名的一部分（如"#id,name"）
+    if (leadingHashes > 0 && leadingHashes < records.size()) {
+        for (int i = 0; i < leadingHashes; ++i) {
+            if (countDelimiters(records.at(i), format.delimiter, format.quoteChar) != bestFields) {
+                format.commentChar = '#';
+                break;
+            }
+        }
+    }
+
+    const int headerRecord = (format.commentChar != '\0') ? leadingHashes : 0;
+    format.hasHeader = looksLikeHeader(records, headerRecord, format.delimiter, format.quoteChar);
+    return format;
+}
+
+bool DialectCache::lookup(const QString &filePath, CsvFormat *format)
+{
+    QSettings settings("csv-viewer", "csv-viewer");
+    settings.beginGroup(settingsGroup(filePath));
+    if (!settings.contains("delimiter")) {
+        return false;
+    }
+
+    // 检测得到的方言只对同一版本的文件有效
+    if (!settings.value("explicit").toBool()) {
+        const QFileInfo fileInfo(filePath);
+        if (settings.value("size").toLongLong() != fileInfo.size()
+            || settings.value("modified").toLongLong() != fileInfo.lastModified().toMSecsSinceEpoch()) {
+            return false;
+        }
+    }
+
+    format->delimiter = static_cast<char>(settings.value("delimiter").toInt());
+    format->quoteChar = static_cast<char>(settings.value("quote").toInt());
+    format->hasHeader = settings.value("header").toBool();
+    format->commentChar = static_cast<char>(settings.value("comment").toInt());
+    return true;
+}
+
+void DialectCache::store(const QString &filePath, const CsvFormat &format, bool isExplicit)
+{
+    const QFileInfo fileInfo(filePath);
+    QSettings settings("csv-viewer", "csv-viewer");
+    settings.beginGroup(settingsGroup(filePath));
+    settings.setValue("path", filePath);
+    settings.setValue("size", fileInfo.size());
+    settings.setValue("modified", fileInfo.lastModified().toMSecsSinceEpoch());
+    settings.setValue("delimiter", int(format.delimiter));
+    settings.setValue("quote", int(format.quoteChar));
+    settings.setValue("header", format.hasHeader);
+    settings.setValue("comment", int(format.commentChar));
+    settings.setValue("explicit", isExplicit);
+}
+
+void DialectCache::remove(const QString &filePath)
+{
+    QSettings settings("csv-viewer", "csv-viewer");
+    settings.remove(settingsGroup(filePath));
+}
@@ -0,0 +1,58 @@
+#ifndef CSVFORMAT_H
+#define CSVFORMAT_H
+
+#include <QString>
+#include <QtGlobal>
+
+// 包含vincentlaucsb的CSV解析库
+#include "csv.hpp"
+
+// CSV方言：分隔符、引号字符、首行是否为表头、注释行
+// 打开文件时确定一次，之后所有片段都用同一方言解析，不再让解析库猜测
+struct CsvFormat {
+    char delimiter = ',';
+    char quoteChar = '"';
+    bool hasHeader = true;
+    char commentChar = '\0'; // 文件开头（表头之前）以该字符开始的行为注释，'\0'表示没有注释行
+
+    bool operator==(const CsvFormat &other) const;
+    bool operator!=(const CsvFormat &other) const;
+
+    // 解析库使用的格式（不读取表头，列名由调用方设置）
+    csv::CSVFormat toParserFormat() const;
+
+    // 从offset处跳过文件开头的注释行，返回第一条非注释记录的起始偏移
+    qint64 skipComments(const char *data, qint64 size, qint64 offset) const;
+
+    // 用于日志和界面显示的描述，如 "';' quote='\"' header"
+    QString description() const;
+};
+
+// 方言检测
+// 只检查文件开头有限的样本（不超过SAMPLE_SIZE字节、SAMPLE_RECORDS条记录），
+// 耗时与文件大小无关，通常在几十微秒内完成
+class CsvSniffer
+{
+public:
+    static constexpr qint64 SAMPLE_SIZE = 64 * 1024;
+    static constexpr int SAMPLE_RECORDS = 100;
+
+    // 检测分隔符、引号字符、注释行和首行是否为表头
+    static CsvFormat sniff(const char *data, qint64 length);
+
+private:
+    // 候选分隔符，得分相同时靠前的优先
+    static constexpr char DELIMITERS[] = { ',', ';', '\t', '|' };
+};
+
+// 按文件缓存的方言（保存在用户配置中）
+// 检测得到的方言在文件大小或修改时间变化后失效；用户显式指定的方言一直有效，直到被清除
+class DialectCache
+{
+public:
+    static bool lookup(const QString &filePath, CsvFormat *format);
+    static void store(const QString &filePath, const CsvFormat &format, bool isExplicit);
+    static void remove(const QString &filePath);
+};
+
+#endif // CSVFORMAT_H
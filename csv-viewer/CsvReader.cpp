@@ -1,20 +1,64 @@
 #include "CsvReader.h"
+#include "RowCountEstimator.h"
+#include "RecordScanner.h"
+#include "CompressedFile.h"
+#include "CsvFormat.h"
+#include "RecordParser.h"
+#include "MemoryBudget.h"
+#include "RowIndex.h"
 #include <QFile>
 #include <QDebug>
 #include <QFileInfo>
 #include <QDir>
 #include <QElapsedTimer>
 #include <QStringConverter>
+#include <algorithm>
 #include <sstream>
+#include <limits>
+#include <cstring>
 #include "csv.hpp"
 
+// 编码检测使用的文件开头样本大小
+static const qint64 ENCODING_SAMPLE_SIZE = 1024 * 1024;
+
+// 初始加载的最大行数
+static const int MAX_INITIAL_ROWS = 10000;
+
+// 查找格式错误行的行号时，从行索引检查点向后最多扫描的字节数
+static const qint64 MAX_MALFORMED_SCAN_BYTES = 64 * 1024 * 1024;
+
+// 已读取片段末尾位置的记录个数上限（每条只有十几个字节，离当前位置远的在超限时丢弃）
+static const int MAX_ROW_OFFSETS = 4096;
+
 CsvReader::CsvReader(QObject *parent)
     : QObject(parent)
     , m_encoding(GBK) // 默认使用UTF-8编码
     , m_totalRowCount(0)
     , m_hasMoreData(false)
     , m_lastLoadedRow(-1)
+    , m_rowCountEstimator(new RowCountEstimator(this))
+    , m_data(nullptr)
+    , m_fileSize(0)
+    , m_dataStart(0)
+    , m_nextRowOffset(0)
+    , m_effectiveEncoding(GBK)
+{
+    // 后台计数修正估算值时同步更新总行数
+    connect(m_rowCountEstimator, &RowCountEstimator::estimateChanged, this, &CsvReader::updateEstimatedTotalRows);
+    connect(m_rowCountEstimator, &RowCountEstimator::countFinished, this, &CsvReader::onRowCountFinished);
+    connect(m_rowCountEstimator, &RowCountEstimator::countFailed, this, &CsvReader::onRowCountFailed);
+    
+    // 内存不足时释放可以从文件重新读取的初始加载行
+    connect(MemoryBudget::instance(), &MemoryBudget::memoryPressure, this, &CsvReader::releaseLoadedRows);
+}
+
+CsvReader::~CsvReader()
 {
+    // 后台计数任务引用了文件映射和解压视图，先停止再释放
+    m_rowCountEstimator->stop();
+    closeFile();
+    m_dataRows.clear();
+    updateLoadedRowsUsage();
 }
 
 void CsvReader::setEncoding(Encoding encoding)
@@ -30,9 +74,19 @@ CsvReader::Encoding CsvReader::getEncoding() const
 bool CsvReader::loadFile(const QString &filePath)
 {
     // 清空之前的数据
+    m_rowCountEstimator->stop();
+    closeFile();
     m_headers.clear();
     m_dataRows.clear();
+    m_loadedRowsReleased = false;
+    updateLoadedRowsUsage();
     m_lastError.clear();
+    m_totalRowCount = 0;
+    m_hasMoreData = false;
+    m_lastLoadedRow = -1;
+    m_rowOffsets.clear();
+    m_columnProjection.clear();
+    m_malformedRows.clear();
     
     // 检查文件是否存在和可读
     QFileInfo fileInfo(filePath);
@@ -70,71 +124,70 @@ bool CsvReader::loadFile(const QString &filePath)
         QElapsedTimer libraryReadTimer;
         libraryReadTimer.start();
         
-        QFile file(filePath);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            m_lastError = QString("Failed to open file: %1, error: %2").arg(filePath).arg(file.errorString());
+        m_file.setFileName(filePath);
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            m_lastError = QString("Failed to open file: %1, error: %2").arg(filePath).arg(m_file.errorString());
             qDebug() << m_lastError;
             return false;
         }
         
-        // 读取文件内容
-        QByteArray fileContent = file.readAll();
-        file.close();
+        // 内存映射整个文件，之后按字节偏移只解析需要的片段，不再一次性读入全部内容
+        m_data = reinterpret_cast<const char *>(m_file.map(0, fileSize));
+        if (!m_data) {
+            m_lastError = QString("Failed to map file: %1, error: %2").arg(filePath).arg(m_file.errorString());
+            qDebug() << m_lastError;
+            closeFile();
+            return false;
+        }
+        m_fileSize = fileSize;
         
-        // 初始化内容
-        QString content;
+        // 列式文件只需读取末尾的目录，不做任何解析
+        if (ColumnarFile::isColumnarFile(m_data, fileSize)) {
+            return loadColumnarFile(filePath);
+        }
         
-        // 根据编码设置选择解码器
-        if (m_encoding == UTF8) {
-            content = QString::fromUtf8(fileContent);
-        } else if (m_encoding == GBK) {
-            // 在Qt6中使用fromLocal8Bit处理GBK编码
-            content = QString::fromLocal8Bit(fileContent);
-        } else { // AutoDetect
-            // 读取文件头进行简单编码检测
-            if (fileContent.startsWith("\xEF\xBB\xBF")) {
-                // 移除BOM并使用UTF-8
-                content = QString::fromUtf8(fileContent.mid(3));
-                qDebug() << "Auto-detected encoding: UTF-8 (with BOM)";
-            } else {
-                // 使用简单策略检测编码：先尝试UTF-8
-                QString utf8Content = QString::fromUtf8(fileContent);
-                // 检查UTF-8解码是否成功（基本策略：没有乱码标记）
-                bool isUtf8 = true;
-                for (const QChar &c : utf8Content) {
-                    // 检查是否有替换字符（通常表示解码失败）
-                    if (c.unicode() == 0xFFFD) {
-                        isUtf8 = false;
-                        break;
-                    }
-                }
-                
-                if (isUtf8) {
-                    content = utf8Content;
-                    qDebug() << "Auto-detected encoding: UTF-8";
-                } else {
-                    // 否则使用local8Bit（对于Windows系统，通常支持GBK）
-                    content = QString::fromLocal8Bit(fileContent);
-                    qDebug() << "Auto-detected encoding: Local (GBK compatible)";
-                }
+        // 压缩文件通过解压视图访问，不生成解压后的副本
+        const CompressedFile::Compression compression = CompressedFile::detect(m_data, fileSize);
+        if (compression != CompressedFile::None) {
+            if (!CompressedFile::isSupported(compression)) {
+                m_lastError = QString("Compressed file format is not supported by this build: %1").arg(filePath);
+                qDebug() << m_lastError;
+                closeFile();
+                return false;
             }
+            m_compressed.reset(new CompressedFile(m_data, fileSize, compression));
         }
         
-        // 检查转换是否成功
-        if (content.isEmpty() && !fileContent.isEmpty()) {
-            qWarning() << "Content conversion failed, trying UTF-8 as fallback";
-            content = QString::fromUtf8(fileContent);
+        // 文件开头的数据：普通文件直接使用内存映射，压缩文件只解压出初始加载需要的一段
+        const char *data = m_data;
+        qint64 dataSize = m_fileSize;
+        QByteArray head;
+        bool headReachedEnd = true;
+        if (m_compressed) {
+            qint64 headEnd = 0;
+            head = readCompressedRecords(0, MAX_INITIAL_ROWS + 1, &headEnd, &headReachedEnd);
+            data = head.constData();
+            dataSize = head.size();
         }
         
-        // 将QString转换为UTF-8编码的std::string
-        std::string utf8Content = content.toUtf8().constData();
+        // 根据文件开头的样本确定编码，之后所有片段使用相同的编码
+        m_effectiveEncoding = detectEncoding(QByteArray::fromRawData(data, qMin(dataSize, ENCODING_SAMPLE_SIZE)));
+        
+        // 跳过UTF-8 BOM
+        qint64 contentStart = 0;
+        if (dataSize >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+            contentStart = 3;
+        }
         
-        // 将内容放入std::istringstream中，以便csv库读取
-        std::istringstream csvStream(utf8Content);
+        // 确定方言，之后所有片段使用相同的分隔符和引号，不再让解析库猜测
+        m_format = resolveFormat(filePath, data + contentStart, dataSize - contentStart);
+        const char quoteChar = m_format.quoteChar;
+        contentStart = m_format.skipComments(data, dataSize, contentStart);
         
-        // 使用第三方库的CSVReader从流中读取
-        using namespace csv;
-        CSVReader reader(csvStream);
+        // 定位数据区起始位置和初始加载范围，只解析文件开头的一小段
+        m_dataStart = m_format.hasHeader ? RecordScanner::skipRecords(data, dataSize, contentStart, 1, quoteChar)
+                                         : contentStart;
+        const qint64 initialEnd = RecordScanner::skipRecords(data, dataSize, m_dataStart, MAX_INITIAL_ROWS, quoteChar);
         
         qint64 libraryReadTime = libraryReadTimer.elapsed();
         qDebug() << "Library read time:" << libraryReadTime << "ms";
@@ -143,13 +196,38 @@ bool CsvReader::loadFile(const QString &filePath)
             QElapsedTimer headersTimer;
             headersTimer.start();
             
-            // 获取表头
-            auto col_names = reader.get_col_names();
-            qDebug() << "Number of columns detected:" << col_names.size();
+            m_parseSettings = ParseSettings();
+            m_parseSettings.encoding = m_effectiveEncoding;
+            m_parseSettings.dialect = m_format;
+            m_parseSettings.parserFormat = m_format.toParserFormat();
+            m_parseSettings.tolerant = m_tolerant;
+            m_parseSettings.parseKernel = RecordParser::kernelFor(m_format);
+            m_parseSettings.width = -1;
+            
+            // 表头按数据行解析（不规整列数）；没有表头时按第一条记录的字段数生成列名
+            const qint64 firstRecordEnd = RecordScanner::skipRecords(data, dataSize, contentStart, 1, quoteChar);
+            const QList<QStringList> firstRecord = parseBytes(data + contentStart, firstRecordEnd - contentStart,
+                                                              m_parseSettings);
             m_headers.clear();
-            for (const auto& name : col_names) {
-                m_headers.append(QString::fromStdString(name));
+            if (!firstRecord.isEmpty()) {
+                if (m_format.hasHeader) {
+                    m_headers = firstRecord.first();
+                } else {
+                    for (int column = 0; column < firstRecord.first().size(); ++column) {
+                        m_headers.append(QString("Column %1").arg(column + 1));
+                    }
+                }
             }
+            qDebug() << "Number of columns detected:" << m_headers.size();
+            
+            // 后续片段没有表头，使用确定的方言和列名，每行规整为表头列数
+            std::vector<std::string> col_names;
+            col_names.reserve(m_headers.size());
+            for (const QString &name : m_headers) {
+                col_names.push_back(name.toStdString());
+            }
+            m_parseSettings.parserFormat.column_names(col_names);
+            m_parseSettings.width = m_headers.size();
             
             qint64 headersTime = headersTimer.elapsed();
             qDebug() << "Headers processing time:" << headersTime << "ms";
@@ -160,48 +238,38 @@ bool CsvReader::loadFile(const QString &filePath)
             
             // 优化1: 预分配容器大小以减少重分配
             m_dataRows.clear();
-            m_dataRows.reserve(25000); // 根据预估的行数预分配
-            int rowCount = 0;
+            m_dataRows.reserve(MAX_INITIAL_ROWS);
             
-            // 优化2: 减少内存重分配
-            // 优化3: 流式处理，仅加载需要的数据
-            const int MAX_INITIAL_ROWS = 10000; // 初始加载的最大行数
-            for (auto& row : reader) {
-                // 超过初始行数后停止加载
-                if (rowCount >= MAX_INITIAL_ROWS) {
-                    break;
-                }
-                
-                QStringList qRow;
-                qRow.reserve(row.size()); // 预分配每行列数
-                
-                // 处理数据行
-                for (size_t i = 0; i < row.size(); i++) {
-                    qRow.append(QString::fromStdString(row[i].get<std::string>()));
-                }
-                
-                m_dataRows.append(qRow);
-                rowCount++;
-            }
+            // 优化2: 只解析初始范围内的数据
+            QVector<MalformedRecord> malformed;
+            m_dataRows.append(parseBytes(data + m_dataStart, initialEnd - m_dataStart, m_parseSettings, m_dataStart, &malformed));
+            addMalformedRows(malformed, 0);
+            const int rowCount = m_dataRows.size();
+            updateLoadedRowsUsage();
             
             qint64 rowsTime = rowsTimer.elapsed();
             qDebug() << "Rows processing time:" << rowsTime << "ms" << "(" << rowCount << " rows loaded initially)";
-            qDebug() << "Memory usage: ~" << (m_dataRows.capacity() * m_headers.size() * 20) / (1024*1024) << "MB (estimated)";
+            qDebug() << "Memory usage:" << m_loadedRowsBytes / 1024 << "KB";
             
-            // 记录总行数，但不加载所有数据
-            // 这是一个估算值，实际行数可能需要完整读取文件才能确定
-            // 对于大文件，可以考虑保存文件内容以便后续分页加载
+            // 记录顺序加载的位置，后续从这里继续
+            m_nextRowOffset = initialEnd;
+            rememberRowOffset(rowCount, initialEnd, true);
+            m_lastLoadedRow = rowCount - 1;
             m_totalRowCount = rowCount;
-            if (rowCount >= MAX_INITIAL_ROWS) {
+            
+            const bool moreData = m_compressed ? (!headReachedEnd || initialEnd < dataSize) : (initialEnd < m_fileSize);
+            if (moreData) {
                 // 如果文件还有更多行，标记为需要延迟加载
                 m_hasMoreData = true;
-                m_lastLoadedRow = rowCount - 1;
-                m_fileContentBackup = content; // 保存文件内容用于后续加载
-                qDebug() << "File may have more data, enabled lazy loading.";
-            } else {
-                m_hasMoreData = false;
-                m_lastLoadedRow = rowCount - 1;
-                m_totalRowCount = rowCount;
+                qDebug() << "File has more data, enabled lazy loading.";
+                
+                // 采样估算总行数，使滚动条从一开始就反映整个文件的大小；
+                // 压缩文件在后台解压计数的同时建立行索引和解压访问点
+                const bool estimating = m_compressed ? m_rowCountEstimator->startCompressed(m_compressed.get(), m_dataStart, quoteChar)
+                                                     : m_rowCountEstimator->start(filePath, m_dataStart, quoteChar);
+                if (estimating) {
+                    updateEstimatedTotalRows();
+                }
             }
             
             qDebug() << "Initially loaded rows:" << rowCount;
@@ -217,7 +285,235 @@ bool CsvReader::loadFile(const QString &filePath)
     }
 }
 
+void CsvReader::closeFile()
+{
+    if (m_data) {
+        m_file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(m_data)));
+        m_data = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_fileSize = 0;
+    m_dataStart = 0;
+    m_nextRowOffset = 0;
+    m_columnarFile.close();
+    m_isColumnar = false;
+    m_compressed.reset();
+}
+
+bool CsvReader::loadColumnarFile(const QString &filePath)
+{
+    QElapsedTimer openTimer;
+    openTimer.start();
+    
+    QString error;
+    if (!m_columnarFile.open(m_data, m_fileSize, &error)) {
+        m_lastError = QString("Failed to open columnar file: %1, error: %2").arg(filePath).arg(error);
+        qDebug() << m_lastError;
+        closeFile();
+        return false;
+    }
+    m_isColumnar = true;
+    
+    // 行数和列名都保存在目录中，总行数从一开始就是精确的
+    m_headers = m_columnarFile.headers();
+    m_dataRows = m_columnarFile.readRows(0, MAX_INITIAL_ROWS, m_columnProjection);
+    m_lastLoadedRow = m_dataRows.size() - 1;
+    m_totalRowCount = static_cast<int>(qMin<qint64>(m_columnarFile.rowCount(), std::numeric_limits<int>::max()));
+    m_hasMoreData = m_dataRows.size() < m_totalRowCount;
+    updateLoadedRowsUsage();
+    
+    qDebug() << "Opened columnar file with" << m_headers.size() << "columns and" << m_columnarFile.rowCount()
+             << "rows in" << openTimer.elapsed() << "ms";
+    return true;
+}
+
+void CsvReader::setFormat(const CsvFormat &format)
+{
+    m_requestedFormat = format;
+    m_hasRequestedFormat = true;
+}
+
+void CsvReader::setFormatAutoDetect()
+{
+    m_hasRequestedFormat = false;
+    m_redetectFormat = true;
+}
+
+bool CsvReader::hasExplicitFormat() const
+{
+    return m_hasRequestedFormat;
+}
+
+CsvFormat CsvReader::format() const
+{
+    return m_format;
+}
 
+CsvFormat CsvReader::resolveFormat(const QString &filePath, const char *data, qint64 length)
+{
+    // 显式指定的方言优先，并记住该文件的选择
+    if (m_hasRequestedFormat) {
+        DialectCache::store(filePath, m_requestedFormat, true);
+        qDebug() << "Using explicit dialect:" << m_requestedFormat.description();
+        return m_requestedFormat;
+    }
+    
+    CsvFormat format;
+    if (!m_redetectFormat && DialectCache::lookup(filePath, &format)) {
+        qDebug() << "Using cached dialect:" << format.description();
+        return format;
+    }
+    m_redetectFormat = false;
+    
+    QElapsedTimer sniffTimer;
+    sniffTimer.start();
+    
+    if (m_effectiveEncoding == UTF8) {
+        format = CsvSniffer::sniff(data, length);
+    } else {
+        // GBK的双字节字符中可能出现'|'，转换为UTF-8后再检测；样本被截断时丢弃末尾不完整的行
+        const qint64 sampleLength = qMin(length, CsvSniffer::SAMPLE_SIZE);
+        std::string sample = toUtf8(data, sampleLength, m_effectiveEncoding);
+        if (sampleLength < length) {
+            const size_t lastNewline = sample.rfind('\n');
+            sample.resize(lastNewline == std::string::npos ? 0 : lastNewline + 1);
+        }
+        format = CsvSniffer::sniff(sample.data(), static_cast<qint64>(sample.size()));
+    }
+    
+    qDebug() << "Sniffed dialect:" << format.description() << "in" << sniffTimer.nsecsElapsed() / 1000 << "us";
+    DialectCache::store(filePath, format, false);
+    return format;
+}
+
+CsvReader::Encoding CsvReader::detectEncoding(const QByteArray &sample) const
+{
+    if (m_encoding != AutoDetect) {
+        return m_encoding;
+    }
+    
+    // 读取文件头进行简单编码检测
+    if (sample.startsWith("\xEF\xBB\xBF")) {
+        qDebug() << "Auto-detected encoding: UTF-8 (with BOM)";
+        return UTF8;
+    }
+    
+    // 使用简单策略检测编码：先尝试UTF-8
+    // 样本末尾可能截断在多字节字符中间，只检查到最后一个换行符
+    const int lastNewline = sample.lastIndexOf('\n');
+    QString utf8Content = QString::fromUtf8(lastNewline > 0 ? sample.left(lastNewline) : sample);
+    // 检查UTF-8解码是否成功（基本策略：没有乱码标记）
+    for (const QChar &c : utf8Content) {
+        // 检查是否有替换字符（通常表示解码失败）
+        if (c.unicode() == 0xFFFD) {
+            // 否则使用local8Bit（对于Windows系统，通常支持GBK）
+            qDebug() << "Auto-detected encoding: Local (GBK compatible)";
+            return GBK;
+        }
+    }
+    
+    qDebug() << "Auto-detected encoding: UTF-8";
+    return UTF8;
+}
+
+std::string CsvReader::toUtf8(const char *bytes, qint64 length, Encoding encoding)
+{
+    if (encoding == UTF8) {
+        return std::string(bytes, static_cast<size_t>(length));
+    }
+    
+    // 在Qt6中使用fromLocal8Bit处理GBK编码，再转换为UTF-8交给解析库
+    return QString::fromLocal8Bit(bytes, length).toStdString();
+}
+
+QStringList CsvReader::toStringList(const csv::CSVRow &row, int width)
+{
+    // 列数规整为width（为负数时保持原样），字段不足的补空字符串
+    const int fields = static_cast<int>(row.size());
+    const int columns = width >= 0 ? width : fields;
+    QStringList qRow;
+    qRow.reserve(columns); // 预分配每行列数
+    
+    // 处理数据行
+    for (int i = 0; i < qMin(fields, columns); i++) {
+        qRow.append(QString::fromStdString(row[i].get<std::string>()));
+    }
+    qRow.resize(columns);
+    return qRow;
+}
+
+QList<QStringList> CsvReader::parseRange(qint64 begin, qint64 end, qint64 firstRow)
+{
+    if (!m_data || end <= begin) {
+        return QList<QStringList>();
+    }
+    
+    // 片段中没有表头，使用初始加载时确定的格式和列名
+    QVector<MalformedRecord> malformed;
+    const QList<QStringList> rows = parseBytes(m_data + begin, end - begin, m_parseSettings, begin, &malformed);
+    addMalformedRows(malformed, firstRow);
+    return rows;
+}
+
+QList<QStringList> CsvReader::parseWindow(const QByteArray &window, qint64 baseOffset, qint64 firstRow)
+{
+    QVector<MalformedRecord> malformed;
+    const QList<QStringList> rows = parseBytes(window.constData(), window.size(), m_parseSettings, baseOffset, &malformed);
+    addMalformedRows(malformed, firstRow);
+    return rows;
+}
+
+QList<QStringList> CsvReader::parseBytes(const char *bytes, qint64 length, const ParseSettings &settings,
+                                         qint64 baseOffset, QVector<MalformedRecord> *malformed)
+{
+    QList<QStringList> rows;
+    if (length <= 0) {
+        return rows;
+    }
+    
+    // 容错模式直接在原始字节上解析，格式错误的记录只登记，不会抛出异常
+    if (settings.tolerant) {
+        const RecordParser::ParseFunction kernel = settings.parseKernel ? settings.parseKernel
+                                                                        : RecordParser::kernelFor(settings.dialect);
+        return kernel(bytes, length, settings.dialect.delimiter, settings.dialect.quoteChar,
+                      settings.encoding == UTF8, settings.width, baseOffset, malformed);
+    }
+    
+    std::string utf8Content = toUtf8(bytes, length, settings.encoding);
+    std::istringstream csvStream(utf8Content);
+    
+    csv::CSVReader reader(csvStream, settings.parserFormat);
+    for (auto& row : reader) {
+        rows.append(toStringList(row, settings.width));
+    }
+    return rows;
+}
+
+QList<QStringList> CsvReader::parseRecords(const char *bytes, qint64 length, const ParseSettings &settings,
+                                           qint64 baseOffset, QVector<MalformedRecord> *malformed)
+{
+    ParseSettings aligned = settings;
+    aligned.tolerant = true;
+    return parseBytes(bytes, length, aligned, baseOffset, malformed);
+}
+
+void CsvReader::addMalformedRows(QVector<MalformedRecord> records, qint64 firstRow)
+{
+    if (records.isEmpty()) {
+        return;
+    }
+    
+    // 解析器给出的是片段内的序号，换算为文件中的行号
+    for (MalformedRecord &record : records) {
+        record.row = (firstRow >= 0) ? firstRow + record.row : -1;
+    }
+    if (m_malformedRows.add(records) > 0) {
+        qDebug() << "Malformed rows found:" << m_malformedRows.count() << "in total";
+        emit malformedRowsFound(m_malformedRows.count());
+    }
+}
 
 QStringList CsvReader::getHeaders() const
 {
@@ -278,6 +574,21 @@ int CsvReader::getEstimatedTotalRows() const
     return m_totalRowCount;
 }
 
+void CsvReader::updateEstimatedTotalRows()
+{
+    // 数据已全部加载时总行数是确定的，不再使用估算值
+    if (!m_hasMoreData) {
+        return;
+    }
+    
+    const qint64 estimate = qMin<qint64>(m_rowCountEstimator->estimatedRows(), std::numeric_limits<int>::max());
+    const int rows = qMax(static_cast<int>(estimate), static_cast<int>(m_dataRows.size()));
+    if (rows != m_totalRowCount) {
+        m_totalRowCount = rows;
+        emit estimatedTotalRowsChanged(rows);
+    }
+}
+
 int CsvReader::getLastLoadedRowIndex() const
 {
     return m_lastLoadedRow;
@@ -285,62 +596,55 @@ int CsvReader::getLastLoadedRowIndex() const
 
 bool CsvReader::loadMoreRows(int count)
 {
-    if (!m_hasMoreData || m_fileContentBackup.isEmpty()) {
+    // 顺序加载的行已被释放后，行号只能通过行索引定位，不再顺序追加
+    if (!m_hasMoreData || !m_data || m_loadedRowsReleased) {
         return false;
     }
     
+    if (m_isColumnar) {
+        const QList<QStringList> newRows = m_columnarFile.readRows(m_dataRows.size(), count, m_columnProjection);
+        m_dataRows.append(newRows);
+        m_lastLoadedRow = m_dataRows.size() - 1;
+        m_hasMoreData = m_dataRows.size() < m_totalRowCount;
+        updateLoadedRowsUsage();
+        return !newRows.isEmpty();
+    }
+    
     try {
         QElapsedTimer loadTimer;
         loadTimer.start();
         
-        // 将QString转换为UTF-8编码的std::string
-        std::string utf8Content = m_fileContentBackup.toUtf8().constData();
-        
-        // 将内容放入std::istringstream中，以便csv库读取
-        std::istringstream csvStream(utf8Content);
-        
-        // 使用第三方库的CSVReader从流中读取
-        using namespace csv;
-        CSVReader reader(csvStream);
-        
-        // 跳过已经加载的行
-        int rowsSkipped = 0;
-        for (auto& row : reader) {
-            if (rowsSkipped > m_lastLoadedRow) {
-                break;
-            }
-            rowsSkipped++;
+        // 从上次停止的字节位置继续，只解析新的count条记录
+        qint64 end = 0;
+        bool reachedEnd = false;
+        QList<QStringList> newRows;
+        if (m_compressed) {
+            const QByteArray window = readCompressedRecords(m_nextRowOffset, count, &end, &reachedEnd);
+            newRows = parseWindow(window, m_nextRowOffset, m_dataRows.size());
+        } else {
+            end = RecordScanner::skipRecords(m_data, m_fileSize, m_nextRowOffset, count, m_format.quoteChar);
+            reachedEnd = (end >= m_fileSize);
+            newRows = parseRange(m_nextRowOffset, end, m_dataRows.size());
         }
         
-        // 加载指定数量的新行
-        int newRowsLoaded = 0;
-        for (auto& row : reader) {
-            if (newRowsLoaded >= count) {
-                break;
-            }
-            
-            QStringList qRow;
-            qRow.reserve(row.size()); // 预分配每行列数
-            
-            // 处理数据行
-            for (size_t i = 0; i < row.size(); i++) {
-                qRow.append(QString::fromStdString(row[i].get<std::string>()));
-            }
-            
-            m_dataRows.append(qRow);
-            newRowsLoaded++;
-            m_lastLoadedRow++;
-        }
+        m_dataRows.append(newRows);
+        updateLoadedRowsUsage();
+        const int newRowsLoaded = newRows.size();
+        m_lastLoadedRow += newRowsLoaded;
+        m_nextRowOffset = end;
+        rememberRowOffset(m_dataRows.size(), end, true);
         
         // 检查是否还有更多数据
-        if (newRowsLoaded < count) {
+        if (reachedEnd) {
             m_hasMoreData = false;
             m_totalRowCount = m_lastLoadedRow + 1;
+            m_rowCountEstimator->stop();
+            emit estimatedTotalRowsChanged(m_totalRowCount);
         }
         
         qDebug() << "Loaded" << newRowsLoaded << "more rows in" << loadTimer.elapsed() << "ms";
         qDebug() << "Total rows loaded now:" << m_dataRows.size();
-        qDebug() << "Memory usage: ~" << (m_dataRows.capacity() * m_headers.size() * 20) / (1024*1024) << "MB (estimated)";
+        qDebug() << "Memory usage:" << m_loadedRowsBytes / 1024 << "KB";
         
         return newRowsLoaded > 0;
     } catch (const std::exception &e) {
@@ -353,3 +657,414 @@ bool CsvReader::loadMoreRows(int count)
         return false;
     }
 }
+
+QList<QStringList> CsvReader::readRows(int firstRow, int count)
+{
+    QList<QStringList> result;
+    if (!m_data || firstRow < 0 || count <= 0) {
+        return result;
+    }
+    
+    // 已顺序加载的行直接返回
+    const int loadedRows = m_dataRows.size();
+    if (firstRow < loadedRows) {
+        result = getRowsRange(firstRow, count);
+        if (result.size() >= count || !m_hasMoreData) {
+            return result;
+        }
+        count -= result.size();
+        firstRow = loadedRows;
+    }
+    
+    // 列式文件直接按行号读取，只取需要的列
+    if (m_isColumnar) {
+        result.append(m_columnarFile.readRows(firstRow, count, m_columnProjection));
+        return result;
+    }
+    
+    try {
+        QElapsedTimer seekTimer;
+        seekTimer.start();
+        
+        bool exact = false;
+        const qint64 begin = offsetForRow(firstRow, &exact);
+        if (begin < 0) {
+            // 压缩文件中后台扫描尚未到达的位置，扫描完成后会重新加载
+            return result;
+        }
+        
+        qint64 end = 0;
+        if (m_compressed) {
+            bool reachedEnd = false;
+            const QByteArray window = readCompressedRecords(begin, count, &end, &reachedEnd);
+            result.append(parseWindow(window, begin, exact ? firstRow : -1));
+        } else {
+            end = RecordScanner::skipRecords(m_data, m_fileSize, begin, count, m_format.quoteChar);
+            result.append(parseRange(begin, end, exact ? firstRow : -1));
+        }
+        
+        // 记录片段末尾的位置，相邻的下一个片段从这里继续，不会重叠或遗漏
+        rememberRowOffset(firstRow + count, end, exact);
+        
+        qDebug() << "Read rows" << firstRow << "-" << firstRow + count - 1 << "at offset" << begin
+                 << (exact ? "(exact)" : "(estimated)") << "in" << seekTimer.elapsed() << "ms";
+    } catch (const std::exception &e) {
+        m_lastError = QString("Error reading rows: %1").arg(e.what());
+        qDebug() << m_lastError;
+    } catch (...) {
+        m_lastError = "Unknown error occurred while reading rows";
+        qDebug() << m_lastError;
+    }
+    
+    return result;
+}
+
+QList<QStringList> CsvReader::readRecords(const QVector<qint64> &offsets)
+{
+    QList<QStringList> result;
+    if (!m_data || m_compressed || m_isColumnar) {
+        return result;
+    }
+    
+    QElapsedTimer readTimer;
+    readTimer.start();
+    
+    try {
+        result.reserve(offsets.size());
+        for (int i = 0; i < offsets.size();) {
+            // 连续的记录一次解析，只需要找到这一段最后一条记录的结尾
+            const qint64 begin = offsets.at(i);
+            if (begin < 0 || begin >= m_fileSize) {
+                break;
+            }
+            qint64 end = RecordScanner::skipRecords(m_data, m_fileSize, begin, 1, m_format.quoteChar);
+            int count = 1;
+            while (i + count < offsets.size() && offsets.at(i + count) == end) {
+                end = RecordScanner::skipRecords(m_data, m_fileSize, end, 1, m_format.quoteChar);
+                ++count;
+            }
+            
+            // 按RecordScanner的记录边界解析，每个偏移恰好对应一行（严格模式下也不会错位）；
+            // 解析结果只取前count行，避免末尾记录缺少换行符时多出空行
+            const QList<QStringList> rows = parseRecords(m_data + begin, end - begin, m_parseSettings, begin);
+            result.append(rows.mid(0, count));
+            i += count;
+        }
+    } catch (const std::exception &e) {
+        m_lastError = QString("Error reading records: %1").arg(e.what());
+        qDebug() << m_lastError;
+    } catch (...) {
+        m_lastError = "Unknown error occurred while reading records";
+        qDebug() << m_lastError;
+    }
+    
+    qDebug() << "Read" << result.size() << "records by offset in" << readTimer.elapsed() << "ms";
+    return result;
+}
+
+bool CsvReader::isRowCountExact() const
+{
+    return m_isColumnar || !m_hasMoreData || m_rowCountEstimator->isExact();
+}
+
+bool CsvReader::isCompressed() const
+{
+    return m_compressed != nullptr;
+}
+
+bool CsvReader::supportsRandomAccess() const
+{
+    return !m_compressed || !m_hasMoreData || m_compressed->hasRandomAccess();
+}
+
+QByteArray CsvReader::readCompressedRecords(qint64 offset, qint64 count, qint64 *endOffset, bool *reachedEnd) const
+{
+    *endOffset = offset;
+    *reachedEnd = false;
+    if (count <= 0) {
+        return QByteArray();
+    }
+    
+    // 从1MB开始解压，不够count条记录时加倍，直到找到完整的记录边界或到达文件末尾
+    qint64 length = 1024 * 1024;
+    for (;;) {
+        QByteArray window = m_compressed->read(offset, length);
+        const bool atEnd = window.size() < length;
+        qint64 skipped = 0;
+        const qint64 end = RecordScanner::skipRecords(window.constData(), window.size(), 0, count, m_format.quoteChar, &skipped);
+        
+        // 窗口末尾的不完整记录会被当作最后一条记录，未到文件末尾时需要更大的窗口
+        if (atEnd || (skipped == count && end < window.size())) {
+            *reachedEnd = atEnd && end >= window.size();
+            *endOffset = offset + end;
+            window.truncate(end);
+            return window;
+        }
+        length *= 2;
+    }
+}
+
+bool CsvReader::isColumnar() const
+{
+    return m_isColumnar;
+}
+
+void CsvReader::setColumnProjection(const QVector<int> &columns)
+{
+    if (columns == m_columnProjection) {
+        return;
+    }
+    m_columnProjection = columns;
+    
+    // 初始加载的行按之前的投影读取，直接丢弃，之后按新的投影从文件重新读取（列式文件随机访问没有额外代价）
+    if (m_isColumnar && !m_dataRows.isEmpty()) {
+        m_dataRows.clear();
+        m_dataRows.squeeze();
+        m_lastLoadedRow = -1;
+        m_hasMoreData = m_totalRowCount > 0;
+        m_loadedRowsReleased = true;
+        updateLoadedRowsUsage();
+    }
+}
+
+qint64 CsvReader::dataStartOffset() const
+{
+    return m_dataStart;
+}
+
+CsvReader::Encoding CsvReader::effectiveEncoding() const
+{
+    return m_effectiveEncoding;
+}
+
+CsvReader::ParseSettings CsvReader::parseSettings() const
+{
+    return m_parseSettings;
+}
+
+void CsvReader::updateLoadedRowsUsage()
+{
+    // 与模型中的页共享的字符串也计入，按上限估算
+    const qint64 bytes = m_dataRows.isEmpty() ? 0 : MemoryBudget::measureRows(m_dataRows);
+    if (bytes > m_loadedRowsBytes) {
+        MemoryBudget::instance()->pageAdded(bytes - m_loadedRowsBytes);
+    } else if (bytes < m_loadedRowsBytes) {
+        MemoryBudget::instance()->pageRemoved(m_loadedRowsBytes - bytes);
+    }
+    m_loadedRowsBytes = bytes;
+}
+
+bool CsvReader::releaseLoadedRows()
+{
+    // 全部数据都在内存中的小文件没有行索引，不能释放；
+    // 其余文件只在行索引覆盖这些行之后释放，之后按精确的字节偏移重新读取
+    if (m_dataRows.isEmpty() || !m_hasMoreData) {
+        return false;
+    }
+    if (!m_isColumnar && m_rowCountEstimator->rowIndex().indexedRows() < m_dataRows.size()) {
+        return false;
+    }
+    
+    qDebug() << "Released" << m_dataRows.size() << "initially loaded rows (" << m_loadedRowsBytes / 1024 << "KB )";
+    m_dataRows.clear();
+    m_dataRows.squeeze();
+    m_loadedRowsReleased = true;
+    updateLoadedRowsUsage();
+    return true;
+}
+
+bool CsvReader::readAheadSource(ReadAheadSource *source) const
+{
+    if (!m_data || m_compressed) {
+        return false;
+    }
+    
+    source->data = m_data;
+    source->fileSize = m_fileSize;
+    source->dataStart = m_dataStart;
+    source->fileHandle = m_file.handle();
+    source->parse = m_parseSettings;
+    // 全部数据已在初始加载时读入的文件没有启动计数，行索引可能属于之前打开的文件
+    source->rowIndex = m_hasMoreData ? &m_rowCountEstimator->rowIndex() : nullptr;
+    source->columnarFile = m_isColumnar ? &m_columnarFile : nullptr;
+    source->columnProjection = m_columnProjection;
+    source->loadedRows = m_dataRows.size();
+    source->bytesPerRecord = m_rowCountEstimator->averageBytesPerRecord();
+    return true;
+}
+
+qint64 CsvReader::locateRow(const ReadAheadSource &source, qint64 row)
+{
+    qint64 checkpointRow = 0;
+    qint64 checkpointOffset = source.dataStart;
+    if (source.rowIndex && !source.rowIndex->lookup(row, &checkpointRow, &checkpointOffset)) {
+        // 退回到已索引的最后一个检查点
+        const qint64 lastIndexed = source.rowIndex->indexedRows() - 1;
+        if (lastIndexed < 0 || !source.rowIndex->lookup(lastIndexed, &checkpointRow, &checkpointOffset)) {
+            checkpointRow = 0;
+            checkpointOffset = source.dataStart;
+        }
+    }
+    return RecordScanner::skipRecords(source.data, source.fileSize, checkpointOffset, row - checkpointRow,
+                                      source.parse.dialect.quoteChar);
+}
+
+void CsvReader::commitReadAhead(int firstRow, int count, qint64 endOffset, const QVector<MalformedRecord> &malformed)
+{
+    // 预读只使用行索引中的精确位置
+    if (!m_isColumnar) {
+        rememberRowOffset(firstRow + count, endOffset, true);
+    }
+    addMalformedRows(malformed, firstRow);
+}
+
+void CsvReader::setTolerant(bool tolerant)
+{
+    m_tolerant = tolerant;
+}
+
+bool CsvReader::isTolerant() const
+{
+    return m_tolerant;
+}
+
+const MalformedRowIndex &CsvReader::malformedRows() const
+{
+    return m_malformedRows;
+}
+
+int CsvReader::nextMalformedRow(int currentRow, bool *exact)
+{
+    *exact = false;
+    if (m_isColumnar || m_malformedRows.count() == 0) {
+        return -1;
+    }
+    
+    // 从当前行的起始偏移之后查找；压缩文件中无法定位时从头查找
+    bool offsetExact = false;
+    const qint64 currentOffset = (currentRow >= 0) ? offsetForRow(currentRow, &offsetExact) : -1;
+    const MalformedRecord *record = m_malformedRows.next(currentOffset);
+    if (!record) {
+        return -1;
+    }
+    if (record->row >= 0) {
+        *exact = true;
+        return static_cast<int>(qMin<qint64>(record->row, std::numeric_limits<int>::max()));
+    }
+    
+    // 在估算位置解析时登记的记录没有行号：从行索引中不超过该偏移的检查点开始计数；
+    // 检查点离得太远时只按平均记录长度估算，不在界面线程上扫描大段数据
+    qint64 checkpointRow = 0;
+    qint64 checkpointOffset = 0;
+    if (!m_compressed && m_rowCountEstimator->rowIndex().lookupOffset(record->offset, &checkpointRow, &checkpointOffset)
+        && record->offset - checkpointOffset <= MAX_MALFORMED_SCAN_BYTES) {
+        bool inQuotes = false;
+        *exact = true;
+        return static_cast<int>(checkpointRow + RecordScanner::countRecords(m_data + checkpointOffset,
+                                                                            record->offset - checkpointOffset,
+                                                                            m_format.quoteChar, inQuotes));
+    }
+    if (m_compressed) {
+        // 平均记录长度按压缩字节计算，不能换算解压后的偏移；只定位到不超过该记录的最近检查点，
+        // 该记录在当前行之后，结果至少前进一行，避免反复定位到同一位置
+        if (m_rowCountEstimator->rowIndex().lookupOffset(record->offset, &checkpointRow, &checkpointOffset)) {
+            return static_cast<int>(qMin<qint64>(qMax<qint64>(checkpointRow, currentRow + 1), std::numeric_limits<int>::max()));
+        }
+        return -1;
+    }
+    const double bytesPerRecord = m_rowCountEstimator->averageBytesPerRecord();
+    return bytesPerRecord > 0 ? static_cast<int>((record->offset - m_dataStart) / bytesPerRecord) : -1;
+}
+
+qint64 CsvReader::offsetForRow(int row, bool *exact) const
+{
+    // 与已读取的片段相邻，精确的位置直接衔接
+    auto known = m_rowOffsets.constFind(row);
+    if (known != m_rowOffsets.constEnd() && known->exact) {
+        *exact = true;
+        return known->offset;
+    }
+    
+    // 行索引已覆盖（优先于估算定位记下的片段位置）：从最近的检查点向后跳过不超过STRIDE条记录
+    qint64 checkpointRow = 0;
+    qint64 checkpointOffset = 0;
+    if (m_rowCountEstimator->rowIndex().lookup(row, &checkpointRow, &checkpointOffset)) {
+        *exact = true;
+        if (m_compressed) {
+            qint64 end = checkpointOffset;
+            bool reachedEnd = false;
+            readCompressedRecords(checkpointOffset, row - checkpointRow, &end, &reachedEnd);
+            return end;
+        }
+        return RecordScanner::skipRecords(m_data, m_fileSize, checkpointOffset, row - checkpointRow, m_format.quoteChar);
+    }
+    
+    // 行索引尚未覆盖：与估算定位读取的片段衔接，保持相邻页面连续
+    if (known != m_rowOffsets.constEnd()) {
+        *exact = false;
+        return known->offset;
+    }
+    
+    // 压缩文件不能按估算的偏移随机定位
+    if (m_compressed) {
+        *exact = false;
+        return -1;
+    }
+    
+    // 按平均记录长度估算字节偏移，再同步到真实的记录边界
+    *exact = false;
+    const qint64 approxOffset = m_dataStart + static_cast<qint64>(row * m_rowCountEstimator->averageBytesPerRecord());
+    return RecordScanner::syncToRecordStart(m_data, m_fileSize, m_dataStart, approxOffset, m_format.quoteChar);
+}
+
+void CsvReader::rememberRowOffset(int row, qint64 offset, bool exact)
+{
+    m_rowOffsets.insert(row, RowOffset{offset, exact});
+    if (m_rowOffsets.size() <= MAX_ROW_OFFSETS) {
+        return;
+    }
+
+    // 保留离当前行最近的一半：视口附近的片段最可能被再次衔接
+    QVector<qint64> distances;
+    distances.reserve(m_rowOffsets.size());
+    for (auto it = m_rowOffsets.constBegin(); it != m_rowOffsets.constEnd(); ++it) {
+        distances.append(qAbs(qint64(it.key()) - row));
+    }
+    const int keep = MAX_ROW_OFFSETS / 2;
+    std::nth_element(distances.begin(), distances.begin() + keep, distances.end());
+    const qint64 limit = distances.at(keep);
+    for (auto it = m_rowOffsets.begin(); it != m_rowOffsets.end();) {
+        if (qAbs(qint64(it.key()) - row) >= limit && it.key() != row) {
+            it = m_rowOffsets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CsvReader::dropEstimatedRowOffsets()
+{
+    for (auto it = m_rowOffsets.begin(); it != m_rowOffsets.end();) {
+        if (!it->exact) {
+            it = m_rowOffsets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CsvReader::onRowCountFinished()
+{
+    // 估算定位得到的片段位置不再可靠，之后统一使用精确的行索引
+    dropEstimatedRowOffsets();
+    
+    emit rowIndexCompleted();
+}
+
+void CsvReader::onRowCountFailed(const QString &error)
+{
+    // 计数中止后平均记录长度不再更新，按旧估算记下的片段位置也不再可信
+    dropEstimatedRowOffsets();
+    
+    emit rowCountFailed(error);
+}
@@ -5,16 +5,31 @@
 #include <QString>
 #include <QList>
 #include <QStringList>
+#include <QFile>
+#include <QHash>
 
 // 包含vincentlaucsb的CSV解析库
 #include "csv.hpp"
 
+#include "ColumnarFile.h"
+#include "CsvFormat.h"
+#include "MalformedRowIndex.h"
+#include "RecordParser.h"
+
+#include <memory>
+
+class CompressedFile;
+
+class RowCountEstimator;
+class RowIndex;
+
 class CsvReader : public QObject
 {
     Q_OBJECT
 
 public:
     explicit CsvReader(QObject *parent = nullptr);
+    ~CsvReader();
     
     // 支持的文件编码枚举
     enum Encoding {
@@ -32,6 +47,18 @@ public:
     // 获取当前设置的编码
     Encoding getEncoding() const;
     
+    // 显式指定方言，之后加载文件时使用该方言并记住这个文件的选择
+    void setFormat(const CsvFormat &format);
+    
+    // 下次加载时忽略缓存，重新从文件开头的样本检测方言
+    void setFormatAutoDetect();
+    
+    // 是否使用显式指定的方言
+    bool hasExplicitFormat() const;
+    
+    // 当前文件实际使用的方言
+    CsvFormat format() const;
+    
     // 获取表头
     QStringList getHeaders() const;
     
@@ -55,11 +82,175 @@ public:
     int getEstimatedTotalRows() const; // 获取估计的总行数
     bool loadMoreRows(int count); // 加载更多数据行
     int getLastLoadedRowIndex() const; // 获取最后加载的行索引
+    
+    // 随机访问：读取从firstRow开始的count行
+    // 按字节偏移定位到目标行附近后只解析这一小段数据，无需加载之前的所有行；
+    // 行索引尚未覆盖目标行时按平均记录长度估算位置，行号为近似值
+    QList<QStringList> readRows(int firstRow, int count);
+    
+    // 读取从指定字节偏移开始的记录（偏移必须是记录的起始位置，如按值筛选得到的倒排表），
+    // 在文件中相邻的记录合并为一段解析；只支持未压缩的CSV文件
+    QList<QStringList> readRecords(const QVector<qint64> &offsets);
+    
+    // 总行数是否已经精确（后台计数完成或已全部加载）
+    bool isRowCountExact() const;
+    
+    // 打开的是否为压缩文件（gzip/zstd，通过解压视图访问）
+    bool isCompressed() const;
+    
+    // 能否跳转到文件中的任意位置而不必从头解压（只有单帧的zstd文件不能）
+    bool supportsRandomAccess() const;
+    
+    // 打开的是否为列式文件（由CSV转换得到，无需解析）
+    bool isColumnar() const;
+    
+    // 列式文件只读取这些列，其余列为空字符串；为空时读取所有列
+    // 投影变化时丢弃按旧投影读取的初始加载行
+    void setColumnProjection(const QVector<int> &columns);
+    
+    // 容错解析（默认开启）：格式错误的行登记到旁路索引后继续解析；
+    // 关闭时使用解析库严格解析，任何解析错误都会中止加载
+    void setTolerant(bool tolerant);
+    bool isTolerant() const;
+    
+    // 已解析的片段中发现的格式错误行
+    const MalformedRowIndex &malformedRows() const;
+    
+    // currentRow之后的下一个格式错误行，没有时返回-1；exact返回行号是否精确
+    int nextMalformedRow(int currentRow, bool *exact);
+    
+    // 解析数据片段需要的全部参数，不依赖读取器的其他状态，可以复制给工作线程
+    struct ParseSettings {
+        Encoding encoding = UTF8;
+        CsvFormat dialect;
+        csv::CSVFormat parserFormat; // 严格模式下交给解析库的格式（已设置列名，无表头）
+        int width = 0;               // 表头列数，每行都规整为该列数
+        bool tolerant = true;
+        RecordParser::ParseFunction parseKernel = nullptr; // 容错模式的解析内核，确定方言时按方言选定
+    };
+    
+    // 导出等后台任务独立解析文件片段时使用的参数
+    qint64 dataStartOffset() const; // 数据区（表头之后）的起始偏移
+    Encoding effectiveEncoding() const; // 实际使用的编码
+    ParseSettings parseSettings() const;
+    
+    // 后台预读、复制选中内容等工作线程直接读取文件需要的全部参数，
+    // 引用读取器持有的内存映射和行索引，重新加载或关闭文件前必须先停止使用
+    struct ReadAheadSource {
+        const char *data = nullptr;
+        qint64 fileSize = 0;
+        qint64 dataStart = 0;
+        int fileHandle = -1;               // 用于向系统提示即将读取的范围
+        ParseSettings parse;
+        const RowIndex *rowIndex = nullptr;       // 为nullptr时只能从数据区起始位置顺序定位
+        const ColumnarFile *columnarFile = nullptr; // 列式文件，否则为nullptr
+        QVector<int> columnProjection;
+        int loadedRows = 0;                // 顺序加载的行已在内存中，不需要预读
+        double bytesPerRecord = 0.0;       // 平均记录长度，用于估算行索引尚未覆盖的行的位置
+    };
+    
+    // 压缩文件只能顺序解压，不支持后台预读，返回false
+    bool readAheadSource(ReadAheadSource *source) const;
+    
+    // 在工作线程中定位第row行的起始偏移：从行索引中不超过该行的最近检查点向后跳过记录，
+    // 行索引尚未覆盖时从已索引的最后一个检查点（或数据区起始位置）开始，结果总是精确的
+    static qint64 locateRow(const ReadAheadSource &source, qint64 row);
+    
+    // 登记后台预读的一页：记录片段末尾的位置，登记格式错误的行
+    void commitReadAhead(int firstRow, int count, qint64 endOffset, const QVector<MalformedRecord> &malformed);
+    
+    // 释放初始加载（顺序加载）的行，之后这些行按需从文件重新读取；不能安全释放时返回false
+    bool releaseLoadedRows();
+    
+    // 把一段从记录边界开始的原始字节解析为数据行，每行的列数都等于settings.width
+    // baseOffset为片段在文件中的偏移，容错模式下格式错误的记录追加到malformed（可为nullptr）
+    // 不访问读取器的状态，可以在工作线程中并行调用
+    static QList<QStringList> parseBytes(const char *bytes, qint64 length, const ParseSettings &settings,
+                                         qint64 baseOffset = 0, QVector<MalformedRecord> *malformed = nullptr);
+    
+    // 与parseBytes相同，但总是使用容错解析内核：每条记录（边界与RecordScanner一致）恰好得到一行，
+    // 需要按记录序号或记录偏移对应到行时使用（严格模式的解析器可能丢弃空记录或不规则的记录）
+    static QList<QStringList> parseRecords(const char *bytes, qint64 length, const ParseSettings &settings,
+                                           qint64 baseOffset = 0, QVector<MalformedRecord> *malformed = nullptr);
+
+signals:
+    // 估算的总行数发生变化（采样估算后由后台精确计数逐步修正）
+    void estimatedTotalRowsChanged(int rows);
+    
+    // 后台计数完成，行索引覆盖整个文件，之后按行号定位都是精确的
+    void rowIndexCompleted();
+    
+    // 后台计数读取出错，总行数保持估算值，行索引只覆盖出错位置之前的部分
+    void rowCountFailed(const QString &error);
+    
+    // 解析时发现了新的格式错误行，total为目前登记的总数
+    void malformedRowsFound(int total);
 
 private:
+    // 已知的记录起始位置
+    struct RowOffset {
+        qint64 offset; // 字节偏移
+        bool exact;    // 是否为精确位置（否则由估算定位得到）
+    };
+    
+    // 根据估算器结果更新总行数
+    void updateEstimatedTotalRows();
+    
+    // 后台计数完成
+    void onRowCountFinished();
+    
+    // 后台计数失败
+    void onRowCountFailed(const QString &error);
+    
+    // 关闭并解除映射当前文件
+    void closeFile();
+    
+    // 打开已映射的列式文件
+    bool loadColumnarFile(const QString &filePath);
+    
+    // 确定文件的方言：显式指定 > 按文件缓存 > 采样检测（检测结果写入缓存）
+    CsvFormat resolveFormat(const QString &filePath, const char *data, qint64 length);
+    
+    // 根据文件开头的样本确定实际使用的编码
+    Encoding detectEncoding(const QByteArray &sample) const;
+    
+    // 把原始字节转换为解析库使用的UTF-8文本
+    static std::string toUtf8(const char *bytes, qint64 length, Encoding encoding);
+    
+    // 解析[begin, end)范围内的数据行，范围必须从记录边界开始
+    // firstRow为第一行的行号（位置是估算的时为-1），用于登记格式错误的行
+    QList<QStringList> parseRange(qint64 begin, qint64 end, qint64 firstRow);
+    
+    // 解析内存中的一段数据（压缩文件解压出的窗口），baseOffset为其在解压后数据中的偏移
+    QList<QStringList> parseWindow(const QByteArray &window, qint64 baseOffset, qint64 firstRow);
+    
+    // 登记片段中的格式错误行，firstRow为-1时行号未知
+    void addMalformedRows(QVector<MalformedRecord> records, qint64 firstRow);
+    
+    // 查找指定行的起始字节偏移，压缩文件中尚未扫描到的行返回-1
+    qint64 offsetForRow(int row, bool *exact) const;
+    
+    // 记录片段末尾的位置；超过上限时丢弃离这一行最远的一半，长时间浏览大文件时不会无限增长
+    void rememberRowOffset(int row, qint64 offset, bool exact);
+    
+    // 丢弃按估算定位记下的片段位置
+    void dropEstimatedRowOffsets();
+    
+    // 压缩文件：解压从offset处的记录起始位置开始的count条记录，
+    // endOffset返回下一条记录的起始偏移，reachedEnd表示已到达文件末尾
+    QByteArray readCompressedRecords(qint64 offset, qint64 count, qint64 *endOffset, bool *reachedEnd) const;
+    
+    // 把初始加载的行实际占用的内存同步到全局内存预算
+    void updateLoadedRowsUsage();
+    
+    // 单行数据转换，列数规整为width
+    static QStringList toStringList(const csv::CSVRow &row, int width);
+
     // CSV数据存储
     QStringList m_headers;
     QList<QStringList> m_dataRows;
+    qint64 m_loadedRowsBytes = 0; // m_dataRows计入内存预算的字节数
+    bool m_loadedRowsReleased = false; // m_dataRows已因内存不足释放
     QString m_lastError;
     Encoding m_encoding; // 当前设置的编码
     
@@ -67,7 +258,31 @@ private:
     int m_totalRowCount; // 估计的总行数
     bool m_hasMoreData; // 是否还有更多数据未加载
     int m_lastLoadedRow; // 最后加载的行索引
-    QString m_fileContentBackup; // 保存文件内容用于后续加载
+    RowCountEstimator *m_rowCountEstimator; // 采样估算总行数并在后台精确计数
+    
+    // 按字节偏移访问文件相关成员变量
+    QFile m_file; // 当前打开的文件
+    const char *m_data; // 文件的内存映射
+    qint64 m_fileSize; // 文件大小
+    qint64 m_dataStart; // 数据区（表头之后）的起始偏移
+    qint64 m_nextRowOffset; // 顺序加载的下一行的起始偏移
+    Encoding m_effectiveEncoding; // 实际使用的编码（自动检测时为检测结果）
+    ParseSettings m_parseSettings; // 解析数据片段使用的参数（已确定方言和列名）
+    bool m_tolerant = true;
+    MalformedRowIndex m_malformedRows;
+    CsvFormat m_format; // 当前文件实际使用的方言
+    CsvFormat m_requestedFormat; // 显式指定的方言
+    bool m_hasRequestedFormat = false;
+    bool m_redetectFormat = false; // 下次加载时忽略缓存重新检测
+    QHash<int, RowOffset> m_rowOffsets; // 已读取片段末尾的记录位置，用于衔接相邻片段
+    
+    // 列式文件
+    ColumnarFile m_columnarFile;
+    bool m_isColumnar = false;
+    QVector<int> m_columnProjection; // 列式文件只读取的列
+    
+    // 压缩文件的解压视图，为空表示未压缩
+    std::unique_ptr<CompressedFile> m_compressed;
 
 };
 
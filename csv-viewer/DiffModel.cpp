@@ -0,0 +1,161 @@
+#include "DiffModel.h"
+#include <QBrush>
+#include <QColor>
+
+DiffModel::DiffModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int DiffModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_result.entries.size();
+}
+
+int DiffModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return FIXED_COLUMNS + m_result.columns.size();
+}
+
+QVariant DiffModel::data(const QModelIndex &index, int role) const
+{
+    static const QVariant addedBackground = QBrush(QColor(0xdf, 0xf6, 0xdd));
+    static const QVariant removedBackground = QBrush(QColor(0xfd, 0xdd, 0xdd));
+    static const QVariant changedBackground = QBrush(QColor(0xff, 0xf1, 0xb8));
+    static const QVariant whiteBackground = QBrush(Qt::white);
+
+    if (!index.isValid() || index.row() >= m_result.entries.size()) {
+        return QVariant();
+    }
+    const DiffEntry &entry = m_result.entries.at(index.row());
+    const int column = index.column() - FIXED_COLUMNS;
+
+    switch (role) {
+    case Qt::DisplayRole: {
+        switch (index.column()) {
+        case 0:
+            return entry.kind == DiffEntry::Added ? tr("新增") : entry.kind == DiffEntry::Removed ? tr("删除") : tr("修改");
+        case 1:
+            return entry.oldRow >= 0 ? QVariant(entry.oldRow + 1) : QVariant();
+        case 2:
+            return entry.newRow >= 0 ? QVariant(entry.newRow + 1) : QVariant();
+        default:
+            break;
+        }
+        const RowValues &values = rowValues(index.row());
+        if (entry.kind == DiffEntry::Removed) {
+            return values.oldValues.value(column);
+        }
+        if (entry.kind == DiffEntry::Changed && entry.changedColumns.contains(column)) {
+            return QString("%1 → %2").arg(values.oldValues.value(column), values.newValues.value(column));
+        }
+        return values.newValues.value(column);
+    }
+    case Qt::BackgroundRole:
+        if (entry.kind == DiffEntry::Added) {
+            return addedBackground;
+        }
+        if (entry.kind == DiffEntry::Removed) {
+            return removedBackground;
+        }
+        return (index.column() == 0 || entry.changedColumns.contains(column)) ? changedBackground : whiteBackground;
+    case Qt::ToolTipRole:
+        if (entry.kind == DiffEntry::Changed && entry.changedColumns.contains(column)) {
+            const RowValues &values = rowValues(index.row());
+            return tr("旧值: %1\n新值: %2").arg(values.oldValues.value(column), values.newValues.value(column));
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+QVariant DiffModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role == Qt::DisplayRole && orientation == Qt::Horizontal) {
+        switch (section) {
+        case 0:
+            return tr("状态");
+        case 1:
+            return tr("旧行号");
+        case 2:
+            return tr("新行号");
+        default:
+            return m_result.columns.value(section - FIXED_COLUMNS);
+        }
+    }
+
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+bool DiffModel::setResult(const DiffResult &result, const DiffSource &oldSource, const DiffSource &newSource)
+{
+    beginResetModel();
+    m_cache.clear();
+    m_oldFile.close();
+    m_newFile.close();
+    m_oldData = nullptr;
+    m_newData = nullptr;
+    m_result = result;
+    m_oldParse = oldSource.parse;
+    m_newParse = newSource.parse;
+
+    // 只映射文件，记录在显示时才读取
+    bool ok = true;
+    m_oldFile.setFileName(oldSource.filePath);
+    m_newFile.setFileName(newSource.filePath);
+    if (m_oldFile.open(QIODevice::ReadOnly) && m_oldFile.size() > 0) {
+        m_oldData = m_oldFile.map(0, m_oldFile.size());
+    }
+    if (m_newFile.open(QIODevice::ReadOnly) && m_newFile.size() > 0) {
+        m_newData = m_newFile.map(0, m_newFile.size());
+    }
+    if ((result.removed + result.changed > 0 && !m_oldData) || (result.added + result.changed > 0 && !m_newData)) {
+        m_result.entries.clear();
+        ok = false;
+    }
+    endResetModel();
+    return ok;
+}
+
+const DiffModel::RowValues &DiffModel::rowValues(int row) const
+{
+    auto it = m_cache.constFind(row);
+    if (it != m_cache.constEnd()) {
+        return it.value();
+    }
+
+    if (m_cache.size() >= CACHE_ROWS) {
+        m_cache.clear();
+    }
+    const DiffEntry &entry = m_result.entries.at(row);
+    RowValues values;
+    if (entry.kind != DiffEntry::Added) {
+        values.oldValues = recordValues(m_oldData, entry.oldOffset, entry.oldLength, m_oldParse, m_result.oldColumns);
+    }
+    if (entry.kind != DiffEntry::Removed) {
+        values.newValues = recordValues(m_newData, entry.newOffset, entry.newLength, m_newParse, m_result.newColumns);
+    }
+    return m_cache.insert(row, values).value();
+}
+
+QStringList DiffModel::recordValues(const uchar *data, qint64 offset, qint32 length,
+                                    const CsvReader::ParseSettings &parse, const QVector<int> &columns)
+{
+    QStringList values;
+    if (!data || offset < 0) {
+        return values;
+    }
+    const QStringList fields = CsvReader::parseBytes(reinterpret_cast<const char *>(data) + offset, length, parse).value(0);
+    values.reserve(columns.size());
+    for (int column : columns) {
+        values.append(fields.value(column));
+    }
+    return values;
+}
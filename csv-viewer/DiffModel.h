@@ -0,0 +1,55 @@
+#ifndef DIFFMODEL_H
+#define DIFFMODEL_H
+
+#include <QAbstractTableModel>
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+
+#include "FileDiff.h"
+
+// 比较结果模型
+// 每行是一条差异：状态、两个文件中的行号和各比较列的值。差异只保存记录的位置，
+// 显示时才从内存映射的源文件中解析，缓存视口附近的行；新增、删除的行和修改的单元格用背景色标出
+class DiffModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit DiffModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // 设置比较结果，打开并映射两个源文件，失败时返回false
+    bool setResult(const DiffResult &result, const DiffSource &oldSource, const DiffSource &newSource);
+
+    static constexpr int FIXED_COLUMNS = 3;   // 状态、旧行号、新行号
+    static constexpr int CACHE_ROWS = 2000;   // 缓存的已解析行数，超出时整体清空
+
+private:
+    // 一条差异在显示列上的旧值和新值
+    struct RowValues {
+        QStringList oldValues;
+        QStringList newValues;
+    };
+
+    const RowValues &rowValues(int row) const;
+
+    // 从源文件中解析一条记录，取出显示列的值
+    static QStringList recordValues(const uchar *data, qint64 offset, qint32 length,
+                                    const CsvReader::ParseSettings &parse, const QVector<int> &columns);
+
+    DiffResult m_result;
+    CsvReader::ParseSettings m_oldParse;
+    CsvReader::ParseSettings m_newParse;
+    QFile m_oldFile;
+    QFile m_newFile;
+    const uchar *m_oldData = nullptr;
+    const uchar *m_newData = nullptr;
+    mutable QHash<int, RowValues> m_cache;
+};
+
+#endif // DIFFMODEL_H
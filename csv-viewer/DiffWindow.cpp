@@ -0,0 +1,80 @@
+#include "DiffWindow.h"
+#include "DiffModel.h"
+#include <QHeaderView>
+#include <QLabel>
+#include <QProgressBar>
+#include <QTableView>
+#include <QVBoxLayout>
+
+DiffWindow::DiffWindow(const QString &title, const DiffSource &oldSource, const DiffSource &newSource,
+                       const DiffOptions &options, QWidget *parent)
+    : QDialog(parent)
+    , m_differ(new FileDiffer(this))
+    , m_diffModel(new DiffModel(this))
+    , m_oldSource(oldSource)
+    , m_newSource(newSource)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(title);
+    resize(900, 550);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    m_statusLabel = new QLabel(tr("正在比较 ..."), this);
+    m_statusLabel->setWordWrap(true);
+    layout->addWidget(m_statusLabel);
+    m_progressBar = new QProgressBar(this);
+    m_progressBar->setRange(0, 1000);
+    layout->addWidget(m_progressBar);
+
+    // 差异行数有限且需要显示背景色，使用默认委托
+    m_view = new QTableView(this);
+    m_view->setModel(m_diffModel);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_view->setWordWrap(false);
+    m_view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_view->verticalHeader()->setDefaultSectionSize(m_view->fontMetrics().height() + 6);
+    m_view->setVisible(false);
+    layout->addWidget(m_view);
+
+    connect(m_differ, &FileDiffer::progress, this, [this](qint64 done, qint64 total) {
+        m_progressBar->setValue(total > 0 ? static_cast<int>(done * 1000 / total) : 0);
+    });
+    connect(m_differ, &FileDiffer::finished, this, &DiffWindow::onFinished);
+
+    m_differ->start(oldSource, newSource, options);
+}
+
+DiffWindow::~DiffWindow()
+{
+    m_differ->cancel();
+}
+
+void DiffWindow::onFinished(bool success, const DiffResult &result, const QString &error)
+{
+    m_progressBar->setVisible(false);
+    if (!success) {
+        m_statusLabel->setText(tr("比较失败: %1").arg(error));
+        return;
+    }
+    if (!m_diffModel->setResult(result, m_oldSource, m_newSource)) {
+        m_statusLabel->setText(tr("比较完成，但无法重新打开源文件显示差异"));
+        return;
+    }
+
+    QString summary = tr("旧文件 %1 行，新文件 %2 行：新增 %3 行，删除 %4 行，修改 %5 行")
+        .arg(result.oldRows).arg(result.newRows).arg(result.added).arg(result.removed).arg(result.changed);
+    if (result.entries.size() < result.added + result.removed + result.changed) {
+        summary += tr("（只列出前 %1 条差异）").arg(result.entries.size());
+    }
+    if (result.duplicateKeys > 0) {
+        summary += tr("\n%1 行的键与同一文件中之前的行重复，未参与比较").arg(result.duplicateKeys);
+    }
+    if (!result.oldOnlyColumns.isEmpty() || !result.newOnlyColumns.isEmpty()) {
+        summary += tr("\n不参与比较的列：旧文件独有 [%1]，新文件独有 [%2]")
+            .arg(result.oldOnlyColumns.join(", "), result.newOnlyColumns.join(", "));
+    }
+    m_statusLabel->setText(summary);
+    m_view->setVisible(true);
+    m_view->resizeColumnsToContents();
+}
@@ -0,0 +1,36 @@
+#ifndef DIFFWINDOW_H
+#define DIFFWINDOW_H
+
+#include <QDialog>
+
+#include "FileDiff.h"
+
+class QLabel;
+class QProgressBar;
+class QTableView;
+class DiffModel;
+
+// 文件比较结果窗口
+// 非模态，在后台比较完成后列出新增、删除和修改的行，关闭窗口时取消尚未完成的比较
+class DiffWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    DiffWindow(const QString &title, const DiffSource &oldSource, const DiffSource &newSource,
+               const DiffOptions &options, QWidget *parent = nullptr);
+    ~DiffWindow();
+
+private:
+    void onFinished(bool success, const DiffResult &result, const QString &error);
+
+    FileDiffer *m_differ;
+    DiffModel *m_diffModel;
+    DiffSource m_oldSource;
+    DiffSource m_newSource;
+    QTableView *m_view;
+    QLabel *m_statusLabel;
+    QProgressBar *m_progressBar;
+};
+
+#endif // DIFFWINDOW_H
@@ -0,0 +1,1361 @@
+#include "Expression.h"
+#include <QObject>
+#include <QtMath>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+static const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+int ValueVector::size() const
+{
+    switch (type) {
+    case Number:
+        return numbers.size();
+    case Bool:
+        return bools.size();
+    case Text:
+        break;
+    }
+    return texts.size();
+}
+
+void ValueVector::reset(Type newType, int count)
+{
+    type = newType;
+    numbers.clear();
+    texts.clear();
+    bools.clear();
+    switch (type) {
+    case Number:
+        numbers.resize(count);
+        break;
+    case Text:
+        texts.resize(count);
+        break;
+    case Bool:
+        bools.resize(count);
+        break;
+    }
+}
+
+QString ValueVector::text(int i) const
+{
+    switch (type) {
+    case Number:
+        return numberText(numbers.at(i));
+    case Bool:
+        return bools.at(i) ? QStringLiteral("true") : QStringLiteral("false");
+    case Text:
+        break;
+    }
+    return texts.at(i);
+}
+
+QString ValueVector::numberText(double value)
+{
+    if (qIsNaN(value)) {
+        return QString();
+    }
+    // 整数（例如两个整数列相乘）按整数显示，不出现小数点和指数
+    if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        return QString::number(static_cast<qint64>(value));
+    }
+    return QString::number(value, 'g', 15);
+}
+
+ExpressionBatch::ExpressionBatch(const QList<QStringList> &rows, int first, int count)
+    : m_rows(rows)
+    , m_first(first)
+    , m_count(count)
+{
+}
+
+int ExpressionBatch::size() const
+{
+    return m_count;
+}
+
+const QStringList &ExpressionBatch::text(int column) const
+{
+    auto it = m_texts.constFind(column);
+    if (it != m_texts.constEnd()) {
+        return it.value();
+    }
+    // 字符串隐式共享，取出一列不复制文本
+    QStringList values;
+    values.reserve(m_count);
+    for (int i = 0; i < m_count; ++i) {
+        values.append(m_rows.at(m_first + i).value(column));
+    }
+    return m_texts.insert(column, values).value();
+}
+
+const QVector<double> &ExpressionBatch::numbers(int column) const
+{
+    auto it = m_numbers.constFind(column);
+    if (it != m_numbers.constEnd()) {
+        return it.value();
+    }
+    const QStringList texts = text(column);
+    QVector<double> values(m_count);
+    for (int i = 0; i < m_count; ++i) {
+        bool ok = false;
+        const double value = texts.at(i).toDouble(&ok);
+        values[i] = ok ? value : NaN;
+    }
+    return m_numbers.insert(column, values).value();
+}
+
+namespace {
+
+using NodePtr = std::unique_ptr<ExpressionNode>;
+
+// 把一批值转换为目标类型
+void convert(const ValueVector &in, ValueVector::Type type, ValueVector &out)
+{
+    const int count = in.size();
+    out.reset(type, count);
+    switch (type) {
+    case ValueVector::Number:
+        if (in.type == ValueVector::Text) {
+            for (int i = 0; i < count; ++i) {
+                bool ok = false;
+                const double value = in.texts.at(i).toDouble(&ok);
+                out.numbers[i] = ok ? value : NaN;
+            }
+        } else {
+            for (int i = 0; i < count; ++i) {
+                out.numbers[i] = in.bools.at(i) ? 1.0 : 0.0;
+            }
+        }
+        break;
+    case ValueVector::Bool:
+        if (in.type == ValueVector::Number) {
+            for (int i = 0; i < count; ++i) {
+                const double value = in.numbers.at(i);
+                out.bools[i] = !qIsNaN(value) && value != 0.0;
+            }
+        } else {
+            for (int i = 0; i < count; ++i) {
+                out.bools[i] = !in.texts.at(i).isEmpty();
+            }
+        }
+        break;
+    case ValueVector::Text:
+        for (int i = 0; i < count; ++i) {
+            out.texts[i] = in.text(i);
+        }
+        break;
+    }
+}
+
+// 原始列的文本
+class TextColumnNode : public ExpressionNode
+{
+public:
+    explicit TextColumnNode(int column) : m_column(column) {}
+    ValueVector::Type type() const override { return ValueVector::Text; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        out.reset(ValueVector::Text, 0);
+        out.texts = batch.text(m_column);
+    }
+
+private:
+    int m_column;
+};
+
+// 原始列的数值，同一批内共用转换结果
+class NumberColumnNode : public ExpressionNode
+{
+public:
+    explicit NumberColumnNode(int column) : m_column(column) {}
+    ValueVector::Type type() const override { return ValueVector::Number; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        out.reset(ValueVector::Number, 0);
+        out.numbers = batch.numbers(m_column);
+    }
+
+private:
+    int m_column;
+};
+
+// 字面量，展开为整批相同的值
+class ConstantNode : public ExpressionNode
+{
+public:
+    explicit ConstantNode(const ValueVector &value) : m_value(value) {}
+    ValueVector::Type type() const override { return m_value.type; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        const int count = batch.size();
+        out.reset(m_value.type, 0);
+        switch (m_value.type) {
+        case ValueVector::Number:
+            out.numbers.fill(m_value.numbers.first(), count);
+            break;
+        case ValueVector::Text:
+            out.texts.reserve(count);
+            for (int i = 0; i < count; ++i) {
+                out.texts.append(m_value.texts.first());
+            }
+            break;
+        case ValueVector::Bool:
+            out.bools.fill(m_value.bools.first(), count);
+            break;
+        }
+    }
+
+private:
+    ValueVector m_value;
+};
+
+// 类型转换
+class CastNode : public ExpressionNode
+{
+public:
+    CastNode(ValueVector::Type type, NodePtr child) : m_type(type), m_child(std::move(child)) {}
+    ValueVector::Type type() const override { return m_type; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        ValueVector value;
+        m_child->evaluate(batch, value);
+        convert(value, m_type, out);
+    }
+
+private:
+    ValueVector::Type m_type;
+    NodePtr m_child;
+};
+
+// 算术运算，除数为0时结果为空
+class ArithmeticNode : public ExpressionNode
+{
+public:
+    enum Op { Add, Subtract, Multiply, Divide, Modulo };
+
+    ArithmeticNode(Op op, NodePtr left, NodePtr right) : m_op(op), m_left(std::move(left)), m_right(std::move(right)) {}
+    ValueVector::Type type() const override { return ValueVector::Number; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        ValueVector left;
+        ValueVector right;
+        m_left->evaluate(batch, left);
+        m_right->evaluate(batch, right);
+        const int count = batch.size();
+        out.reset(ValueVector::Number, count);
+        const double *a = left.numbers.constData();
+        const double *b = right.numbers.constData();
+        double *r = out.numbers.data();
+        switch (m_op) {
+        case Add:
+            for (int i = 0; i < count; ++i) {
+                r[i] = a[i] + b[i];
+            }
+            break;
+        case Subtract:
+            for (int i = 0; i < count; ++i) {
+                r[i] = a[i] - b[i];
+            }
+            break;
+        case Multiply:
+            for (int i = 0; i < count; ++i) {
+                r[i] = a[i] * b[i];
+            }
+            break;
+        case Divide:
+            for (int i = 0; i < count; ++i) {
+                r[i] = b[i] != 0.0 ? a[i] / b[i] : NaN;
+            }
+            break;
+        case Modulo:
+            for (int i = 0; i < count; ++i) {
+                r[i] = b[i] != 0.0 ? std::fmod(a[i], b[i]) : NaN;
+            }
+            break;
+        }
+    }
+
+private:
+    Op m_op;
+    NodePtr m_left;
+    NodePtr m_right;
+};
+
+class NegateNode : public ExpressionNode
+{
+public:
+    explicit NegateNode(NodePtr child) : m_child(std::move(child)) {}
+    ValueVector::Type type() const override { return ValueVector::Number; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        m_child->evaluate(batch, out);
+        for (double &value : out.numbers) {
+            value = -value;
+        }
+    }
+
+private:
+    NodePtr m_child;
+};
+
+// 比较运算
+// 数值比较：两边都是数值；文本比较：两边都是文本时逐行判断，两个值都是数值时按数值比较，否则按文本比较
+class CompareNode : public ExpressionNode
+{
+public:
+    enum Op { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+    CompareNode(Op op, NodePtr leftNumber, NodePtr rightNumber, NodePtr leftText, NodePtr rightText)
+        : m_op(op)
+        , m_leftNumber(std::move(leftNumber))
+        , m_rightNumber(std::move(rightNumber))
+        , m_leftText(std::move(leftText))
+        , m_rightText(std::move(rightText))
+    {
+    }
+    ValueVector::Type type() const override { return ValueVector::Bool; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        const int count = batch.size();
+        ValueVector leftNumbers;
+        ValueVector rightNumbers;
+        m_leftNumber->evaluate(batch, leftNumbers);
+        m_rightNumber->evaluate(batch, rightNumbers);
+        const double *a = leftNumbers.numbers.constData();
+        const double *b = rightNumbers.numbers.constData();
+        out.reset(ValueVector::Bool, count);
+        quint8 *r = out.bools.data();
+        switch (m_op) {
+        case Equal:
+            for (int i = 0; i < count; ++i) {
+                r[i] = a[i] == b[i];
+            }
+            break;
+        case NotEqual:
+            for (int i = 0; i < count; ++i) {
+                r[i] = a[i] != b[i];
+            }
+            break;
+        case Less:
+            for (int i = 0; i < count; ++i) {
+                r[i] = a[i] < b[i];
+            }
+            break;
+        case LessEqual:
+            for (int i = 0; i < count; ++i) {
+                r[i] = a[i] <= b[i];
+            }
+            break;
+        case Greater:
+            for (int i = 0; i < count; ++i) {
+                r[i] = a[i] > b[i];
+            }
+            break;
+        case GreaterEqual:
+            for (int i = 0; i < count; ++i) {
+                r[i] = a[i] >= b[i];
+            }
+            break;
+        }
+        if (!m_leftText) {
+            return;
+        }
+
+        // 只有一边不是数值的行按文本重新比较
+        ValueVector leftTexts;
+        ValueVector rightTexts;
+        m_leftText->evaluate(batch, leftTexts);
+        m_rightText->evaluate(batch, rightTexts);
+        for (int i = 0; i < count; ++i) {
+            if (!qIsNaN(a[i]) && !qIsNaN(b[i])) {
+                continue;
+            }
+            const int order = leftTexts.texts.at(i).compare(rightTexts.texts.at(i));
+            switch (m_op) {
+            case Equal:
+                r[i] = order == 0;
+                break;
+            case NotEqual:
+                r[i] = order != 0;
+                break;
+            case Less:
+                r[i] = order < 0;
+                break;
+            case LessEqual:
+                r[i] = order <= 0;
+                break;
+            case Greater:
+                r[i] = order > 0;
+                break;
+            case GreaterEqual:
+                r[i] = order >= 0;
+                break;
+            }
+        }
+    }
+
+private:
+    Op m_op;
+    NodePtr m_leftNumber;
+    NodePtr m_rightNumber;
+    NodePtr m_leftText;  // 为nullptr时是纯数值比较
+    NodePtr m_rightText;
+};
+
+class LogicalNode : public ExpressionNode
+{
+public:
+    enum Op { And, Or };
+
+    LogicalNode(Op op, NodePtr left, NodePtr right) : m_op(op), m_left(std::move(left)), m_right(std::move(right)) {}
+    ValueVector::Type type() const override { return ValueVector::Bool; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        ValueVector right;
+        m_left->evaluate(batch, out);
+        m_right->evaluate(batch, right);
+        const int count = batch.size();
+        quint8 *r = out.bools.data();
+        const quint8 *b = right.bools.constData();
+        if (m_op == And) {
+            for (int i = 0; i < count; ++i) {
+                r[i] &= b[i];
+            }
+        } else {
+            for (int i = 0; i < count; ++i) {
+                r[i] |= b[i];
+            }
+        }
+    }
+
+private:
+    Op m_op;
+    NodePtr m_left;
+    NodePtr m_right;
+};
+
+class NotNode : public ExpressionNode
+{
+public:
+    explicit NotNode(NodePtr child) : m_child(std::move(child)) {}
+    ValueVector::Type type() const override { return ValueVector::Bool; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        m_child->evaluate(batch, out);
+        for (quint8 &value : out.bools) {
+            value = !value;
+        }
+    }
+
+private:
+    NodePtr m_child;
+};
+
+// 内置函数，参数已按函数要求的类型编译
+class FunctionNode : public ExpressionNode
+{
+public:
+    enum Function { Substr, Length, Upper, Lower, Trim, Concat, Contains, Abs, Round, Floor, Ceil, If };
+
+    FunctionNode(Function function, ValueVector::Type type, std::vector<NodePtr> arguments)
+        : m_function(function)
+        , m_type(type)
+        , m_arguments(std::move(arguments))
+    {
+    }
+    ValueVector::Type type() const override { return m_type; }
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const override
+    {
+        const int count = batch.size();
+        std::vector<ValueVector> args(m_arguments.size());
+        for (size_t i = 0; i < m_arguments.size(); ++i) {
+            m_arguments[i]->evaluate(batch, args[i]);
+        }
+
+        switch (m_function) {
+        case Substr: {
+            out.reset(ValueVector::Text, count);
+            for (int i = 0; i < count; ++i) {
+                const double start = args[1].numbers.at(i);
+                const double length = args.size() > 2 ? args[2].numbers.at(i) : -1.0;
+                if (qIsNaN(start) || qIsNaN(length)) {
+                    continue;
+                }
+                // 在double中截断到[0, INT_MAX]再转换，超大或为无穷大的参数转换为int是未定义行为
+                const double maxPosition = std::numeric_limits<int>::max();
+                const int position = static_cast<int>(qBound(0.0, start, maxPosition));
+                const int size = length < 0 ? -1 : static_cast<int>(qMin(length, maxPosition));
+                out.texts[i] = args[0].texts.at(i).mid(position, size);
+            }
+            break;
+        }
+        case Length:
+            out.reset(ValueVector::Number, count);
+            for (int i = 0; i < count; ++i) {
+                out.numbers[i] = args[0].texts.at(i).size();
+            }
+            break;
+        case Upper:
+            out.reset(ValueVector::Text, count);
+            for (int i = 0; i < count; ++i) {
+                out.texts[i] = args[0].texts.at(i).toUpper();
+            }
+            break;
+        case Lower:
+            out.reset(ValueVector::Text, count);
+            for (int i = 0; i < count; ++i) {
+                out.texts[i] = args[0].texts.at(i).toLower();
+            }
+            break;
+        case Trim:
+            out.reset(ValueVector::Text, count);
+            for (int i = 0; i < count; ++i) {
+                out.texts[i] = args[0].texts.at(i).trimmed();
+            }
+            break;
+        case Concat:
+            out = args[0];
+            for (size_t arg = 1; arg < args.size(); ++arg) {
+                for (int i = 0; i < count; ++i) {
+                    out.texts[i].append(args[arg].texts.at(i));
+                }
+            }
+            break;
+        case Contains:
+            out.reset(ValueVector::Bool, count);
+            for (int i = 0; i < count; ++i) {
+                out.bools[i] = args[0].texts.at(i).contains(args[1].texts.at(i));
+            }
+            break;
+        case Abs:
+            out = args[0];
+            for (double &value : out.numbers) {
+                value = std::fabs(value);
+            }
+            break;
+        case Round:
+            out = args[0];
+            if (args.size() > 1) {
+                for (int i = 0; i < count; ++i) {
+                    const double factor = std::pow(10.0, args[1].numbers.at(i));
+                    out.numbers[i] = std::round(out.numbers.at(i) * factor) / factor;
+                }
+            } else {
+                for (double &value : out.numbers) {
+                    value = std::round(value);
+                }
+            }
+            break;
+        case Floor:
+            out = args[0];
+            for (double &value : out.numbers) {
+                value = std::floor(value);
+            }
+            break;
+        case Ceil:
+            out = args[0];
+            for (double &value : out.numbers) {
+                value = std::ceil(value);
+            }
+            break;
+        case If: {
+            // 两个分支都按整批计算，再逐行选择
+            out = args[1];
+            const quint8 *condition = args[0].bools.constData();
+            for (int i = 0; i < count; ++i) {
+                if (condition[i]) {
+                    continue;
+                }
+                switch (m_type) {
+                case ValueVector::Number:
+                    out.numbers[i] = args[2].numbers.at(i);
+                    break;
+                case ValueVector::Text:
+                    out.texts[i] = args[2].texts.at(i);
+                    break;
+                case ValueVector::Bool:
+                    out.bools[i] = args[2].bools.at(i);
+                    break;
+                }
+            }
+            break;
+        }
+        }
+    }
+
+private:
+    Function m_function;
+    ValueVector::Type m_type;
+    std::vector<NodePtr> m_arguments;
+};
+
+// 语法树，编译为运算符树之前的中间形式
+struct Ast {
+    enum Kind { NumberLiteral, TextLiteral, BoolLiteral, Column, Unary, Binary, Call };
+
+    Kind kind = NumberLiteral;
+    QString op;        // 运算符（小写），函数名（小写）
+    double number = 0.0;
+    QString text;
+    int column = -1;
+    int position = 0;
+    std::vector<std::unique_ptr<Ast>> children;
+};
+
+using AstPtr = std::unique_ptr<Ast>;
+
+struct Token {
+    enum Kind { End, Number, String, Identifier, QuotedIdentifier, Operator, LeftParen, RightParen, Comma };
+
+    Kind kind = End;
+    QString text;
+    double number = 0.0;
+    int position = 0;
+};
+
+// 递归下降解析：or < and < not < 比较 < 加减 < 乘除 < 负号 < 基本表达式
+class Parser
+{
+public:
+    Parser(const QString &text, const QStringList &headers)
+        : m_text(text)
+        , m_headers(headers)
+    {
+    }
+
+    AstPtr parse()
+    {
+        if (!tokenize()) {
+            return nullptr;
+        }
+        AstPtr root = parseOr();
+        if (root && current().kind != Token::End) {
+            fail(current().position, QObject::tr("多余的内容"));
+            return nullptr;
+        }
+        return root;
+    }
+
+    QString error() const { return m_error; }
+
+private:
+    bool tokenize()
+    {
+        int i = 0;
+        const int length = m_text.size();
+        while (i < length) {
+            const QChar c = m_text.at(i);
+            if (c.isSpace()) {
+                ++i;
+                continue;
+            }
+            Token token;
+            token.position = i;
+            if (c.isDigit() || (c == QLatin1Char('.') && i + 1 < length && m_text.at(i + 1).isDigit())) {
+                int end = i;
+                while (end < length && (m_text.at(end).isDigit() || m_text.at(end) == QLatin1Char('.'))) {
+                    ++end;
+                }
+                if (end < length && (m_text.at(end) == QLatin1Char('e') || m_text.at(end) == QLatin1Char('E'))) {
+                    int exponent = end + 1;
+                    if (exponent < length && (m_text.at(exponent) == QLatin1Char('+') || m_text.at(exponent) == QLatin1Char('-'))) {
+                        ++exponent;
+                    }
+                    if (exponent < length && m_text.at(exponent).isDigit()) {
+                        end = exponent;
+                        while (end < length && m_text.at(end).isDigit()) {
+                            ++end;
+                        }
+                    }
+                }
+                bool ok = false;
+                token.kind = Token::Number;
+                token.number = m_text.mid(i, end - i).toDouble(&ok);
+                if (!ok) {
+                    return fail(i, QObject::tr("无效的数字"));
+                }
+                i = end;
+            } else if (c == QLatin1Char('\'') || c == QLatin1Char('"')) {
+                // 字符串字面量，连续两个引号表示引号本身
+                token.kind = Token::String;
+                int end = i + 1;
+                for (;; ++end) {
+                    if (end >= length) {
+                        return fail(i, QObject::tr("字符串没有结束"));
+                    }
+                    if (m_text.at(end) == c) {
+                        if (end + 1 < length && m_text.at(end + 1) == c) {
+                            token.text.append(c);
+                            ++end;
+                            continue;
+                        }
+                        break;
+                    }
+                    token.text.append(m_text.at(end));
+                }
+                i = end + 1;
+            } else if (c == QLatin1Char('[') || c == QLatin1Char('`')) {
+                const QChar close = (c == QLatin1Char('[')) ? QLatin1Char(']') : QLatin1Char('`');
+                const int end = m_text.indexOf(close, i + 1);
+                if (end < 0) {
+                    return fail(i, QObject::tr("列名没有结束"));
+                }
+                token.kind = Token::QuotedIdentifier;
+                token.text = m_text.mid(i + 1, end - i - 1);
+                i = end + 1;
+            } else if (c.isLetter() || c == QLatin1Char('_')) {
+                int end = i + 1;
+                while (end < length && (m_text.at(end).isLetterOrNumber() || m_text.at(end) == QLatin1Char('_'))) {
+                    ++end;
+                }
+                token.kind = Token::Identifier;
+                token.text = m_text.mid(i, end - i);
+                i = end;
+            } else if (c == QLatin1Char('(')) {
+                token.kind = Token::LeftParen;
+                ++i;
+            } else if (c == QLatin1Char(')')) {
+                token.kind = Token::RightParen;
+                ++i;
+            } else if (c == QLatin1Char(',')) {
+                token.kind = Token::Comma;
+                ++i;
+            } else {
+                static const QStringList operators = {
+                    "==", "!=", "<>", "<=", ">=", "&&", "||", "=", "<", ">", "+", "-", "*", "/", "%", "!"
+                };
+                token.kind = Token::Operator;
+                for (const QString &op : operators) {
+                    if (QStringView(m_text).mid(i).startsWith(op)) {
+                        token.text = op;
+                        break;
+                    }
+                }
+                if (token.text.isEmpty()) {
+                    return fail(i, QObject::tr("无法识别的字符 '%1'").arg(c));
+                }
+                i += token.text.size();
+            }
+            m_tokens.append(token);
+        }
+        Token end;
+        end.position = length;
+        m_tokens.append(end);
+        return true;
+    }
+
+    const Token &current() const { return m_tokens.at(m_index); }
+
+    // 当前记号是否为指定的运算符或关键字（关键字不区分大小写）
+    bool isOperator(const char *op) const
+    {
+        const Token &token = current();
+        if (token.kind == Token::Operator) {
+            return token.text == QLatin1String(op);
+        }
+        return token.kind == Token::Identifier && token.text.compare(QLatin1String(op), Qt::CaseInsensitive) == 0;
+    }
+
+    bool fail(int position, const QString &message)
+    {
+        if (m_error.isEmpty()) {
+            m_error = QObject::tr("第 %1 个字符处: %2").arg(position + 1).arg(message);
+        }
+        return false;
+    }
+
+    static AstPtr makeNode(Ast::Kind kind, const QString &op, int position)
+    {
+        AstPtr node(new Ast);
+        node->kind = kind;
+        node->op = op;
+        node->position = position;
+        return node;
+    }
+
+    static AstPtr makeBinary(const QString &op, int position, AstPtr left, AstPtr right)
+    {
+        AstPtr node = makeNode(Ast::Binary, op, position);
+        node->children.push_back(std::move(left));
+        node->children.push_back(std::move(right));
+        return node;
+    }
+
+    AstPtr parseOr()
+    {
+        AstPtr left = parseAnd();
+        while (left && (isOperator("or") || isOperator("||"))) {
+            const int position = current().position;
+            ++m_index;
+            AstPtr right = parseAnd();
+            if (!right) {
+                return nullptr;
+            }
+            left = makeBinary("or", position, std::move(left), std::move(right));
+        }
+        return left;
+    }
+
+    AstPtr parseAnd()
+    {
+        AstPtr left = parseNot();
+        while (left && (isOperator("and") || isOperator("&&"))) {
+            const int position = current().position;
+            ++m_index;
+            AstPtr right = parseNot();
+            if (!right) {
+                return nullptr;
+            }
+            left = makeBinary("and", position, std::move(left), std::move(right));
+        }
+        return left;
+    }
+
+    AstPtr parseNot()
+    {
+        if (isOperator("not") || isOperator("!")) {
+            const int position = current().position;
+            ++m_index;
+            AstPtr child = parseNot();
+            if (!child) {
+                return nullptr;
+            }
+            AstPtr node = makeNode(Ast::Unary, "not", position);
+            node->children.push_back(std::move(child));
+            return node;
+        }
+        return parseComparison();
+    }
+
+    AstPtr parseComparison()
+    {
+        AstPtr left = parseAdditive();
+        if (!left) {
+            return nullptr;
+        }
+        static const char *const comparisons[] = {"==", "=", "!=", "<>", "<=", ">=", "<", ">"};
+        for (const char *op : comparisons) {
+            if (current().kind == Token::Operator && isOperator(op)) {
+                const int position = current().position;
+                ++m_index;
+                AstPtr right = parseAdditive();
+                if (!right) {
+                    return nullptr;
+                }
+                // 统一写法：= 与 ==、<> 与 != 相同
+                QString name = QString::fromLatin1(op);
+                if (name == QLatin1String("=")) {
+                    name = QStringLiteral("==");
+                } else if (name == QLatin1String("<>")) {
+                    name = QStringLiteral("!=");
+                }
+                return makeBinary(name, position, std::move(left), std::move(right));
+            }
+        }
+        return left;
+    }
+
+    AstPtr parseAdditive()
+    {
+        AstPtr left = parseMultiplicative();
+        while (left && current().kind == Token::Operator && (isOperator("+") || isOperator("-"))) {
+            const QString op = current().text;
+            const int position = current().position;
+            ++m_index;
+            AstPtr right = parseMultiplicative();
+            if (!right) {
+                return nullptr;
+            }
+            left = makeBinary(op, position, std::move(left), std::move(right));
+        }
+        return left;
+    }
+
+    AstPtr parseMultiplicative()
+    {
+        AstPtr left = parseUnary();
+        while (left && current().kind == Token::Operator && (isOperator("*") || isOperator("/") || isOperator("%"))) {
+            const QString op = current().text;
+            const int position = current().position;
+            ++m_index;
+            AstPtr right = parseUnary();
+            if (!right) {
+                return nullptr;
+            }
+            left = makeBinary(op, position, std::move(left), std::move(right));
+        }
+        return left;
+    }
+
+    AstPtr parseUnary()
+    {
+        if (current().kind == Token::Operator && (isOperator("-") || isOperator("+"))) {
+            const bool negate = isOperator("-");
+            const int position = current().position;
+            ++m_index;
+            AstPtr child = parseUnary();
+            if (!child || !negate) {
+                return child;
+            }
+            AstPtr node = makeNode(Ast::Unary, "-", position);
+            node->children.push_back(std::move(child));
+            return node;
+        }
+        return parsePrimary();
+    }
+
+    AstPtr parsePrimary()
+    {
+        const Token token = current();
+        switch (token.kind) {
+        case Token::Number: {
+            ++m_index;
+            AstPtr node = makeNode(Ast::NumberLiteral, QString(), token.position);
+            node->number = token.number;
+            return node;
+        }
+        case Token::String: {
+            ++m_index;
+            AstPtr node = makeNode(Ast::TextLiteral, QString(), token.position);
+            node->text = token.text;
+            return node;
+        }
+        case Token::LeftParen: {
+            ++m_index;
+            AstPtr inner = parseOr();
+            if (!inner) {
+                return nullptr;
+            }
+            if (current().kind != Token::RightParen) {
+                fail(current().position, QObject::tr("缺少右括号"));
+                return nullptr;
+            }
+            ++m_index;
+            return inner;
+        }
+        case Token::Identifier:
+            if (m_tokens.at(m_index + 1).kind == Token::LeftParen) {
+                return parseCall();
+            }
+            if (token.text.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0
+                || token.text.compare(QLatin1String("false"), Qt::CaseInsensitive) == 0) {
+                ++m_index;
+                AstPtr node = makeNode(Ast::BoolLiteral, QString(), token.position);
+                node->number = token.text.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0 ? 1.0 : 0.0;
+                return node;
+            }
+            Q_FALLTHROUGH();
+        case Token::QuotedIdentifier: {
+            ++m_index;
+            const int column = findColumn(token.text);
+            if (column < 0) {
+                fail(token.position, QObject::tr("找不到列 '%1'").arg(token.text));
+                return nullptr;
+            }
+            AstPtr node = makeNode(Ast::Column, QString(), token.position);
+            node->column = column;
+            return node;
+        }
+        case Token::End:
+            fail(token.position, QObject::tr("表达式不完整"));
+            return nullptr;
+        default:
+            fail(token.position, QObject::tr("此处不能出现 '%1'").arg(token.text.isEmpty() ? m_text.mid(token.position, 1) : token.text));
+            return nullptr;
+        }
+    }
+
+    AstPtr parseCall()
+    {
+        const Token name = current();
+        m_index += 2; // 函数名和左括号
+        AstPtr node = makeNode(Ast::Call, name.text.toLower(), name.position);
+        if (current().kind != Token::RightParen) {
+            for (;;) {
+                AstPtr argument = parseOr();
+                if (!argument) {
+                    return nullptr;
+                }
+                node->children.push_back(std::move(argument));
+                if (current().kind == Token::Comma) {
+                    ++m_index;
+                    continue;
+                }
+                break;
+            }
+        }
+        if (current().kind != Token::RightParen) {
+            fail(current().position, QObject::tr("缺少右括号"));
+            return nullptr;
+        }
+        ++m_index;
+        return node;
+    }
+
+    // 列名精确匹配，找不到时不区分大小写匹配
+    int findColumn(const QString &name) const
+    {
+        const int exact = m_headers.indexOf(name);
+        if (exact >= 0) {
+            return exact;
+        }
+        for (int column = 0; column < m_headers.size(); ++column) {
+            if (m_headers.at(column).compare(name, Qt::CaseInsensitive) == 0) {
+                return column;
+            }
+        }
+        return -1;
+    }
+
+    QString m_text;
+    QStringList m_headers;
+    QVector<Token> m_tokens;
+    int m_index = 0;
+    QString m_error;
+};
+
+// 把语法树编译为运算符树：确定每个节点的结果类型，需要时插入类型转换
+class Compiler
+{
+public:
+    NodePtr compile(const Ast &ast)
+    {
+        switch (ast.kind) {
+        case Ast::NumberLiteral:
+        case Ast::TextLiteral:
+        case Ast::BoolLiteral: {
+            ValueVector value;
+            if (ast.kind == Ast::NumberLiteral) {
+                value.type = ValueVector::Number;
+                value.numbers.append(ast.number);
+            } else if (ast.kind == Ast::TextLiteral) {
+                value.type = ValueVector::Text;
+                value.texts.append(ast.text);
+            } else {
+                value.type = ValueVector::Bool;
+                value.bools.append(ast.number != 0.0);
+            }
+            return NodePtr(new ConstantNode(value));
+        }
+        case Ast::Column:
+            addColumn(ast.column);
+            return NodePtr(new TextColumnNode(ast.column));
+        case Ast::Unary:
+            if (ast.op == QLatin1String("not")) {
+                NodePtr child = compileAs(*ast.children[0], ValueVector::Bool);
+                return child ? NodePtr(new NotNode(std::move(child))) : nullptr;
+            } else {
+                NodePtr child = compileAs(*ast.children[0], ValueVector::Number);
+                return child ? NodePtr(new NegateNode(std::move(child))) : nullptr;
+            }
+        case Ast::Binary:
+            return compileBinary(ast);
+        case Ast::Call:
+            return compileCall(ast);
+        }
+        return nullptr;
+    }
+
+    // 编译为指定类型；列在数值上下文中直接读取批内共用的数值
+    NodePtr compileAs(const Ast &ast, ValueVector::Type type)
+    {
+        if (ast.kind == Ast::Column && type == ValueVector::Number) {
+            addColumn(ast.column);
+            return NodePtr(new NumberColumnNode(ast.column));
+        }
+        NodePtr node = compile(ast);
+        if (node && node->type() != type) {
+            node.reset(new CastNode(type, std::move(node)));
+        }
+        return node;
+    }
+
+    QVector<int> columns() const { return m_columns; }
+    QString error() const { return m_error; }
+
+private:
+    void addColumn(int column)
+    {
+        if (!m_columns.contains(column)) {
+            m_columns.append(column);
+        }
+    }
+
+    NodePtr fail(const Ast &ast, const QString &message)
+    {
+        if (m_error.isEmpty()) {
+            m_error = QObject::tr("第 %1 个字符处: %2").arg(ast.position + 1).arg(message);
+        }
+        return nullptr;
+    }
+
+    // 不编译就能确定的结果类型，用于选择比较方式和if的结果类型
+    static ValueVector::Type naturalType(const Ast &ast)
+    {
+        switch (ast.kind) {
+        case Ast::NumberLiteral:
+            return ValueVector::Number;
+        case Ast::TextLiteral:
+        case Ast::Column:
+            return ValueVector::Text;
+        case Ast::BoolLiteral:
+            return ValueVector::Bool;
+        case Ast::Unary:
+            return ast.op == QLatin1String("not") ? ValueVector::Bool : ValueVector::Number;
+        case Ast::Binary:
+            if (ast.op == QLatin1String("+") || ast.op == QLatin1String("-") || ast.op == QLatin1String("*")
+                || ast.op == QLatin1String("/") || ast.op == QLatin1String("%")) {
+                return ValueVector::Number;
+            }
+            return ValueVector::Bool;
+        case Ast::Call: {
+            const QString &name = ast.op;
+            if (name == QLatin1String("length") || name == QLatin1String("len") || name == QLatin1String("abs")
+                || name == QLatin1String("round") || name == QLatin1String("floor") || name == QLatin1String("ceil")) {
+                return ValueVector::Number;
+            }
+            if (name == QLatin1String("contains")) {
+                return ValueVector::Bool;
+            }
+            if (name == QLatin1String("if") && ast.children.size() == 3) {
+                const ValueVector::Type a = naturalType(*ast.children[1]);
+                const ValueVector::Type b = naturalType(*ast.children[2]);
+                return a == b ? a : ValueVector::Text;
+            }
+            return ValueVector::Text;
+        }
+        }
+        return ValueVector::Text;
+    }
+
+    NodePtr compileBinary(const Ast &ast)
+    {
+        const Ast &left = *ast.children[0];
+        const Ast &right = *ast.children[1];
+        const QString &op = ast.op;
+
+        if (op == QLatin1String("and") || op == QLatin1String("or")) {
+            NodePtr a = compileAs(left, ValueVector::Bool);
+            NodePtr b = a ? compileAs(right, ValueVector::Bool) : nullptr;
+            if (!b) {
+                return nullptr;
+            }
+            return NodePtr(new LogicalNode(op == QLatin1String("and") ? LogicalNode::And : LogicalNode::Or,
+                                           std::move(a), std::move(b)));
+        }
+
+        static const QHash<QString, ArithmeticNode::Op> arithmetic = {
+            {"+", ArithmeticNode::Add}, {"-", ArithmeticNode::Subtract}, {"*", ArithmeticNode::Multiply},
+            {"/", ArithmeticNode::Divide}, {"%", ArithmeticNode::Modulo}
+        };
+        auto arithmeticOp = arithmetic.constFind(op);
+        if (arithmeticOp != arithmetic.constEnd()) {
+            NodePtr a = compileAs(left, ValueVector::Number);
+            NodePtr b = a ? compileAs(right, ValueVector::Number) : nullptr;
+            if (!b) {
+                return nullptr;
+            }
+            return NodePtr(new ArithmeticNode(arithmeticOp.value(), std::move(a), std::move(b)));
+        }
+
+        static const QHash<QString, CompareNode::Op> comparisons = {
+            {"==", CompareNode::Equal}, {"!=", CompareNode::NotEqual}, {"<", CompareNode::Less},
+            {"<=", CompareNode::LessEqual}, {">", CompareNode::Greater}, {">=", CompareNode::GreaterEqual}
+        };
+        const CompareNode::Op compareOp = comparisons.value(op);
+
+        // 任意一边是数值或布尔值时按数值比较；两边都是文本时逐行判断
+        NodePtr leftNumber = compileAs(left, ValueVector::Number);
+        NodePtr rightNumber = leftNumber ? compileAs(right, ValueVector::Number) : nullptr;
+        if (!rightNumber) {
+            return nullptr;
+        }
+        NodePtr leftText;
+        NodePtr rightText;
+        if (naturalType(left) == ValueVector::Text && naturalType(right) == ValueVector::Text) {
+            leftText = compileAs(left, ValueVector::Text);
+            rightText = leftText ? compileAs(right, ValueVector::Text) : nullptr;
+            if (!rightText) {
+                return nullptr;
+            }
+        }
+        return NodePtr(new CompareNode(compareOp, std::move(leftNumber), std::move(rightNumber),
+                                       std::move(leftText), std::move(rightText)));
+    }
+
+    NodePtr compileCall(const Ast &ast)
+    {
+        struct Signature {
+            FunctionNode::Function function;
+            QVector<ValueVector::Type> parameters;
+            int required; // 必须提供的参数个数，其余可省略
+            bool variadic; // 最后一个参数可以重复
+            ValueVector::Type result;
+        };
+        static const QHash<QString, Signature> functions = {
+            {"substr", {FunctionNode::Substr, {ValueVector::Text, ValueVector::Number, ValueVector::Number}, 2, false, ValueVector::Text}},
+            {"length", {FunctionNode::Length, {ValueVector::Text}, 1, false, ValueVector::Number}},
+            {"len", {FunctionNode::Length, {ValueVector::Text}, 1, false, ValueVector::Number}},
+            {"upper", {FunctionNode::Upper, {ValueVector::Text}, 1, false, ValueVector::Text}},
+            {"lower", {FunctionNode::Lower, {ValueVector::Text}, 1, false, ValueVector::Text}},
+            {"trim", {FunctionNode::Trim, {ValueVector::Text}, 1, false, ValueVector::Text}},
+            {"concat", {FunctionNode::Concat, {ValueVector::Text}, 1, true, ValueVector::Text}},
+            {"contains", {FunctionNode::Contains, {ValueVector::Text, ValueVector::Text}, 2, false, ValueVector::Bool}},
+            {"abs", {FunctionNode::Abs, {ValueVector::Number}, 1, false, ValueVector::Number}},
+            {"round", {FunctionNode::Round, {ValueVector::Number, ValueVector::Number}, 1, false, ValueVector::Number}},
+            {"floor", {FunctionNode::Floor, {ValueVector::Number}, 1, false, ValueVector::Number}},
+            {"ceil", {FunctionNode::Ceil, {ValueVector::Number}, 1, false, ValueVector::Number}},
+        };
+
+        const int count = static_cast<int>(ast.children.size());
+        if (ast.op == QLatin1String("if")) {
+            if (count != 3) {
+                return fail(ast, QObject::tr("if需要3个参数"));
+            }
+            const ValueVector::Type type = naturalType(ast);
+            std::vector<NodePtr> arguments;
+            arguments.push_back(compileAs(*ast.children[0], ValueVector::Bool));
+            arguments.push_back(arguments.back() ? compileAs(*ast.children[1], type) : nullptr);
+            arguments.push_back(arguments.back() ? compileAs(*ast.children[2], type) : nullptr);
+            if (!arguments.back()) {
+                return nullptr;
+            }
+            return NodePtr(new FunctionNode(FunctionNode::If, type, std::move(arguments)));
+        }
+
+        auto it = functions.constFind(ast.op);
+        if (it == functions.constEnd()) {
+            return fail(ast, QObject::tr("未知的函数 '%1'").arg(ast.op));
+        }
+        const Signature &signature = it.value();
+        if (count < signature.required || (!signature.variadic && count > signature.parameters.size())) {
+            return fail(ast, QObject::tr("函数 %1 的参数个数不正确").arg(ast.op));
+        }
+        std::vector<NodePtr> arguments;
+        for (int i = 0; i < count; ++i) {
+            const ValueVector::Type type = signature.parameters.at(qMin<qsizetype>(i, signature.parameters.size() - 1));
+            NodePtr argument = compileAs(*ast.children[i], type);
+            if (!argument) {
+                return nullptr;
+            }
+            arguments.push_back(std::move(argument));
+        }
+        return NodePtr(new FunctionNode(signature.function, signature.result, std::move(arguments)));
+    }
+
+    QVector<int> m_columns;
+    QString m_error;
+};
+
+} // namespace
+
+Expression::~Expression() = default;
+
+std::shared_ptr<const Expression> Expression::compile(const QString &text, const QStringList &headers, QString *error)
+{
+    Parser parser(text, headers);
+    const AstPtr ast = parser.parse();
+    if (!ast) {
+        if (error) {
+            *error = parser.error();
+        }
+        return nullptr;
+    }
+
+    Compiler compiler;
+    NodePtr root = compiler.compile(*ast);
+    if (!root) {
+        if (error) {
+            *error = compiler.error();
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<Expression> expression(new Expression);
+    expression->m_text = text;
+    expression->m_root = std::move(root);
+    expression->m_sourceColumns = compiler.columns();
+    return expression;
+}
+
+QString Expression::text() const
+{
+    return m_text;
+}
+
+ValueVector::Type Expression::type() const
+{
+    return m_root->type();
+}
+
+QVector<int> Expression::sourceColumns() const
+{
+    return m_sourceColumns;
+}
+
+void Expression::evaluate(const ExpressionBatch &batch, ValueVector &out) const
+{
+    m_root->evaluate(batch, out);
+}
+
+QStringList Expression::evaluateText(const QList<QStringList> &rows) const
+{
+    QStringList result;
+    result.reserve(rows.size());
+    ValueVector values;
+    for (int first = 0; first < rows.size(); first += BATCH_SIZE) {
+        const ExpressionBatch batch(rows, first, qMin<int>(BATCH_SIZE, rows.size() - first));
+        m_root->evaluate(batch, values);
+        for (int i = 0; i < batch.size(); ++i) {
+            result.append(values.text(i));
+        }
+    }
+    return result;
+}
+
+QVector<bool> Expression::evaluatePredicate(const QList<QStringList> &rows) const
+{
+    QVector<bool> result;
+    result.reserve(rows.size());
+    ValueVector values;
+    ValueVector conditions;
+    for (int first = 0; first < rows.size(); first += BATCH_SIZE) {
+        const ExpressionBatch batch(rows, first, qMin<int>(BATCH_SIZE, rows.size() - first));
+        m_root->evaluate(batch, values);
+        if (values.type == ValueVector::Bool) {
+            for (quint8 value : std::as_const(values.bools)) {
+                result.append(value != 0);
+            }
+        } else {
+            convert(values, ValueVector::Bool, conditions);
+            for (quint8 value : std::as_const(conditions.bools)) {
+                result.append(value != 0);
+            }
+        }
+    }
+    return result;
+}
+
+void appendComputedValues(const QVector<ComputedColumn> &computed, const QVector<bool> &needed, QList<QStringList> &rows)
+{
+    if (computed.isEmpty()) {
+        return;
+    }
+
+    // 先算完所有计算列再追加，计算时各行仍是原来的宽度
+    QList<QStringList> values(computed.size());
+    for (int k = 0; k < computed.size(); ++k) {
+        if (needed.isEmpty() || needed.value(k)) {
+            values[k] = computed.at(k).expression->evaluateText(rows);
+        }
+    }
+    for (int row = 0; row < rows.size(); ++row) {
+        QStringList &fields = rows[row];
+        for (int k = 0; k < computed.size(); ++k) {
+            fields.append(values.at(k).value(row));
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+// 一批值，按类型存放在连续数组中
+struct ValueVector {
+    enum Type : quint8 {
+        Number, // 数值，空值和无法转换的文本为NaN
+        Text,
+        Bool
+    };
+
+    Type type = Text;
+    QVector<double> numbers;
+    QStringList texts;
+    QVector<quint8> bools;
+
+    int size() const;
+    void reset(Type newType, int count);
+
+    // 第i个值的显示文本：整数不带小数点，NaN为空，布尔值为true/false
+    QString text(int i) const;
+
+    static QString numberText(double value);
+};
+
+// 表达式计算的一批行
+// 按列存储：每个被引用的原始列在批内只取出一次，需要数值时整列只转换一次，
+// 同一列被多个运算符引用时共用转换结果
+class ExpressionBatch
+{
+public:
+    // rows中从first开始的count行，rows在批的使用期间必须保持有效
+    ExpressionBatch(const QList<QStringList> &rows, int first, int count);
+
+    int size() const;
+
+    // 原始列的文本和数值（不是数值的为NaN）
+    const QStringList &text(int column) const;
+    const QVector<double> &numbers(int column) const;
+
+private:
+    const QList<QStringList> &m_rows;
+    int m_first;
+    int m_count;
+    mutable QHash<int, QStringList> m_texts;
+    mutable QHash<int, QVector<double>> m_numbers;
+};
+
+// 运算符节点：一次处理一整批行，内层循环只做一种运算
+class ExpressionNode
+{
+public:
+    virtual ~ExpressionNode() = default;
+
+    virtual ValueVector::Type type() const = 0;
+
+    // 计算整批的值，结果类型总是type()
+    virtual void evaluate(const ExpressionBatch &batch, ValueVector &out) const = 0;
+};
+
+// 计算列的表达式
+// 支持数值和字符串字面量、列名（含空格等字符时写作[列名]或`列名`）、
+// 算术运算 + - * / %、比较 = == != <> < <= > >=、逻辑运算 and or not，
+// 以及函数 substr(s, start[, length]) length upper lower trim concat contains
+// abs round(x[, digits]) floor ceil if(cond, a, b)。
+// 编译时解析列名并确定每个节点的结果类型，得到一棵向量化运算符树；编译后的表达式只读，可以在多个线程中同时计算
+class Expression
+{
+public:
+    ~Expression();
+
+    // 编译表达式，列名按headers解析；失败时返回nullptr并写入error
+    static std::shared_ptr<const Expression> compile(const QString &text, const QStringList &headers, QString *error);
+
+    QString text() const;
+    ValueVector::Type type() const;
+
+    // 引用的原始列
+    QVector<int> sourceColumns() const;
+
+    // 计算一批行
+    void evaluate(const ExpressionBatch &batch, ValueVector &out) const;
+
+    // 按BATCH_SIZE分批计算所有行，返回每行结果的显示文本
+    QStringList evaluateText(const QList<QStringList> &rows) const;
+
+    // 按BATCH_SIZE分批计算所有行的条件结果（结果为数值时非零为真，为文本时非空为真）
+    QVector<bool> evaluatePredicate(const QList<QStringList> &rows) const;
+
+    static constexpr int BATCH_SIZE = 1024; // 每批计算的行数
+
+private:
+    Expression() = default;
+
+    QString m_text;
+    std::unique_ptr<ExpressionNode> m_root;
+    QVector<int> m_sourceColumns;
+};
+
+// 计算列：名称和编译好的表达式
+struct ComputedColumn {
+    QString name;
+    std::shared_ptr<const Expression> expression;
+};
+
+// 在每行末尾追加计算列的值，之后原始列号（表头列数 + k）即第k个计算列；行宽必须已规整为表头列数
+// needed非空时只计算其中为true的计算列，其余追加空字符串
+void appendComputedValues(const QVector<ComputedColumn> &computed, const QVector<bool> &needed, QList<QStringList> &rows);
+
+#endif // EXPRESSION_H
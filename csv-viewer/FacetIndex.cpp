@@ -0,0 +1,607 @@
+#include "FacetIndex.h"
+#include "BackgroundTask.h"
+#include "RecordParser.h"
+#include "RecordScanner.h"
+#include <QAtomicInteger>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Space-Saving摘要：固定个数的计数器，保证出现次数超过总数/容量的值一定被保留
+// 已跟踪的值直接计数；未跟踪的新值替换计数最小的值，并继承它的计数作为误差上界。
+// 计数器按计数组成最小堆，替换和递增都是O(log容量)
+class SpaceSaving
+{
+public:
+    struct Counter {
+        QByteArray value;
+        qint64 count = 0;
+        qint64 error = 0; // count - error为真实次数的下界
+    };
+
+    explicit SpaceSaving(int capacity = 0)
+        : m_capacity(capacity)
+    {
+    }
+
+    void add(const QByteArray &value)
+    {
+        auto it = m_position.constFind(value);
+        if (it != m_position.constEnd()) {
+            const int index = it.value();
+            ++m_heap[index].count;
+            siftDown(index);
+            return;
+        }
+
+        // value可能引用内存映射的原始数据，保存前先复制
+        const QByteArray copy(value.constData(), value.size());
+        if (m_heap.size() < m_capacity) {
+            m_heap.append(Counter{copy, 1, 0});
+            m_position.insert(copy, m_heap.size() - 1);
+            siftUp(m_heap.size() - 1);
+            return;
+        }
+
+        Counter &minimum = m_heap[0];
+        m_position.remove(minimum.value);
+        minimum.error = minimum.count;
+        ++minimum.count;
+        minimum.value = copy;
+        m_position.insert(copy, 0);
+        siftDown(0);
+    }
+
+    // 合并另一个工作任务的摘要：一方没有跟踪的值按该方最小计数估计，再保留计数最大的若干个
+    void merge(const SpaceSaving &other)
+    {
+        const qint64 ownMinimum = isFull() ? m_heap.first().count : 0;
+        const qint64 otherMinimum = other.isFull() ? other.m_heap.first().count : 0;
+
+        QVector<Counter> combined;
+        combined.reserve(m_heap.size() + other.m_heap.size());
+        for (const Counter &counter : std::as_const(m_heap)) {
+            Counter merged = counter;
+            auto it = other.m_position.constFind(counter.value);
+            if (it != other.m_position.constEnd()) {
+                merged.count += other.m_heap.at(it.value()).count;
+                merged.error += other.m_heap.at(it.value()).error;
+            } else {
+                merged.count += otherMinimum;
+                merged.error += otherMinimum;
+            }
+            combined.append(merged);
+        }
+        for (const Counter &counter : other.m_heap) {
+            if (m_position.contains(counter.value)) {
+                continue;
+            }
+            Counter merged = counter;
+            merged.count += ownMinimum;
+            merged.error += ownMinimum;
+            combined.append(merged);
+        }
+
+        // 按计数升序排列的数组本身就是最小堆
+        std::sort(combined.begin(), combined.end(), [](const Counter &a, const Counter &b) {
+            return a.count > b.count;
+        });
+        if (combined.size() > m_capacity) {
+            combined.resize(m_capacity);
+        }
+        std::reverse(combined.begin(), combined.end());
+        m_heap = combined;
+        m_position.clear();
+        for (int i = 0; i < m_heap.size(); ++i) {
+            m_position.insert(m_heap.at(i).value, i);
+        }
+    }
+
+    // 计数最大的n个值，次数相同时按值排序
+    QVector<Counter> top(int n) const
+    {
+        QVector<Counter> counters = m_heap;
+        std::sort(counters.begin(), counters.end(), [](const Counter &a, const Counter &b) {
+            return a.count != b.count ? a.count > b.count : a.value < b.value;
+        });
+        if (counters.size() > n) {
+            counters.resize(n);
+        }
+        return counters;
+    }
+
+private:
+    bool isFull() const
+    {
+        return m_heap.size() >= m_capacity;
+    }
+
+    void swapCounters(int a, int b)
+    {
+        std::swap(m_heap[a], m_heap[b]);
+        m_position[m_heap.at(a).value] = a;
+        m_position[m_heap.at(b).value] = b;
+    }
+
+    void siftUp(int index)
+    {
+        while (index > 0) {
+            const int parent = (index - 1) / 2;
+            if (m_heap.at(parent).count <= m_heap.at(index).count) {
+                break;
+            }
+            swapCounters(parent, index);
+            index = parent;
+        }
+    }
+
+    void siftDown(int index)
+    {
+        const int size = m_heap.size();
+        for (;;) {
+            const int left = index * 2 + 1;
+            const int right = left + 1;
+            int smallest = index;
+            if (left < size && m_heap.at(left).count < m_heap.at(smallest).count) {
+                smallest = left;
+            }
+            if (right < size && m_heap.at(right).count < m_heap.at(smallest).count) {
+                smallest = right;
+            }
+            if (smallest == index) {
+                break;
+            }
+            swapCounters(index, smallest);
+            index = smallest;
+        }
+    }
+
+    int m_capacity;
+    QVector<Counter> m_heap;
+    QHash<QByteArray, int> m_position; // 值 -> 在堆中的位置
+};
+
+// 映射源文件并切分为记录对齐的数据块
+struct MappedSource {
+    QFile file;
+    const char *data = nullptr;
+    qint64 size = 0;
+    QVector<qint64> bounds;
+
+    bool open(const FacetSource &source, qint64 chunkSize, QString *error)
+    {
+        file.setFileName(source.filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            *error = QString("Failed to open file: %1, error: %2").arg(source.filePath).arg(file.errorString());
+            return false;
+        }
+        size = file.size();
+        if (size > 0) {
+            data = reinterpret_cast<const char *>(file.map(0, size));
+            if (!data) {
+                *error = QString("Failed to map file: %1, error: %2").arg(source.filePath).arg(file.errorString());
+                return false;
+            }
+        }
+        bounds = RecordScanner::chunkBounds(data, size, qMin(source.dataStart, size), chunkSize,
+                                            source.parse.dialect.quoteChar);
+        return true;
+    }
+};
+
+} // namespace
+
+FacetThread::FacetThread(const FacetSource &source, QObject *parent)
+    : QThread(parent)
+    , m_source(source)
+{
+}
+
+QVector<QVector<Facet>> FacetThread::facets() const
+{
+    return m_facets;
+}
+
+void FacetThread::run()
+{
+    QElapsedTimer facetTimer;
+    facetTimer.start();
+
+    MappedSource mapped;
+    QString error;
+    if (!mapped.open(m_source, CHUNK_SIZE, &error)) {
+        emit finished(false, error);
+        return;
+    }
+    const int chunkCount = mapped.bounds.size() - 1;
+    const qint64 total = mapped.size - mapped.bounds.first();
+    const int columnCount = m_source.headers.size();
+
+    // 所有列都需要，字段槽与列号相同
+    QVector<int> slotOfColumn(columnCount);
+    for (int column = 0; column < columnCount; ++column) {
+        slotOfColumn[column] = column;
+    }
+
+    // 每个工作任务每列一个摘要，循环领取下一块数据，直到全部处理完或被取消
+    const int workerCount = BackgroundTask::workerCount(chunkCount);
+    QVector<QVector<SpaceSaving>> sketches(workerCount, QVector<SpaceSaving>(columnCount, SpaceSaving(SKETCH_CAPACITY)));
+    QVector<qint64> records(workerCount, 0);
+    QAtomicInteger<qint64> done(0);
+    const char quoteChar = m_source.parse.dialect.quoteChar;
+    const bool utf8 = m_source.parse.encoding == CsvReader::UTF8;
+
+    BackgroundTask::forEachChunk(chunkCount, [&](int chunk, int worker) {
+        if (isInterruptionRequested()) {
+            return false;
+        }
+        QVector<SpaceSaving> &columns = sketches[worker];
+        QVarLengthArray<RecordParser::FieldSlice, 64> slices(columnCount);
+        QByteArray buffer;
+        const char *p = mapped.data + mapped.bounds[chunk];
+        const char *end = mapped.data + mapped.bounds[chunk + 1];
+        while (p < end) {
+            p = RecordParser::sliceRecord(p, end, m_source.parse.dialect, utf8, slotOfColumn, slices.data(), columnCount);
+            for (int column = 0; column < columnCount; ++column) {
+                columns[column].add(RecordParser::fieldValue(slices[column], quoteChar, buffer));
+            }
+            ++records[worker];
+        }
+        done.fetchAndAddRelaxed(mapped.bounds[chunk + 1] - mapped.bounds[chunk]);
+        return true;
+    }, [&]() {
+        emit progress(done.loadRelaxed(), total);
+    });
+
+    if (isInterruptionRequested()) {
+        emit finished(false, "Facet computation cancelled");
+        return;
+    }
+
+    // 合并各工作任务的摘要，取每列计数最大的值
+    m_rows = 0;
+    for (qint64 count : records) {
+        m_rows += count;
+    }
+    m_facets.resize(columnCount);
+    for (int column = 0; column < columnCount; ++column) {
+        SpaceSaving &merged = sketches[0][column];
+        for (int worker = 1; worker < workerCount; ++worker) {
+            merged.merge(sketches.at(worker).at(column));
+        }
+        for (const SpaceSaving::Counter &counter : merged.top(TOP_N)) {
+            Facet facet;
+            facet.value = counter.value;
+            facet.text = utf8 ? QString::fromUtf8(counter.value) : QString::fromLocal8Bit(counter.value);
+            facet.count = counter.count;
+            facet.exact = counter.error == 0;
+            m_facets[column].append(facet);
+        }
+    }
+
+    qDebug() << "Computed facets of" << columnCount << "columns over" << m_rows << "rows with" << workerCount
+             << "workers in" << facetTimer.elapsed() << "ms";
+    emit progress(total, total);
+    emit finished(true, QString());
+}
+
+PostingThread::PostingThread(const FacetSource &source, int column, const QByteArray &value,
+                             const std::shared_ptr<const Expression> &predicate, QObject *parent)
+    : QThread(parent)
+    , m_source(source)
+    , m_column(column)
+    , m_value(value)
+    , m_predicate(predicate)
+{
+}
+
+int PostingThread::column() const
+{
+    return m_column;
+}
+
+QByteArray PostingThread::value() const
+{
+    return m_value;
+}
+
+QVector<qint64> PostingThread::offsets() const
+{
+    return m_offsets;
+}
+
+void PostingThread::run()
+{
+    QElapsedTimer postingTimer;
+    postingTimer.start();
+
+    MappedSource mapped;
+    QString error;
+    if (!mapped.open(m_source, CHUNK_SIZE, &error)) {
+        emit finished(false, error);
+        return;
+    }
+    const int chunkCount = mapped.bounds.size() - 1;
+    const qint64 total = mapped.size - mapped.bounds.first();
+
+    // 只切分出筛选列，其余字段只跳过不转换
+    QVector<int> slotOfColumn;
+    if (!m_predicate) {
+        slotOfColumn.fill(-1, m_column + 1);
+        slotOfColumn[m_column] = 0;
+    }
+
+    // 每块的结果单独保存，最后按块的顺序拼接，偏移自然有序
+    QVector<QVector<qint64>> chunkOffsets(chunkCount);
+    QAtomicInteger<qint64> done(0);
+    QMutex mutex;
+    QString scanError;
+    const char quoteChar = m_source.parse.dialect.quoteChar;
+    const bool utf8 = m_source.parse.encoding == CsvReader::UTF8;
+
+    BackgroundTask::forEachChunk(chunkCount, [&](int chunk, int) {
+        if (isInterruptionRequested()) {
+            return false;
+        }
+        QVector<qint64> &offsets = chunkOffsets[chunk];
+        const qint64 chunkBegin = mapped.bounds[chunk];
+        const qint64 chunkEnd = mapped.bounds[chunk + 1];
+        if (m_predicate) {
+            // 记录的起始偏移与解析出的行一一对应
+            QVector<qint64> starts;
+            for (qint64 offset = chunkBegin; offset < chunkEnd;
+                 offset = RecordScanner::skipRecords(mapped.data, mapped.size, offset, 1, quoteChar)) {
+                starts.append(offset);
+            }
+            try {
+                // 容错解析内核的记录边界与RecordScanner一致，严格模式下也不会丢行错位
+                const QList<QStringList> rows = CsvReader::parseRecords(mapped.data + chunkBegin, chunkEnd - chunkBegin,
+                                                                        m_source.parse, chunkBegin);
+                if (rows.size() != starts.size()) {
+                    QMutexLocker locker(&mutex);
+                    scanError = QString("Record count mismatch while filtering rows at offset %1").arg(chunkBegin);
+                    return false;
+                }
+                const QVector<bool> matches = m_predicate->evaluatePredicate(rows);
+                for (int i = 0; i < starts.size(); ++i) {
+                    if (matches.at(i)) {
+                        offsets.append(starts.at(i));
+                    }
+                }
+            } catch (const std::exception &e) {
+                QMutexLocker locker(&mutex);
+                scanError = QString("Error parsing CSV file: %1").arg(e.what());
+                return false;
+            }
+        } else {
+            RecordParser::FieldSlice slice;
+            QByteArray buffer;
+            const char *p = mapped.data + chunkBegin;
+            const char *end = mapped.data + chunkEnd;
+            while (p < end) {
+                const char *record = p;
+                p = RecordParser::sliceRecord(p, end, m_source.parse.dialect, utf8, slotOfColumn, &slice, 1);
+                if (RecordParser::fieldValue(slice, quoteChar, buffer) == m_value) {
+                    offsets.append(record - mapped.data);
+                }
+            }
+        }
+        done.fetchAndAddRelaxed(chunkEnd - chunkBegin);
+        return true;
+    }, [&]() {
+        emit progress(done.loadRelaxed(), total);
+    });
+
+    if (isInterruptionRequested()) {
+        emit finished(false, "Posting scan cancelled");
+        return;
+    }
+    if (!scanError.isEmpty()) {
+        emit finished(false, scanError);
+        return;
+    }
+
+    qint64 matches = 0;
+    for (const QVector<qint64> &offsets : std::as_const(chunkOffsets)) {
+        matches += offsets.size();
+    }
+    m_offsets.clear();
+    m_offsets.reserve(matches);
+    for (const QVector<qint64> &offsets : std::as_const(chunkOffsets)) {
+        m_offsets.append(offsets);
+    }
+
+    qDebug() << "Collected" << m_offsets.size() << "rows for column" << m_column << "with"
+             << BackgroundTask::workerCount(chunkCount) << "workers in" << postingTimer.elapsed() << "ms";
+    emit finished(true, QString());
+}
+
+FacetIndex::FacetIndex(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FacetIndex::~FacetIndex()
+{
+    cancelFacets();
+    cancelPostings();
+}
+
+void FacetIndex::setSource(const FacetSource &source)
+{
+    clear();
+    m_source = source;
+    m_hasSource = true;
+}
+
+void FacetIndex::clear()
+{
+    cancelFacets();
+    cancelPostings();
+    m_hasSource = false;
+    m_facets.clear();
+    m_hasFacets = false;
+    m_postings.clear();
+    m_postingBytes = 0;
+}
+
+void FacetIndex::computeFacets()
+{
+    if (!m_hasSource || m_hasFacets || m_facetThread) {
+        return;
+    }
+
+    m_facetThread = new FacetThread(m_source, this);
+    connect(m_facetThread, &FacetThread::progress, this, &FacetIndex::onFacetsProgress);
+    connect(m_facetThread, &FacetThread::finished, this, &FacetIndex::onFacetsFinished);
+    m_facetThread->start();
+}
+
+bool FacetIndex::hasFacets() const
+{
+    return m_hasFacets;
+}
+
+bool FacetIndex::isComputing() const
+{
+    return m_facetThread != nullptr;
+}
+
+QVector<Facet> FacetIndex::facets(int column) const
+{
+    return m_facets.value(column);
+}
+
+bool FacetIndex::postings(int column, const QByteArray &value, QVector<qint64> *offsets)
+{
+    auto it = m_postings.find(postingKey(column, value));
+    if (it != m_postings.end()) {
+        it->lastAccess = ++m_accessClock;
+        *offsets = it->offsets;
+        return true;
+    }
+    if (!m_hasSource) {
+        return false;
+    }
+
+    std::shared_ptr<const Expression> predicate;
+    const int headerCount = m_source.headers.size();
+    if (column >= headerCount) {
+        predicate = m_computed.value(column - headerCount).expression;
+        if (!predicate) {
+            return false;
+        }
+    }
+
+    // 同一时间只扫描最近一次请求的值
+    if (m_postingThread && m_postingThread->column() == column && m_postingThread->value() == value) {
+        return false;
+    }
+    cancelPostings();
+    m_postingThread = new PostingThread(m_source, column, value, predicate, this);
+    connect(m_postingThread, &PostingThread::finished, this, &FacetIndex::onPostingsFinished);
+    m_postingThread->start();
+    return false;
+}
+
+void FacetIndex::setComputedColumns(const QVector<ComputedColumn> &computed)
+{
+    const int headerCount = m_source.headers.size();
+    if (m_postingThread && m_postingThread->column() >= headerCount) {
+        cancelPostings();
+    }
+    for (auto it = m_postings.begin(); it != m_postings.end();) {
+        if (it->column >= headerCount) {
+            m_postingBytes -= it->offsets.size() * qint64(sizeof(qint64));
+            it = m_postings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_computed = computed;
+}
+
+void FacetIndex::onFacetsProgress(qint64 done, qint64 total)
+{
+    // 忽略已取消的旧统计遗留的信号
+    if (sender() != m_facetThread) {
+        return;
+    }
+
+    emit facetsProgress(done, total);
+}
+
+void FacetIndex::onFacetsFinished(bool success, const QString &error)
+{
+    if (sender() != m_facetThread) {
+        return;
+    }
+
+    if (success) {
+        m_facets = m_facetThread->facets();
+        m_hasFacets = true;
+    }
+    cancelFacets();
+    if (success) {
+        emit facetsReady();
+    } else {
+        emit failed(error);
+    }
+}
+
+void FacetIndex::onPostingsFinished(bool success, const QString &error)
+{
+    if (sender() != m_postingThread) {
+        return;
+    }
+
+    const int column = m_postingThread->column();
+    const QByteArray value = m_postingThread->value();
+    const QVector<qint64> offsets = m_postingThread->offsets();
+    cancelPostings();
+    if (!success) {
+        emit failed(error);
+        return;
+    }
+
+    // 缓存超出上限时淘汰最久没有使用的倒排表；单个超过上限的倒排表不缓存
+    const qint64 bytes = offsets.size() * qint64(sizeof(qint64));
+    if (bytes <= POSTING_CACHE_BYTES) {
+        while (m_postingBytes + bytes > POSTING_CACHE_BYTES && !m_postings.isEmpty()) {
+            auto oldest = m_postings.begin();
+            for (auto it = m_postings.begin(); it != m_postings.end(); ++it) {
+                if (it->lastAccess < oldest->lastAccess) {
+                    oldest = it;
+                }
+            }
+            m_postingBytes -= oldest->offsets.size() * qint64(sizeof(qint64));
+            m_postings.erase(oldest);
+        }
+        m_postings.insert(postingKey(column, value), CachedPostings{column, offsets, ++m_accessClock});
+        m_postingBytes += bytes;
+    }
+    emit postingsReady(column, value, offsets);
+}
+
+void FacetIndex::cancelFacets()
+{
+    BackgroundTask::stopThread(m_facetThread);
+}
+
+void FacetIndex::cancelPostings()
+{
+    BackgroundTask::stopThread(m_postingThread);
+}
+
+QByteArray FacetIndex::postingKey(int column, const QByteArray &value)
+{
+    QByteArray key(reinterpret_cast<const char *>(&column), sizeof(column));
+    key.append(value);
+    return key;
+}
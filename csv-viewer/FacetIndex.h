@@ -0,0 +1,155 @@
+#ifndef FACETINDEX_H
+#define FACETINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <memory>
+
+#include "Aggregator.h"
+#include "Expression.h"
+
+// 分面的数据来源，与聚合相同（只支持未压缩的CSV文件）
+using FacetSource = AggregateSource;
+
+// 一列中的一个值及其出现次数
+struct Facet {
+    QByteArray value;  // 去掉引号后的原始字节，筛选时按字节比较
+    QString text;      // 按文件编码解码后的显示文本
+    qint64 count = 0;  // 出现次数（不精确时为上界）
+    bool exact = true; // 计数是否精确
+};
+
+// 分面统计线程
+// 把数据切分为若干块，共享线程池中每个工作任务为每一列维护一个有界的Space-Saving摘要，
+// 全部完成后由本线程合并；每列只保留SKETCH_CAPACITY个计数器，内存与文件大小和值的种类无关
+class FacetThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    FacetThread(const FacetSource &source, QObject *parent = nullptr);
+
+    // 各列出现最多的值，按次数从多到少（finished信号发出后有效）
+    QVector<QVector<Facet>> facets() const;
+
+    static constexpr qint64 CHUNK_SIZE = 8 * 1024 * 1024; // 每块CSV数据的大小
+    static constexpr int SKETCH_CAPACITY = 256;           // 每列的计数器个数
+    static constexpr int TOP_N = 20;                      // 每列报告的值个数
+
+signals:
+    void progress(qint64 done, qint64 total);
+    void finished(bool success, const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    FacetSource m_source;
+    QVector<QVector<Facet>> m_facets;
+    qint64 m_rows = 0;
+};
+
+// 倒排表线程：并行扫描整个文件，收集某列等于指定值的所有记录的起始偏移（按文件顺序）
+// 给出predicate时column是计算列，收集条件为真的记录：各块解析后按批计算表达式
+class PostingThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    PostingThread(const FacetSource &source, int column, const QByteArray &value,
+                  const std::shared_ptr<const Expression> &predicate = nullptr, QObject *parent = nullptr);
+
+    int column() const;
+    QByteArray value() const;
+    QVector<qint64> offsets() const; // finished信号发出后有效
+
+    static constexpr qint64 CHUNK_SIZE = 8 * 1024 * 1024;
+
+signals:
+    void progress(qint64 done, qint64 total);
+    void finished(bool success, const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    FacetSource m_source;
+    int m_column;
+    QByteArray m_value;
+    std::shared_ptr<const Expression> m_predicate;
+    QVector<qint64> m_offsets;
+};
+
+// 一个文件的分面索引：所有列的分面统计结果，以及按值筛选时用过的倒排表缓存
+class FacetIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FacetIndex(QObject *parent = nullptr);
+    ~FacetIndex();
+
+    // 设置数据来源，之前的统计结果和倒排表全部作废
+    void setSource(const FacetSource &source);
+
+    // 停止后台任务并清空所有结果
+    void clear();
+
+    // 在后台统计所有列的分面，已完成或正在统计时不重复开始
+    void computeFacets();
+
+    bool hasFacets() const;
+    bool isComputing() const;
+    QVector<Facet> facets(int column) const;
+
+    // 某列等于value的记录的偏移：已缓存时写入offsets并返回true；
+    // 否则在后台扫描（之前未完成的扫描被取消），完成后发出postingsReady
+    // 从表头列数开始的列号是计算列，收集的是表达式为真的记录，value不参与比较
+    bool postings(int column, const QByteArray &value, QVector<qint64> *offsets);
+
+    // 设置计算列，之前计算列的倒排表全部作废
+    void setComputedColumns(const QVector<ComputedColumn> &computed);
+
+    static constexpr qint64 POSTING_CACHE_BYTES = 256 * 1024 * 1024; // 倒排表缓存的上限
+
+signals:
+    void facetsProgress(qint64 done, qint64 total);
+    void facetsReady();
+    void postingsReady(int column, const QByteArray &value, const QVector<qint64> &offsets);
+    void failed(const QString &error);
+
+private slots:
+    void onFacetsProgress(qint64 done, qint64 total);
+    void onFacetsFinished(bool success, const QString &error);
+    void onPostingsFinished(bool success, const QString &error);
+
+private:
+    void cancelFacets();
+    void cancelPostings();
+
+    // 倒排表缓存的键：列号和值
+    static QByteArray postingKey(int column, const QByteArray &value);
+
+    struct CachedPostings {
+        int column = -1;
+        QVector<qint64> offsets;
+        quint64 lastAccess = 0;
+    };
+
+    FacetSource m_source;
+    bool m_hasSource = false;
+    QVector<ComputedColumn> m_computed;
+    FacetThread *m_facetThread = nullptr;
+    PostingThread *m_postingThread = nullptr;
+    QVector<QVector<Facet>> m_facets;
+    bool m_hasFacets = false;
+    QHash<QByteArray, CachedPostings> m_postings;
+    qint64 m_postingBytes = 0;
+    quint64 m_accessClock = 0;
+};
+
+#endif // FACETINDEX_H
@@ -0,0 +1,58 @@
+#include "FastItemDelegate.h"
+#include "CellTextCache.h"
+#include <QPainter>
+#include <QStyle>
+
+FastItemDelegate::FastItemDelegate(QObject *parent)
+    : QAbstractItemDelegate(parent)
+{
+}
+
+void FastItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const QPalette::ColorGroup colorGroup = (option.state & QStyle::State_Enabled) ? QPalette::Normal : QPalette::Disabled;
+    const bool selected = option.state & QStyle::State_Selected;
+
+    // 未选中的单元格使用视图的底色，不再逐格填充背景
+    if (selected) {
+        painter->fillRect(option.rect, option.palette.brush(colorGroup, QPalette::Highlight));
+    }
+
+    const QRect textRect = option.rect.adjusted(H_PADDING, 0, -H_PADDING, 0);
+    painter->setPen(option.palette.color(colorGroup, selected ? QPalette::HighlightedText : QPalette::Text));
+
+    // 缓存命中时直接绘制省略并排版好的文本；未命中时省略后加入缓存，之后的重绘都会命中
+    if (m_textCache) {
+        const QStaticText *staticText = m_textCache->lookup(index.row(), index.column(), textRect.width());
+        if (!staticText) {
+            const QString text = index.data(Qt::DisplayRole).toString();
+            staticText = m_textCache->insert(index.row(), index.column(), textRect.width(),
+                text.isEmpty() ? QString() : option.fontMetrics.elidedText(text, Qt::ElideRight, textRect.width()));
+        }
+        if (!staticText->text().isEmpty()) {
+            const int y = textRect.top() + (textRect.height() - option.fontMetrics.height()) / 2;
+            painter->drawStaticText(QPointF(textRect.left(), y), *staticText);
+        }
+        return;
+    }
+
+    const QString text = index.data(Qt::DisplayRole).toString();
+    if (text.isEmpty()) {
+        return;
+    }
+
+    painter->drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter | Qt::TextSingleLine,
+                      option.fontMetrics.elidedText(text, Qt::ElideRight, textRect.width()));
+}
+
+void FastItemDelegate::setTextCache(CellTextCache *cache)
+{
+    m_textCache = cache;
+}
+
+QSize FastItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const QString text = index.data(Qt::DisplayRole).toString();
+    return QSize(option.fontMetrics.horizontalAdvance(text) + 2 * H_PADDING,
+                 option.fontMetrics.height() + 2 * V_PADDING);
+}
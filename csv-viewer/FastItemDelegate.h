@@ -0,0 +1,34 @@
+#ifndef FASTITEMDELEGATE_H
+#define FASTITEMDELEGATE_H
+
+#include <QAbstractItemDelegate>
+
+class CellTextCache;
+
+// 轻量级单元格委托
+// 只读取DisplayRole并直接绘制单行文本，不经过QStyledItemDelegate的
+// initStyleOption/样式绘制流程，也不再逐格查询背景、前景、字体、对齐等角色
+class FastItemDelegate : public QAbstractItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit FastItemDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    // 使用单元格文本缓存：命中时直接绘制排版好的文本，不再读取模型数据
+    void setTextCache(CellTextCache *cache);
+
+    // 单元格宽度为cellWidth时文本区域的宽度，与缓存的键一致
+    static int textWidth(int cellWidth) { return cellWidth - 2 * H_PADDING; }
+
+private:
+    static constexpr int H_PADDING = 4; // 文本左右边距
+    static constexpr int V_PADDING = 2; // 文本上下边距
+
+    CellTextCache *m_textCache = nullptr;
+};
+
+#endif // FASTITEMDELEGATE_H
@@ -0,0 +1,636 @@
+#include "FileDiff.h"
+#include "BackgroundTask.h"
+#include "CompositeKey.h"
+#include "RecordParser.h"
+#include "RecordScanner.h"
+#include <QAtomicInteger>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QTemporaryDir>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// 一条记录的引用：记录内容留在内存映射的源文件中，分区里只保存定位所需的信息
+struct RecordRef {
+    quint64 hash = 0;    // 键的哈希
+    qint64 offset = 0;   // 记录在文件中的偏移
+    qint64 location = 0; // 数据块序号（高32位）和块内序号（低32位），扫描结束后换算为行号
+    qint32 length = 0;   // 记录长度（不含换行符）
+    qint32 reserved = 0;
+};
+
+// 比较的一侧文件
+struct DiffSide {
+    const char *data = nullptr;
+    qint64 size = 0;
+    CsvReader::ParseSettings parse;
+    QVector<int> slotOfColumn; // 原始列 -> 键的字段槽，非键列为-1
+    int keyCount = 0;
+    bool toUtf8 = false;       // 两个文件编码不同时，非UTF-8一侧的键先转换为UTF-8再比较
+    QVector<qint64> bounds;    // 记录对齐的数据块边界
+    QVector<qint64> firstRows; // 各数据块第一条记录的行号（扫描后填充）
+
+    qint64 rowOf(qint64 location) const
+    {
+        return firstRows.at(static_cast<int>(location >> 32)) + (location & 0xffffffff);
+    }
+};
+
+// 切分从p开始的一条记录并生成键（各键值组成的CompositeKey），返回下一条记录的起始位置
+const char *readKey(const DiffSide &side, const char *p, const char *end, RecordParser::FieldSlice *slices,
+                    QByteArray &key, QByteArray &buffer, const char **recordEnd = nullptr)
+{
+    p = RecordParser::sliceRecord(p, end, side.parse.dialect, side.parse.encoding == CsvReader::UTF8, side.slotOfColumn, slices, side.keyCount, recordEnd);
+    key.clear();
+    for (int i = 0; i < side.keyCount; ++i) {
+        const QByteArray value = RecordParser::fieldValue(slices[i], side.parse.dialect.quoteChar, buffer);
+        CompositeKey::append(key, side.toUtf8 ? QString::fromLocal8Bit(value).toUtf8() : value);
+    }
+    return p;
+}
+
+// 引用的记录的键
+void keyOf(const DiffSide &side, const RecordRef &ref, RecordParser::FieldSlice *slices, QByteArray &key,
+           QByteArray &buffer)
+{
+    const char *record = side.data + ref.offset;
+    readKey(side, record, record + ref.length, slices, key, buffer);
+}
+
+quint64 hashKey(const QByteArray &key)
+{
+    return static_cast<quint64>(qHashBits(key.constData(), static_cast<size_t>(key.size()), 0x9e3779b9));
+}
+
+// 一侧文件按键哈希分区后的记录引用
+// 扫描时各工作任务按数据块追加，内存中的引用超过上限时所有分区整体追加到各自的临时文件；
+// 扫描结束后每个分区只由一个工作任务读取，不再加锁
+class PartitionSet
+{
+public:
+    PartitionSet(int partitions, const QString &pathPrefix, qint64 memoryLimit)
+        : m_memory(partitions)
+        , m_spilled(partitions, 0)
+        , m_pathPrefix(pathPrefix)
+        , m_memoryLimit(memoryLimit)
+    {
+    }
+
+    // 追加一个数据块的分区结果，写入临时文件失败时返回false
+    bool append(QVector<QVector<RecordRef>> &parts)
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int partition = 0; partition < parts.size(); ++partition) {
+            m_memory[partition].append(parts.at(partition));
+            m_memoryBytes += parts.at(partition).size() * qint64(sizeof(RecordRef));
+            parts[partition].clear();
+        }
+        return m_memoryBytes <= m_memoryLimit || spill();
+    }
+
+    // 分批读出一个分区的引用（先临时文件中的，后内存中的），handler返回false时停止
+    template<typename Handler>
+    bool read(int partition, int batch, Handler handler)
+    {
+        if (m_spilled.at(partition) > 0) {
+            QFile file(path(partition));
+            if (!file.open(QIODevice::ReadOnly)) {
+                m_error = QString("Failed to read partition file: %1, error: %2").arg(file.fileName()).arg(file.errorString());
+                return false;
+            }
+            QVector<RecordRef> refs(batch);
+            for (qint64 remaining = m_spilled.at(partition); remaining > 0;) {
+                const int count = static_cast<int>(qMin<qint64>(remaining, batch));
+                const qint64 bytes = count * qint64(sizeof(RecordRef));
+                if (file.read(reinterpret_cast<char *>(refs.data()), bytes) != bytes) {
+                    m_error = QString("Failed to read partition file: %1").arg(file.fileName());
+                    return false;
+                }
+                if (!handler(refs.constData(), count)) {
+                    return true;
+                }
+                remaining -= count;
+            }
+        }
+
+        const QVector<RecordRef> &refs = m_memory.at(partition);
+        for (int first = 0; first < refs.size(); first += batch) {
+            if (!handler(refs.constData() + first, qMin(batch, int(refs.size()) - first))) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    // 释放一个分区在内存中的引用
+    void release(int partition)
+    {
+        m_memory[partition] = QVector<RecordRef>();
+    }
+
+    qint64 spilledBytes() const
+    {
+        return m_spilledBytes;
+    }
+
+    QString errorString() const
+    {
+        return m_error;
+    }
+
+private:
+    // 把内存中的所有分区追加到临时文件（调用者持有锁）
+    bool spill()
+    {
+        QElapsedTimer spillTimer;
+        spillTimer.start();
+        for (int partition = 0; partition < m_memory.size(); ++partition) {
+            QVector<RecordRef> &refs = m_memory[partition];
+            if (refs.isEmpty()) {
+                continue;
+            }
+            QFile file(path(partition));
+            const qint64 bytes = refs.size() * qint64(sizeof(RecordRef));
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Append)
+                || file.write(reinterpret_cast<const char *>(refs.constData()), bytes) != bytes) {
+                m_error = QString("Failed to write partition file: %1, error: %2").arg(file.fileName()).arg(file.errorString());
+                return false;
+            }
+            m_spilled[partition] += refs.size();
+            m_spilledBytes += bytes;
+            refs = QVector<RecordRef>();
+        }
+        qDebug() << "Spilled" << m_memoryBytes << "bytes of record references to" << m_pathPrefix
+                 << "in" << spillTimer.elapsed() << "ms";
+        m_memoryBytes = 0;
+        return true;
+    }
+
+    QString path(int partition) const
+    {
+        return QString("%1-%2.part").arg(m_pathPrefix).arg(partition);
+    }
+
+    QMutex m_mutex;
+    QVector<QVector<RecordRef>> m_memory;
+    QVector<qint64> m_spilled; // 每个分区写入临时文件的引用数
+    QString m_pathPrefix;
+    qint64 m_memoryLimit;
+    qint64 m_memoryBytes = 0;
+    qint64 m_spilledBytes = 0;
+    QString m_error;
+};
+
+// 扫描一个数据块，把每条记录的引用按键的哈希放入对应分区，返回记录数
+qint64 partitionChunk(const DiffSide &side, int chunk, QVector<QVector<RecordRef>> &parts)
+{
+    const char *end = side.data + side.bounds[chunk + 1];
+    const char *p = side.data + side.bounds[chunk];
+    QVarLengthArray<RecordParser::FieldSlice, 8> slices(side.keyCount);
+    QByteArray key;
+    QByteArray buffer;
+    qint64 records = 0;
+
+    while (p < end) {
+        const char *recordStart = p;
+        const char *recordEnd = p;
+        p = readKey(side, p, end, slices.data(), key, buffer, &recordEnd);
+
+        RecordRef ref;
+        ref.hash = hashKey(key);
+        ref.offset = recordStart - side.data;
+        ref.location = (qint64(chunk) << 32) | records;
+        ref.length = static_cast<qint32>(recordEnd - recordStart);
+        parts[static_cast<int>(ref.hash % quint64(parts.size()))].append(ref);
+        ++records;
+    }
+    return records;
+}
+
+// 一个工作任务的比较结果
+struct PartialDiff {
+    QVector<DiffEntry> entries;
+    qint64 added = 0;
+    qint64 removed = 0;
+    qint64 changed = 0;
+    qint64 duplicateKeys = 0;
+};
+
+} // namespace
+
+DiffThread::DiffThread(const DiffSource &oldSource, const DiffSource &newSource, const DiffOptions &options,
+                       QObject *parent)
+    : QThread(parent)
+    , m_oldSource(oldSource)
+    , m_newSource(newSource)
+    , m_options(options)
+{
+}
+
+DiffResult DiffThread::result() const
+{
+    return m_result;
+}
+
+void DiffThread::run()
+{
+    QElapsedTimer diffTimer;
+    diffTimer.start();
+
+    if (m_oldSource.columnar || m_newSource.columnar) {
+        emit compared(false, "Only CSV files can be compared");
+        return;
+    }
+    if (m_options.keyColumns.isEmpty()) {
+        emit compared(false, "No key columns selected");
+        return;
+    }
+
+    // 显示的列：键列在前，其余为两个文件共有的列，按旧文件中的顺序
+    m_result = DiffResult();
+    for (const QString &key : m_options.keyColumns) {
+        const int oldColumn = m_oldSource.headers.indexOf(key);
+        const int newColumn = m_newSource.headers.indexOf(key);
+        if (oldColumn < 0 || newColumn < 0) {
+            emit compared(false, QString("Key column not found in both files: %1").arg(key));
+            return;
+        }
+        m_result.columns.append(key);
+        m_result.oldColumns.append(oldColumn);
+        m_result.newColumns.append(newColumn);
+    }
+    m_result.keyCount = m_result.columns.size();
+    for (int column = 0; column < m_oldSource.headers.size(); ++column) {
+        const QString &header = m_oldSource.headers.at(column);
+        const int newColumn = m_newSource.headers.indexOf(header);
+        if (newColumn < 0) {
+            m_result.oldOnlyColumns.append(header);
+        } else if (!m_result.columns.contains(header)) {
+            m_result.columns.append(header);
+            m_result.oldColumns.append(column);
+            m_result.newColumns.append(newColumn);
+        }
+    }
+    for (const QString &header : m_newSource.headers) {
+        if (!m_oldSource.headers.contains(header)) {
+            m_result.newOnlyColumns.append(header);
+        }
+    }
+
+    QFile oldFile(m_oldSource.filePath);
+    QFile newFile(m_newSource.filePath);
+    DiffSide sides[2];
+    QFile *files[2] = {&oldFile, &newFile};
+    const DiffSource *sources[2] = {&m_oldSource, &m_newSource};
+    for (int s = 0; s < 2; ++s) {
+        if (!files[s]->open(QIODevice::ReadOnly)) {
+            emit compared(false, QString("Failed to open file: %1, error: %2").arg(files[s]->fileName()).arg(files[s]->errorString()));
+            return;
+        }
+        DiffSide &side = sides[s];
+        side.size = files[s]->size();
+        // 空文件不能映射，只有表头的文件数据区为空
+        if (side.size > 0) {
+            side.data = reinterpret_cast<const char *>(files[s]->map(0, side.size));
+            if (!side.data) {
+                emit compared(false, QString("Failed to map file: %1, error: %2").arg(files[s]->fileName()).arg(files[s]->errorString()));
+                return;
+            }
+        }
+        side.parse = sources[s]->parse;
+        side.keyCount = m_result.keyCount;
+        const QVector<int> &columns = s == 0 ? m_result.oldColumns : m_result.newColumns;
+        for (int slot = 0; slot < side.keyCount; ++slot) {
+            if (columns.at(slot) >= side.slotOfColumn.size()) {
+                side.slotOfColumn.resize(columns.at(slot) + 1, -1);
+            }
+            side.slotOfColumn[columns.at(slot)] = slot;
+        }
+        side.bounds = RecordScanner::chunkBounds(side.data, side.size, qMin(sources[s]->dataStart, side.size),
+                                                  CHUNK_SIZE, side.parse.dialect.quoteChar);
+    }
+    if (m_oldSource.parse.encoding != m_newSource.parse.encoding) {
+        sides[0].toUtf8 = m_oldSource.parse.encoding != CsvReader::UTF8;
+        sides[1].toUtf8 = m_newSource.parse.encoding != CsvReader::UTF8;
+    }
+
+    const qint64 sourceBytes = (sides[0].size - sides[0].bounds.first()) + (sides[1].size - sides[1].bounds.first());
+    const int partitions = static_cast<int>(qBound<qint64>(MIN_PARTITIONS, sourceBytes / PARTITION_SOURCE_BYTES, MAX_PARTITIONS));
+    const qint64 total = sourceBytes * 2;
+
+    QTemporaryDir spillDir;
+    if (!spillDir.isValid()) {
+        emit compared(false, QString("Failed to create temporary directory: %1").arg(spillDir.errorString()));
+        return;
+    }
+    PartitionSet oldSet(partitions, spillDir.filePath("old"), MEMORY_LIMIT / 2);
+    PartitionSet newSet(partitions, spillDir.filePath("new"), MEMORY_LIMIT / 2);
+    PartitionSet *sets[2] = {&oldSet, &newSet};
+
+    QAtomicInteger<qint64> done(0);
+    QAtomicInteger<int> failed(0);
+
+    // 等待工作任务时定期报告进度
+    auto reportProgress = [&]() {
+        emit progress(done.loadRelaxed(), total);
+    };
+
+    // 第一阶段：两个文件的数据块放在同一个队列中，工作任务循环领取并分区
+    QElapsedTimer partitionTimer;
+    partitionTimer.start();
+    const int oldChunks = sides[0].bounds.size() - 1;
+    const int chunkCount = oldChunks + sides[1].bounds.size() - 1;
+    QVector<qint64> chunkRecords(chunkCount, 0);
+    // 每个工作任务的分区缓冲区，各块之间重复使用
+    QVector<QVector<QVector<RecordRef>>> workerParts(BackgroundTask::workerCount(chunkCount),
+                                                     QVector<QVector<RecordRef>>(partitions));
+    BackgroundTask::forEachChunk(chunkCount, [&](int chunk, int worker) {
+        if (isInterruptionRequested() || failed.loadRelaxed()) {
+            return false;
+        }
+        const int s = chunk < oldChunks ? 0 : 1;
+        const int sideChunk = s == 0 ? chunk : chunk - oldChunks;
+        chunkRecords[chunk] = partitionChunk(sides[s], sideChunk, workerParts[worker]);
+        if (!sets[s]->append(workerParts[worker])) {
+            failed.storeRelaxed(1);
+        }
+        done.fetchAndAddRelaxed(sides[s].bounds[sideChunk + 1] - sides[s].bounds[sideChunk]);
+        return true;
+    }, reportProgress);
+
+    if (isInterruptionRequested()) {
+        emit compared(false, "Comparison cancelled");
+        return;
+    }
+    if (failed.loadRelaxed()) {
+        emit compared(false, !oldSet.errorString().isEmpty() ? oldSet.errorString() : newSet.errorString());
+        return;
+    }
+
+    // 各数据块第一条记录的行号
+    for (int s = 0; s < 2; ++s) {
+        const int first = s == 0 ? 0 : oldChunks;
+        const int count = sides[s].bounds.size() - 1;
+        sides[s].firstRows.resize(count + 1);
+        sides[s].firstRows[0] = 0;
+        for (int chunk = 0; chunk < count; ++chunk) {
+            sides[s].firstRows[chunk + 1] = sides[s].firstRows[chunk] + chunkRecords[first + chunk];
+        }
+    }
+    m_result.oldRows = sides[0].firstRows.last();
+    m_result.newRows = sides[1].firstRows.last();
+    m_result.spilledBytes = oldSet.spilledBytes() + newSet.spilledBytes();
+    const qint64 partitionTime = partitionTimer.elapsed();
+
+    // 第二阶段：每个工作任务领取一个分区，用旧文件一侧建表，新文件一侧分批探测
+    const DiffSide &oldSide = sides[0];
+    const DiffSide &newSide = sides[1];
+    const int compareColumns = m_result.columns.size();
+    const QVector<int> &oldColumns = m_result.oldColumns;
+    const QVector<int> &newColumns = m_result.newColumns;
+    QAtomicInteger<int> storedEntries(0);
+    const int joinWorkers = BackgroundTask::workerCount(partitions);
+    QVector<PartialDiff> partials(joinWorkers);
+    BackgroundTask::forEachChunk(partitions, [&](int partition, int worker) {
+        if (isInterruptionRequested() || failed.loadRelaxed()) {
+            return false;
+        }
+        PartialDiff &partial = partials[worker];
+        QVarLengthArray<RecordParser::FieldSlice, 8> slices(m_result.keyCount);
+        QByteArray buffer;
+        QByteArray probeKey;
+        QByteArray buildKey;
+
+        // 只保存前MAX_ENTRIES条差异，其余只计数
+        auto addEntry = [&](const DiffEntry &entry) {
+            if (storedEntries.fetchAndAddRelaxed(1) < MAX_ENTRIES) {
+                partial.entries.append(entry);
+            }
+        };
+
+        // 分区中的引用按扫描线程写入的先后排列，顺序不固定；读出后按在文件中的位置排序，
+        // 键重复时总是靠前的一行参与匹配，结果与线程调度无关
+        auto readSorted = [partition](auto &set, QVector<RecordRef> &refs) {
+            const bool ok = set.read(partition, PROBE_BATCH, [&refs](const RecordRef *batch, int count) {
+                const qsizetype first = refs.size();
+                refs.resize(first + count);
+                std::copy(batch, batch + count, refs.begin() + first);
+                return true;
+            });
+            set.release(partition);
+            std::sort(refs.begin(), refs.end(), [](const RecordRef &a, const RecordRef &b) {
+                return a.location < b.location;
+            });
+            return ok;
+        };
+
+        // 建表：按文件中的顺序，重复的键只保留靠前的一行
+        QVector<RecordRef> build;
+        if (!readSorted(oldSet, build)) {
+            failed.storeRelaxed(1);
+            return false;
+        }
+
+        enum State : quint8 { Unmatched, Matched, Duplicate };
+        QHash<quint64, int> heads; // 哈希 -> 链表头，哈希相同而键不同的记录串在next中
+        heads.reserve(build.size());
+        QVector<int> next(build.size(), -1);
+        QVector<quint8> states(build.size(), Unmatched);
+        for (int i = 0; i < build.size(); ++i) {
+            auto it = heads.find(build.at(i).hash);
+            if (it == heads.end()) {
+                heads.insert(build.at(i).hash, i);
+                continue;
+            }
+            keyOf(oldSide, build.at(i), slices.data(), probeKey, buffer);
+            for (int candidate = it.value(); candidate >= 0; candidate = next[candidate]) {
+                keyOf(oldSide, build.at(candidate), slices.data(), buildKey, buffer);
+                if (buildKey == probeKey) {
+                    states[i] = Duplicate;
+                    break;
+                }
+            }
+            if (states[i] == Duplicate) {
+                ++partial.duplicateKeys;
+            } else {
+                next[i] = it.value();
+                it.value() = i;
+            }
+        }
+
+        // 探测：按新文件中的顺序，键相同且原始字节也相同的记录没有变化，只有字节不同时才解析字段逐列比较
+        QVector<RecordRef> probes;
+        if (!readSorted(newSet, probes)) {
+            failed.storeRelaxed(1);
+            return false;
+        }
+        for (int r = 0; r < probes.size(); ++r) {
+            if (r % PROBE_BATCH == 0 && isInterruptionRequested()) {
+                return false;
+            }
+            const RecordRef &probe = probes.at(r);
+            int match = -1;
+            auto it = heads.constFind(probe.hash);
+            if (it != heads.constEnd()) {
+                keyOf(newSide, probe, slices.data(), probeKey, buffer);
+                for (int candidate = it.value(); candidate >= 0; candidate = next[candidate]) {
+                    keyOf(oldSide, build.at(candidate), slices.data(), buildKey, buffer);
+                    if (buildKey == probeKey) {
+                        match = candidate;
+                        break;
+                    }
+                }
+            }
+
+            if (match < 0) {
+                ++partial.added;
+                DiffEntry entry;
+                entry.kind = DiffEntry::Added;
+                entry.newRow = newSide.rowOf(probe.location);
+                entry.newOffset = probe.offset;
+                entry.newLength = probe.length;
+                addEntry(entry);
+                continue;
+            }
+            if (states[match] == Matched) {
+                ++partial.duplicateKeys;
+                continue;
+            }
+            states[match] = Matched;
+
+            const RecordRef &original = build.at(match);
+            if (original.length == probe.length
+                && memcmp(oldSide.data + original.offset, newSide.data + probe.offset, size_t(probe.length)) == 0) {
+                continue;
+            }
+            const QList<QStringList> oldRecord = CsvReader::parseBytes(oldSide.data + original.offset, original.length, oldSide.parse);
+            const QList<QStringList> newRecord = CsvReader::parseBytes(newSide.data + probe.offset, probe.length, newSide.parse);
+            const QStringList oldFields = oldRecord.value(0);
+            const QStringList newFields = newRecord.value(0);
+            QVector<int> changedColumns;
+            for (int column = m_result.keyCount; column < compareColumns; ++column) {
+                if (oldFields.value(oldColumns.at(column)) != newFields.value(newColumns.at(column))) {
+                    changedColumns.append(column);
+                }
+            }
+            // 只有不参与比较的列或格式（引号、换行符）不同时视为没有变化
+            if (changedColumns.isEmpty()) {
+                continue;
+            }
+            ++partial.changed;
+            DiffEntry entry;
+            entry.kind = DiffEntry::Changed;
+            entry.oldRow = oldSide.rowOf(original.location);
+            entry.newRow = newSide.rowOf(probe.location);
+            entry.oldOffset = original.offset;
+            entry.oldLength = original.length;
+            entry.newOffset = probe.offset;
+            entry.newLength = probe.length;
+            entry.changedColumns = changedColumns;
+            addEntry(entry);
+        }
+
+        for (int i = 0; i < build.size(); ++i) {
+            if (states[i] != Unmatched) {
+                continue;
+            }
+            ++partial.removed;
+            DiffEntry entry;
+            entry.kind = DiffEntry::Removed;
+            entry.oldRow = oldSide.rowOf(build.at(i).location);
+            entry.oldOffset = build.at(i).offset;
+            entry.oldLength = build.at(i).length;
+            addEntry(entry);
+        }
+        done.fetchAndAddRelaxed(sourceBytes / partitions);
+        return true;
+    }, reportProgress);
+
+    if (isInterruptionRequested()) {
+        emit compared(false, "Comparison cancelled");
+        return;
+    }
+    if (failed.loadRelaxed()) {
+        emit compared(false, !oldSet.errorString().isEmpty() ? oldSet.errorString() : newSet.errorString());
+        return;
+    }
+
+    // 合并各工作任务的结果，按行号排序（删除的行按旧文件中的行号排在对应位置）
+    for (const PartialDiff &partial : std::as_const(partials)) {
+        m_result.entries.append(partial.entries);
+        m_result.added += partial.added;
+        m_result.removed += partial.removed;
+        m_result.changed += partial.changed;
+        m_result.duplicateKeys += partial.duplicateKeys;
+    }
+    auto sortRow = [](const DiffEntry &entry) {
+        return entry.kind == DiffEntry::Removed ? entry.oldRow : entry.newRow;
+    };
+    std::sort(m_result.entries.begin(), m_result.entries.end(), [&sortRow](const DiffEntry &a, const DiffEntry &b) {
+        const qint64 rowA = sortRow(a);
+        const qint64 rowB = sortRow(b);
+        return rowA != rowB ? rowA < rowB : a.kind > b.kind;
+    });
+
+    qDebug() << "Compared" << m_result.oldRows << "rows with" << m_result.newRows << "rows using" << partitions
+             << "partitions in" << diffTimer.elapsed() << "ms (partition" << partitionTime << "ms, spilled"
+             << m_result.spilledBytes << "bytes):" << m_result.added << "added," << m_result.removed << "removed,"
+             << m_result.changed << "changed";
+    emit progress(total, total);
+    emit compared(true, QString());
+}
+
+FileDiffer::FileDiffer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FileDiffer::~FileDiffer()
+{
+    cancel();
+}
+
+void FileDiffer::start(const DiffSource &oldSource, const DiffSource &newSource, const DiffOptions &options)
+{
+    cancel();
+
+    m_thread = new DiffThread(oldSource, newSource, options, this);
+    connect(m_thread, &DiffThread::progress, this, &FileDiffer::onProgress);
+    connect(m_thread, &DiffThread::compared, this, &FileDiffer::onCompared);
+    m_thread->start();
+}
+
+void FileDiffer::cancel()
+{
+    BackgroundTask::stopThread(m_thread);
+}
+
+bool FileDiffer::isRunning() const
+{
+    return m_thread && m_thread->isRunning();
+}
+
+void FileDiffer::onProgress(qint64 done, qint64 total)
+{
+    // 忽略已取消的旧比较遗留的信号
+    if (sender() != m_thread) {
+        return;
+    }
+
+    emit progress(done, total);
+}
+
+void FileDiffer::onCompared(bool success, const QString &error)
+{
+    if (sender() != m_thread) {
+        return;
+    }
+
+    emit finished(success, success ? m_thread->result() : DiffResult(), error);
+}
@@ -0,0 +1,123 @@
+#ifndef FILEDIFF_H
+#define FILEDIFF_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+
+#include "Aggregator.h"
+
+// 比较的一侧文件，与聚合使用相同的数据来源（只支持未压缩的CSV文件）
+using DiffSource = AggregateSource;
+
+// 比较选项：按若干键列（列名在两个文件中都存在）匹配两个文件的行
+struct DiffOptions {
+    QStringList keyColumns;
+};
+
+// 一条差异
+struct DiffEntry {
+    enum Kind {
+        Added,   // 只在新文件中存在的键
+        Removed, // 只在旧文件中存在的键
+        Changed  // 两个文件中都存在，但有比较列的值不同
+    };
+
+    Kind kind = Changed;
+    qint64 oldRow = -1;     // 旧文件中的行号，新增的行为-1
+    qint64 newRow = -1;     // 新文件中的行号，删除的行为-1
+    qint64 oldOffset = -1;  // 记录在旧文件中的字节范围（不含换行符）
+    qint64 newOffset = -1;
+    qint32 oldLength = 0;
+    qint32 newLength = 0;
+    QVector<int> changedColumns; // 值不同的列（DiffResult::columns中的下标）
+};
+
+// 比较结果
+struct DiffResult {
+    QStringList columns;      // 显示的列：键列在前，其余为两个文件共有的列
+    QVector<int> oldColumns;  // 各显示列在旧文件中的列号
+    QVector<int> newColumns;  // 各显示列在新文件中的列号
+    int keyCount = 0;         // columns开头的键列个数
+    QStringList oldOnlyColumns; // 只在一个文件中存在的列，不参与比较
+    QStringList newOnlyColumns;
+    QVector<DiffEntry> entries; // 按行号排序，超过MAX_ENTRIES的差异只计数不保存
+    qint64 oldRows = 0;
+    qint64 newRows = 0;
+    qint64 added = 0;
+    qint64 removed = 0;
+    qint64 changed = 0;
+    qint64 duplicateKeys = 0; // 同一文件中重复的键，每个键只有一行参与比较
+    qint64 spilledBytes = 0;  // 写入临时文件的分区数据量
+};
+
+// 比较线程：分区哈希连接
+// 第一阶段并行扫描两个文件，按键的哈希把每条记录的引用（哈希、偏移、行号）分配到若干分区，
+// 内存中的引用超过上限时整体写入临时目录；第二阶段共享线程池中每个工作任务领取一个分区，
+// 用旧文件一侧建哈希表，再从分区文件中分批读取新文件一侧逐条探测。
+// 记录内容始终留在内存映射的源文件中，只有匹配后原始字节不同的记录才解析字段
+class DiffThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    DiffThread(const DiffSource &oldSource, const DiffSource &newSource, const DiffOptions &options,
+               QObject *parent = nullptr);
+
+    // 比较成功后的结果（compared信号发出后有效）
+    DiffResult result() const;
+
+    static constexpr qint64 CHUNK_SIZE = 8 * 1024 * 1024;          // 扫描时每块CSV数据的大小
+    static constexpr qint64 PARTITION_SOURCE_BYTES = 64 * 1024 * 1024; // 每个分区大约对应的源数据量
+    static constexpr int MIN_PARTITIONS = 16;
+    static constexpr int MAX_PARTITIONS = 256;
+    static constexpr qint64 MEMORY_LIMIT = 512 * 1024 * 1024;     // 两侧内存中的记录引用共用的上限
+    static constexpr int PROBE_BATCH = 64 * 1024;                  // 探测时每次从分区文件读取的引用数
+    static constexpr int MAX_ENTRIES = 5 * 1000 * 1000;            // 保存的差异条数上限
+
+signals:
+    void progress(qint64 done, qint64 total);
+    void compared(bool success, const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    DiffSource m_oldSource;
+    DiffSource m_newSource;
+    DiffOptions m_options;
+    DiffResult m_result;
+};
+
+// 文件比较器：在后台按键列比较两个文件
+class FileDiffer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileDiffer(QObject *parent = nullptr);
+    ~FileDiffer();
+
+    // 开始比较，之前的比较会被取消
+    void start(const DiffSource &oldSource, const DiffSource &newSource, const DiffOptions &options);
+
+    // 取消比较
+    void cancel();
+
+    bool isRunning() const;
+
+signals:
+    void progress(qint64 done, qint64 total);
+    void finished(bool success, const DiffResult &result, const QString &error);
+
+private slots:
+    void onProgress(qint64 done, qint64 total);
+    void onCompared(bool success, const QString &error);
+
+private:
+    DiffThread *m_thread = nullptr;
+};
+
+#endif // FILEDIFF_H
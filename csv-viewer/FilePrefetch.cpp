@@ -0,0 +1,57 @@
+#include "FilePrefetch.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtGlobal>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+FilePrefetchTask::FilePrefetchTask(const QString &filePath, QObject *parent)
+    : BackgroundTask(parent)
+    , m_filePath(filePath)
+{
+}
+
+void FilePrefetchTask::execute()
+{
+    QElapsedTimer prefetchTimer;
+    prefetchTimer.start();
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) {
+        return;
+    }
+    const qint64 length = qMin(file.size(), PREFETCH_BYTES);
+    const uchar *data = file.map(0, length);
+    if (!data) {
+        return;
+    }
+
+    // 先一次性提示系统读入整段，再逐页访问，确保加载开始前这些页已在页缓存中
+#ifdef Q_OS_LINUX
+    posix_fadvise(file.handle(), 0, length, POSIX_FADV_WILLNEED);
+#endif
+#ifdef Q_OS_UNIX
+    madvise(const_cast<uchar *>(data), static_cast<size_t>(length), MADV_WILLNEED);
+    const qint64 pageSize = sysconf(_SC_PAGESIZE);
+#else
+    const qint64 pageSize = 4096;
+#endif
+    quint8 checksum = 0;
+    for (qint64 offset = 0; offset < length; offset += pageSize) {
+        if (isCancelled()) {
+            break;
+        }
+        checksum ^= *static_cast<const volatile uchar *>(data + offset);
+    }
+    Q_UNUSED(checksum);
+    file.unmap(const_cast<uchar *>(data));
+
+    qDebug() << "Prefetched" << length / 1024 << "KB of" << m_filePath << "in" << prefetchTimer.elapsed() << "ms";
+}
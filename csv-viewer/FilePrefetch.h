@@ -0,0 +1,27 @@
+#ifndef FILEPREFETCH_H
+#define FILEPREFETCH_H
+
+#include <QString>
+
+#include "BackgroundTask.h"
+
+// 启动预读任务：从命令行打开文件时，在主窗口构造的同时把文件开头读入页缓存
+// 打开文件时的编码检测、方言识别和初始行解析都只访问文件开头的一段，
+// 这段数据提前读入后，界面线程上的加载不再等待磁盘
+class FilePrefetchTask : public BackgroundTask
+{
+    Q_OBJECT
+
+public:
+    explicit FilePrefetchTask(const QString &filePath, QObject *parent = nullptr);
+
+    static constexpr qint64 PREFETCH_BYTES = 8 * 1024 * 1024; // 预读文件开头的字节数
+
+protected:
+    void execute() override;
+
+private:
+    QString m_filePath;
+};
+
+#endif // FILEPREFETCH_H
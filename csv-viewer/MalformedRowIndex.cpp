@@ -0,0 +1,45 @@
+#include "MalformedRowIndex.h"
+#include <algorithm>
+
+namespace {
+
+bool offsetLess(const MalformedRecord &record, qint64 offset)
+{
+    return record.offset < offset;
+}
+
+} // namespace
+
+void MalformedRowIndex::clear()
+{
+    m_records.clear();
+    m_records.squeeze();
+}
+
+int MalformedRowIndex::add(const QVector<MalformedRecord> &records)
+{
+    int added = 0;
+    for (const MalformedRecord &record : records) {
+        auto it = std::lower_bound(m_records.begin(), m_records.end(), record.offset, offsetLess);
+        if (it != m_records.end() && it->offset == record.offset) {
+            if (it->row < 0) {
+                it->row = record.row;
+            }
+            continue;
+        }
+        m_records.insert(it, record);
+        ++added;
+    }
+    return added;
+}
+
+int MalformedRowIndex::count() const
+{
+    return m_records.size();
+}
+
+const MalformedRecord *MalformedRowIndex::next(qint64 offset) const
+{
+    auto it = std::lower_bound(m_records.constBegin(), m_records.constEnd(), offset + 1, offsetLess);
+    return it != m_records.constEnd() ? &*it : nullptr;
+}
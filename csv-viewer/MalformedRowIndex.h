@@ -0,0 +1,41 @@
+#ifndef MALFORMEDROWINDEX_H
+#define MALFORMEDROWINDEX_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// 格式错误的记录
+struct MalformedRecord {
+    enum Reason : quint8 {
+        RaggedRow = 0x1,        // 字段数与表头列数不一致
+        UnbalancedQuotes = 0x2, // 引号不配对：字段中间的引号导致跨行，或到数据末尾仍未闭合
+        InvalidEncoding = 0x4   // 包含当前编码下无效的字节
+    };
+
+    qint64 offset = 0; // 记录起始的字节偏移
+    qint64 row = -1;   // 行号，定位时只有估算位置的为-1
+    qint32 fields = 0; // 实际字段数
+    quint8 reasons = 0;
+};
+
+// 格式错误行的旁路索引
+// 容错解析时把格式错误的记录按字节偏移登记在这里，数据行本身已规整为表头列数，
+// 显示时不需要任何额外检查；只有实际解析过的片段中的错误才会被登记
+class MalformedRowIndex
+{
+public:
+    void clear();
+
+    // 登记一批记录，已登记的偏移只补充行号，返回新增的记录数
+    int add(const QVector<MalformedRecord> &records);
+
+    int count() const;
+
+    // 偏移大于offset的第一条记录，没有时返回nullptr
+    const MalformedRecord *next(qint64 offset) const;
+
+private:
+    QVector<MalformedRecord> m_records; // 按偏移排序
+};
+
+#endif // MALFORMEDROWINDEX_H
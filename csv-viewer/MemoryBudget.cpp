@@ -0,0 +1,141 @@
+#include "MemoryBudget.h"
+#include "TableModel.h"
+#include <QDebug>
+#include <QSettings>
+#include <algorithm>
+
+MemoryBudget *MemoryBudget::instance()
+{
+    static MemoryBudget budget;
+    return &budget;
+}
+
+MemoryBudget::MemoryBudget(QObject *parent)
+    : QObject(parent)
+{
+    // 共享终端服务器上可以在配置文件中设置较小的上限
+    QSettings settings("csv-viewer", "csv-viewer");
+    const qint64 budgetMB = settings.value("memory/budgetMB", DEFAULT_BUDGET / (1024 * 1024)).toLongLong();
+    m_budget = qMax<qint64>(budgetMB * 1024 * 1024, MIN_BUDGET);
+}
+
+void MemoryBudget::setBudget(qint64 bytes)
+{
+    m_budget = qMax<qint64>(bytes, MIN_BUDGET);
+    enforce();
+    emit usageChanged(m_usedBytes, m_budget);
+}
+
+void MemoryBudget::saveBudget() const
+{
+    QSettings settings("csv-viewer", "csv-viewer");
+    settings.setValue("memory/budgetMB", m_budget / (1024 * 1024));
+}
+
+qint64 MemoryBudget::budget() const
+{
+    return m_budget;
+}
+
+qint64 MemoryBudget::usedBytes() const
+{
+    return m_usedBytes;
+}
+
+void MemoryBudget::registerModel(TableModel *model)
+{
+    if (!m_models.contains(model)) {
+        m_models.append(model);
+    }
+}
+
+void MemoryBudget::unregisterModel(TableModel *model)
+{
+    m_models.removeAll(model);
+}
+
+quint64 MemoryBudget::nextTick()
+{
+    return ++m_tick;
+}
+
+void MemoryBudget::pageAdded(qint64 bytes)
+{
+    m_usedBytes += bytes;
+    if (m_usedBytes > m_budget) {
+        enforce();
+    }
+    emit usageChanged(m_usedBytes, m_budget);
+}
+
+void MemoryBudget::pageRemoved(qint64 bytes)
+{
+    m_usedBytes = qMax<qint64>(0, m_usedBytes - bytes);
+    emit usageChanged(m_usedBytes, m_budget);
+}
+
+qint64 MemoryBudget::measureRows(const QList<QStringList> &rows)
+{
+    qint64 bytes = ALLOCATION_OVERHEAD + rows.capacity() * qint64(sizeof(QStringList));
+    for (const QStringList &row : rows) {
+        bytes += ALLOCATION_OVERHEAD + row.capacity() * qint64(sizeof(QString));
+        for (const QString &cell : row) {
+            if (cell.capacity() > 0) {
+                bytes += ALLOCATION_OVERHEAD + (cell.capacity() + 1) * qint64(sizeof(QChar));
+            }
+        }
+    }
+    return bytes;
+}
+
+void MemoryBudget::enforce()
+{
+    // 淘汰过程中pageRemoved不会再次触发淘汰，这里只防止setBudget等重入
+    if (m_enforcing || m_usedBytes <= m_budget) {
+        return;
+    }
+    m_enforcing = true;
+
+    struct Candidate {
+        TableModel *model;
+        int page;
+        int distance;
+        quint64 lastAccess;
+    };
+
+    // 视口内的页不淘汰，其余按离视口的距离从远到近，距离相同时先淘汰最久未访问的
+    QVector<Candidate> candidates;
+    for (TableModel *model : m_models) {
+        const QVector<TableModel::PageUsage> pages = model->pageUsage();
+        for (const TableModel::PageUsage &usage : pages) {
+            if (usage.distance > 0) {
+                candidates.append({model, usage.page, usage.distance, usage.lastAccess});
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        if (a.distance != b.distance) {
+            return a.distance > b.distance;
+        }
+        return a.lastAccess < b.lastAccess;
+    });
+
+    // 淘汰到预算的90%，留出余量避免每加载一页就淘汰一页
+    const qint64 target = m_budget / 10 * 9;
+    qint64 evictedPages = 0;
+    for (const Candidate &candidate : candidates) {
+        if (m_usedBytes <= target) {
+            break;
+        }
+        candidate.model->evictPage(candidate.page);
+        ++evictedPages;
+    }
+
+    qDebug() << "Memory budget exceeded, evicted" << evictedPages << "pages, now using" << m_usedBytes << "bytes";
+
+    // 只剩视口内的页，请读取器释放可以重新读取的行
+    if (m_usedBytes > target) {
+        emit memoryPressure();
+    }
+    m_enforcing = false;
+}
@@ -0,0 +1,68 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QObject>
+#include <QList>
+#include <QStringList>
+
+class TableModel;
+
+// 全局内存预算
+// 所有打开文件的页缓存（以及读取器初始加载的行）共用一个上限，占用量按实际分配的字节统计。
+// 超出时先淘汰离视口最远的页（没有视口的模型最先），视口内的页不淘汰；
+// 仍然超出时发出memoryPressure，由读取器释放可以从文件重新读取的行。
+// 被淘汰的页在重新滚动到时从文件中再次加载
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MemoryBudget *instance();
+
+    static constexpr qint64 DEFAULT_BUDGET = 2LL * 1024 * 1024 * 1024; // 默认上限2GB
+    static constexpr qint64 MIN_BUDGET = 64LL * 1024 * 1024;             // 最小上限64MB，再小时视口外的页刚加载就被淘汰
+    static constexpr qint64 ALLOCATION_OVERHEAD = 32; // 每次堆分配的数组头部和分配器开销
+
+    // 设置上限（不低于MIN_BUDGET），只在本次运行中生效
+    void setBudget(qint64 bytes);
+
+    // 把当前上限保存到配置，下次启动时使用；用户在界面中修改上限时调用
+    void saveBudget() const;
+    qint64 budget() const;
+    qint64 usedBytes() const;
+
+    // 模型创建和销毁时登记/注销
+    void registerModel(TableModel *model);
+    void unregisterModel(TableModel *model);
+
+    // 全局访问时钟，页被访问时记录当前值，用于跨模型比较新旧
+    quint64 nextTick();
+
+    // 页加入或移出缓存时更新占用量，加入后超出预算会触发淘汰
+    void pageAdded(qint64 bytes);
+    void pageRemoved(qint64 bytes);
+
+    // 一组行实际占用的堆内存：字符串按容量计算，空字符串不分配内存，
+    // 每次分配再加上数组头部和分配器的开销
+    static qint64 measureRows(const QList<QStringList> &rows);
+
+signals:
+    void usageChanged(qint64 usedBytes, qint64 budget);
+
+    // 淘汰所有视口外的页后仍然超出预算
+    void memoryPressure();
+
+private:
+    explicit MemoryBudget(QObject *parent = nullptr);
+
+    // 淘汰离视口最远的页，直到占用量回落到预算的90%以下
+    void enforce();
+
+    QList<TableModel *> m_models;
+    qint64 m_budget = DEFAULT_BUDGET;
+    qint64 m_usedBytes = 0;
+    quint64 m_tick = 0;
+    bool m_enforcing = false;
+};
+
+#endif // MEMORYBUDGET_H
@@ -0,0 +1,241 @@
+#include "ReadAheadScheduler.h"
+#include "RecordScanner.h"
+#include "RowIndex.h"
+#include "TableModel.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+ReadAheadTask::ReadAheadTask(const CsvReader::ReadAheadSource &source, const QVector<int> &pages, QObject *parent)
+    : BackgroundTask(parent)
+    , m_source(source)
+    , m_pages(pages)
+{
+}
+
+void ReadAheadTask::adviseWillNeed(qint64 begin, qint64 end) const
+{
+    if (end <= begin) {
+        return;
+    }
+#ifdef Q_OS_UNIX
+    // 内存映射从文件开头开始，按系统页对齐即可
+    const qint64 pageSize = sysconf(_SC_PAGESIZE);
+    const qint64 alignedBegin = begin - begin % pageSize;
+    madvise(const_cast<char *>(m_source.data) + alignedBegin, static_cast<size_t>(end - alignedBegin), MADV_WILLNEED);
+#endif
+#ifdef Q_OS_LINUX
+    if (m_source.fileHandle >= 0) {
+        posix_fadvise(m_source.fileHandle, begin, end - begin, POSIX_FADV_WILLNEED);
+    }
+#endif
+}
+
+void ReadAheadTask::execute()
+{
+    QElapsedTimer readAheadTimer;
+    readAheadTimer.start();
+
+    // 列式文件按行号直接读取，不需要定位
+    if (m_source.columnarFile) {
+        for (int page : m_pages) {
+            if (isCancelled()) {
+                return;
+            }
+            LoadedPage loaded;
+            loaded.page = page;
+            loaded.rows = m_source.columnarFile->readRows(qint64(page) * TableModel::PAGE_SIZE, TableModel::PAGE_SIZE,
+                                                          m_source.columnProjection);
+            m_result.append(loaded);
+        }
+        emit pagesLoaded();
+        return;
+    }
+
+    // 先按行索引定位所有页，并一次性提示系统读入这些范围，之后的解析与磁盘读取重叠
+    struct Located {
+        int page;
+        qint64 checkpointRow;
+        qint64 checkpointOffset;
+    };
+    QVector<Located> located;
+    for (int page : m_pages) {
+        const qint64 firstRow = qint64(page) * TableModel::PAGE_SIZE;
+        Located entry{page, 0, 0};
+        if (!m_source.rowIndex || !m_source.rowIndex->lookup(firstRow, &entry.checkpointRow, &entry.checkpointOffset)) {
+            continue;
+        }
+        // 下一页之后的检查点是这一页数据的上界，尚未索引到时提示到文件末尾
+        qint64 nextRow = 0;
+        qint64 upperBound = m_source.fileSize;
+        m_source.rowIndex->lookup(firstRow + TableModel::PAGE_SIZE + RowIndex::STRIDE, &nextRow, &upperBound);
+        adviseWillNeed(entry.checkpointOffset, qMin(upperBound, m_source.fileSize));
+        located.append(entry);
+    }
+
+    const char quoteChar = m_source.parse.dialect.quoteChar;
+    for (const Located &entry : located) {
+        if (isCancelled()) {
+            return;
+        }
+        const qint64 firstRow = qint64(entry.page) * TableModel::PAGE_SIZE;
+        const qint64 begin = RecordScanner::skipRecords(m_source.data, m_source.fileSize, entry.checkpointOffset,
+                                                        firstRow - entry.checkpointRow, quoteChar);
+        const qint64 end = RecordScanner::skipRecords(m_source.data, m_source.fileSize, begin,
+                                                      TableModel::PAGE_SIZE, quoteChar);
+        LoadedPage loaded;
+        loaded.page = entry.page;
+        loaded.endOffset = end;
+        try {
+            loaded.rows = CsvReader::parseBytes(m_source.data + begin, end - begin, m_source.parse, begin, &loaded.malformed);
+        } catch (const std::exception &e) {
+            // 严格模式下的解析错误留给视口加载报告
+            qDebug() << "Read-ahead of page" << entry.page << "failed:" << e.what();
+            continue;
+        }
+        m_result.append(loaded);
+    }
+
+    qDebug() << "Read ahead" << m_result.size() << "of" << m_pages.size() << "pages in" << readAheadTimer.elapsed() << "ms";
+    emit pagesLoaded();
+}
+
+ReadAheadScheduler::ReadAheadScheduler(CsvReader *reader, TableModel *model, QObject *parent)
+    : QObject(parent)
+    , m_reader(reader)
+    , m_tableModel(model)
+{
+}
+
+ReadAheadScheduler::~ReadAheadScheduler()
+{
+    cancel();
+}
+
+void ReadAheadScheduler::setScreens(int ahead, int behind)
+{
+    m_screensAhead = qMax(ahead, 0);
+    m_screensBehind = qMax(behind, 0);
+}
+
+void ReadAheadScheduler::resetVelocity()
+{
+    m_velocity = 0.0;
+    m_velocityTimer.invalidate();
+}
+
+void ReadAheadScheduler::viewportChanged(int firstVisibleRow, int lastVisibleRow)
+{
+    // 滚动速度：两次视口变化之间的行数除以时间；停顿较久后重新计算
+    if (m_velocityTimer.isValid()) {
+        const qint64 elapsed = m_velocityTimer.restart();
+        const double sample = elapsed > 0 ? (firstVisibleRow - m_firstVisibleRow) * 1000.0 / elapsed : 0.0;
+        m_velocity = elapsed > 500 ? sample : 0.5 * m_velocity + 0.5 * sample;
+    } else {
+        m_velocityTimer.start();
+    }
+    m_firstVisibleRow = firstVisibleRow;
+    m_lastVisibleRow = lastVisibleRow;
+
+    if (m_task) {
+        m_pending = true;
+        return;
+    }
+    schedule();
+}
+
+void ReadAheadScheduler::schedule()
+{
+    CsvReader::ReadAheadSource source;
+    if (m_lastVisibleRow < m_firstVisibleRow || !m_reader->readAheadSource(&source)) {
+        return;
+    }
+
+    // 前方：若干屏加上按当前速度在LOOKAHEAD_SECONDS内会滚过的行；后方：若干屏
+    const int visibleRows = m_lastVisibleRow - m_firstVisibleRow + 1;
+    // 速度在double中先截断到上限再转换为int，拖动滚动条时的极大速度不会溢出
+    const int maxRows = MAX_PAGES_AHEAD * TableModel::PAGE_SIZE;
+    const int velocityRows = static_cast<int>(qMin(qAbs(m_velocity) * LOOKAHEAD_SECONDS, double(maxRows)));
+    const int aheadRows = qMin(m_screensAhead * visibleRows + velocityRows, maxRows);
+    const int behindRows = qMin(m_screensBehind * visibleRows, maxRows);
+    const bool down = m_velocity >= 0;
+
+    const int aheadFirst = down ? m_lastVisibleRow + 1 : m_firstVisibleRow - aheadRows;
+    const int aheadLast = down ? m_lastVisibleRow + aheadRows : m_firstVisibleRow - 1;
+    const int behindFirst = down ? m_firstVisibleRow - behindRows : m_lastVisibleRow + 1;
+    const int behindLast = down ? m_firstVisibleRow - 1 : m_lastVisibleRow + behindRows;
+
+    const int rowCount = m_tableModel->rowCount();
+    QVector<int> pages;
+    auto addPages = [&](int firstRow, int lastRow, bool forward) {
+        firstRow = qMax(firstRow, source.loadedRows);
+        lastRow = qMin(lastRow, rowCount - 1);
+        if (firstRow > lastRow) {
+            return;
+        }
+        const int firstPage = firstRow / TableModel::PAGE_SIZE;
+        const int lastPage = lastRow / TableModel::PAGE_SIZE;
+        // 离视口近的页先读
+        for (int i = 0; i <= lastPage - firstPage; ++i) {
+            const int page = forward ? firstPage + i : lastPage - i;
+            if (!m_tableModel->isPageLoaded(page) && !pages.contains(page)) {
+                pages.append(page);
+            }
+        }
+    };
+    addPages(aheadFirst, aheadLast, down);
+    addPages(behindFirst, behindLast, !down);
+    if (pages.isEmpty()) {
+        return;
+    }
+
+    m_task = new ReadAheadTask(source, pages, this);
+    connect(m_task, &ReadAheadTask::pagesLoaded, this, &ReadAheadScheduler::onPagesLoaded);
+    m_task->start();
+}
+
+void ReadAheadScheduler::cancel()
+{
+    if (m_task) {
+        m_task->cancel();
+        delete m_task;
+        m_task = nullptr;
+    }
+    m_pending = false;
+}
+
+void ReadAheadScheduler::onPagesLoaded()
+{
+    // 忽略已取消的旧任务遗留的信号
+    if (sender() != m_task) {
+        return;
+    }
+
+    ReadAheadTask *task = m_task;
+    m_task = nullptr;
+    task->cancel(); // 等待run()返回，信号在任务结束前发出
+    const QList<ReadAheadTask::LoadedPage> loadedPages = task->result();
+    delete task;
+
+    // 任务执行期间视口已经加载的页保持不变
+    for (const ReadAheadTask::LoadedPage &loaded : loadedPages) {
+        if (loaded.rows.isEmpty() || m_tableModel->isPageLoaded(loaded.page)) {
+            continue;
+        }
+        m_reader->commitReadAhead(loaded.page * TableModel::PAGE_SIZE, TableModel::PAGE_SIZE, loaded.endOffset, loaded.malformed);
+        m_tableModel->setPage(loaded.page, loaded.rows);
+    }
+
+    if (m_pending) {
+        m_pending = false;
+        schedule();
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef READAHEADSCHEDULER_H
+#define READAHEADSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+
+#include "BackgroundTask.h"
+#include "CsvReader.h"
+
+class TableModel;
+
+// 预读任务：在工作线程中定位并解析若干页
+// 只使用行索引中的精确位置，行索引尚未覆盖的页跳过（滚动到时由视口加载按估算位置读取）
+class ReadAheadTask : public BackgroundTask
+{
+    Q_OBJECT
+
+public:
+    struct LoadedPage {
+        int page = 0;
+        QList<QStringList> rows;
+        qint64 endOffset = 0; // 下一页的起始偏移
+        QVector<MalformedRecord> malformed;
+    };
+
+    ReadAheadTask(const CsvReader::ReadAheadSource &source, const QVector<int> &pages, QObject *parent = nullptr);
+
+    // 已解析的页（pagesLoaded信号发出后有效）
+    QList<LoadedPage> result() const { return m_result; }
+
+signals:
+    void pagesLoaded();
+
+protected:
+    void execute() override;
+
+private:
+    // 提示系统尽快把[begin, end)读入页缓存，读取与解析重叠进行
+    void adviseWillNeed(qint64 begin, qint64 end) const;
+
+    CsvReader::ReadAheadSource m_source;
+    QVector<int> m_pages;
+    QList<LoadedPage> m_result;
+};
+
+// 预读调度器
+// 根据滚动位置和速度，在后台保持视口前方（滚动方向上）和后方若干屏的页已经解析好，
+// 连续滚动时视口加载总是命中已加载的页；同一时间只有一个预读任务，新的请求只保留最新的
+class ReadAheadScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    ReadAheadScheduler(CsvReader *reader, TableModel *model, QObject *parent = nullptr);
+    ~ReadAheadScheduler();
+
+    // 视口前方和后方保持解析好的屏数
+    void setScreens(int ahead, int behind);
+
+    // 视口位置变化，更新滚动速度并安排预读
+    void viewportChanged(int firstVisibleRow, int lastVisibleRow);
+
+    // 程序跳转（跳转到行等）不是滚动：清除速度，从新位置重新测量
+    void resetVelocity();
+
+    // 停止预读并等待任务结束，重新加载或关闭文件前调用
+    void cancel();
+
+    static constexpr int DEFAULT_SCREENS_AHEAD = 4;
+    static constexpr int DEFAULT_SCREENS_BEHIND = 1;
+    static constexpr double LOOKAHEAD_SECONDS = 0.5;  // 按当前速度额外预读的时间
+    static constexpr int MAX_PAGES_AHEAD = 32;        // 前方（和后方）最多预读的页数
+
+private slots:
+    void onPagesLoaded();
+
+private:
+    // 按当前视口和速度挑出需要预读的页并启动任务
+    void schedule();
+
+    CsvReader *m_reader;
+    TableModel *m_tableModel;
+    ReadAheadTask *m_task = nullptr;
+    bool m_pending = false; // 任务执行期间视口又发生了变化
+
+    int m_screensAhead = DEFAULT_SCREENS_AHEAD;
+    int m_screensBehind = DEFAULT_SCREENS_BEHIND;
+
+    // 滚动速度（行/秒，向下为正），按指数滑动平均平滑
+    int m_firstVisibleRow = 0;
+    int m_lastVisibleRow = -1;
+    double m_velocity = 0.0;
+    QElapsedTimer m_velocityTimer;
+};
+
+#endif // READAHEADSCHEDULER_H
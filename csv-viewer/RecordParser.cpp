@@ -0,0 +1,318 @@
+#include "RecordParser.h"
+#include <algorithm>
+
+namespace {
+
+// p处是否为GBK双字节字符：首字节0x81-0xFE，尾字节0x40-0xFE（不含0x7F）
+// 尾字节可能与竖线、反斜杠等ASCII分隔符相同，切分字段时必须把整个字符一起跳过；
+// 换行符和引号（双引号、单引号）都小于0x40，不会出现在尾字节中
+inline bool isGbkPair(const char *p, const char *end)
+{
+    const unsigned char lead = static_cast<unsigned char>(p[0]);
+    if (lead < 0x81 || lead > 0xFE || p + 1 >= end) {
+        return false;
+    }
+    const unsigned char trail = static_cast<unsigned char>(p[1]);
+    return trail >= 0x40 && trail <= 0xFE && trail != 0x7F;
+}
+
+// 把[begin, end)转换为字段文本：去掉引号并还原转义的引号，再按编码解码
+// 纯ASCII的字段直接按Latin-1转换，只有包含非ASCII字节的字段才检查编码
+QString makeField(const char *begin, const char *end, bool quoted, bool highBytes, char quoteChar,
+                  bool utf8, QByteArray &buffer, quint8 &reasons)
+{
+    if (quoted) {
+        buffer.clear();
+        bool inQuotes = false;
+        for (const char *p = begin; p < end; ++p) {
+            if (*p == quoteChar) {
+                if (inQuotes && p + 1 < end && p[1] == quoteChar) {
+                    buffer.append(quoteChar);
+                    ++p;
+                } else {
+                    inQuotes = !inQuotes;
+                }
+            } else {
+                buffer.append(*p);
+            }
+        }
+        begin = buffer.constData();
+        end = begin + buffer.size();
+    }
+
+    const qsizetype length = end - begin;
+    if (!highBytes) {
+        return QString::fromLatin1(begin, length);
+    }
+    if (utf8) {
+        if (!RecordParser::isValidUtf8(begin, length)) {
+            reasons |= MalformedRecord::InvalidEncoding;
+        }
+        return QString::fromUtf8(begin, length);
+    }
+    const QString text = QString::fromLocal8Bit(begin, length);
+    if (text.contains(QChar::ReplacementCharacter)) {
+        reasons |= MalformedRecord::InvalidEncoding;
+    }
+    return text;
+}
+
+// 运行时指定的方言，用于不常见的分隔符和引号
+struct RuntimeDialect {
+    char delimiter;
+    char quoteChar;
+};
+
+// 编译期确定的方言
+template <char Delimiter, char Quote>
+struct FixedDialect {
+    static constexpr char delimiter = Delimiter;
+    static constexpr char quoteChar = Quote;
+};
+
+// 解析内核：Dialect为编译期常量方言时，内层循环中的分隔符和引号都是立即数
+template <typename Dialect>
+QList<QStringList> parseRecords(const char *data, qint64 length, Dialect dialect, bool utf8,
+                                int width, qint64 baseOffset, QVector<MalformedRecord> *malformed)
+{
+    QList<QStringList> rows;
+    const char quoteChar = dialect.quoteChar;
+    const char delimiter = dialect.delimiter;
+    const char *end = data + length;
+    const char *p = data;
+    QByteArray buffer;
+    qint64 record = 0;
+
+    while (p < end) {
+        const char *recordStart = p;
+        QStringList row;
+        row.reserve(qMax(width, 0));
+        quint8 reasons = 0;
+        bool inQuotes = false;
+        bool midFieldQuote = false;   // 在字段中间打开的引号，通常是多余的引号
+        bool newlineInQuotes = false; // 引号内有换行，记录跨越了多行
+
+        const char *fieldStart = p;
+        bool quoted = false;
+        bool highBytes = false;
+        for (;; ++p) {
+            if (p == end || (!inQuotes && *p == '\n')) {
+                // 记录结束：去掉行尾的回车
+                const char *fieldEnd = (p > fieldStart && p[-1] == '\r') ? p - 1 : p;
+                row.append(makeField(fieldStart, fieldEnd, quoted, highBytes, quoteChar, utf8, buffer, reasons));
+                if (p == end) {
+                    if (inQuotes) {
+                        reasons |= MalformedRecord::UnbalancedQuotes;
+                    }
+                } else {
+                    ++p;
+                }
+                break;
+            }
+
+            const char c = *p;
+            if ((c & 0x80) && !utf8 && isGbkPair(p, end)) {
+                // 跳过整个GBK字符，尾字节不参与分隔符判断
+                highBytes = true;
+                ++p;
+                continue;
+            }
+            if (c == quoteChar) {
+                if (!inQuotes && p != fieldStart && p[-1] != quoteChar) {
+                    midFieldQuote = true;
+                }
+                quoted = true;
+                inQuotes = !inQuotes;
+            } else if (inQuotes) {
+                newlineInQuotes |= (c == '\n');
+                highBytes |= (c & 0x80) != 0;
+            } else if (c == delimiter) {
+                row.append(makeField(fieldStart, p, quoted, highBytes, quoteChar, utf8, buffer, reasons));
+                fieldStart = p + 1;
+                quoted = false;
+                highBytes = false;
+            } else {
+                highBytes |= (c & 0x80) != 0;
+            }
+        }
+
+        if (midFieldQuote && newlineInQuotes) {
+            reasons |= MalformedRecord::UnbalancedQuotes;
+        }
+
+        // 规整行宽，之后显示时不需要逐格检查
+        const int fields = row.size();
+        if (width >= 0 && fields != width) {
+            reasons |= MalformedRecord::RaggedRow;
+            row.resize(width);
+        }
+
+        if (reasons && malformed) {
+            MalformedRecord entry;
+            entry.offset = baseOffset + (recordStart - data);
+            entry.row = record;
+            entry.fields = fields;
+            entry.reasons = reasons;
+            malformed->append(entry);
+        }
+
+        rows.append(row);
+        ++record;
+    }
+
+    return rows;
+}
+
+template <char Delimiter, char Quote>
+QList<QStringList> fixedKernel(const char *data, qint64 length, char, char, bool utf8,
+                               int width, qint64 baseOffset, QVector<MalformedRecord> *malformed)
+{
+    return parseRecords(data, length, FixedDialect<Delimiter, Quote>(), utf8, width, baseOffset, malformed);
+}
+
+QList<QStringList> runtimeKernel(const char *data, qint64 length, char delimiter, char quoteChar, bool utf8,
+                                 int width, qint64 baseOffset, QVector<MalformedRecord> *malformed)
+{
+    return parseRecords(data, length, RuntimeDialect{delimiter, quoteChar}, utf8, width, baseOffset, malformed);
+}
+
+} // namespace
+
+RecordParser::ParseFunction RecordParser::kernelFor(const CsvFormat &format)
+{
+    // 换行符不需要特化：回车只在记录结尾检查一次，LF和CRLF走同一条路径
+    if (format.quoteChar == '"') {
+        switch (format.delimiter) {
+        case ',':
+            return fixedKernel<',', '"'>;
+        case '\t':
+            return fixedKernel<'\t', '"'>;
+        case ';':
+            return fixedKernel<';', '"'>;
+        case '|':
+            return fixedKernel<'|', '"'>;
+        default:
+            break;
+        }
+    }
+    return runtimeKernel;
+}
+
+QList<QStringList> RecordParser::parse(const char *data, qint64 length, const CsvFormat &format, bool utf8,
+                                       int width, qint64 baseOffset, QVector<MalformedRecord> *malformed)
+{
+    return kernelFor(format)(data, length, format.delimiter, format.quoteChar, utf8, width, baseOffset, malformed);
+}
+
+const char *RecordParser::sliceRecord(const char *p, const char *end, const CsvFormat &format, bool utf8,
+                                      const QVector<int> &slotOfColumn, FieldSlice *slices, int slotCount,
+                                      const char **recordEnd)
+{
+    const char quoteChar = format.quoteChar;
+    const char delimiter = format.delimiter;
+    const int columnsNeeded = slotOfColumn.size();
+    std::fill(slices, slices + slotCount, FieldSlice());
+
+    int column = 0;
+    const char *fieldStart = p;
+    bool quoted = false;
+    bool inQuotes = false;
+    for (;; ++p) {
+        if (p == end || (!inQuotes && *p == '\n')) {
+            const char *fieldEnd = (p > fieldStart && p[-1] == '\r') ? p - 1 : p;
+            if (column < columnsNeeded && slotOfColumn[column] >= 0) {
+                slices[slotOfColumn[column]] = FieldSlice{fieldStart, fieldEnd, quoted};
+            }
+            if (recordEnd) {
+                *recordEnd = fieldEnd;
+            }
+            return p < end ? p + 1 : p;
+        }
+        const char c = *p;
+        if ((c & 0x80) && !utf8 && isGbkPair(p, end)) {
+            ++p;
+            continue;
+        }
+        if (c == quoteChar) {
+            quoted = true;
+            inQuotes = !inQuotes;
+        } else if (c == delimiter && !inQuotes) {
+            if (column < columnsNeeded && slotOfColumn[column] >= 0) {
+                slices[slotOfColumn[column]] = FieldSlice{fieldStart, p, quoted};
+            }
+            ++column;
+            fieldStart = p + 1;
+            quoted = false;
+        }
+    }
+}
+
+QByteArray RecordParser::fieldValue(const FieldSlice &slice, char quoteChar, QByteArray &buffer)
+{
+    if (!slice.begin) {
+        return QByteArray();
+    }
+    if (!slice.quoted) {
+        return QByteArray::fromRawData(slice.begin, slice.end - slice.begin);
+    }
+    buffer.clear();
+    bool inQuotes = false;
+    for (const char *p = slice.begin; p < slice.end; ++p) {
+        if (*p == quoteChar) {
+            if (inQuotes && p + 1 < slice.end && p[1] == quoteChar) {
+                buffer.append(quoteChar);
+                ++p;
+            } else {
+                inQuotes = !inQuotes;
+            }
+        } else {
+            buffer.append(*p);
+        }
+    }
+    return buffer;
+}
+
+bool RecordParser::isValidUtf8(const char *data, qint64 length)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *end = p + length;
+    while (p < end) {
+        const unsigned char c = *p;
+        if (c < 0x80) {
+            ++p;
+            continue;
+        }
+
+        int continuation = 0;
+        quint32 codePoint = 0;
+        if (c >= 0xC2 && c <= 0xDF) {
+            continuation = 1;
+            codePoint = c & 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            continuation = 2;
+            codePoint = c & 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            continuation = 3;
+            codePoint = c & 0x07;
+        } else {
+            return false;
+        }
+        if (end - p <= continuation) {
+            return false;
+        }
+        for (int i = 1; i <= continuation; ++i) {
+            if ((p[i] & 0xC0) != 0x80) {
+                return false;
+            }
+            codePoint = (codePoint << 6) | (p[i] & 0x3F);
+        }
+
+        // 过长编码、代理区和超出Unicode范围的码点
+        if ((continuation == 2 && (codePoint < 0x800 || (codePoint >= 0xD800 && codePoint <= 0xDFFF)))
+            || (continuation == 3 && (codePoint < 0x10000 || codePoint > 0x10FFFF))) {
+            return false;
+        }
+        p += continuation + 1;
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef RECORDPARSER_H
+#define RECORDPARSER_H
+
+#include <QList>
+#include <QStringList>
+#include <QVector>
+
+#include "CsvFormat.h"
+#include "MalformedRowIndex.h"
+
+// 容错的记录解析器
+// 记录边界与RecordScanner完全一致（引号在任何位置都切换引号状态），保证行号与行索引对应；
+// 解析时把每行规整为固定的列数，格式错误的记录只登记不抛出异常，解析总能继续
+class RecordParser
+{
+public:
+    // 记录中的一个字段在原始数据中的范围
+    struct FieldSlice {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+        bool quoted = false;
+    };
+
+    // utf8为false时数据为GBK编码：双字节字符作为整体跳过，尾字节与分隔符相同时不会被切开
+    // 解析[data, data + length)中的记录，范围必须从记录边界开始
+    // width为表头列数，字段不足的行补空字符串，多出的字段丢弃（为负数时不规整）；
+    // baseOffset为data在文件中的偏移，malformed（可为nullptr）中的行号为记录在本片段中的序号
+    static QList<QStringList> parse(const char *data, qint64 length, const CsvFormat &format, bool utf8,
+                                    int width, qint64 baseOffset, QVector<MalformedRecord> *malformed);
+
+    // 解析内核，参数与parse相同，方言以分隔符和引号给出
+    using ParseFunction = QList<QStringList> (*)(const char *data, qint64 length, char delimiter, char quoteChar,
+                                                 bool utf8, int width, qint64 baseOffset,
+                                                 QVector<MalformedRecord> *malformed);
+
+    // 按方言选择解析内核：双引号加逗号、制表符、分号或竖线分隔的方言使用编译期特化的版本，
+    // 分隔符和引号是常量；其余方言使用运行时版本。打开文件时选定一次，之后每个片段直接调用
+    static ParseFunction kernelFor(const CsvFormat &format);
+
+    // 切分从p开始的一条记录，只取出slotOfColumn中需要的列（原始列 -> 字段槽，不需要的列为-1），
+    // 其余字段只跳过不转换；slices中的slotCount个槽先被清空，字段不足时缺少的槽保持为空
+    // recordEnd（可为nullptr）返回记录内容的结尾（不含换行符），返回值为下一条记录的起始位置
+    static const char *sliceRecord(const char *p, const char *end, const CsvFormat &format, bool utf8,
+                                   const QVector<int> &slotOfColumn, FieldSlice *slices, int slotCount,
+                                   const char **recordEnd = nullptr);
+
+    // 字段的原始值：带引号的字段去掉引号并还原转义的引号（写入buffer），否则直接引用原始数据
+    static QByteArray fieldValue(const FieldSlice &slice, char quoteChar, QByteArray &buffer);
+
+    // 是否为合法的UTF-8字节序列
+    static bool isValidUtf8(const char *data, qint64 length);
+};
+
+#endif // RECORDPARSER_H
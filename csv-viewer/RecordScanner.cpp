@@ -0,0 +1,170 @@
+#include "RecordScanner.h"
+#include <algorithm>
+#include <cstring>
+
+qint64 RecordScanner::countRecords(const char *data, qint64 length, char quoteChar, bool &inQuotes)
+{
+    if (length <= 0) {
+        return 0;
+    }
+
+    const char *end = data + length;
+
+    // 快速路径：数据块中没有引号且不在引号内时，直接统计换行符
+    if (!inQuotes && !memchr(data, quoteChar, static_cast<size_t>(length))) {
+        return std::count(data, end, '\n');
+    }
+
+    qint64 records = 0;
+    for (const char *p = data; p < end; ++p) {
+        const char c = *p;
+        if (c == quoteChar) {
+            // 转义的双引号("")会翻转两次，引号状态保持正确
+            inQuotes = !inQuotes;
+        } else if (c == '\n' && !inQuotes) {
+            ++records;
+        }
+    }
+    return records;
+}
+
+qint64 RecordScanner::skipRecords(const char *data, qint64 size, qint64 offset, qint64 count,
+                                  char quoteChar, qint64 *skipped)
+{
+    qint64 done = 0;
+    bool inQuotes = false;
+    qint64 pos = qMax<qint64>(offset, 0);
+
+    while (done < count && pos < size) {
+        const char c = data[pos++];
+        if (c == quoteChar) {
+            inQuotes = !inQuotes;
+        } else if (c == '\n' && !inQuotes) {
+            ++done;
+        }
+    }
+
+    // 文件末尾没有换行符的最后一条记录也计入
+    if (done < count && pos >= size && pos > offset && data[size - 1] != '\n') {
+        ++done;
+    }
+
+    if (skipped) {
+        *skipped = done;
+    }
+    return pos;
+}
+
+void RecordScanner::indexRecords(const char *data, qint64 length, char quoteChar, bool &inQuotes,
+                                 qint64 baseOffset, qint64 &recordNumber, qint64 stride,
+                                 QVector<qint64> &checkpoints)
+{
+    if (length <= 0) {
+        return;
+    }
+
+    const char *p = data;
+    const char *end = data + length;
+
+    // 快速路径：没有引号时只需逐个查找换行符
+    if (!inQuotes && !memchr(data, quoteChar, static_cast<size_t>(length))) {
+        while ((p = static_cast<const char *>(memchr(p, '\n', static_cast<size_t>(end - p)))) != nullptr) {
+            ++p;
+            ++recordNumber;
+            if (recordNumber % stride == 0) {
+                checkpoints.append(baseOffset + (p - data));
+            }
+        }
+        return;
+    }
+
+    for (; p < end; ++p) {
+        const char c = *p;
+        if (c == quoteChar) {
+            inQuotes = !inQuotes;
+        } else if (c == '\n' && !inQuotes) {
+            ++recordNumber;
+            if (recordNumber % stride == 0) {
+                checkpoints.append(baseOffset + (p - data) + 1);
+            }
+        }
+    }
+}
+
+qint64 RecordScanner::syncToRecordStart(const char *data, qint64 size, qint64 minOffset,
+                                        qint64 offset, char quoteChar)
+{
+    if (offset <= minOffset) {
+        return minOffset;
+    }
+    if (offset >= size) {
+        return size;
+    }
+
+    // 假定start处于引号外，正向扫描到不小于offset的第一个记录边界
+    auto boundaryFrom = [&](qint64 start) -> qint64 {
+        bool inQuotes = false;
+        for (qint64 pos = start; pos < size; ++pos) {
+            const char c = data[pos];
+            if (c == quoteChar) {
+                inQuotes = !inQuotes;
+            } else if (c == '\n' && !inQuotes && pos + 1 >= offset) {
+                return pos + 1;
+            }
+        }
+        return size;
+    };
+
+    // 返回[from, offset)内第一个换行符之后的位置，没有换行符时返回-1
+    auto lineStartAfter = [&](qint64 from) -> qint64 {
+        const void *hit = memchr(data + from, '\n', static_cast<size_t>(offset - from));
+        return hit ? (static_cast<const char *>(hit) - data) + 1 : -1;
+    };
+
+    // 仅凭局部字节无法判断offset是否处于引号内。向前回退一段上下文，
+    // 从上下文中两个不同的行首分别按引号状态扫描：两者得到相同的边界时，
+    // 说明扫描已经收敛到真实的记录边界；否则加大回退距离重试
+    const qint64 INITIAL_CONTEXT = 16 * 1024;
+    const qint64 MAX_CONTEXT = 1024 * 1024;
+
+    qint64 fallback = -1;
+    for (qint64 context = INITIAL_CONTEXT; ; context *= 2) {
+        const qint64 contextStart = qMax(minOffset, offset - context);
+
+        // 回退到已知边界时，从该边界扫描的结果就是精确的
+        if (contextStart == minOffset) {
+            return boundaryFrom(minOffset);
+        }
+
+        const qint64 farStart = lineStartAfter(contextStart);
+        const qint64 nearStart = lineStartAfter(contextStart + (offset - contextStart) / 2);
+        if (farStart >= 0) {
+            fallback = boundaryFrom(farStart);
+            if (nearStart < 0 || nearStart == farStart || boundaryFrom(nearStart) == fallback) {
+                return fallback;
+            }
+        }
+
+        if (context >= MAX_CONTEXT) {
+            break;
+        }
+    }
+
+    // 超长的带引号字段：采用最远起点的结果，最坏情况下只错位一条记录
+    return fallback >= 0 ? fallback : boundaryFrom(offset);
+}
+
+QVector<qint64> RecordScanner::chunkBounds(const char *data, qint64 size, qint64 dataStart,
+                                           qint64 chunkSize, char quoteChar)
+{
+    QVector<qint64> bounds;
+    bounds.append(dataStart);
+    for (qint64 offset = dataStart + chunkSize; offset < size; offset += chunkSize) {
+        const qint64 boundary = syncToRecordStart(data, size, bounds.last(), offset, quoteChar);
+        if (boundary > bounds.last() && boundary < size) {
+            bounds.append(boundary);
+        }
+    }
+    bounds.append(size);
+    return bounds;
+}
@@ -0,0 +1,40 @@
+#ifndef RECORDSCANNER_H
+#define RECORDSCANNER_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// 记录边界扫描工具
+// 只在原始字节上按引号状态查找CSV记录边界，不做字段解析，
+// 供行数估算、按字节偏移定位等需要知道记录位置的场景使用
+// 换行符和引号（双引号、单引号）都小于0x40，不会是GBK双字节字符的尾字节，GBK文件也可以直接扫描
+class RecordScanner
+{
+public:
+    // 统计[data, data + length)中位于引号外的换行符个数
+    // inQuotes为跨数据块传递的引号状态，返回时更新为块末尾的状态
+    static qint64 countRecords(const char *data, qint64 length, char quoteChar, bool &inQuotes);
+
+    // 从offset处的记录起始位置向后跳过count条记录，返回下一条记录的起始偏移
+    // skipped返回实际跳过的记录数（到达数据末尾时可能小于count）
+    static qint64 skipRecords(const char *data, qint64 size, qint64 offset, qint64 count,
+                              char quoteChar, qint64 *skipped = nullptr);
+
+    // 统计记录数，同时每隔stride条记录保存一次下一条记录的起始偏移
+    // baseOffset为data在文件中的偏移，recordNumber为data之前已统计的记录数（返回时更新）
+    static void indexRecords(const char *data, qint64 length, char quoteChar, bool &inQuotes,
+                             qint64 baseOffset, qint64 &recordNumber, qint64 stride,
+                             QVector<qint64> &checkpoints);
+
+    // 从任意字节偏移重新同步到不小于offset的第一条真实记录的起始位置
+    // minOffset为已知的记录边界（如数据区起始位置），向前回退时不会越过它
+    static qint64 syncToRecordStart(const char *data, qint64 size, qint64 minOffset,
+                                    qint64 offset, char quoteChar);
+
+    // 把[dataStart, size)切分为大约chunkSize字节、从记录边界开始的数据块，供并行处理整个文件
+    // 返回各块的起始偏移，最后一项为size（数据区为空时只有一个空块）
+    static QVector<qint64> chunkBounds(const char *data, qint64 size, qint64 dataStart,
+                                       qint64 chunkSize, char quoteChar);
+};
+
+#endif // RECORDSCANNER_H
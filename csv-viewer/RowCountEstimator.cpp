@@ -0,0 +1,374 @@
+#include "RowCountEstimator.h"
+#include "BlockReader.h"
+#include "RecordScanner.h"
+#include "CompressedFile.h"
+#include <QFile>
+#include <QDebug>
+#include <QElapsedTimer>
+
+RowCountTask::RowCountTask(const QString &filePath, qint64 startOffset, char quoteChar,
+                           RowIndex *rowIndex, QObject *parent)
+    : BackgroundTask(parent)
+    , m_filePath(filePath)
+    , m_startOffset(startOffset)
+    , m_quoteChar(quoteChar)
+    , m_rowIndex(rowIndex)
+{
+}
+
+void RowCountTask::execute()
+{
+    // 多个大块读取同时在途，冷缓存和网络存储上扫描速度接近设备的顺序读取带宽
+    BlockReader reader(m_filePath, m_startOffset);
+    if (!reader.open()) {
+        qDebug() << "Row count task failed to open file:" << m_filePath << reader.errorString();
+        return;
+    }
+
+    const qint64 PROGRESS_INTERVAL_MS = 200;     // 进度上报间隔
+
+    QElapsedTimer countTimer;
+    countTimer.start();
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+
+    bool inQuotes = false;
+    qint64 records = 0;
+    qint64 bytesScanned = 0;
+    char lastByte = '\n';
+    QVector<qint64> checkpoints;
+    BlockReader::Block block;
+
+    while (!isCancelled() && reader.next(&block)) {
+        // 每个数据块扫描完就发布新的检查点，索引覆盖的范围随扫描进度增长
+        checkpoints.clear();
+        RecordScanner::indexRecords(block.data, block.size, m_quoteChar, inQuotes,
+                                    block.offset, records, RowIndex::STRIDE, checkpoints);
+        m_rowIndex->append(checkpoints);
+        lastByte = block.data[block.size - 1];
+        bytesScanned += block.size;
+
+        if (progressTimer.elapsed() >= PROGRESS_INTERVAL_MS) {
+            emit progress(records, bytesScanned);
+            progressTimer.restart();
+        }
+    }
+
+    if (isCancelled()) {
+        return;
+    }
+
+    // 读取出错时已统计的记录数不完整，不能当作精确值，之后的行只能按估算位置访问
+    if (reader.hasError()) {
+        qDebug() << "Row count stopped early:" << reader.errorString();
+        emit failed(reader.errorString());
+        return;
+    }
+
+    // 最后一条记录没有换行符结尾
+    if (bytesScanned > 0 && lastByte != '\n') {
+        ++records;
+    }
+
+    qDebug() << "Exact row count:" << records << "(" << bytesScanned << "bytes scanned in" << countTimer.elapsed() << "ms,"
+             << (reader.backendType() == BlockReader::IoUring ? "io_uring)" : "pread thread pool)");
+    emit counted(records);
+}
+
+CompressedRowCountTask::CompressedRowCountTask(CompressedFile *file, qint64 startOffset, char quoteChar,
+                                               RowIndex *rowIndex, QObject *parent)
+    : BackgroundTask(parent)
+    , m_file(file)
+    , m_startOffset(startOffset)
+    , m_quoteChar(quoteChar)
+    , m_rowIndex(rowIndex)
+{
+}
+
+void CompressedRowCountTask::execute()
+{
+    const qint64 CHUNK_SIZE = 4 * 1024 * 1024;   // 每次解压4MB
+    const qint64 PROGRESS_INTERVAL_MS = 200;     // 进度上报间隔
+
+    QByteArray buffer;
+    buffer.resize(CHUNK_SIZE);
+
+    QElapsedTimer countTimer;
+    countTimer.start();
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+
+    CompressedFile::Decoder decoder(m_file, true);
+    bool inQuotes = false;
+    qint64 records = 0;
+    qint64 bytesDecoded = 0;
+    char lastByte = '\n';
+    QVector<qint64> checkpoints;
+
+    while (!isCancelled()) {
+        const qint64 bytesRead = decoder.read(buffer.data(), CHUNK_SIZE);
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        // 表头之前的数据不计入
+        const qint64 skip = qBound<qint64>(0, m_startOffset - bytesDecoded, bytesRead);
+        if (skip < bytesRead) {
+            checkpoints.clear();
+            RecordScanner::indexRecords(buffer.constData() + skip, bytesRead - skip, m_quoteChar, inQuotes,
+                                        bytesDecoded + skip, records, RowIndex::STRIDE, checkpoints);
+            m_rowIndex->append(checkpoints);
+            lastByte = buffer.at(bytesRead - 1);
+        }
+        bytesDecoded += bytesRead;
+
+        if (progressTimer.elapsed() >= PROGRESS_INTERVAL_MS) {
+            emit progress(records, decoder.compressedPosition());
+            progressTimer.restart();
+        }
+    }
+
+    if (isCancelled()) {
+        return;
+    }
+
+    if (decoder.hasError()) {
+        qDebug() << "Compressed row count stopped early:" << decoder.errorString();
+        emit failed(decoder.errorString());
+        return;
+    }
+
+    // 最后一条记录没有换行符结尾
+    if (bytesDecoded > m_startOffset && lastByte != '\n') {
+        ++records;
+    }
+
+    qDebug() << "Exact row count:" << records << "(" << bytesDecoded << "bytes decompressed from"
+             << decoder.compressedPosition() << "in" << countTimer.elapsed() << "ms)";
+    emit counted(records);
+}
+
+RowCountEstimator::RowCountEstimator(QObject *parent)
+    : QObject(parent)
+{
+}
+
+RowCountEstimator::~RowCountEstimator()
+{
+    stop();
+}
+
+bool RowCountEstimator::start(const QString &filePath, qint64 dataStart, char quoteChar)
+{
+    stop();
+
+    m_fileSize = 0;
+    m_dataStart = dataStart;
+    m_quoteChar = quoteChar;
+    m_estimatedRows = 0;
+    m_avgBytesPerRecord = 0.0;
+    m_isExact = false;
+    m_countError = false;
+
+    QElapsedTimer sampleTimer;
+    sampleTimer.start();
+
+    if (!sampleFile(filePath)) {
+        return false;
+    }
+
+    qDebug() << "Estimated rows:" << m_estimatedRows << "(" << m_avgBytesPerRecord << "bytes/record,"
+             << (m_isExact ? "exact," : "sampled,") << sampleTimer.elapsed() << "ms)";
+
+    if (m_isExact) {
+        return true;
+    }
+
+    // 后台精确计数，逐步修正估算值
+    RowCountTask *task = new RowCountTask(filePath, m_dataStart, m_quoteChar, &m_rowIndex, this);
+    connect(task, &RowCountTask::progress, this, &RowCountEstimator::onCountProgress);
+    connect(task, &RowCountTask::counted, this, &RowCountEstimator::onCounted);
+    connect(task, &RowCountTask::failed, this, &RowCountEstimator::onCountFailed);
+    task->setThreadPool(BackgroundTask::scanPool());
+    m_countTask = task;
+    m_countTask->start();
+    return true;
+}
+
+bool RowCountEstimator::startCompressed(CompressedFile *file, qint64 dataStart, char quoteChar)
+{
+    stop();
+
+    // 进度按压缩字节计算，剩余行数按已消耗的压缩字节比例推算
+    m_fileSize = file->compressedSize();
+    m_dataStart = 0;
+    m_quoteChar = quoteChar;
+    m_estimatedRows = 0;
+    m_avgBytesPerRecord = 0.0;
+    m_isExact = false;
+    m_countError = false;
+    m_rowIndex.reset(dataStart);
+
+    CompressedRowCountTask *task = new CompressedRowCountTask(file, dataStart, m_quoteChar, &m_rowIndex, this);
+    connect(task, &CompressedRowCountTask::progress, this, &RowCountEstimator::onCountProgress);
+    connect(task, &CompressedRowCountTask::counted, this, &RowCountEstimator::onCounted);
+    connect(task, &CompressedRowCountTask::failed, this, &RowCountEstimator::onCountFailed);
+    task->setThreadPool(BackgroundTask::scanPool());
+    m_countTask = task;
+    m_countTask->start();
+    return true;
+}
+
+void RowCountEstimator::stop()
+{
+    if (m_countTask) {
+        m_countTask->cancel();
+        delete m_countTask;
+        m_countTask = nullptr;
+    }
+}
+
+qint64 RowCountEstimator::estimatedRows() const
+{
+    return m_estimatedRows;
+}
+
+bool RowCountEstimator::isExact() const
+{
+    return m_isExact;
+}
+
+double RowCountEstimator::averageBytesPerRecord() const
+{
+    return m_avgBytesPerRecord;
+}
+
+qint64 RowCountEstimator::dataStartOffset() const
+{
+    return m_dataStart;
+}
+
+const RowIndex &RowCountEstimator::rowIndex() const
+{
+    return m_rowIndex;
+}
+
+bool RowCountEstimator::hasCountError() const
+{
+    return m_countError;
+}
+
+bool RowCountEstimator::sampleFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Row count estimator failed to open file:" << filePath;
+        return false;
+    }
+    m_fileSize = file.size();
+
+    m_rowIndex.reset(m_dataStart);
+
+    const qint64 dataBytes = m_fileSize - m_dataStart;
+    if (dataBytes <= 0) {
+        m_isExact = true;
+        return true;
+    }
+
+    // 数据量不超过采样总量时直接精确计数
+    if (dataBytes <= SAMPLE_BLOCK_SIZE * SAMPLE_BLOCK_COUNT) {
+        file.seek(m_dataStart);
+        const QByteArray content = file.readAll();
+        bool inQuotes = false;
+        qint64 records = 0;
+        QVector<qint64> checkpoints;
+        RecordScanner::indexRecords(content.constData(), content.size(), m_quoteChar, inQuotes,
+                                    m_dataStart, records, RowIndex::STRIDE, checkpoints);
+        m_rowIndex.append(checkpoints);
+        if (!content.isEmpty() && !content.endsWith('\n')) {
+            ++records;
+        }
+        m_estimatedRows = records;
+        m_avgBytesPerRecord = records > 0 ? double(dataBytes) / records : 0.0;
+        m_isExact = true;
+        return true;
+    }
+
+    // 在数据区内均匀读取采样块，统计完整记录的平均长度
+    qint64 sampledRecords = 0;
+    qint64 sampledBytes = 0;
+    for (int i = 0; i < SAMPLE_BLOCK_COUNT; ++i) {
+        const qint64 offset = m_dataStart + (dataBytes - SAMPLE_BLOCK_SIZE) * i / (SAMPLE_BLOCK_COUNT - 1);
+        if (!file.seek(offset)) {
+            continue;
+        }
+        const QByteArray block = file.read(SAMPLE_BLOCK_SIZE);
+
+        // 第一个块从记录边界开始，其余块可能落在记录中间，对齐到第一个换行符之后
+        const qint64 first = (i == 0) ? -1 : block.indexOf('\n');
+        const qint64 last = block.lastIndexOf('\n');
+        if ((i != 0 && first < 0) || last <= first) {
+            continue;
+        }
+
+        bool inQuotes = false;
+        sampledRecords += RecordScanner::countRecords(block.constData() + first + 1, last - first, m_quoteChar, inQuotes);
+        sampledBytes += last - first;
+    }
+
+    if (sampledRecords == 0) {
+        // 单条记录比采样块还大，无法估算，按一条记录处理并等待精确计数
+        m_avgBytesPerRecord = double(dataBytes);
+        m_estimatedRows = 1;
+        return true;
+    }
+
+    m_avgBytesPerRecord = double(sampledBytes) / sampledRecords;
+    m_estimatedRows = qRound64(dataBytes / m_avgBytesPerRecord);
+    return true;
+}
+
+void RowCountEstimator::onCountProgress(qint64 records, qint64 bytesScanned)
+{
+    // 忽略已停止的旧计数任务遗留的信号
+    if (sender() != m_countTask || records <= 0 || bytesScanned <= 0) {
+        return;
+    }
+
+    // 用已扫描部分的实际平均长度推算剩余部分
+    m_avgBytesPerRecord = double(bytesScanned) / records;
+    const qint64 remainingBytes = qMax<qint64>(0, m_fileSize - m_dataStart - bytesScanned);
+    const qint64 estimate = records + qRound64(remainingBytes / m_avgBytesPerRecord);
+
+    if (estimate != m_estimatedRows) {
+        m_estimatedRows = estimate;
+        emit estimateChanged(m_estimatedRows);
+    }
+}
+
+void RowCountEstimator::onCounted(qint64 records)
+{
+    if (sender() != m_countTask) {
+        return;
+    }
+
+    m_estimatedRows = records;
+    m_isExact = true;
+    if (records > 0) {
+        m_avgBytesPerRecord = double(m_fileSize - m_dataStart) / records;
+    }
+
+    emit estimateChanged(m_estimatedRows);
+    emit countFinished(m_estimatedRows);
+}
+
+void RowCountEstimator::onCountFailed(const QString &error)
+{
+    if (sender() != m_countTask) {
+        return;
+    }
+
+    // 保留按已扫描部分修正过的估算值，行索引停留在出错位置，不标记为精确
+    m_countError = true;
+    emit countFailed(error);
+}
@@ -0,0 +1,143 @@
+#ifndef ROWCOUNTESTIMATOR_H
+#define ROWCOUNTESTIMATOR_H
+
+#include <QObject>
+#include <QString>
+#include "BackgroundTask.h"
+#include "RowIndex.h"
+
+class CompressedFile;
+
+// 后台精确计数任务：从数据区起始位置顺序扫描整个文件，统计记录数并建立稀疏行索引
+class RowCountTask : public BackgroundTask
+{
+    Q_OBJECT
+
+public:
+    RowCountTask(const QString &filePath, qint64 startOffset, char quoteChar,
+                 RowIndex *rowIndex, QObject *parent = nullptr);
+
+signals:
+    // 扫描进度：已统计的记录数和已扫描的字节数
+    void progress(qint64 records, qint64 bytesScanned);
+
+    // 扫描完成，records为精确记录数
+    void counted(qint64 records);
+
+    // 读取出错，扫描中途停止，已统计的记录数不是精确值
+    void failed(const QString &error);
+
+protected:
+    void execute() override;
+
+private:
+    QString m_filePath;
+    qint64 m_startOffset;
+    char m_quoteChar;
+    RowIndex *m_rowIndex;
+};
+
+// 压缩文件的后台计数任务：顺序解压整个文件，统计记录数、建立稀疏行索引，
+// 同时在压缩文件中登记访问点，之后的随机读取可以从附近开始解压
+class CompressedRowCountTask : public BackgroundTask
+{
+    Q_OBJECT
+
+public:
+    CompressedRowCountTask(CompressedFile *file, qint64 startOffset, char quoteChar,
+                           RowIndex *rowIndex, QObject *parent = nullptr);
+
+signals:
+    // 扫描进度：已统计的记录数和已消耗的压缩字节数
+    void progress(qint64 records, qint64 bytesScanned);
+
+    // 扫描完成，records为精确记录数
+    void counted(qint64 records);
+
+    // 读取出错，扫描中途停止，已统计的记录数不是精确值
+    void failed(const QString &error);
+
+protected:
+    void execute() override;
+
+private:
+    CompressedFile *m_file;
+    qint64 m_startOffset; // 解压后数据区的起始偏移
+    char m_quoteChar;
+    RowIndex *m_rowIndex;
+};
+
+// 行数估算器
+// 打开文件时读取少量均匀分布的采样块，用平均每条记录的字节数推算总行数，
+// 随后在共享线程池中精确计数，并随扫描进度不断修正估算值
+class RowCountEstimator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RowCountEstimator(QObject *parent = nullptr);
+    ~RowCountEstimator();
+
+    // 采样估算文件行数（同步，毫秒级），并启动后台精确计数
+    // dataStart为数据区（表头和注释之后）的起始偏移，quoteChar为文件方言的引号字符
+    bool start(const QString &filePath, qint64 dataStart, char quoteChar);
+
+    // 压缩文件无法按字节采样，直接启动后台解压计数，估算值随解压进度按压缩字节比例推算
+    // file在计数结束或stop()之前必须保持有效
+    bool startCompressed(CompressedFile *file, qint64 dataStart, char quoteChar);
+
+    // 停止后台计数
+    void stop();
+
+    // 当前估算的数据行数（不含表头）
+    qint64 estimatedRows() const;
+
+    // 估算值是否已经是精确值
+    bool isExact() const;
+
+    // 平均每条记录的字节数
+    double averageBytesPerRecord() const;
+
+    // 数据区（表头之后）的起始字节偏移
+    qint64 dataStartOffset() const;
+
+    // 计数过程中建立的稀疏行索引
+    const RowIndex &rowIndex() const;
+
+    // 后台计数是否因读取出错中途停止（行索引只覆盖出错位置之前的记录）
+    bool hasCountError() const;
+
+signals:
+    // 估算值发生变化
+    void estimateChanged(qint64 rows);
+
+    // 后台精确计数完成
+    void countFinished(qint64 rows);
+
+    // 后台计数出错中途停止，估算值保持不变
+    void countFailed(const QString &error);
+
+private slots:
+    void onCountProgress(qint64 records, qint64 bytesScanned);
+    void onCounted(qint64 records);
+    void onCountFailed(const QString &error);
+
+private:
+    // 读取采样块计算平均记录长度
+    bool sampleFile(const QString &filePath);
+
+    static constexpr qint64 SAMPLE_BLOCK_SIZE = 64 * 1024; // 每个采样块的大小
+    static constexpr int SAMPLE_BLOCK_COUNT = 8;            // 采样块数量
+
+    BackgroundTask *m_countTask = nullptr;
+    RowIndex m_rowIndex;
+    qint64 m_fileSize = 0;
+    qint64 m_dataStart = 0;
+    char m_quoteChar = '"';
+    qint64 m_estimatedRows = 0;
+    double m_avgBytesPerRecord = 0.0;
+    bool m_isExact = false;
+    bool m_countError = false;
+};
+
+#endif // ROWCOUNTESTIMATOR_H
@@ -0,0 +1,57 @@
+#include "RowIndex.h"
+#include <QMutexLocker>
+#include <algorithm>
+
+void RowIndex::reset(qint64 dataStartOffset)
+{
+    QMutexLocker locker(&m_mutex);
+    m_checkpoints.clear();
+    m_checkpoints.append(dataStartOffset);
+}
+
+void RowIndex::append(const QVector<qint64> &checkpoints)
+{
+    if (checkpoints.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_checkpoints += checkpoints;
+}
+
+bool RowIndex::lookup(qint64 row, qint64 *checkpointRow, qint64 *offset) const
+{
+    if (row < 0) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    const qint64 checkpoint = row / STRIDE;
+    if (checkpoint >= m_checkpoints.size()) {
+        return false;
+    }
+
+    *checkpointRow = checkpoint * STRIDE;
+    *offset = m_checkpoints.at(checkpoint);
+    return true;
+}
+
+bool RowIndex::lookupOffset(qint64 offset, qint64 *checkpointRow, qint64 *checkpointOffset) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = std::upper_bound(m_checkpoints.constBegin(), m_checkpoints.constEnd(), offset);
+    if (it == m_checkpoints.constBegin()) {
+        return false;
+    }
+
+    --it;
+    *checkpointRow = (it - m_checkpoints.constBegin()) * STRIDE;
+    *checkpointOffset = *it;
+    return true;
+}
+
+qint64 RowIndex::indexedRows() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_checkpoints.size() * STRIDE;
+}
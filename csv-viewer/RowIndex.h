@@ -0,0 +1,35 @@
+#ifndef ROWINDEX_H
+#define ROWINDEX_H
+
+#include <QMutex>
+#include <QVector>
+
+// 稀疏行索引
+// 每隔STRIDE条记录保存一次记录起始的字节偏移，由后台计数线程边扫描边追加，
+// UI线程通过lookup查找不超过目标行的最近检查点，再向后跳过少量记录即可精确定位
+class RowIndex
+{
+public:
+    static constexpr qint64 STRIDE = 1024; // 检查点间隔（记录数）
+
+    // 清空索引，第0个检查点为数据区起始偏移
+    void reset(qint64 dataStartOffset);
+
+    // 追加新扫描到的检查点（线程安全）
+    void append(const QVector<qint64> &checkpoints);
+
+    // 查找row之前最近的检查点，索引尚未覆盖该行时返回false（线程安全）
+    bool lookup(qint64 row, qint64 *checkpointRow, qint64 *offset) const;
+
+    // 查找不超过offset的最近检查点（线程安全）
+    bool lookupOffset(qint64 offset, qint64 *checkpointRow, qint64 *checkpointOffset) const;
+
+    // 已建立索引的行数上限
+    qint64 indexedRows() const;
+
+private:
+    mutable QMutex m_mutex;
+    QVector<qint64> m_checkpoints;
+};
+
+#endif // ROWINDEX_H
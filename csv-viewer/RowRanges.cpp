@@ -0,0 +1,24 @@
+#include "RowRanges.h"
+#include <algorithm>
+
+QVector<QPair<int, int>> RowRanges::normalize(QVector<QPair<int, int>> ranges)
+{
+    std::sort(ranges.begin(), ranges.end());
+    QVector<QPair<int, int>> merged;
+    for (const QPair<int, int> &range : ranges) {
+        if (!merged.isEmpty() && range.first <= merged.last().second + 1) {
+            merged.last().second = qMax(merged.last().second, range.second);
+        } else {
+            merged.append(range);
+        }
+    }
+    return merged;
+}
+
+bool RowRanges::intersects(const QVector<QPair<int, int>> &ranges, qint64 firstRow, qint64 lastRow)
+{
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), firstRow, [](const QPair<int, int> &range, qint64 row) {
+        return range.second < row;
+    });
+    return it != ranges.end() && it->first <= lastRow;
+}
@@ -0,0 +1,18 @@
+#ifndef ROWRANGES_H
+#define ROWRANGES_H
+
+#include <QPair>
+#include <QVector>
+
+// 行范围[first, last]的集合，导出和复制选中行时使用
+class RowRanges
+{
+public:
+    // 合并重叠和相邻的范围并排序，便于按行号递增顺序查找
+    static QVector<QPair<int, int>> normalize(QVector<QPair<int, int>> ranges);
+
+    // [firstRow, lastRow]与已合并排序的范围是否有交集
+    static bool intersects(const QVector<QPair<int, int>> &ranges, qint64 firstRow, qint64 lastRow);
+};
+
+#endif // ROWRANGES_H
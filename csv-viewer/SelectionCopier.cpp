@@ -0,0 +1,182 @@
+#include "SelectionCopier.h"
+#include "ColumnarFile.h"
+#include "RecordScanner.h"
+#include "RowIndex.h"
+#include "RowRanges.h"
+#include <QDebug>
+#include <QElapsedTimer>
+
+CopyTask::CopyTask(const CsvReader::ReadAheadSource &source, const QVector<QPair<int, int>> &rowRanges,
+                   const QVector<int> &columns, const QVector<ComputedColumn> &computed, QObject *parent)
+    : BackgroundTask(parent)
+    , m_source(source)
+    , m_rowRanges(rowRanges)
+    , m_columns(columns)
+    , m_computed(computed)
+    , m_neededComputed(computed.size(), false)
+{
+    const int headerCount = m_source.parse.width;
+    for (int column : m_columns) {
+        if (column >= headerCount && column - headerCount < m_neededComputed.size()) {
+            m_neededComputed[column - headerCount] = true;
+        }
+    }
+}
+
+void CopyTask::appendRows(const QList<QStringList> &rows)
+{
+    for (const QStringList &row : rows) {
+        for (int i = 0; i < m_columns.size(); ++i) {
+            if (i > 0) {
+                m_text.append(QLatin1Char('\t'));
+            }
+            // TSV没有转义规则，与导出一致，字段中的制表符和换行替换为空格
+            const QString &field = row.at(m_columns.at(i));
+            if (field.contains(QLatin1Char('\t')) || field.contains(QLatin1Char('\n')) || field.contains(QLatin1Char('\r'))) {
+                QString cleaned = field;
+                cleaned.replace(QLatin1Char('\t'), QLatin1Char(' ')).replace(QLatin1Char('\n'), QLatin1Char(' '))
+                       .replace(QLatin1Char('\r'), QLatin1Char(' '));
+                m_text.append(cleaned);
+            } else {
+                m_text.append(field);
+            }
+        }
+        m_text.append(QLatin1Char('\n'));
+    }
+    m_cells += qint64(rows.size()) * m_columns.size();
+}
+
+void CopyTask::execute()
+{
+    QElapsedTimer copyTimer;
+    copyTimer.start();
+
+    qint64 totalRows = 0;
+    for (const QPair<int, int> &range : m_rowRanges) {
+        totalRows += range.second - range.first + 1;
+    }
+
+    const char quoteChar = m_source.parse.dialect.quoteChar;
+    qint64 rowsDone = 0;
+    bool reserved = false;
+    qint64 cursorRow = -1;   // 上一批结束的位置，相邻的范围从这里继续，无需重新定位
+    qint64 cursorOffset = 0;
+
+    try {
+        for (const QPair<int, int> &range : m_rowRanges) {
+            for (qint64 first = range.first; first <= range.second; first += SelectionCopier::BATCH_ROWS) {
+                if (isCancelled()) {
+                    return;
+                }
+                const int count = static_cast<int>(qMin<qint64>(SelectionCopier::BATCH_ROWS, range.second - first + 1));
+
+                QList<QStringList> rows;
+                if (m_source.columnarFile) {
+                    rows = m_source.columnarFile->readRows(first, count, m_columns);
+                } else {
+                    // 在上一批之后不远处时直接向后跳过，否则按行索引重新定位
+                    qint64 begin = 0;
+                    if (cursorRow >= 0 && first >= cursorRow && first - cursorRow < RowIndex::STRIDE) {
+                        begin = RecordScanner::skipRecords(m_source.data, m_source.fileSize, cursorOffset, first - cursorRow, quoteChar);
+                    } else {
+                        begin = CsvReader::locateRow(m_source, first);
+                    }
+                    const qint64 end = RecordScanner::skipRecords(m_source.data, m_source.fileSize, begin, count, quoteChar);
+                    // 行按记录序号定位，解析也必须每条记录恰好得到一行
+                    rows = CsvReader::parseRecords(m_source.data + begin, end - begin, m_source.parse, begin);
+                    cursorRow = first + count;
+                    cursorOffset = end;
+                    if (m_neededComputed.contains(true)) {
+                        appendComputedValues(m_computed, m_neededComputed, rows);
+                    }
+                }
+                if (rows.isEmpty()) {
+                    break; // 超出文件末尾（总行数是估算的）
+                }
+
+                // 第一批之后按平均长度一次性分配整个输出缓冲区，之后不再重新分配
+                if (!reserved) {
+                    const qint64 before = m_text.size();
+                    appendRows(rows);
+                    const double charsPerRow = double(m_text.size() - before) / rows.size();
+                    m_text.reserve(static_cast<qsizetype>(charsPerRow * totalRows * 1.1) + 1024);
+                    reserved = true;
+                } else {
+                    appendRows(rows);
+                }
+                rowsDone += rows.size();
+                emit progress(rowsDone, totalRows);
+            }
+        }
+    } catch (const std::exception &e) {
+        m_error = QString("Error reading rows: %1").arg(e.what());
+    } catch (...) {
+        m_error = "Unknown error occurred while reading rows";
+    }
+
+    qDebug() << "Copied" << m_cells << "cells (" << m_text.size() << "chars) in" << copyTimer.elapsed() << "ms";
+    emit copied();
+}
+
+SelectionCopier::SelectionCopier(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SelectionCopier::~SelectionCopier()
+{
+    cancel();
+}
+
+void SelectionCopier::start(const CsvReader::ReadAheadSource &source, const QVector<QPair<int, int>> &rowRanges,
+                            const QVector<int> &columns, const QVector<ComputedColumn> &computed)
+{
+    cancel();
+
+    m_task = new CopyTask(source, RowRanges::normalize(rowRanges), columns, computed, this);
+    connect(m_task, &CopyTask::progress, this, &SelectionCopier::onProgress);
+    connect(m_task, &CopyTask::copied, this, &SelectionCopier::onCopied);
+    // 用户在等待复制结果，优先于行计数等长时间任务执行
+    m_task->start(1);
+}
+
+void SelectionCopier::cancel()
+{
+    if (m_task) {
+        m_task->cancel();
+        delete m_task;
+        m_task = nullptr;
+    }
+}
+
+bool SelectionCopier::isRunning() const
+{
+    return m_task != nullptr;
+}
+
+void SelectionCopier::onProgress(qint64 rowsDone, qint64 rowsTotal)
+{
+    // 忽略已取消的旧复制遗留的信号
+    if (sender() != m_task) {
+        return;
+    }
+
+    emit progress(rowsDone, rowsTotal);
+}
+
+void SelectionCopier::onCopied()
+{
+    if (sender() != m_task) {
+        return;
+    }
+
+    CopyTask *task = m_task;
+    m_task = nullptr;
+    task->cancel(); // 等待run()返回，信号在任务结束前发出
+    const QString text = task->text();
+    const qint64 cells = task->cells();
+    const QString error = task->error();
+    delete task;
+
+    emit finished(error.isEmpty(), text, cells, error);
+}
@@ -0,0 +1,84 @@
+#ifndef SELECTIONCOPIER_H
+#define SELECTIONCOPIER_H
+
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include "BackgroundTask.h"
+#include "CsvReader.h"
+#include "Expression.h"
+
+// 复制任务：按行范围从文件中成批读取选中的行，投影出选中的列，生成TSV文本
+class CopyTask : public BackgroundTask
+{
+    Q_OBJECT
+
+public:
+    // rowRanges为已合并排序的行范围[first, last]，columns为按输出顺序的原始列，
+    // 其中从表头列数开始的列号是computed中的计算列
+    CopyTask(const CsvReader::ReadAheadSource &source, const QVector<QPair<int, int>> &rowRanges,
+             const QVector<int> &columns, const QVector<ComputedColumn> &computed, QObject *parent = nullptr);
+
+    // 生成的TSV文本和单元格数（copied信号发出后有效）
+    QString text() const { return m_text; }
+    qint64 cells() const { return m_cells; }
+    QString error() const { return m_error; }
+
+signals:
+    void progress(qint64 rowsDone, qint64 rowsTotal);
+    void copied();
+
+protected:
+    void execute() override;
+
+private:
+    // 把一批行追加到输出
+    void appendRows(const QList<QStringList> &rows);
+
+    CsvReader::ReadAheadSource m_source;
+    QVector<QPair<int, int>> m_rowRanges;
+    QVector<int> m_columns;
+    QVector<ComputedColumn> m_computed;
+    QVector<bool> m_neededComputed; // 选中的计算列，其余的不计算
+    QString m_text;
+    qint64 m_cells = 0;
+    QString m_error;
+};
+
+// 选中内容复制器
+// 把表格中的选择转换为行范围和列集合，在共享线程池中直接从文件成批读取，
+// 结果写入一个预先分配好大小的缓冲区；选中几十万个单元格时可以取消
+class SelectionCopier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SelectionCopier(QObject *parent = nullptr);
+    ~SelectionCopier();
+
+    // 开始复制，之前的复制会被取消
+    void start(const CsvReader::ReadAheadSource &source, const QVector<QPair<int, int>> &rowRanges,
+               const QVector<int> &columns, const QVector<ComputedColumn> &computed = QVector<ComputedColumn>());
+
+    // 取消复制并等待任务结束
+    void cancel();
+
+    bool isRunning() const;
+
+    static constexpr int BATCH_ROWS = 4096; // 每批解析的行数，批与批之间检查取消并报告进度
+
+signals:
+    void progress(qint64 rowsDone, qint64 rowsTotal);
+    void finished(bool success, const QString &text, qint64 cells, const QString &error);
+
+private slots:
+    void onProgress(qint64 rowsDone, qint64 rowsTotal);
+    void onCopied();
+
+private:
+    CopyTask *m_task = nullptr;
+};
+
+#endif // SELECTIONCOPIER_H
@@ -1,9 +1,20 @@
 #include "TableModel.h"
-#include <QBrush>
+#include "MemoryBudget.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <limits>
 
 TableModel::TableModel(QObject *parent)
     : QAbstractTableModel(parent)
 {
+    MemoryBudget::instance()->registerModel(this);
+}
+
+TableModel::~TableModel()
+{
+    MemoryBudget::instance()->unregisterModel(this);
+    releasePages();
 }
 
 int TableModel::rowCount(const QModelIndex &parent) const
@@ -11,7 +22,7 @@ int TableModel::rowCount(const QModelIndex &parent) const
     if (parent.isValid())
         return 0;
         
-    return m_dataRows.size();
+    return m_totalRowCount;
 }
 
 int TableModel::columnCount(const QModelIndex &parent) const
@@ -19,36 +30,49 @@ int TableModel::columnCount(const QModelIndex &parent) const
     if (parent.isValid())
         return 0;
         
-    return m_headers.size();
+    return m_visibleColumns.size();
 }
 
 QVariant TableModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid())
+    // 只提供显示文本；背景色、文本颜色等角色由FastItemDelegate直接绘制，不经过模型
+    if (role != Qt::DisplayRole || !index.isValid()) {
         return QVariant();
+    }
 
-    if (role == Qt::DisplayRole) {
-        if (index.row() < m_dataRows.size() && index.column() < m_dataRows[index.row()].size()) {
-            return m_dataRows[index.row()][index.column()];
+    // 视图按行连续绘制，缓存上一次访问的页以省去逐格的哈希查找
+    const int page = index.row() / PAGE_SIZE;
+    if (page != m_cachedPageIndex) {
+        auto it = m_pages.constFind(page);
+        m_cachedPageIndex = page;
+        m_cachedPage = (it != m_pages.constEnd()) ? &it.value() : nullptr;
+        // 只在切换页时更新访问时钟，同一页内的连续访问不重复记录
+        if (m_cachedPage) {
+            m_cachedPage->lastAccess = MemoryBudget::instance()->nextTick();
         }
     }
-    // 设置单元格背景色为白色，确保所有单元格都能正常显示
-    else if (role == Qt::BackgroundRole) {
-        return QBrush(Qt::white);
+    // 所在页尚未加载时显示为空
+    if (!m_cachedPage) {
+        return QVariant();
+    }
+    const int rowInPage = index.row() - page * PAGE_SIZE;
+    if (rowInPage >= m_cachedPage->rows.size() || index.column() >= m_visibleColumns.size()) {
+        return QVariant();
     }
-    // 设置单元格文本颜色为黑色
-    else if (role == Qt::ForegroundRole) {
-        return QBrush(Qt::black);
+    // 行宽在setPage时已规整为表头列数，这里不再逐格检查
+    const int column = m_visibleColumns.at(index.column());
+    if (column < m_headers.size()) {
+        return m_cachedPage->rows.at(rowInPage).at(column);
     }
-
-    return QVariant();
+    return cellText(*m_cachedPage, rowInPage, column, m_headers.size());
 }
 
 QVariant TableModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
     if (role == Qt::DisplayRole) {
-        if (orientation == Qt::Horizontal && section < m_headers.size()) {
-            return m_headers[section];
+        if (orientation == Qt::Horizontal && section < m_visibleColumns.size()) {
+            const int column = m_visibleColumns.at(section);
+            return column < m_headers.size() ? m_headers.at(column) : m_computed.at(column - m_headers.size()).name;
         }
     }
 
@@ -59,31 +83,300 @@ void TableModel::setHeaders(const QStringList &headers)
 {
     beginResetModel();
     m_headers = headers;
+    m_computed.clear();
+    m_visibleColumns.resize(headers.size());
+    for (int i = 0; i < headers.size(); ++i) {
+        m_visibleColumns[i] = i;
+    }
     endResetModel();
 }
 
-void TableModel::addRow(const QStringList &row)
+void TableModel::setVisibleColumns(const QVector<int> &sourceColumns)
 {
-    beginInsertRows(QModelIndex(), m_dataRows.size(), m_dataRows.size());
-    m_dataRows.append(row);
-    endInsertRows();
+    beginResetModel();
+    m_visibleColumns.clear();
+    m_visibleColumns.reserve(sourceColumns.size());
+    for (int column : sourceColumns) {
+        if (column >= 0 && column < m_headers.size() + m_computed.size()) {
+            m_visibleColumns.append(column);
+        }
+    }
+    endResetModel();
+
+    // 新显示的计算列在视口内立即计算
+    computeViewport();
 }
 
-// 批量添加数据行 - 优化性能
-void TableModel::addRows(const QList<QStringList> &rows)
+int TableModel::sourceColumn(int column) const
 {
-    if (rows.isEmpty())
-        return;
-        
-    beginInsertRows(QModelIndex(), m_dataRows.size(), m_dataRows.size() + rows.size() - 1);
-    m_dataRows.append(rows);
-    endInsertRows();
+    return (column >= 0 && column < m_visibleColumns.size()) ? m_visibleColumns.at(column) : -1;
+}
+
+void TableModel::setComputedColumns(const QVector<ComputedColumn> &computed)
+{
+    beginResetModel();
+    invalidatePageCache();
+    m_computed = computed;
+
+    // 表达式可能已经改变，丢弃所有页中已计算的值
+    const int limit = m_headers.size() + m_computed.size();
+    m_visibleColumns.erase(std::remove_if(m_visibleColumns.begin(), m_visibleColumns.end(),
+                                          [limit](int column) { return column >= limit; }),
+                           m_visibleColumns.end());
+    qint64 released = 0;
+    for (Page &page : m_pages) {
+        if (page.computed.isEmpty()) {
+            continue;
+        }
+        const qint64 bytes = MemoryBudget::measureRows(page.computed);
+        page.computed.clear();
+        page.bytes -= bytes;
+        released += bytes;
+    }
+    if (released > 0) {
+        MemoryBudget::instance()->pageRemoved(released);
+    }
+    endResetModel();
+
+    computeViewport();
+}
+
+void TableModel::setTotalRowCount(int rows)
+{
+    const int oldRowCount = m_totalRowCount;
+    const int newRowCount = qMax(rows, 0);
+    
+    if (newRowCount > oldRowCount) {
+        beginInsertRows(QModelIndex(), oldRowCount, newRowCount - 1);
+        m_totalRowCount = newRowCount;
+        endInsertRows();
+    } else if (newRowCount < oldRowCount) {
+        beginRemoveRows(QModelIndex(), newRowCount, oldRowCount - 1);
+        m_totalRowCount = newRowCount;
+        endRemoveRows();
+    }
+}
+
+// 按页设置数据 - 只通知该页范围内的变化
+void TableModel::setPage(int page, const QList<QStringList> &rows)
+{
+    invalidatePageCache();
+
+    Page entry;
+    entry.rows = rows;
+    // 解析时已经规整过行宽，这里只逐行确认，保证data()可以不做边界检查
+    const int width = m_headers.size();
+    for (QStringList &row : entry.rows) {
+        if (row.size() != width) {
+            row.resize(width);
+        }
+    }
+    entry.bytes = MemoryBudget::measureRows(entry.rows);
+    // 视口内的页立即计算可见的计算列，其余的页滚动到视口时再计算
+    if (page >= m_viewportFirstPage && page <= m_viewportLastPage) {
+        entry.bytes += computePage(entry);
+    }
+    entry.lastAccess = MemoryBudget::instance()->nextTick();
+
+    auto it = m_pages.find(page);
+    if (it != m_pages.end()) {
+        MemoryBudget::instance()->pageRemoved(it->bytes);
+        *it = entry;
+    } else {
+        m_pages.insert(page, entry);
+    }
+    // 超出预算时可能淘汰其他页（包括其他文件的页）
+    MemoryBudget::instance()->pageAdded(entry.bytes);
+    
+    const int firstRow = page * PAGE_SIZE;
+    const int lastRow = qMin(firstRow + PAGE_SIZE, m_totalRowCount) - 1;
+    if (firstRow <= lastRow && !m_visibleColumns.isEmpty()) {
+        emit dataChanged(index(firstRow, 0), index(lastRow, m_visibleColumns.size() - 1), {Qt::DisplayRole});
+    }
+}
+
+bool TableModel::isPageLoaded(int page) const
+{
+    return m_pages.contains(page);
+}
+
+QList<QStringList> TableModel::loadedRows(int firstRow, int count, const QVector<int> &columns) const
+{
+    QList<QStringList> rows;
+    const int lastRow = qMin(firstRow + count, m_totalRowCount) - 1;
+    for (int row = qMax(firstRow, 0); row <= lastRow; ++row) {
+        auto it = m_pages.constFind(row / PAGE_SIZE);
+        if (it == m_pages.constEnd() || row % PAGE_SIZE >= it->rows.size()) {
+            break;
+        }
+        QStringList values;
+        values.reserve(columns.size());
+        for (int column : columns) {
+            values.append(cellText(*it, row % PAGE_SIZE, m_visibleColumns.at(column), m_headers.size()));
+        }
+        rows.append(values);
+    }
+    return rows;
+}
+
+void TableModel::clearPages()
+{
+    releasePages();
+    if (m_totalRowCount > 0 && !m_visibleColumns.isEmpty()) {
+        emit dataChanged(index(0, 0), index(m_totalRowCount - 1, m_visibleColumns.size() - 1), {Qt::DisplayRole});
+    }
 }
 
 void TableModel::clear()
 {
     beginResetModel();
+    invalidatePageCache();
     m_headers.clear();
-    m_dataRows.clear();
+    m_visibleColumns.clear();
+    m_computed.clear();
+    releasePages();
+    m_totalRowCount = 0;
+    m_viewportFirstPage = -1;
+    m_viewportLastPage = -1;
     endResetModel();
-}
\ No newline at end of file
+}
+
+void TableModel::invalidatePageCache()
+{
+    // 插入或删除页可能导致哈希表重新分配，缓存的指针随之失效
+    m_cachedPageIndex = -1;
+    m_cachedPage = nullptr;
+}
+
+void TableModel::setViewport(int firstRow, int lastRow)
+{
+    if (firstRow < 0 || lastRow < firstRow) {
+        m_viewportFirstPage = -1;
+        m_viewportLastPage = -1;
+        return;
+    }
+    m_viewportFirstPage = firstRow / PAGE_SIZE;
+    m_viewportLastPage = lastRow / PAGE_SIZE;
+    computeViewport();
+}
+
+qint64 TableModel::computePage(Page &page) const
+{
+    if (m_computed.isEmpty() || page.rows.isEmpty()) {
+        return 0;
+    }
+
+    const int headerCount = m_headers.size();
+    qint64 added = 0;
+    for (int column : m_visibleColumns) {
+        const int k = column - headerCount;
+        if (k < 0) {
+            continue;
+        }
+        if (page.computed.size() < m_computed.size()) {
+            page.computed.resize(m_computed.size());
+        }
+        if (page.computed.at(k).size() == page.rows.size()) {
+            continue;
+        }
+        // 按批计算整页，结果只保存显示文本
+        page.computed[k] = m_computed.at(k).expression->evaluateText(page.rows);
+        added += MemoryBudget::measureRows({page.computed.at(k)});
+    }
+    return added;
+}
+
+void TableModel::computeViewport()
+{
+    if (m_computed.isEmpty() || m_viewportFirstPage < 0) {
+        return;
+    }
+
+    QElapsedTimer computeTimer;
+    computeTimer.start();
+
+    qint64 added = 0;
+    int pagesComputed = 0;
+    for (int page = m_viewportFirstPage; page <= m_viewportLastPage; ++page) {
+        auto it = m_pages.find(page);
+        if (it == m_pages.end()) {
+            continue;
+        }
+        const qint64 bytes = computePage(*it);
+        if (bytes == 0) {
+            continue;
+        }
+        it->bytes += bytes;
+        added += bytes;
+        ++pagesComputed;
+
+        const int firstRow = page * PAGE_SIZE;
+        const int lastRow = qMin(firstRow + PAGE_SIZE, m_totalRowCount) - 1;
+        if (firstRow <= lastRow && !m_visibleColumns.isEmpty()) {
+            emit dataChanged(index(firstRow, 0), index(lastRow, m_visibleColumns.size() - 1), {Qt::DisplayRole});
+        }
+    }
+    // 计算完所有页后再计入预算，淘汰不会在遍历页的过程中发生
+    if (added > 0) {
+        MemoryBudget::instance()->pageAdded(added);
+        qDebug() << "Computed columns for" << pagesComputed << "pages in" << computeTimer.elapsed() << "ms";
+    }
+}
+
+QString TableModel::cellText(const Page &page, int rowInPage, int sourceColumn, int headerCount)
+{
+    if (sourceColumn < headerCount) {
+        return page.rows.at(rowInPage).at(sourceColumn);
+    }
+    // 尚未计算的计算列显示为空
+    return page.computed.value(sourceColumn - headerCount).value(rowInPage);
+}
+
+QVector<TableModel::PageUsage> TableModel::pageUsage() const
+{
+    QVector<PageUsage> usage;
+    usage.reserve(m_pages.size());
+    for (auto it = m_pages.constBegin(); it != m_pages.constEnd(); ++it) {
+        const int page = it.key();
+        int distance = std::numeric_limits<int>::max();
+        if (m_viewportFirstPage >= 0) {
+            distance = page < m_viewportFirstPage ? m_viewportFirstPage - page
+                     : page > m_viewportLastPage ? page - m_viewportLastPage : 0;
+        }
+        usage.append({page, distance, it->lastAccess});
+    }
+    return usage;
+}
+
+void TableModel::evictPage(int page)
+{
+    auto it = m_pages.find(page);
+    if (it == m_pages.end()) {
+        return;
+    }
+
+    invalidatePageCache();
+    const qint64 bytes = it->bytes;
+    m_pages.erase(it);
+    MemoryBudget::instance()->pageRemoved(bytes);
+
+    const int firstRow = page * PAGE_SIZE;
+    const int lastRow = qMin(firstRow + PAGE_SIZE, m_totalRowCount) - 1;
+    if (firstRow <= lastRow && !m_visibleColumns.isEmpty()) {
+        emit dataChanged(index(firstRow, 0), index(lastRow, m_visibleColumns.size() - 1), {Qt::DisplayRole});
+    }
+    emit pageEvicted(page);
+}
+
+void TableModel::releasePages()
+{
+    invalidatePageCache();
+    qint64 bytes = 0;
+    for (const Page &page : std::as_const(m_pages)) {
+        bytes += page.bytes;
+    }
+    m_pages.clear();
+    if (bytes > 0) {
+        MemoryBudget::instance()->pageRemoved(bytes);
+    }
+}
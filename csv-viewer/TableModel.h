@@ -2,16 +2,23 @@
 #define TABLEMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QList>
 #include <QStringList>
 #include <QVector>
 
+#include "Expression.h"
+
 class TableModel : public QAbstractTableModel
 {
     Q_OBJECT
 
 public:
     explicit TableModel(QObject *parent = nullptr);
+    ~TableModel();
+
+    // 每页的行数，数据按页加载，可以只加载文件中任意位置的一段
+    static constexpr int PAGE_SIZE = 1000;
 
     // 基本的模型接口实现
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
@@ -20,14 +27,74 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
     // 设置数据
-    void setHeaders(const QStringList &headers);
-    void addRow(const QStringList &row);
-    void addRows(const QList<QStringList> &rows); // 批量添加数据行，优化性能
+    void setHeaders(const QStringList &headers); // 设置表头，默认显示所有列
+    
+    // 列投影：视图只显示这些原始列，一次模型重置完成所有列的显示/隐藏
+    void setVisibleColumns(const QVector<int> &sourceColumns);
+    int sourceColumn(int column) const; // 视图列对应的原始列
+
+    // 计算列：原始列号从表头列数开始依次编号，可以和文件中的列一样投影显示；
+    // 只为视口内已加载的页计算可见的计算列，设置后已计算的值全部作废
+    void setComputedColumns(const QVector<ComputedColumn> &computed);
+
+    void setTotalRowCount(int rows); // 设置（估算的）总行数，使滚动条反映整个文件
+    void setPage(int page, const QList<QStringList> &rows); // 设置一页数据，未加载的页显示为空
+    bool isPageLoaded(int page) const;
+    // 从firstRow开始最多count行中指定视图列的文本，遇到未加载的页时截止
+    QList<QStringList> loadedRows(int firstRow, int count, const QVector<int> &columns) const;
+    void clearPages(); // 丢弃已加载的页，保留表头和行数
     void clear();
 
+    // 视口所在的行，内存预算按离视口的距离淘汰页；firstRow为-1表示没有视口
+    void setViewport(int firstRow, int lastRow);
+
+    // 供全局内存预算统计和淘汰页使用
+    struct PageUsage {
+        int page;
+        int distance;       // 离视口的页数，0表示在视口内，没有视口时为INT_MAX
+        quint64 lastAccess;
+    };
+    QVector<PageUsage> pageUsage() const;
+    void evictPage(int page);
+
+signals:
+    // 页因内存预算被淘汰，视图需要时应重新加载
+    void pageEvicted(int page);
+
 private:
+    struct Page {
+        QList<QStringList> rows;
+        QList<QStringList> computed;    // 第k个计算列在本页各行的值，尚未计算时为空
+        qint64 bytes = 0;               // 实际占用的内存
+        mutable quint64 lastAccess = 0; // 最近一次访问时的全局时钟
+    };
+
+    // 释放所有页并从全局预算中扣除
+    void releasePages();
+
+    // 页数据变化时清除data()中缓存的页
+    void invalidatePageCache();
+
+    // 计算页中尚未计算的可见计算列，返回新增占用的字节数（由调用方计入预算）
+    qint64 computePage(Page &page) const;
+
+    // 为视口内已加载的页补算可见的计算列
+    void computeViewport();
+
+    // 原始列的文本，计算列从页的计算结果中读取
+    static QString cellText(const Page &page, int rowInPage, int sourceColumn, int headerCount);
+
     QStringList m_headers;
-    QList<QStringList> m_dataRows;
+    QVector<int> m_visibleColumns; // 视图列 -> 原始列
+    QVector<ComputedColumn> m_computed;
+    QHash<int, Page> m_pages; // 页号 -> 该页的数据行
+    int m_totalRowCount = 0; // 估算的总行数
+    int m_viewportFirstPage = -1; // 视口所在的页范围
+    int m_viewportLastPage = -1;
+
+    // data()最近访问的页，连续绘制同一页的单元格时免去哈希查找
+    mutable int m_cachedPageIndex = -1;
+    mutable const Page *m_cachedPage = nullptr;
 };
 
-#endif // TABLEMODEL_H
\ No newline at end of file
+#endif // TABLEMODEL_H
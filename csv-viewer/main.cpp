@@ -1,13 +1,63 @@
-
 #include "mainwindow.h"
+#include "FilePrefetch.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
 
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
     QApplication a(argc, argv);
+
+    // 命令行: csv-viewer [file.csv] [--columns a,b,c] [--row N]
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QObject::tr("CSV文件查看器"));
+    parser.addHelpOption();
+    parser.addPositionalArgument("file", QObject::tr("要打开的CSV文件"), "[file]");
+    QCommandLineOption columnsOption(QStringList{"c", "columns"}, QObject::tr("只显示这些列（逗号分隔的列名）"), "columns");
+    QCommandLineOption rowOption(QStringList{"r", "row"}, QObject::tr("打开后跳转到第N行（从1开始）"), "N");
+    parser.addOption(columnsOption);
+    parser.addOption(rowOption);
+    parser.process(a);
+
+    const QStringList positional = parser.positionalArguments();
+    const QString filePath = positional.value(0);
+
+    // 构造主窗口的同时在后台把文件开头读入页缓存
+    FilePrefetchTask prefetch(filePath);
+    if (!filePath.isEmpty()) {
+        prefetch.start(2);
+    }
+
     MainWindow w;
     w.show();
+
+    // 窗口显示后、第一次绘制前加载文件，事件循环开始时第一帧就包含数据
+    if (!filePath.isEmpty()) {
+        QStringList columns;
+        if (parser.isSet(columnsOption)) {
+            for (const QString &name : parser.value(columnsOption).split(',', Qt::SkipEmptyParts)) {
+                columns.append(name.trimmed());
+            }
+        }
+        int row = 0;
+        if (parser.isSet(rowOption)) {
+            bool ok = false;
+            row = parser.value(rowOption).toInt(&ok);
+            if (!ok || row < 1) {
+                qWarning() << "Invalid row number:" << parser.value(rowOption);
+                row = 0;
+            }
+        }
+        w.openFromCommandLine(filePath, columns, row);
+        prefetch.cancel();
+        qDebug() << "Startup to first data:" << startupTimer.elapsed() << "ms";
+    }
+
     return a.exec();
 }
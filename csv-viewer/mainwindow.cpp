@@ -1,7 +1,10 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
-#include "TableModel.h"
-#include "CsvReader.h"
+#include "CsvDocument.h"
+#include "ColumnListModel.h"
+#include "AggregationWindow.h"
+#include "DiffWindow.h"
+#include "MemoryBudget.h"
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QDir>
@@ -12,54 +15,70 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
-#include <QCheckBox>
 #include <QLineEdit>
+#include <QListView>
+#include <QSortFilterProxyModel>
+#include <QInputDialog>
+#include <QTabWidget>
+#include <QProgressDialog>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QListWidget>
+#include <QGridLayout>
+#include <QLabel>
+#include <QClipboard>
+#include <QGuiApplication>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , m_tableModel(new TableModel(this))
-    , m_csvReader(new CsvReader(this))
-    , m_currentFilePath(QString())
-    , m_isFiltered(false)
+    , m_columnProxyModel(new QSortFilterProxyModel(this))
 {
     ui->setupUi(this);
     
-    // 设置表格模型
-    ui->tableView->setModel(m_tableModel);
+    // 每个打开的文件占一个标签页，关闭标签页时释放该文件的所有数据
+    ui->tabWidget->setTabsClosable(true);
+    ui->tabWidget->setMovable(true);
+    ui->tabWidget->setDocumentMode(true);
+    connect(ui->tabWidget, &QTabWidget::tabCloseRequested, this, &MainWindow::closeDocument);
+    connect(ui->tabWidget, &QTabWidget::currentChanged, this, &MainWindow::onCurrentTabChanged);
     
-    // 连接表格视图的垂直滚动条信号，实现滚动到底部时加载更多数据
-    connect(ui->tableView->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
-        QScrollBar *scrollBar = ui->tableView->verticalScrollBar();
-        if (scrollBar && scrollBar->value() == scrollBar->maximum()) {
-            // 当滚动到最底部时，加载更多数据
-            loadMoreRows();
-        }
+    // 标签页可以拖动排序，文档列表与标签页顺序保持一致
+    connect(ui->tabWidget->tabBar(), &QTabBar::tabMoved, this, [this](int from, int to) {
+        m_documents.move(from, to);
     });
     
-    // 表格视图性能优化设置
-    ui->tableView->setSortingEnabled(false); // 禁用排序，需要时再启用
-    ui->tableView->setSelectionMode(QAbstractItemView::ExtendedSelection); // 设置选择模式
-    ui->tableView->setEditTriggers(QAbstractItemView::NoEditTriggers); // 禁用编辑
-    ui->tableView->setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel); // 像素滚动
-    ui->tableView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel); // 像素滚动
-    ui->tableView->setAttribute(Qt::WA_AlwaysShowToolTips);
-
-    
-    // 设置表格字体为支持中文的字体
-    QFont font = ui->tableView->font();
-    font.setFamily(QStringLiteral("SimHei")); // 黑体
-    ui->tableView->setFont(font);
-    
     // 连接菜单项到打开文件槽函数
     connect(ui->actionOpen, &QAction::triggered, this, &MainWindow::openFile);
+    connect(ui->actionExport, &QAction::triggered, this, &MainWindow::exportView);
     
     // 连接筛选按钮到槽函数
     connect(ui->filterButton, &QPushButton::clicked, this, &MainWindow::applyFilter);
     
+    // 创建筛选面板控件
+    createFilterPanel();
+    
     // 创建编码选择菜单
     createEncodingMenu();
     
+    // 创建编辑菜单
+    createEditMenu();
+    
+    // 创建CSV格式菜单
+    createFormatMenu();
+    
+    // 创建分析菜单
+    createAnalysisMenu();
+    
+    // 状态栏右侧显示页缓存的实际内存占用和上限
+    createMemoryIndicator();
+    
+    // 创建导航菜单
+    createNavigationMenu();
+    
     // 连接视图菜单中显示筛选面板的动作
     connect(ui->actionShowFilterPanel, &QAction::triggered, this, &MainWindow::toggleFilterPanel);
     
@@ -72,26 +91,207 @@ MainWindow::MainWindow(QWidget *parent)
     ui->actionShowFilterPanel->setChecked(true);
     ui->filterDockWidget->show();
     
-    // 初始隐藏表格数据，直到用户点击筛选按钮
-    ui->tableView->setVisible(false);
     statusBar()->showMessage(tr("请打开CSV文件，然后使用左侧面板筛选列"));
 }
 
 MainWindow::~MainWindow()
 {
+    // 先释放所有文档（停止各自的后台任务），再销毁界面；
+    // 释放过程中标签页依次移除，不再响应切换信号
+    disconnect(ui->tabWidget, nullptr, this, nullptr);
+    qDeleteAll(m_documents);
+    m_documents.clear();
     delete ui;
 }
 
+void MainWindow::openFromCommandLine(const QString &filePath, const QStringList &columns, int row)
+{
+    QElapsedTimer openTimer;
+    openTimer.start();
+    
+    loadCsvFile(filePath);
+    CsvDocument *document = currentDocument();
+    if (!document || document->filePath() != QFileInfo(filePath).absoluteFilePath()) {
+        return;
+    }
+    
+    // 按列名勾选要显示的列，一个都找不到时显示所有列
+    QStringList missing;
+    if (!columns.isEmpty()) {
+        missing = document->columnListModel()->setCheckedColumns(columns);
+        if (missing.size() == columns.size()) {
+            document->columnListModel()->setAllChecked(true);
+        }
+    }
+    
+    // 不等用户点击筛选，直接显示表格，窗口第一次绘制时就有数据
+    document->applyFilter();
+    if (row > 0) {
+        document->jumpToRow(row - 1);
+    }
+    if (!missing.isEmpty()) {
+        statusBar()->showMessage(tr("找不到列: %1").arg(missing.join(", ")));
+    }
+    
+    qDebug() << "Opened file from command line in" << openTimer.elapsed() << "ms";
+}
+
 void MainWindow::openFile()
 {
     QString fileName = QFileDialog::getOpenFileName(this,
-        tr("Open CSV File"), "", tr("CSV Files (*.csv)"));
+        tr("Open CSV File"), "", tr("CSV Files (*.csv *.csv.gz *.csv.zst);;Columnar Files (*.csvc);;All Files (*)"));
     
     if (!fileName.isEmpty()) {
         loadCsvFile(fileName);
     }
 }
 
+void MainWindow::exportView()
+{
+    CsvDocument *document = currentDocument();
+    if (!document || !document->isFiltered()) {
+        QMessageBox::information(this, tr("提示"), tr("请先打开文件并筛选要显示的列"));
+        return;
+    }
+    
+    if (document->reader()->isColumnar() || document->reader()->isCompressed()) {
+        QMessageBox::information(this, tr("提示"), tr("列式文件和压缩文件不支持导出，请打开未压缩的CSV文件"));
+        return;
+    }
+    
+    if (document->hasRowFilter()) {
+        QMessageBox::information(this, tr("提示"), tr("按值筛选时不支持导出，请先取消按值筛选"));
+        return;
+    }
+    
+    if (document->exporter()->isRunning()) {
+        QMessageBox::information(this, tr("提示"), tr("该文件正在导出，请等待完成"));
+        return;
+    }
+    
+    QString selectedFilter;
+    const QString defaultName = QFileInfo(document->filePath()).completeBaseName() + "_export.csv";
+    const QString outputPath = QFileDialog::getSaveFileName(this, tr("导出"),
+        QFileInfo(document->filePath()).dir().filePath(defaultName),
+        tr("CSV Files (*.csv);;TSV Files (*.tsv *.txt);;Columnar Files (*.csvc)"), &selectedFilter);
+    if (outputPath.isEmpty()) {
+        return;
+    }
+    
+    if (QFileInfo(outputPath).absoluteFilePath() == document->filePath()) {
+        QMessageBox::critical(this, tr("Error"), tr("不能导出到正在查看的源文件"));
+        return;
+    }
+    
+    // 列式文件重新打开时无需解析，适合反复查看的大文件
+    ExportOptions::Format format = ExportOptions::Csv;
+    if (selectedFilter.startsWith("Columnar") || outputPath.endsWith(".csvc", Qt::CaseInsensitive)) {
+        format = ExportOptions::Columnar;
+    } else if (selectedFilter.startsWith("TSV") || outputPath.endsWith(".tsv", Qt::CaseInsensitive)) {
+        format = ExportOptions::Tsv;
+    }
+    
+    // 有选中的行时询问是否只导出选中的行
+    bool selectedRowsOnly = false;
+    if (document->hasRowSelection()) {
+        selectedRowsOnly = QMessageBox::question(this, tr("导出"), tr("只导出选中的行？\n选择“否”导出全部行。"))
+            == QMessageBox::Yes;
+    }
+    
+    if (!document->startExport(outputPath, format, selectedRowsOnly)) {
+        return;
+    }
+    
+    // 进度以千分比显示，对话框关闭时连接随之断开
+    CsvExporter *exporter = document->exporter();
+    QProgressDialog *progressDialog = new QProgressDialog(tr("正在导出 %1 ...").arg(QFileInfo(outputPath).fileName()),
+                                                          tr("取消"), 0, 1000, this);
+    progressDialog->setAttribute(Qt::WA_DeleteOnClose);
+    progressDialog->setMinimumDuration(500);
+    progressDialog->setAutoClose(false);
+    progressDialog->setAutoReset(false);
+    
+    connect(exporter, &CsvExporter::progress, progressDialog, [progressDialog](qint64 done, qint64 total) {
+        progressDialog->setValue(total > 0 ? static_cast<int>(done * 1000 / total) : 0);
+    });
+    connect(exporter, &CsvExporter::finished, progressDialog, [this, progressDialog, outputPath](bool success, qint64 rows, const QString &error) {
+        progressDialog->close();
+        if (success) {
+            statusBar()->showMessage(tr("已导出 %1 行到 %2").arg(rows).arg(outputPath));
+        } else {
+            QMessageBox::critical(this, tr("Error"), error);
+        }
+    });
+    connect(progressDialog, &QProgressDialog::canceled, exporter, [this, exporter, progressDialog]() {
+        exporter->cancel();
+        progressDialog->close();
+        statusBar()->showMessage(tr("导出已取消"));
+    });
+    // 导出过程中关闭了标签页
+    connect(exporter, &QObject::destroyed, progressDialog, &QWidget::close);
+}
+
+void MainWindow::createEditMenu()
+{
+    QMenu *editMenu = new QMenu(tr("编辑"), this);
+    ui->menubar->addMenu(editMenu);
+    
+    QAction *copyAction = editMenu->addAction(tr("复制选中内容"));
+    copyAction->setShortcut(QKeySequence::Copy);
+    connect(copyAction, &QAction::triggered, this, &MainWindow::copySelection);
+}
+
+void MainWindow::copySelection()
+{
+    CsvDocument *document = currentDocument();
+    if (!document || !document->isFiltered() || !document->hasRowSelection()) {
+        statusBar()->showMessage(tr("请先在表格中选择要复制的单元格"));
+        return;
+    }
+    
+    if (document->reader()->isCompressed()) {
+        QMessageBox::information(this, tr("提示"), tr("压缩文件不支持复制选中内容，请打开未压缩的CSV文件"));
+        return;
+    }
+    
+    if (document->hasRowFilter()) {
+        QMessageBox::information(this, tr("提示"), tr("按值筛选时不支持复制选中内容，请先取消按值筛选"));
+        return;
+    }
+    
+    if (!document->startCopySelection()) {
+        return;
+    }
+    
+    // 选中范围很大时显示进度并可以取消，对话框关闭时连接随之断开
+    SelectionCopier *copier = document->copier();
+    QProgressDialog *progressDialog = new QProgressDialog(tr("正在复制选中内容 ..."), tr("取消"), 0, 1000, this);
+    progressDialog->setAttribute(Qt::WA_DeleteOnClose);
+    progressDialog->setMinimumDuration(500);
+    progressDialog->setAutoClose(false);
+    progressDialog->setAutoReset(false);
+    
+    connect(copier, &SelectionCopier::progress, progressDialog, [progressDialog](qint64 done, qint64 total) {
+        progressDialog->setValue(total > 0 ? static_cast<int>(done * 1000 / total) : 0);
+    });
+    connect(copier, &SelectionCopier::finished, progressDialog, [this, progressDialog](bool success, const QString &text, qint64 cells, const QString &error) {
+        progressDialog->close();
+        if (success) {
+            QGuiApplication::clipboard()->setText(text);
+            statusBar()->showMessage(tr("已复制 %1 个单元格").arg(cells));
+        } else {
+            QMessageBox::critical(this, tr("Error"), error);
+        }
+    });
+    connect(progressDialog, &QProgressDialog::canceled, copier, [this, copier, progressDialog]() {
+        copier->cancel();
+        progressDialog->close();
+        statusBar()->showMessage(tr("复制已取消"));
+    });
+    // 复制过程中关闭了标签页
+    connect(copier, &QObject::destroyed, progressDialog, &QWidget::close);
+}
+
 void MainWindow::createEncodingMenu()
 {
     // 创建编码菜单
@@ -120,30 +320,484 @@ void MainWindow::createEncodingMenu()
     
     // 连接编码选择信号
     connect(utf8Action, &QAction::triggered, this, [this]() {
-        m_csvReader->setEncoding(CsvReader::UTF8);
+        m_encoding = CsvReader::UTF8;
         qDebug() << "Encoding set to UTF-8";
         reloadCurrentFileIfNeeded();
     });
     
     connect(gbkAction, &QAction::triggered, this, [this]() {
-        m_csvReader->setEncoding(CsvReader::GBK);
+        m_encoding = CsvReader::GBK;
         qDebug() << "Encoding set to GBK";
         reloadCurrentFileIfNeeded();
     });
     
     connect(autoDetectAction, &QAction::triggered, this, [this]() {
-        m_csvReader->setEncoding(CsvReader::AutoDetect);
+        m_encoding = CsvReader::AutoDetect;
         qDebug() << "Encoding set to AutoDetect";
         reloadCurrentFileIfNeeded();
     });
 }
 
+void MainWindow::createFormatMenu()
+{
+    QMenu *formatMenu = new QMenu(tr("格式"), this);
+    ui->menubar->addMenu(formatMenu);
+    
+    QAction *formatAction = formatMenu->addAction(tr("CSV格式..."));
+    connect(formatAction, &QAction::triggered, this, &MainWindow::editCsvFormat);
+    
+    // 容错解析：格式错误的行只登记不中止加载；关闭后任何解析错误都会报错
+    QAction *tolerantAction = formatMenu->addAction(tr("容错解析"));
+    tolerantAction->setCheckable(true);
+    tolerantAction->setChecked(m_tolerantParsing);
+    connect(tolerantAction, &QAction::toggled, this, [this](bool checked) {
+        m_tolerantParsing = checked;
+        qDebug() << "Tolerant parsing" << (checked ? "enabled" : "disabled");
+        if (CsvDocument *document = currentDocument()) {
+            document->reader()->setTolerant(checked);
+            reloadDocument(document, document->reader()->getEncoding());
+        }
+    });
+}
+
+void MainWindow::createMemoryIndicator()
+{
+    m_memoryLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_memoryLabel);
+    
+    MemoryBudget *budget = MemoryBudget::instance();
+    auto updateLabel = [this](qint64 usedBytes, qint64 budgetBytes) {
+        // 每加载一页都会通知，只在显示的数值变化时更新文本
+        const QString text = tr("内存: %1 / %2 MB").arg(usedBytes / (1024 * 1024)).arg(budgetBytes / (1024 * 1024));
+        if (m_memoryLabel->text() != text) {
+            m_memoryLabel->setText(text);
+        }
+    };
+    updateLabel(budget->usedBytes(), budget->budget());
+    connect(budget, &MemoryBudget::usageChanged, m_memoryLabel, updateLabel);
+    
+    QAction *budgetAction = ui->menuView->addAction(tr("内存上限..."));
+    connect(budgetAction, &QAction::triggered, this, &MainWindow::setMemoryBudget);
+}
+
+void MainWindow::setMemoryBudget()
+{
+    MemoryBudget *budget = MemoryBudget::instance();
+    bool ok = false;
+    const int budgetMB = QInputDialog::getInt(this, tr("内存上限"),
+        tr("所有文件的页缓存共用的内存上限 (MB)，超出时淘汰离视口最远的数据:"),
+        static_cast<int>(budget->budget() / (1024 * 1024)), static_cast<int>(MemoryBudget::MIN_BUDGET / (1024 * 1024)),
+        1024 * 1024, 64, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    budget->setBudget(qint64(budgetMB) * 1024 * 1024);
+    budget->saveBudget();
+    statusBar()->showMessage(tr("内存上限已设置为 %1 MB").arg(budgetMB));
+}
+
+void MainWindow::createAnalysisMenu()
+{
+    QMenu *analysisMenu = new QMenu(tr("分析"), this);
+    ui->menubar->addMenu(analysisMenu);
+    
+    QAction *groupByAction = analysisMenu->addAction(tr("分组汇总..."));
+    connect(groupByAction, &QAction::triggered, this, &MainWindow::groupBy);
+    
+    QAction *compareAction = analysisMenu->addAction(tr("比较文件..."));
+    connect(compareAction, &QAction::triggered, this, &MainWindow::compareFiles);
+    
+    analysisMenu->addSeparator();
+    
+    QAction *computedAction = analysisMenu->addAction(tr("添加计算列..."));
+    connect(computedAction, &QAction::triggered, this, &MainWindow::addComputedColumn);
+    
+    QAction *computedFilterAction = analysisMenu->addAction(tr("按计算列筛选行..."));
+    connect(computedFilterAction, &QAction::triggered, this, &MainWindow::filterByComputedColumn);
+}
+
+void MainWindow::addComputedColumn()
+{
+    CsvDocument *document = currentDocument();
+    if (!document) {
+        QMessageBox::information(this, tr("提示"), tr("请先打开CSV文件"));
+        return;
+    }
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("添加计算列"));
+    QFormLayout *layout = new QFormLayout(&dialog);
+    
+    QLineEdit *nameEdit = new QLineEdit(tr("计算列%1").arg(document->computedColumns().size() + 1), &dialog);
+    QLineEdit *expressionEdit = new QLineEdit(&dialog);
+    expressionEdit->setPlaceholderText(tr("例如 price * qty、substr(date, 0, 7)、latency_ms > 500"));
+    expressionEdit->setMinimumWidth(400);
+    layout->addRow(tr("列名:"), nameEdit);
+    layout->addRow(tr("表达式:"), expressionEdit);
+    
+    QLabel *helpLabel = new QLabel(tr("列名含空格等字符时写作 [列名]，字符串用单引号或双引号。\n"
+                                      "运算: + - * / %  = != < <= > >=  and or not\n"
+                                      "函数: substr(s, 开始[, 长度]) length upper lower trim concat contains\n"
+                                      "      abs round(x[, 小数位]) floor ceil if(条件, 值1, 值2)"), &dialog);
+    layout->addRow(helpLabel);
+    
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addRow(buttons);
+    
+    // 表达式有错误时提示后保留输入，修改后可以再次确定
+    while (dialog.exec() == QDialog::Accepted) {
+        QString error;
+        if (document->addComputedColumn(nameEdit->text(), expressionEdit->text(), &error)) {
+            return;
+        }
+        QMessageBox::warning(this, tr("添加计算列"), error);
+    }
+}
+
+void MainWindow::filterByComputedColumn()
+{
+    CsvDocument *document = currentDocument();
+    if (!document) {
+        QMessageBox::information(this, tr("提示"), tr("请先打开CSV文件"));
+        return;
+    }
+    
+    // 只列出结果为布尔值的计算列（条件表达式）
+    const QVector<ComputedColumn> computed = document->computedColumns();
+    QStringList names;
+    QVector<int> indexes;
+    for (int k = 0; k < computed.size(); ++k) {
+        if (computed.at(k).expression->type() == ValueVector::Bool) {
+            names.append(QString("%1 (%2)").arg(computed.at(k).name, computed.at(k).expression->text()));
+            indexes.append(k);
+        }
+    }
+    if (names.isEmpty()) {
+        QMessageBox::information(this, tr("提示"), tr("请先添加条件计算列，例如 latency_ms > 500"));
+        return;
+    }
+    
+    bool ok = false;
+    const QString name = QInputDialog::getItem(this, tr("按计算列筛选行"), tr("只显示条件为真的行:"), names, 0, false, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    // 筛选的是行，需要先筛选出要显示的列
+    if (!document->isFiltered()) {
+        document->applyFilter();
+    }
+    if (!document->filterByComputedColumn(indexes.at(names.indexOf(name)))) {
+        QMessageBox::information(this, tr("提示"), tr("压缩文件和列式文件不支持按计算列筛选行"));
+    }
+}
+
+void MainWindow::groupBy()
+{
+    CsvDocument *document = currentDocument();
+    if (!document) {
+        QMessageBox::information(this, tr("提示"), tr("请先打开CSV文件"));
+        return;
+    }
+    
+    AggregateSource source;
+    if (!document->aggregateSource(&source)) {
+        QMessageBox::information(this, tr("提示"), tr("压缩文件不支持分组汇总，请打开未压缩的CSV文件或列式文件"));
+        return;
+    }
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("分组汇总"));
+    QGridLayout *layout = new QGridLayout(&dialog);
+    
+    // 分组列和汇总列都用可勾选的列表，列很多时也能浏览
+    auto makeColumnList = [&dialog, &source]() {
+        QListWidget *list = new QListWidget(&dialog);
+        for (const QString &header : source.headers) {
+            QListWidgetItem *item = new QListWidgetItem(header, list);
+            item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+            item->setCheckState(Qt::Unchecked);
+        }
+        return list;
+    };
+    QListWidget *groupList = makeColumnList();
+    QListWidget *valueList = makeColumnList();
+    layout->addWidget(new QLabel(tr("分组列:"), &dialog), 0, 0);
+    layout->addWidget(groupList, 1, 0);
+    layout->addWidget(new QLabel(tr("汇总列:"), &dialog), 0, 1);
+    layout->addWidget(valueList, 1, 1);
+    
+    // 每个勾选的汇总列计算所有勾选的函数
+    const QList<AggregateOptions::Function> functions = {
+        AggregateOptions::Count, AggregateOptions::Sum, AggregateOptions::Min, AggregateOptions::Max, AggregateOptions::Avg
+    };
+    const QStringList functionLabels = { tr("计数"), tr("求和"), tr("最小值"), tr("最大值"), tr("平均值") };
+    QHBoxLayout *functionLayout = new QHBoxLayout();
+    QList<QCheckBox *> functionBoxes;
+    for (const QString &label : functionLabels) {
+        QCheckBox *box = new QCheckBox(label, &dialog);
+        functionLayout->addWidget(box);
+        functionBoxes.append(box);
+    }
+    functionBoxes.at(1)->setChecked(true);
+    layout->addLayout(functionLayout, 2, 0, 1, 2);
+    
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons, 3, 0, 1, 2);
+    
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    AggregateOptions options;
+    for (int column = 0; column < source.headers.size(); ++column) {
+        if (groupList->item(column)->checkState() == Qt::Checked) {
+            options.groupColumns.append(column);
+        }
+    }
+    for (int column = 0; column < source.headers.size(); ++column) {
+        if (valueList->item(column)->checkState() != Qt::Checked) {
+            continue;
+        }
+        for (int i = 0; i < functions.size(); ++i) {
+            if (functionBoxes.at(i)->isChecked()) {
+                options.measures.append(AggregateOptions::Measure{column, functions.at(i)});
+            }
+        }
+    }
+    
+    // 不选分组列时汇总整个文件为一行
+    if (options.groupColumns.isEmpty() && options.measures.isEmpty()) {
+        QMessageBox::information(this, tr("提示"), tr("请至少选择一个分组列或汇总列"));
+        return;
+    }
+    
+    // 结果窗口持有自己的聚合器，关闭标签页不影响正在进行的汇总
+    AggregationWindow *resultWindow = new AggregationWindow(tr("分组汇总 - %1").arg(document->fileName()), source, options, this);
+    resultWindow->show();
+    statusBar()->showMessage(tr("正在对 %1 分组汇总 ...").arg(document->fileName()));
+}
+
+void MainWindow::compareFiles()
+{
+    CsvDocument *current = currentDocument();
+    if (!current) {
+        QMessageBox::information(this, tr("提示"), tr("请先打开CSV文件"));
+        return;
+    }
+    
+    // 只打开了一个文件时先选择另一个文件，在新标签页中打开
+    if (m_documents.size() < 2) {
+        const QString filePath = QFileDialog::getOpenFileName(this, tr("选择要比较的文件"),
+            QFileInfo(current->filePath()).absolutePath(), tr("CSV Files (*.csv);;All Files (*)"));
+        if (filePath.isEmpty()) {
+            return;
+        }
+        loadCsvFile(filePath);
+        if (m_documents.size() < 2) {
+            return;
+        }
+    }
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("比较文件"));
+    QGridLayout *layout = new QGridLayout(&dialog);
+    
+    // 默认把之前的文件作为旧文件，当前标签页的文件作为新文件
+    QComboBox *oldBox = new QComboBox(&dialog);
+    QComboBox *newBox = new QComboBox(&dialog);
+    for (CsvDocument *document : std::as_const(m_documents)) {
+        oldBox->addItem(document->fileName());
+        newBox->addItem(document->fileName());
+    }
+    const int newIndex = m_documents.indexOf(currentDocument());
+    int oldIndex = m_documents.indexOf(current);
+    if (oldIndex == newIndex) {
+        oldIndex = newIndex == 0 ? 1 : 0;
+    }
+    oldBox->setCurrentIndex(oldIndex);
+    newBox->setCurrentIndex(newIndex);
+    layout->addWidget(new QLabel(tr("旧文件:"), &dialog), 0, 0);
+    layout->addWidget(oldBox, 0, 1);
+    layout->addWidget(new QLabel(tr("新文件:"), &dialog), 1, 0);
+    layout->addWidget(newBox, 1, 1);
+    
+    // 键列只能从两个文件共有的列中选择
+    QListWidget *keyList = new QListWidget(&dialog);
+    layout->addWidget(new QLabel(tr("键列:"), &dialog), 2, 0, 1, 2);
+    layout->addWidget(keyList, 3, 0, 1, 2);
+    auto updateKeyList = [this, oldBox, newBox, keyList]() {
+        keyList->clear();
+        const QStringList oldHeaders = m_documents.at(oldBox->currentIndex())->reader()->getHeaders();
+        const QStringList newHeaders = m_documents.at(newBox->currentIndex())->reader()->getHeaders();
+        for (const QString &header : oldHeaders) {
+            if (!newHeaders.contains(header)) {
+                continue;
+            }
+            QListWidgetItem *item = new QListWidgetItem(header, keyList);
+            item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+            item->setCheckState(keyList->count() == 1 ? Qt::Checked : Qt::Unchecked);
+        }
+    };
+    updateKeyList();
+    connect(oldBox, &QComboBox::currentIndexChanged, &dialog, updateKeyList);
+    connect(newBox, &QComboBox::currentIndexChanged, &dialog, updateKeyList);
+    
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons, 4, 0, 1, 2);
+    
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    CsvDocument *oldDocument = m_documents.at(oldBox->currentIndex());
+    CsvDocument *newDocument = m_documents.at(newBox->currentIndex());
+    if (oldDocument == newDocument) {
+        QMessageBox::information(this, tr("提示"), tr("请选择两个不同的文件"));
+        return;
+    }
+    
+    DiffOptions options;
+    for (int i = 0; i < keyList->count(); ++i) {
+        if (keyList->item(i)->checkState() == Qt::Checked) {
+            options.keyColumns.append(keyList->item(i)->text());
+        }
+    }
+    if (options.keyColumns.isEmpty()) {
+        QMessageBox::information(this, tr("提示"), tr("请至少选择一个键列"));
+        return;
+    }
+    
+    // 比较需要并行访问两个文件的任意位置
+    DiffSource oldSource;
+    DiffSource newSource;
+    if (!oldDocument->aggregateSource(&oldSource) || !newDocument->aggregateSource(&newSource)
+        || oldSource.columnar || newSource.columnar) {
+        QMessageBox::information(this, tr("提示"), tr("比较只支持未压缩的CSV文件"));
+        return;
+    }
+    
+    // 结果窗口持有自己的比较器，关闭标签页不影响正在进行的比较
+    DiffWindow *resultWindow = new DiffWindow(tr("比较 - %1 → %2").arg(oldDocument->fileName(), newDocument->fileName()),
+                                              oldSource, newSource, options, this);
+    resultWindow->show();
+    statusBar()->showMessage(tr("正在比较 %1 和 %2 ...").arg(oldDocument->fileName(), newDocument->fileName()));
+}
+
+void MainWindow::editCsvFormat()
+{
+    CsvDocument *document = currentDocument();
+    if (!document) {
+        QMessageBox::information(this, tr("提示"), tr("请先打开CSV文件"));
+        return;
+    }
+    if (document->reader()->isColumnar()) {
+        QMessageBox::information(this, tr("提示"), tr("列式文件不需要设置CSV格式"));
+        return;
+    }
+    
+    const CsvFormat current = document->reader()->format();
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("CSV格式"));
+    QFormLayout *layout = new QFormLayout(&dialog);
+    
+    QCheckBox *autoDetectBox = new QCheckBox(tr("根据文件内容自动检测"), &dialog);
+    autoDetectBox->setChecked(!document->reader()->hasExplicitFormat());
+    layout->addRow(autoDetectBox);
+    
+    QComboBox *delimiterBox = new QComboBox(&dialog);
+    delimiterBox->addItem(tr("逗号 (,)"), int(','));
+    delimiterBox->addItem(tr("分号 (;)"), int(';'));
+    delimiterBox->addItem(tr("制表符"), int('\t'));
+    delimiterBox->addItem(tr("竖线 (|)"), int('|'));
+    delimiterBox->setCurrentIndex(qMax(0, delimiterBox->findData(int(current.delimiter))));
+    layout->addRow(tr("分隔符:"), delimiterBox);
+    
+    QComboBox *quoteBox = new QComboBox(&dialog);
+    quoteBox->addItem(tr("双引号 (\")"), int('"'));
+    quoteBox->addItem(tr("单引号 (')"), int('\''));
+    quoteBox->setCurrentIndex(qMax(0, quoteBox->findData(int(current.quoteChar))));
+    layout->addRow(tr("引号:"), quoteBox);
+    
+    QCheckBox *headerBox = new QCheckBox(tr("第一行是表头"), &dialog);
+    headerBox->setChecked(current.hasHeader);
+    layout->addRow(headerBox);
+    
+    QLineEdit *commentEdit = new QLineEdit(&dialog);
+    commentEdit->setMaxLength(1);
+    commentEdit->setPlaceholderText(tr("无"));
+    commentEdit->setText(current.commentChar ? QString(QChar::fromLatin1(current.commentChar)) : QString());
+    layout->addRow(tr("注释行开头字符:"), commentEdit);
+    
+    // 自动检测时显示检测结果，不能编辑
+    auto updateEnabled = [=](bool autoDetect) {
+        delimiterBox->setEnabled(!autoDetect);
+        quoteBox->setEnabled(!autoDetect);
+        headerBox->setEnabled(!autoDetect);
+        commentEdit->setEnabled(!autoDetect);
+    };
+    updateEnabled(autoDetectBox->isChecked());
+    connect(autoDetectBox, &QCheckBox::toggled, &dialog, updateEnabled);
+    
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addRow(buttons);
+    
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    if (autoDetectBox->isChecked()) {
+        document->reader()->setFormatAutoDetect();
+    } else {
+        CsvFormat format;
+        format.delimiter = static_cast<char>(delimiterBox->currentData().toInt());
+        format.quoteChar = static_cast<char>(quoteBox->currentData().toInt());
+        format.hasHeader = headerBox->isChecked();
+        const QString comment = commentEdit->text();
+        format.commentChar = (!comment.isEmpty() && comment.at(0).unicode() < 0x80) ? comment.at(0).toLatin1() : '\0';
+        document->reader()->setFormat(format);
+    }
+    
+    // 以新的方言重新加载当前文件，编码保持不变
+    if (!reloadDocument(document, document->reader()->getEncoding())) {
+        return;
+    }
+    statusBar()->showMessage(tr("CSV格式: %1").arg(document->reader()->format().description()));
+}
+
 void MainWindow::reloadCurrentFileIfNeeded()
 {
-    // 如果当前已经打开了文件，则重新加载
-    if (!m_currentFilePath.isEmpty()) {
-        loadCsvFile(m_currentFilePath);
+    // 如果当前已经打开了文件，则以新的编码重新加载；其他标签页保持原来的编码
+    CsvDocument *document = currentDocument();
+    if (!document) {
+        return;
+    }
+    
+    reloadDocument(document, m_encoding);
+}
+
+bool MainWindow::reloadDocument(CsvDocument *document, CsvReader::Encoding encoding)
+{
+    m_searchLineEdit->clear();
+    if (!document->reload(encoding)) {
+        QString error = QString("Failed to load file: %1\nError: %2")
+            .arg(document->filePath())
+            .arg(document->lastError());
+        qDebug() << error;
+        QMessageBox::critical(this, tr("Error"), error);
+        return false;
     }
+    return true;
 }
 
 void MainWindow::loadCsvFile(const QString &filePath)
@@ -171,125 +825,187 @@ void MainWindow::loadCsvFile(const QString &filePath)
     QString absolutePath = fileInfo.absoluteFilePath();
     qDebug() << "Absolute file path:" << absolutePath;
     
-    // 保存当前文件路径，用于可能的重新加载
-    m_currentFilePath = absolutePath;
-    
-    // 重置当前已加载行数
-    m_currentLoadedRows = 0;
+    // 文件已经打开时切换到对应的标签页
+    for (int i = 0; i < m_documents.size(); ++i) {
+        if (m_documents.at(i)->filePath() == absolutePath) {
+            ui->tabWidget->setCurrentIndex(i);
+            return;
+        }
+    }
     
     // 尝试加载文件
-    if (m_csvReader->loadFile(absolutePath)) {
-        displayCsvData(false); // 默认不加载全部数据
-        setWindowTitle(QString("CSV Viewer - %1").arg(fileInfo.fileName()));
-    } else {
+    CsvDocument *document = new CsvDocument(this);
+    document->reader()->setTolerant(m_tolerantParsing);
+    connect(document, &CsvDocument::facetsChanged, this, [this, document]() {
+        if (document == currentDocument()) {
+            showFacets();
+        }
+    });
+    connect(document, &CsvDocument::facetsProgress, this, [this, document](qint64 done, qint64 total) {
+        if (document == currentDocument() && total > 0) {
+            m_facetLabel->setText(tr("正在统计整个文件的值分布 ... %1%").arg(done * 100 / total));
+        }
+    });
+    connect(document, &CsvDocument::statusMessage, this, [this, document](const QString &message) {
+        // 只显示当前标签页的消息
+        if (document == currentDocument()) {
+            statusBar()->showMessage(message);
+        }
+    });
+    
+    if (!document->load(absolutePath, m_encoding)) {
         QString error = QString("Failed to load file: %1\nError: %2")
             .arg(filePath)
-            .arg(m_csvReader->getLastError());
+            .arg(document->lastError());
         qDebug() << error;
+        delete document;
         QMessageBox::critical(this, tr("Error"), error);
+        return;
     }
+    
+    m_documents.append(document);
+    const int index = ui->tabWidget->addTab(document->widget(), fileInfo.fileName());
+    ui->tabWidget->setTabToolTip(index, absolutePath);
+    ui->tabWidget->setCurrentIndex(index);
+    statusBar()->showMessage(tr("请在左侧选择要显示的列，然后点击'筛选'按钮"));
 }
 
-void MainWindow::displayCsvData(bool loadAll)
+void MainWindow::closeDocument(int index)
 {
-    // 计时：整个UI显示过程
-    QElapsedTimer uiDisplayTimer;
-    uiDisplayTimer.start();
+    if (index < 0 || index >= m_documents.size()) {
+        return;
+    }
     
-    // 清空现有数据
-    m_tableModel->clear();
-    m_currentLoadedRows = 0;
+    CsvDocument *document = m_documents.takeAt(index);
+    ui->tabWidget->removeTab(index);
+    delete document;
+}
+
+void MainWindow::onCurrentTabChanged(int index)
+{
+    CsvDocument *document = (index >= 0 && index < m_documents.size()) ? m_documents.at(index) : nullptr;
     
-    // 重置筛选状态
-    resetFilterPanel();
+    // 筛选面板始终显示当前文件的列，各文件的勾选状态保存在各自的列表模型中
+    m_searchLineEdit->clear();
+    m_columnProxyModel->setSourceModel(document ? document->columnListModel() : nullptr);
+    showFacets();
+    
+    // 后台标签页没有视口，内存不足时先淘汰它们的页
+    for (CsvDocument *other : m_documents) {
+        other->setActive(other == document);
+    }
     
-    // 保存表头和原始数据
-    QStringList headers = m_csvReader->getHeaders();
+    if (document) {
+        setWindowTitle(QString("CSV Viewer - %1").arg(document->fileName()));
+    } else {
+        setWindowTitle(QString("CSV Viewer"));
+        statusBar()->showMessage(tr("请打开CSV文件，然后使用左侧面板筛选列"));
+    }
+}
+
+CsvDocument *MainWindow::currentDocument() const
+{
+    const int index = ui->tabWidget->currentIndex();
+    return (index >= 0 && index < m_documents.size()) ? m_documents.at(index) : nullptr;
+}
+
+void MainWindow::createNavigationMenu()
+{
+    // 创建导航菜单
+    QMenu *navigationMenu = new QMenu(tr("导航"), this);
+    ui->menubar->addMenu(navigationMenu);
     
-    // 设置表头
-    m_tableModel->setHeaders(headers);
+    QAction *gotoRowAction = navigationMenu->addAction(tr("跳转到行..."));
+    gotoRowAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_G));
+    connect(gotoRowAction, &QAction::triggered, this, &MainWindow::gotoRow);
     
-    // 获取要加载的行数
-    int totalRows = m_csvReader->getRowCount();
-    int rowsToLoad = loadAll ? totalRows : qMin(DEFAULT_ROWS_LIMIT, totalRows);
+    QAction *gotoPercentageAction = navigationMenu->addAction(tr("跳转到百分比..."));
+    connect(gotoPercentageAction, &QAction::triggered, this, &MainWindow::gotoPercentage);
     
-    // 保存原始数据并直接加载到表格模型中
-    if (rowsToLoad > 0) {
-        m_originalData = m_csvReader->getRowsRange(0, rowsToLoad);
-        m_currentLoadedRows = rowsToLoad;
-        m_tableModel->addRows(m_originalData);
+    QAction *nextMalformedAction = navigationMenu->addAction(tr("下一个格式错误的行"));
+    nextMalformedAction->setShortcut(QKeySequence(Qt::Key_F8));
+    connect(nextMalformedAction, &QAction::triggered, this, &MainWindow::gotoNextMalformedRow);
+}
+
+void MainWindow::gotoNextMalformedRow()
+{
+    CsvDocument *document = currentDocument();
+    if (!document || !document->isFiltered()) {
+        QMessageBox::information(this, tr("提示"), tr("请先打开文件并筛选要显示的列"));
+        return;
     }
     
-    // 设置筛选面板
-    setupFilterPanel(headers);
+    if (!document->reader()->supportsRandomAccess()) {
+        QMessageBox::information(this, tr("提示"), tr("该zstd压缩文件没有第一帧以外的帧边界，每次跳转都要从头解压，不支持跳转；请用支持随机访问的格式（如seekable zstd或gzip）压缩"));
+        return;
+    }
     
-    // 初始时隐藏所有列，直到用户点击筛选按钮
-    for (int i = 0; i < headers.size(); ++i) {
-        ui->tableView->setColumnHidden(i, true);
+    if (!document->jumpToNextMalformedRow()) {
+        statusBar()->showMessage(tr("当前位置之后没有已发现的格式错误行（只检查已经加载过的数据）"));
+    }
+}
+
+void MainWindow::gotoRow()
+{
+    CsvDocument *document = currentDocument();
+    if (!document || !document->isFiltered()) {
+        QMessageBox::information(this, tr("提示"), tr("请先打开文件并筛选要显示的列"));
+        return;
     }
     
-    // 隐藏表格，直到用户点击筛选按钮
-    ui->tableView->setVisible(false);
-    statusBar()->showMessage(tr("请在左侧选择要显示的列，然后点击'筛选'按钮"));
+    if (!document->reader()->supportsRandomAccess()) {
+        QMessageBox::information(this, tr("提示"), tr("该zstd压缩文件没有第一帧以外的帧边界，每次跳转都要从头解压，不支持跳转；请用支持随机访问的格式（如seekable zstd或gzip）压缩"));
+        return;
+    }
     
-    qint64 uiDisplayTime = uiDisplayTimer.elapsed();
-    qDebug() << "UI display time (loading all data):" << uiDisplayTime << "ms";
-}
-
-void MainWindow::loadMoreRows()
-{
-    // 检查是否还有未加载的数据（使用CsvReader的延迟加载功能）
-    if (!m_csvReader->hasMoreData()) {
-        return; // 已经加载了所有数据或没有更多数据可加载
-    }
-    
-    // 计时：加载更多数据的过程
-    QElapsedTimer loadMoreTimer;
-    loadMoreTimer.start();
-    
-    // 定义每次加载的行数
-    const int ROWS_PER_LOAD = DEFAULT_ROWS_LIMIT / 4; // 每次加载默认限制的四分之一
-    
-    // 加载更多数据行
-    if (m_csvReader->loadMoreRows(ROWS_PER_LOAD)) {
-        // 获取已加载数据的总行数
-        int totalRows = m_csvReader->getRowCount();
-        
-        // 计算新加载的行数
-        int newlyLoadedRows = totalRows - m_currentLoadedRows;
-        
-        if (newlyLoadedRows > 0) {
-            // 获取新加载的原始数据行
-            QList<QStringList> moreOriginalRows = m_csvReader->getRowsRange(m_currentLoadedRows, newlyLoadedRows);
-            
-            // 将新加载的行添加到原始数据中
-            m_originalData.append(moreOriginalRows);
-            m_currentLoadedRows = totalRows;
-            
-            // 直接添加到表格模型中，列的可见性已经通过setColumnHidden设置
-            m_tableModel->addRows(moreOriginalRows);
-            
-            qint64 loadMoreTime = loadMoreTimer.elapsed();
-            qDebug() << "Loaded additional" << newlyLoadedRows << "rows in" << loadMoreTime << "ms";
-        }
-    } else {
-        qDebug() << "Failed to load more rows: " << m_csvReader->getLastError();
+    bool ok = false;
+    const int rowCount = document->model()->rowCount();
+    const int row = QInputDialog::getInt(this, tr("跳转到行"),
+        tr("行号 (1 - %1%2):").arg(rowCount).arg(document->reader()->isRowCountExact() ? QString() : tr("，估算")),
+        document->currentRow() + 1, 1, qMax(rowCount, 1), 1, &ok);
+    if (ok) {
+        document->jumpToRow(row - 1);
     }
 }
 
-void MainWindow::setupFilterPanel(const QStringList &headers)
+void MainWindow::gotoPercentage()
 {
-    // 清空现有布局中的所有组件
-    resetFilterPanel();
+    CsvDocument *document = currentDocument();
+    if (!document || !document->isFiltered()) {
+        QMessageBox::information(this, tr("提示"), tr("请先打开文件并筛选要显示的列"));
+        return;
+    }
     
-    // 创建筛选布局
+    if (!document->reader()->supportsRandomAccess()) {
+        QMessageBox::information(this, tr("提示"), tr("该zstd压缩文件没有第一帧以外的帧边界，每次跳转都要从头解压，不支持跳转；请用支持随机访问的格式（如seekable zstd或gzip）压缩"));
+        return;
+    }
+    
+    bool ok = false;
+    const double percentage = QInputDialog::getDouble(this, tr("跳转到百分比"),
+        tr("文件位置 (%):"), 50.0, 0.0, 100.0, 2, &ok);
+    if (ok) {
+        const int lastRow = qMax(document->model()->rowCount() - 1, 0);
+        document->jumpToRow(qRound(lastRow * percentage / 100.0));
+    }
+}
+
+void MainWindow::createFilterPanel()
+{
+    // 筛选面板的控件只创建一次，切换标签页时只替换代理的源模型
     QVBoxLayout *filterLayout = qobject_cast<QVBoxLayout*>(ui->filterContentWidget->layout());
     if (!filterLayout) {
         filterLayout = new QVBoxLayout(ui->filterContentWidget);
         ui->filterContentWidget->setLayout(filterLayout);
     }
     
-    // 增加筛选面板最小宽度，确保复选框文本完整显示
+    // 移除设计器中的占位伸缩项，列表占满剩余空间
+    QLayoutItem *item;
+    while ((item = filterLayout->takeAt(0)) != nullptr) {
+        delete item;
+    }
+    
+    // 增加筛选面板最小宽度，确保列名完整显示
     ui->filterDockWidget->setMinimumWidth(180);
     ui->filterContentWidget->setMinimumWidth(170);
     
@@ -297,10 +1013,11 @@ void MainWindow::setupFilterPanel(const QStringList &headers)
     m_searchLineEdit = new QLineEdit(this);
     m_searchLineEdit->setPlaceholderText(tr("搜索列名..."));
     m_searchLineEdit->setMinimumWidth(150);
+    m_searchLineEdit->setClearButtonEnabled(true);
     filterLayout->addWidget(m_searchLineEdit);
     
     // 连接搜索框的文本变化信号
-    connect(m_searchLineEdit, &QLineEdit::textChanged, this, &MainWindow::filterCheckboxes);
+    connect(m_searchLineEdit, &QLineEdit::textChanged, this, &MainWindow::filterColumnList);
     
     // 添加全选和清空按钮
     QHBoxLayout *controlButtonsLayout = new QHBoxLayout();
@@ -326,112 +1043,119 @@ void MainWindow::setupFilterPanel(const QStringList &headers)
     
     filterLayout->addLayout(controlButtonsLayout);
     
-    // 添加列复选框
-    for (int i = 0; i < headers.size(); ++i) {
-        QCheckBox *checkBox = new QCheckBox(headers[i], this);
-        checkBox->setChecked(true); // 默认选中所有列
-        checkBox->setObjectName(QString("columnCheckBox_%1").arg(i));
-        // 设置复选框的尺寸策略，确保文本不会被截断
-        checkBox->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-        checkBox->setMinimumWidth(150); // 确保有足够的宽度显示文本
-        filterLayout->addWidget(checkBox);
-        
-        // 存储复选框及其状态
-        m_columnCheckboxes.append(qMakePair(checkBox, true));
-    }
-    
-
-    
-    // 添加一个伸缩项，确保所有复选框都显示在顶部
-    filterLayout->addStretch();
+    // 列名列表：当前文件的勾选模型 + 搜索代理，视图只绘制可见的几行
+    m_columnProxyModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    
+    m_columnListView = new QListView(this);
+    m_columnListView->setModel(m_columnProxyModel);
+    m_columnListView->setUniformItemSizes(true); // 所有项等高，滚动时无需逐项计算尺寸
+    m_columnListView->setMinimumWidth(150);
+    m_columnListView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    filterLayout->addWidget(m_columnListView, 1);
+    
+    // 值分布：点击列名时显示该列在整个文件中出现最多的值，点击值按值筛选行
+    m_facetLabel = new QLabel(tr("点击列名查看值分布"), this);
+    m_facetLabel->setWordWrap(true);
+    filterLayout->addWidget(m_facetLabel);
+    
+    m_facetList = new QListWidget(this);
+    m_facetList->setMinimumWidth(150);
+    m_facetList->setUniformItemSizes(true);
+    filterLayout->addWidget(m_facetList, 1);
+    
+    m_clearRowFilterButton = new QPushButton(tr("取消按值筛选"), this);
+    m_clearRowFilterButton->setEnabled(false);
+    filterLayout->addWidget(m_clearRowFilterButton);
+    
+    connect(m_columnListView, &QListView::clicked, this, &MainWindow::showFacets);
+    connect(m_facetList, &QListWidget::itemClicked, this, &MainWindow::onFacetClicked);
+    connect(m_clearRowFilterButton, &QPushButton::clicked, this, [this]() {
+        if (CsvDocument *document = currentDocument()) {
+            document->clearRowFilter();
+        }
+    });
 }
 
-void MainWindow::filterCheckboxes(const QString &text)
+void MainWindow::showFacets()
 {
-    // 如果搜索文本为空，显示所有复选框
-    if (text.isEmpty()) {
-        for (auto &pair : m_columnCheckboxes) {
-            pair.first->setVisible(true);
-        }
+    // 启动时标签页可能先于筛选面板创建
+    if (!m_facetList) {
+        return;
+    }
+    
+    m_facetList->clear();
+    CsvDocument *document = currentDocument();
+    m_clearRowFilterButton->setEnabled(document && document->hasRowFilter());
+    const QModelIndex index = m_columnListView->currentIndex();
+    if (!document || !index.isValid()) {
+        m_facetLabel->setText(tr("点击列名查看值分布"));
+        return;
+    }
+    
+    const int column = m_columnProxyModel->mapToSource(index).row();
+    const QString header = document->columnName(column);
+    if (column >= document->reader()->getHeaders().size()) {
+        m_facetLabel->setText(tr("计算列 %1 不统计值分布，条件计算列可在分析菜单中筛选行").arg(header));
+        return;
+    }
+    if (!document->requestFacets()) {
+        m_facetLabel->setText(tr("压缩文件和列式文件不支持值分布"));
+        return;
+    }
+    if (!document->facetIndex()->hasFacets()) {
+        m_facetLabel->setText(tr("正在统计整个文件的值分布 ..."));
         return;
     }
     
-    // 否则，只显示包含搜索文本的复选框
-    QString searchText = text.toLower();
-    for (auto &pair : m_columnCheckboxes) {
-        QString checkboxText = pair.first->text().toLower();
-        bool matches = checkboxText.contains(searchText);
-        pair.first->setVisible(matches);
+    // 计数不精确（值的种类超过摘要容量）时标出是上界
+    m_facetLabel->setText(tr("%1 出现最多的值:").arg(header));
+    const bool filteredColumn = document->rowFilterColumn() == column;
+    for (const Facet &facet : document->facetIndex()->facets(column)) {
+        const QString text = facet.text.isEmpty() ? tr("(空)") : facet.text;
+        QListWidgetItem *item = new QListWidgetItem(
+            QString("%1  (%2%3)").arg(text, facet.exact ? QString() : QString("≤"), QString::number(facet.count)), m_facetList);
+        item->setData(Qt::UserRole, column);
+        item->setData(Qt::UserRole + 1, facet.value);
+        item->setToolTip(text);
+        if (filteredColumn && facet.value == document->rowFilterValue()) {
+            QFont font = item->font();
+            font.setBold(true);
+            item->setFont(font);
+        }
     }
 }
 
-void MainWindow::resetFilterPanel()
+void MainWindow::onFacetClicked(QListWidgetItem *item)
 {
-    // 清除所有复选框
-    for (auto &pair : m_columnCheckboxes) {
-        delete pair.first;
+    CsvDocument *document = currentDocument();
+    if (!document || !item) {
+        return;
     }
-    m_columnCheckboxes.clear();
     
-    // 清除筛选状态
-    m_isFiltered = false;
-    m_filteredHeaders.clear();
-    
-    // 清空布局
-    QVBoxLayout *filterLayout = qobject_cast<QVBoxLayout*>(ui->filterContentWidget->layout());
-    if (filterLayout) {
-        QLayoutItem *item;
-        while ((item = filterLayout->takeAt(0)) != nullptr) {
-            if (item->widget()) {
-                delete item->widget();
-            }
-            delete item;
-        }
+    // 按值筛选的是行，需要先筛选出要显示的列
+    if (!document->isFiltered()) {
+        document->applyFilter();
     }
+    document->setRowFilter(item->data(Qt::UserRole).toInt(), item->data(Qt::UserRole + 1).toByteArray());
 }
 
-void MainWindow::applyFilter()
+void MainWindow::filterColumnList(const QString &text)
 {
-    // 收集选中的列
-    m_filteredHeaders.clear();
-    QVector<int> visibleColumns;
-    qDebug() << "Colum" << ui->tableView->model()->columnCount();
-    for (int i = 0; i < m_columnCheckboxes.size(); ++i) {
-        bool isVisible = m_columnCheckboxes[i].first->isChecked();
+    // 只显示包含搜索文本的列名，空文本显示所有列
+    m_columnProxyModel->setFilterFixedString(text);
+}
 
-        if (isVisible) {
-            m_filteredHeaders.append(m_columnCheckboxes[i].first->text());
-            visibleColumns.append(i);
-        }
-        ui->tableView->setColumnHidden(i, !isVisible); // 通过隐藏/显示列实现筛选
+void MainWindow::applyFilter()
+{
+    CsvDocument *document = currentDocument();
+    if (!document) {
+        return;
     }
-
     
     // 如果没有选中任何列，显示提示
-    if (m_filteredHeaders.isEmpty()) {
+    if (!document->applyFilter()) {
         QMessageBox::information(this, tr("提示"), tr("请至少选择一列"));
-        return;
     }
-    
-    // 更新筛选状态
-    m_isFiltered = true;
-    
-    // 更新表头，确保表头与可见列一致
-    //m_tableModel->setHeaders(m_filteredHeaders);
-    
-    // 显示表格
-    ui->tableView->setVisible(true);
-    
-    // 优化列宽调整：大幅减少需要调整的列数，提高性能
-    int columnCount = m_tableModel->columnCount();
-    int columnsToResize = qMin(columnCount, 10); // 只调整前10列，显著提高性能
-    for (int i = 0; i < columnsToResize; ++i) {
-        if (!ui->tableView->isColumnHidden(i)) {
-            ui->tableView->resizeColumnToContents(i);
-        }
-    }
-    
-    statusBar()->showMessage(tr("已筛选显示 %1 列数据").arg(m_filteredHeaders.size()));
 }
 
 /*
@@ -450,12 +1174,7 @@ void MainWindow::updateFilteredColumns()
     m_tableModel->setHeaders(m_filteredHeaders);
     
     // 收集选中的列索引并确保与m_filteredHeaders一致
-    QVector<int> selectedColumns;
-    for (int i = 0; i < m_columnCheckboxes.size(); ++i) {
-        if (m_columnCheckboxes[i].first->isChecked()) {
-            selectedColumns.append(i);
-        }
-    }
+    QVector<int> selectedColumns = m_columnListModel->checkedColumns();
     
     // 筛选数据行
     QList<QStringList> filteredRows;
@@ -495,17 +1214,15 @@ void MainWindow::updateFilteredColumns()
 
 void MainWindow::selectAllColumns()
 {
-    for (auto &pair : m_columnCheckboxes) {
-        pair.first->setChecked(true);
-        pair.second = true;
+    if (CsvDocument *document = currentDocument()) {
+        document->columnListModel()->setAllChecked(true);
     }
 }
 
 void MainWindow::clearAllColumns()
 {
-    for (auto &pair : m_columnCheckboxes) {
-        pair.first->setChecked(false);
-        pair.second = false;
+    if (CsvDocument *document = currentDocument()) {
+        document->columnListModel()->setAllChecked(false);
     }
 }
 
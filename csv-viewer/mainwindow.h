@@ -7,12 +7,16 @@
 #include <QAction>
 #include <QActionGroup>
 #include <QTableView>
-#include <QCheckBox>
-#include <QVector>
-#include <QPair>
+#include <QLineEdit>
+#include <QListView>
+#include <QLabel>
+#include <QListWidget>
+#include <QPushButton>
+#include <QSortFilterProxyModel>
+#include <QList>
 
 #include "CsvReader.h"
-#include "TableModel.h"
+#include "CsvDocument.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -26,12 +30,45 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 打开命令行指定的文件并直接显示数据：columns为空时显示所有列，row大于0时跳转到该行（从1开始）
+    void openFromCommandLine(const QString &filePath, const QStringList &columns, int row);
+
 private slots:
     // 打开文件槽函数
     void openFile();
     
-    // 加载更多行数据
-    void loadMoreRows();
+    // 将当前文件筛选后的列（和选中的行）导出为新文件
+    void exportView();
+    
+    // 设置当前文件的CSV格式（分隔符、引号、表头、注释行）
+    void editCsvFormat();
+    
+    // 把选中的单元格以TSV格式复制到剪贴板
+    void copySelection();
+    
+    // 对当前文件按若干列分组汇总，结果显示在单独的窗口中
+    void groupBy();
+    
+    // 按键列比较两个文件，新增、删除和修改的行显示在单独的窗口中
+    void compareFiles();
+    
+    // 用表达式定义计算列，追加到当前文件的列中
+    void addComputedColumn();
+    
+    // 只显示某个条件计算列为真的行
+    void filterByComputedColumn();
+    
+    // 设置所有文件共用的内存上限
+    void setMemoryBudget();
+    
+    // 跳转到指定行
+    void gotoRow();
+    
+    // 跳转到文件的指定百分比位置
+    void gotoPercentage();
+    
+    // 跳转到下一个格式错误的行
+    void gotoNextMalformedRow();
     
     // 处理筛选按钮点击
     void applyFilter();
@@ -45,50 +82,81 @@ private slots:
     // 切换筛选面板的显示/隐藏状态
     void toggleFilterPanel(bool visible);
     
-    // 根据输入过滤复选框显示
-    void filterCheckboxes(const QString &text);
+    // 根据输入过滤列名列表
+    void filterColumnList(const QString &text);
 
 private:
-    // 加载CSV文件
+    // 在新标签页中打开CSV文件，文件已打开时切换到对应的标签页
     void loadCsvFile(const QString &filePath);
     
-    // 显示CSV数据
-    void displayCsvData(bool loadAll = false);
+    // 关闭标签页并释放该文件的所有数据
+    void closeDocument(int index);
+    
+    // 切换标签页时将筛选面板和窗口标题绑定到当前文件
+    void onCurrentTabChanged(int index);
+    
+    // 当前标签页对应的文档，没有打开文件时返回nullptr
+    CsvDocument *currentDocument() const;
+    
+    // 创建导航菜单（跳转到行/百分比）
+    void createNavigationMenu();
     
     // 创建编码选择菜单
     void createEncodingMenu();
     
+    // 创建CSV格式菜单
+    void createFormatMenu();
+    
+    // 创建编辑菜单（复制）
+    void createEditMenu();
+    
+    // 创建分析菜单
+    void createAnalysisMenu();
+    
+    // 在状态栏中显示内存占用，并添加设置内存上限的菜单项
+    void createMemoryIndicator();
+    
     // 在编码变更时重新加载当前文件（如果有）
     void reloadCurrentFileIfNeeded();
     
-    // 设置筛选面板
-    void setupFilterPanel(const QStringList &headers);
+    // 以指定编码重新加载文档，失败时提示错误
+    bool reloadDocument(CsvDocument *document, CsvReader::Encoding encoding);
+    
+    // 创建筛选面板的控件（只在启动时创建一次）
+    void createFilterPanel();
+    
+    // 在筛选面板中显示当前文件当前列出现最多的值，第一次显示时在后台统计整个文件
+    void showFacets();
+    
+    // 按点击的值筛选行，再次点击当前筛选的值时取消
+    void onFacetClicked(QListWidgetItem *item);
     
     // 更新表格显示以反映筛选结果
     void updateFilteredColumns();
     
-    // 重置筛选面板
-    void resetFilterPanel();
-    
     // 搜索输入框
     QLineEdit *m_searchLineEdit = nullptr;
+    
+    // 列名列表
+    QListView *m_columnListView = nullptr;
+    
+    // 当前列的值分布（值和出现次数），点击按值筛选行
+    QLabel *m_facetLabel = nullptr;
+    QListWidget *m_facetList = nullptr;
+    QPushButton *m_clearRowFilterButton = nullptr;
+    
+    // 状态栏中的内存占用
+    QLabel *m_memoryLabel = nullptr;
 
     Ui::MainWindow *ui;
-    CsvReader *m_csvReader;
-    TableModel *m_tableModel;
-    
-    // 性能优化相关成员
-    const int DEFAULT_ROWS_LIMIT = 5000; // 默认初始加载行数限制
-    int m_currentLoadedRows = 0; // 当前已加载的行数
+    QList<CsvDocument *> m_documents; // 与标签页顺序一致
+    QSortFilterProxyModel *m_columnProxyModel; // 按搜索文本过滤当前文件的列名
     
-    // 当前打开的文件路径，用于编码变更时重新加载
-    QString m_currentFilePath;
+    // 新打开的文件使用的编码，与CsvReader的默认编码一致
+    CsvReader::Encoding m_encoding = CsvReader::GBK;
     
-    // 筛选相关成员
-    QVector<QPair<QCheckBox*, bool>> m_columnCheckboxes; // 存储列复选框及其状态
-    QStringList m_filteredHeaders; // 存储筛选后的表头
-    QList<QStringList> m_originalData; // 存储原始数据用于筛选
-    bool m_isFiltered = false; // 标记是否处于筛选状态
+    // 新打开的文件是否使用容错解析
+    bool m_tolerantParsing = true;
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file